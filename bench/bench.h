@@ -0,0 +1,164 @@
+/*
+ * NAH benchmark harness
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * A deliberately small timing loop for nah-bench. Each benchmark is a
+ * callable returning a size_t; the values are folded into a volatile sink so
+ * the measured work can't be optimized away.
+ *
+ *     Runner runner(options);
+ *     runner.run("semver/parse_range", [&] {
+ *         return nah::semver::parse_range(">=1.2.0 <2.0.0")->sets.size();
+ *     });
+ *     std::cout << to_json(runner.results(), NAH_VERSION).dump(2);
+ *
+ * Iterations are doubled until a batch takes at least min_time, and the
+ * reported time is that batch's mean. Results serialize to JSON, and
+ * compare() matches a run against a saved baseline by name.
+ */
+
+#ifndef NAH_BENCH_H
+#define NAH_BENCH_H
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nah {
+namespace bench {
+
+constexpr int REPORT_FORMAT_VERSION = 1;
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double ns_per_op = 0;
+};
+
+struct Options {
+    double min_time_ms = 200;
+    std::string filter;  ///< Only run benchmarks whose name contains this
+};
+
+class Runner {
+public:
+    explicit Runner(Options options) : options_(std::move(options)) {}
+
+    bool selected(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    template <typename Fn>
+    void run(const std::string& name, Fn&& fn) {
+        if (!selected(name)) {
+            return;
+        }
+
+        sink_ = sink_ + fn();  // warm up
+
+        using clock = std::chrono::steady_clock;
+        const auto min_time = std::chrono::duration<double, std::milli>(options_.min_time_ms);
+        std::uint64_t iterations = 1;
+        for (;;) {
+            auto start = clock::now();
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                sink_ = sink_ + fn();
+            }
+            std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+            if (elapsed >= min_time || iterations >= (std::uint64_t{1} << 40)) {
+                results_.push_back({name, iterations, elapsed.count() / static_cast<double>(iterations)});
+                std::fprintf(stderr, "%-56s %14.1f ns/op %12llu iterations\n", name.c_str(),
+                             results_.back().ns_per_op, static_cast<unsigned long long>(iterations));
+                return;
+            }
+            iterations *= 2;
+        }
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    Options options_;
+    std::vector<Result> results_;
+    volatile std::size_t sink_ = 0;
+};
+
+inline nlohmann::json to_json(const std::vector<Result>& results, const std::string& version) {
+    nlohmann::json report;
+    report["format_version"] = REPORT_FORMAT_VERSION;
+    report["nah_version"] = version;
+    report["benchmarks"] = nlohmann::json::array();
+    for (const auto& r : results) {
+        report["benchmarks"].push_back({
+            {"name", r.name},
+            {"iterations", r.iterations},
+            {"ns_per_op", r.ns_per_op},
+        });
+    }
+    return report;
+}
+
+// Parse a report written by to_json(); nullopt if it isn't one
+inline std::optional<std::vector<Result>> from_json(const std::string& text) {
+    auto report = nlohmann::json::parse(text, nullptr, false);
+    if (report.is_discarded() || !report.is_object() ||
+        report.value("format_version", 0) != REPORT_FORMAT_VERSION ||
+        !report.contains("benchmarks") || !report["benchmarks"].is_array()) {
+        return std::nullopt;
+    }
+
+    std::vector<Result> results;
+    for (const auto& b : report["benchmarks"]) {
+        if (!b.is_object() || !b.contains("name") || !b["name"].is_string() ||
+            !b.contains("ns_per_op") || !b["ns_per_op"].is_number()) {
+            return std::nullopt;
+        }
+        results.push_back({b["name"].get<std::string>(), b.value("iterations", std::uint64_t{0}),
+                           b["ns_per_op"].get<double>()});
+    }
+    return results;
+}
+
+struct Comparison {
+    std::string name;
+    double baseline_ns = 0;
+    double current_ns = 0;
+    double change_pct = 0;   ///< Positive = slower than baseline
+    bool regressed = false;
+};
+
+// Match current results against a baseline by name. Benchmarks missing from
+// either side are skipped; a benchmark regresses when it is more than
+// threshold_pct slower.
+inline std::vector<Comparison> compare(const std::vector<Result>& baseline,
+                                       const std::vector<Result>& current,
+                                       double threshold_pct) {
+    std::vector<Comparison> comparisons;
+    for (const auto& cur : current) {
+        for (const auto& base : baseline) {
+            if (base.name != cur.name || base.ns_per_op <= 0) {
+                continue;
+            }
+            Comparison c;
+            c.name = cur.name;
+            c.baseline_ns = base.ns_per_op;
+            c.current_ns = cur.ns_per_op;
+            c.change_pct = (cur.ns_per_op - base.ns_per_op) / base.ns_per_op * 100.0;
+            c.regressed = c.change_pct > threshold_pct;
+            comparisons.push_back(c);
+            break;
+        }
+    }
+    return comparisons;
+}
+
+} // namespace bench
+} // namespace nah
+
+#endif // NAH_BENCH_H
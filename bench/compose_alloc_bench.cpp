@@ -0,0 +1,192 @@
+/*
+ * Allocation benchmark for nah_compose()
+ *
+ * Composes a representative app (a NAK with a loader, 50 environment
+ * variables across all layers, placeholder-bearing arguments) and reports
+ * how many times the global heap is hit per composition:
+ *
+ *   default     - everything on the heap
+ *   monotonic   - scratch state in a monotonic_buffer_resource that is
+ *                 released after every composition
+ *
+ * Usage: nah-bench-alloc [iterations]
+ */
+
+#include <nah/nah_core.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+} // namespace
+
+// Count every global allocation. GCC pairs the inlined free() below with the
+// operator new calls it can see and reports a mismatch that isn't one.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using namespace nah::core;
+
+// Default memory resource that counts what pmr containers draw from the
+// heap; new_delete_resource() goes through aligned operator new, which the
+// replacement above doesn't see
+class CountingResource : public std::pmr::memory_resource {
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+struct Inputs {
+    AppDeclaration app;
+    HostEnvironment host_env;
+    InstallRecord install;
+    RuntimeInventory inventory;
+};
+
+Inputs make_inputs() {
+    Inputs in;
+
+    in.app.id = "com.example.bench";
+    in.app.version = "1.0.0";
+    in.app.nak_id = "lua";
+    in.app.nak_version_req = ">=5.4.0";
+    in.app.entrypoint_path = "bin/main.lua";
+    in.app.entrypoint_args = {"--data={NAH_APP_ROOT}/data", "--verbose"};
+    in.app.lib_dirs = {"lib"};
+    for (int i = 0; i < 10; i++) {
+        in.app.env_vars.push_back("APP_VAR_" + std::to_string(i) + "={NAH_APP_ROOT}/share/" +
+                                  std::to_string(i));
+    }
+
+    // 20 host variables, 15 NAK variables, 5 install overrides: 50 in total
+    for (int i = 0; i < 20; i++) {
+        in.host_env.vars["HOST_VAR_" + std::to_string(i)] =
+            EnvValue(EnvOp::Set, "/opt/host/value/" + std::to_string(i));
+    }
+    in.host_env.vars["PATH"] = EnvValue(EnvOp::Set, "/usr/local/bin:/usr/bin:/bin");
+
+    in.install.install.instance_id = "bench-instance";
+    in.install.paths.install_root = "/nah/apps/com.example.bench-1.0.0";
+    in.install.nak.id = "lua";
+    in.install.nak.version = "5.4.6";
+    in.install.nak.record_ref = "lua@5.4.6.json";
+    in.install.nak.loader = "default";
+    in.install.trust.state = TrustState::Verified;
+    in.install.trust.source = "bench";
+    in.install.trust.evaluated_at = "2025-01-01T00:00:00Z";
+    for (int i = 0; i < 4; i++) {
+        in.install.overrides.environment["OVERRIDE_" + std::to_string(i)] =
+            EnvValue(EnvOp::Set, "override-" + std::to_string(i));
+    }
+    in.install.overrides.environment["PATH"] = EnvValue(EnvOp::Append, "/opt/extra/bin", ":");
+
+    RuntimeDescriptor lua;
+    lua.nak.id = "lua";
+    lua.nak.version = "5.4.6";
+    lua.paths.root = "/nah/naks/lua/5.4.6";
+    lua.paths.lib_dirs = {"/nah/naks/lua/5.4.6/lib"};
+    for (int i = 0; i < 14; i++) {
+        lua.environment["NAK_VAR_" + std::to_string(i)] =
+            EnvValue(EnvOp::Set, "{NAH_NAK_ROOT}/share/" + std::to_string(i));
+    }
+    lua.environment["PATH"] = EnvValue(EnvOp::Prepend, "{NAH_NAK_ROOT}/bin", ":");
+
+    LoaderConfig loader;
+    loader.exec_path = "/nah/naks/lua/5.4.6/bin/lua";
+    loader.args_template = {"-e", "package.path='{NAH_APP_ROOT}/?.lua'", "{NAH_APP_ENTRY}"};
+    loader.args_compiled = compile_templates(loader.args_template);
+    lua.loaders["default"] = loader;
+
+    in.inventory.add("lua@5.4.6.json", lua);
+    return in;
+}
+
+struct Measurement {
+    double allocations_per_compose;
+    double ns_per_compose;
+};
+
+template <typename Compose>
+Measurement measure(size_t iterations, Compose&& compose) {
+    compose();  // warm up
+
+    size_t before = g_allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        compose();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = g_allocations.load(std::memory_order_relaxed) - before;
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return {static_cast<double>(allocations) / static_cast<double>(iterations),
+            static_cast<double>(ns) / static_cast<double>(iterations)};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    CountingResource counting;
+    std::pmr::set_default_resource(&counting);
+
+    Inputs in = make_inputs();
+    size_t variables = 0;
+
+    auto heap = measure(iterations, [&] {
+        auto result = nah_compose(in.app, in.host_env, in.install, in.inventory);
+        variables = result.contract.environment.size();
+    });
+
+    // A reusable buffer on the stack; nothing returns to the heap between runs
+    alignas(std::max_align_t) static char buffer[64 * 1024];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+    CompositionOptions options;
+    options.memory_resource = &arena;
+
+    auto monotonic = measure(iterations, [&] {
+        auto result = nah_compose(in.app, in.host_env, in.install, in.inventory, options);
+        arena.release();
+    });
+
+    std::printf("nah_compose: NAK + loader, %zu contract variables, %zu iterations\n",
+                variables, iterations);
+    std::printf("%-12s %14s %12s\n", "resource", "allocs/call", "ns/call");
+    std::printf("%-12s %14.1f %12.0f\n", "default", heap.allocations_per_compose, heap.ns_per_compose);
+    std::printf("%-12s %14.1f %12.0f\n", "monotonic", monotonic.allocations_per_compose,
+                monotonic.ns_per_compose);
+    return 0;
+}
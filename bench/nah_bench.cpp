@@ -0,0 +1,464 @@
+/*
+ * nah-bench - NAH benchmark suite
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Micro benchmarks for the pure layers (composition, placeholder expansion,
+ * JSON parsing, binary encoding, semver) and macro benchmarks against synthetic registries of
+ * increasing size (record parsing, inventory loading, application lookup).
+ *
+ * Usage:
+ *   nah-bench [--filter TEXT] [--scales 10,1000,100000] [--min-time-ms MS]
+ *             [--out FILE] [--baseline FILE] [--threshold PCT]
+ *
+ * The JSON report goes to --out (or stdout). With --baseline, the run is
+ * compared with a saved report and nah-bench exits 1 if any benchmark is
+ * more than --threshold percent (default 10) slower.
+ */
+
+#define NAH_HOST_IMPLEMENTATION
+#include <nah/nah_binary.h>
+#include <nah/nah_fs.h>
+#include <nah/nah_host.h>
+#include <nah/nah_json.h>
+#include <nah/nah_semver.h>
+
+#include "bench.h"
+#include "registry_generator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef NAH_VERSION
+#define NAH_VERSION "dev"
+#endif
+
+namespace {
+
+using namespace nah;
+using nah::bench::Runner;
+
+const char* APP_MANIFEST_JSON = R"({
+  "app": {
+    "identity": {
+      "id": "com.example.bench",
+      "version": "1.2.3",
+      "nak_id": "lua",
+      "nak_version_req": ">=5.4.0 <6.0.0"
+    },
+    "execution": {
+      "entrypoint": "bin/main.lua",
+      "args": ["--config", "{NAH_APP_ROOT}/etc/config.lua"]
+    },
+    "layout": {
+      "lib_dirs": ["lib", "lib/ext"],
+      "asset_dirs": ["share"]
+    },
+    "environment": {
+      "APP_MODE": "production",
+      "APP_DATA": "{NAH_APP_ROOT}/data"
+    },
+    "exports": [
+      {"id": "icon", "path": "share/icon.png", "type": "image/png"}
+    ],
+    "permissions": {
+      "filesystem": ["read:{NAH_APP_ROOT}", "write:{NAH_APP_ROOT}/data"],
+      "network": ["connect:https://api.example.com"]
+    }
+  }
+})";
+
+const char* INSTALL_RECORD_JSON = R"({
+  "install": {"instance_id": "6f1c2b9e-bench"},
+  "app": {"id": "com.example.bench", "version": "1.2.3", "nak_id": "lua", "nak_version_req": ">=5.4.0"},
+  "nak": {"id": "lua", "version": "5.4.6", "record_ref": "lua@5.4.6.json", "loader": "default",
+          "selection_reason": "highest_matching"},
+  "paths": {"install_root": "/nah/apps/com.example.bench-1.2.3"},
+  "provenance": {"package_hash": "sha256:0123456789abcdef", "installed_at": "2025-01-01T00:00:00Z",
+                 "installed_by": "nah", "source": "file:bench.nap"},
+  "trust": {"state": "verified", "source": "bench", "evaluated_at": "2025-01-01T00:00:00Z",
+            "expires_at": "2030-01-01T00:00:00Z"},
+  "overrides": {
+    "environment": {"APP_MODE": "staging", "PATH": {"op": "append", "value": "/opt/extra/bin"}},
+    "arguments": {"prepend": ["-E"], "append": ["--verbose"]}
+  }
+})";
+
+const char* RUNTIME_DESCRIPTOR_JSON = R"({
+  "nak": {"id": "lua", "version": "5.4.6"},
+  "paths": {"root": "/nah/naks/lua/5.4.6", "lib_dirs": ["/nah/naks/lua/5.4.6/lib"]},
+  "environment": {
+    "LUA_PATH": "{NAH_NAK_ROOT}/share/lua/5.4/?.lua;{NAH_APP_ROOT}/?.lua",
+    "LUA_CPATH": "{NAH_NAK_ROOT}/lib/lua/5.4/?.so",
+    "PATH": {"op": "prepend", "value": "{NAH_NAK_ROOT}/bin"}
+  },
+  "loaders": {
+    "default": {"exec_path": "/nah/naks/lua/5.4.6/bin/lua", "args_template": ["{NAH_APP_ENTRY}"]},
+    "debug": {"exec_path": "/nah/naks/lua/5.4.6/bin/lua", "args_template": ["-e", "DEBUG=1", "{NAH_APP_ENTRY}"]}
+  },
+  "execution": {"cwd": "{NAH_APP_ROOT}"},
+  "provenance": {"installed_at": "2025-01-01T00:00:00Z", "source": "file:lua.nak"}
+})";
+
+struct Args {
+    bench::Options options;
+    std::vector<size_t> scales = {10, 1000};
+    std::string out;
+    std::string baseline;
+    double threshold_pct = 10;
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "Usage: nah-bench [--filter TEXT] [--scales N,N,...] [--min-time-ms MS]\n"
+        "                 [--out FILE] [--baseline FILE] [--threshold PCT]\n");
+}
+
+std::vector<size_t> parse_scales(const std::string& list) {
+    std::vector<size_t> scales;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            scales.push_back(std::strtoull(item.c_str(), nullptr, 10));
+        }
+    }
+    return scales;
+}
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+
+        const char* v = nullptr;
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (arg == "--filter" && (v = value())) {
+            args.options.filter = v;
+        } else if (arg == "--scales" && (v = value())) {
+            args.scales = parse_scales(v);
+        } else if (arg == "--min-time-ms" && (v = value())) {
+            args.options.min_time_ms = std::strtod(v, nullptr);
+        } else if (arg == "--out" && (v = value())) {
+            args.out = v;
+        } else if (arg == "--baseline" && (v = value())) {
+            args.baseline = v;
+        } else if (arg == "--threshold" && (v = value())) {
+            args.threshold_pct = std::strtod(v, nullptr);
+        } else {
+            std::fprintf(stderr, "nah-bench: unknown or incomplete option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Micro benchmarks
+// ----------------------------------------------------------------------------
+
+void bench_placeholders(Runner& runner) {
+    std::unordered_map<std::string, std::string> env = {
+        {"NAH_APP_ROOT", "/nah/apps/com.example.bench-1.2.3"},
+        {"NAH_NAK_ROOT", "/nah/naks/lua/5.4.6"},
+        {"HOME", "/home/user"},
+    };
+    std::string input = "{NAH_NAK_ROOT}/share/lua/5.4/?.lua;{NAH_APP_ROOT}/?.lua;{HOME}/.lua/?.lua";
+    std::string literal = "/usr/local/share/lua/5.4/?.lua";
+    auto compiled = core::compile_template(input);
+
+    runner.run("core/expand_placeholders", [&] {
+        return core::expand_placeholders(input, env).value.size();
+    });
+    runner.run("core/expand_placeholders/literal", [&] {
+        return core::expand_placeholders(literal, env).value.size();
+    });
+    runner.run("core/expand_template", [&] {
+        return core::expand_template(compiled, env).value.size();
+    });
+}
+
+void bench_compose(Runner& runner) {
+    auto app = json::parse_app_declaration(APP_MANIFEST_JSON).value;
+    auto install = json::parse_install_record(INSTALL_RECORD_JSON).value;
+    auto runtime = json::parse_runtime_descriptor(RUNTIME_DESCRIPTOR_JSON).value;
+
+    core::HostEnvironment host_env;
+    for (int i = 0; i < 20; i++) {
+        host_env.vars["HOST_VAR_" + std::to_string(i)] =
+            core::EnvValue(core::EnvOp::Set, "/opt/host/" + std::to_string(i));
+    }
+    host_env.vars["PATH"] = core::EnvValue(core::EnvOp::Set, "/usr/local/bin:/usr/bin:/bin");
+
+    core::RuntimeInventory inventory;
+    inventory.add("lua@5.4.6.json", runtime);
+
+    runner.run("core/nah_compose", [&] {
+        return core::nah_compose(app, host_env, install, inventory).contract.environment.size();
+    });
+
+    core::CompositionOptions traced;
+    traced.enable_trace = true;
+    runner.run("core/nah_compose/trace", [&] {
+        return core::nah_compose(app, host_env, install, inventory, traced).contract.environment.size();
+    });
+
+    auto composed = core::nah_compose(app, host_env, install, inventory);
+    runner.run("core/fingerprint/contract", [&] {
+        return static_cast<size_t>(core::fingerprint(composed.contract).low);
+    });
+    runner.run("core/serialize_contract", [&] {
+        return core::serialize_contract(composed.contract).size();
+    });
+
+    // The contract cache round trip, binary against JSON
+    std::string encoded = binary::encode_result(composed);
+    std::string serialized = core::serialize_result(composed);
+    runner.run("binary/encode_result", [&] {
+        return binary::encode_result(composed).size();
+    });
+    runner.run("binary/view_result", [&] {
+        return binary::view_result(encoded)->contract.environment.size();
+    });
+    runner.run("binary/decode_result", [&] {
+        return binary::decode_result(encoded)->contract.environment.size();
+    });
+    runner.run("json/parse_composition_result", [&] {
+        return json::parse_composition_result(serialized).value.contract.environment.size();
+    });
+
+    std::pmr::monotonic_buffer_resource arena;
+    core::CompositionOptions scratch;
+    scratch.memory_resource = &arena;
+    runner.run("core/nah_compose/monotonic", [&] {
+        size_t n = core::nah_compose(app, host_env, install, inventory, scratch).contract.environment.size();
+        arena.release();
+        return n;
+    });
+}
+
+void bench_json(Runner& runner) {
+    std::string manifest = APP_MANIFEST_JSON;
+    std::string install = INSTALL_RECORD_JSON;
+    std::string runtime = RUNTIME_DESCRIPTOR_JSON;
+
+    runner.run("json/parse_app_declaration", [&] {
+        return json::parse_app_declaration(manifest).value.env_vars.size();
+    });
+    runner.run("json/parse_install_record", [&] {
+        return json::parse_install_record(install).value.overrides.environment.size();
+    });
+    runner.run("json/parse_runtime_descriptor", [&] {
+        return json::parse_runtime_descriptor(runtime).value.loaders.size();
+    });
+
+    // The DOM parsers the streaming ones replaced, for comparison
+    runner.run("json/parse_app_declaration/dom", [&] {
+        return json::parse_app_declaration_dom(manifest).value.env_vars.size();
+    });
+    runner.run("json/parse_install_record/dom", [&] {
+        return json::parse_install_record_dom(install).value.overrides.environment.size();
+    });
+    runner.run("json/parse_runtime_descriptor/dom", [&] {
+        return json::parse_runtime_descriptor_dom(runtime).value.loaders.size();
+    });
+}
+
+void bench_semver(Runner& runner) {
+    const std::vector<std::string> ranges = {
+        ">=1.2.0 <2.0.0", "^3.4.5", "~1.2.3", "1.x || >=2.5.0 <3.0.0", "=5.4.6",
+    };
+    auto version = *semver::parse_version("1.9.12");
+    std::vector<semver::VersionRange> parsed;
+    for (const auto& r : ranges) {
+        parsed.push_back(*semver::parse_range(r));
+    }
+
+    runner.run("semver/parse_range", [&] {
+        size_t n = 0;
+        for (const auto& r : ranges) {
+            n += semver::parse_range(r)->sets.size();
+        }
+        return n;
+    });
+    runner.run("semver/satisfies", [&] {
+        size_t n = 0;
+        for (const auto& r : parsed) {
+            n += semver::satisfies(version, r) ? 1u : 0u;
+        }
+        return n;
+    });
+}
+
+void bench_fs(Runner& runner) {
+    if (!runner.selected("fs/read_file") && !runner.selected("fs/read_file_view")) {
+        return;
+    }
+
+    // A 4 MiB file, the size of a large registry index, read whole each time
+    std::string path = (std::filesystem::temp_directory_path() / "nah_bench_read_file.bin").generic_string();
+    std::ofstream(path, std::ios::binary) << std::string(4u << 20, 'x');
+
+    runner.run("fs/read_file", [&] { return fs::read_file(path)->size(); });
+    runner.run("fs/read_file_view", [&] { return fs::read_file_view(path)->size(); });
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+// ----------------------------------------------------------------------------
+// Macro benchmarks
+// ----------------------------------------------------------------------------
+
+void bench_registry(Runner& runner, size_t scale) {
+    std::string suffix = "/n=" + std::to_string(scale);
+    std::string inventory_name = "fs/load_inventory_from_directory" + suffix;
+    std::string inventory_serial_name = "fs/load_inventory_from_directory/serial" + suffix;
+    std::string cold_name = "host/find_application/cold" + suffix;
+    std::string warm_name = "host/find_application/warm" + suffix;
+    std::string parse_name = "json/parse_registry" + suffix;
+    std::string parse_dom_name = "json/parse_registry/dom" + suffix;
+    std::string list_name = "fs/list_directory" + suffix;
+    std::string enumerate_name = "fs/for_each_entry" + suffix;
+    if (!runner.selected(inventory_name) && !runner.selected(inventory_serial_name) &&
+        !runner.selected(cold_name) && !runner.selected(warm_name) &&
+        !runner.selected(parse_name) && !runner.selected(parse_dom_name) &&
+        !runner.selected(list_name) && !runner.selected(enumerate_name)) {
+        return;
+    }
+
+    // As many NAKs as apps, up to 1000; more NAKs than that is not a host
+    // anyone runs, and reading 100k of them would dominate every iteration
+    bench::SyntheticRegistry registry(scale, std::min<size_t>(scale, 1000));
+    std::string naks_dir = registry.root() + "/registry/naks";
+
+    // Every record, read once up front, so only parsing is timed: with the
+    // configured backend, then with nlohmann's DOM
+    if (runner.selected(parse_name) || runner.selected(parse_dom_name)) {
+        std::vector<std::string> app_records;
+        std::vector<std::string> nak_records;
+        for (const auto& path : fs::list_directory(registry.root() + "/registry/apps")) {
+            app_records.push_back(fs::read_file(path).value_or(""));
+        }
+        for (const auto& path : fs::list_directory(naks_dir)) {
+            nak_records.push_back(fs::read_file(path).value_or(""));
+        }
+
+        runner.run(parse_name, [&] {
+            size_t n = 0;
+            for (const auto& record : app_records) n += json::parse_install_record(record).ok ? 1u : 0u;
+            for (const auto& record : nak_records) n += json::parse_runtime_descriptor(record).ok ? 1u : 0u;
+            return n;
+        });
+        runner.run(parse_dom_name, [&] {
+            size_t n = 0;
+            for (const auto& record : app_records) n += json::parse_install_record_dom(record).ok ? 1u : 0u;
+            for (const auto& record : nak_records) n += json::parse_runtime_descriptor_dom(record).ok ? 1u : 0u;
+            return n;
+        });
+    }
+
+    // Counting the .json records in registry/apps, as every scan does first
+    std::string apps_dir = registry.root() + "/registry/apps";
+    runner.run(list_name, [&] {
+        size_t n = 0;
+        for (const auto& entry : fs::list_directory(apps_dir)) {
+            n += entry.size() > 5 && entry.substr(entry.size() - 5) == ".json" ? 1u : 0u;
+        }
+        return n;
+    });
+    runner.run(enumerate_name, [&] {
+        size_t n = 0;
+        fs::for_each_entry(apps_dir, ".json", [&](const fs::DirEntry&) { ++n; });
+        return n;
+    });
+
+    runner.run(inventory_name, [&] {
+        return fs::load_inventory_from_directory(naks_dir).runtimes.size();
+    });
+    runner.run(inventory_serial_name, [&] {
+        return fs::load_inventory_from_directory(naks_dir, nullptr, 1).runtimes.size();
+    });
+
+    // Lookups spread across the registry so no single record stays hot
+    size_t next = 0;
+    auto lookup_id = [&] {
+        next = (next + 7919) % registry.apps();
+        return bench::app_id(next);
+    };
+
+    runner.run(cold_name, [&] {
+        auto host = host::NahHost::create(registry.root());
+        return host->findApplication(lookup_id()) ? size_t{1} : size_t{0};
+    });
+
+    auto host = host::NahHost::create(registry.root());
+    runner.run(warm_name, [&] {
+        return host->findApplication(lookup_id()) ? size_t{1} : size_t{0};
+    });
+}
+
+int report(const Args& args, const std::vector<bench::Result>& results) {
+    std::string text = bench::to_json(results, NAH_VERSION).dump(2) + "\n";
+    if (args.out.empty()) {
+        std::cout << text;
+    } else {
+        std::ofstream(args.out) << text;
+    }
+
+    if (args.baseline.empty()) {
+        return 0;
+    }
+
+    auto content = fs::read_file(args.baseline);
+    auto baseline = content ? bench::from_json(*content) : std::nullopt;
+    if (!baseline) {
+        std::fprintf(stderr, "nah-bench: not a benchmark report: %s\n", args.baseline.c_str());
+        return 2;
+    }
+
+    int regressions = 0;
+    std::fprintf(stderr, "\n%-56s %12s %12s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+    for (const auto& c : bench::compare(*baseline, results, args.threshold_pct)) {
+        std::fprintf(stderr, "%-56s %12.1f %12.1f %+8.1f%%%s\n", c.name.c_str(), c.baseline_ns,
+                     c.current_ns, c.change_pct, c.regressed ? "  REGRESSION" : "");
+        regressions += c.regressed ? 1 : 0;
+    }
+    if (regressions > 0) {
+        std::fprintf(stderr, "nah-bench: %d benchmark(s) more than %.1f%% slower than baseline\n",
+                     regressions, args.threshold_pct);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        usage();
+        return 2;
+    }
+
+    Runner runner(args.options);
+    bench_placeholders(runner);
+    bench_compose(runner);
+    bench_json(runner);
+    bench_semver(runner);
+    bench_fs(runner);
+    for (size_t scale : args.scales) {
+        if (scale > 0) {
+            bench_registry(runner, scale);
+        }
+    }
+
+    return report(args, runner.results());
+}
@@ -0,0 +1,267 @@
+/*
+ * Package install throughput benchmark
+ *
+ * Generates a synthetic NAK tree (default 1 GiB: large library-like files
+ * plus many small text files), packs it in each requested format and
+ * extracts it the way `nah install` does, reporting package size and
+ * install throughput in MiB/s of tree data:
+ *
+ *   gzip-stream  - single-stream gzip, as written by `tar -czf`
+ *   gzip         - block-gzip, the `nah pack` default
+ *   zstd[:N]     - `nah pack --compression=zstd[:N]`
+ *
+ * The package is in the page cache when it is extracted, so the numbers
+ * are decompression plus file writes, not disk reads.
+ *
+ * Usage: nah-bench-package [--size-mb N] [--formats LIST] [--dir DIR] [--runs N]
+ */
+
+#include "package.hpp"
+
+#include <nah/nah_fs.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace stdfs = std::filesystem;
+using namespace nah::cli;
+
+struct Args {
+    size_t size_mb = 1024;
+    std::vector<std::string> formats = {"gzip-stream", "gzip", "zstd"};
+    std::string dir;
+    size_t runs = 1;
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "Usage: nah-bench-package [--size-mb N] [--formats LIST] [--dir DIR] [--runs N]\n"
+        "  LIST is comma separated: gzip-stream, gzip, gzip:<1-9>, zstd, zstd:<level>\n");
+}
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+
+        const char* v = nullptr;
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (arg == "--size-mb" && (v = value())) {
+            args.size_mb = std::strtoull(v, nullptr, 10);
+        } else if (arg == "--formats" && (v = value())) {
+            args.formats.clear();
+            std::stringstream ss(v);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (item != "gzip-stream" && !package::parse_compression(item)) {
+                    std::fprintf(stderr, "nah-bench-package: unknown format: %s\n", item.c_str());
+                    return false;
+                }
+                args.formats.push_back(item);
+            }
+        } else if (arg == "--dir" && (v = value())) {
+            args.dir = v;
+        } else if (arg == "--runs" && (v = value())) {
+            args.runs = std::max<size_t>(1, std::strtoull(v, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "nah-bench-package: unknown or incomplete option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Synthetic NAK
+// ----------------------------------------------------------------------------
+
+struct Rng {
+    std::uint64_t state;
+    std::uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+// Library-like bytes: runs of noise between repeated instruction-like
+// patterns, which compresses about as well as real shared objects
+void fill_binary(std::string& out, size_t size, Rng& rng) {
+    out.clear();
+    std::string pattern;
+    while (out.size() < size) {
+        if (rng.next() % 4 == 0) {
+            for (size_t n = 16 + rng.next() % 240; n > 0; --n) {
+                out.push_back(static_cast<char>(rng.next()));
+            }
+        } else {
+            if (pattern.empty() || rng.next() % 8 == 0) {
+                pattern.clear();
+                for (size_t n = 8 + rng.next() % 56; n > 0; --n) {
+                    pattern.push_back(static_cast<char>(rng.next() % 64));
+                }
+            }
+            out += pattern;
+        }
+    }
+    out.resize(size);
+}
+
+// Headers, scripts and docs: words from a small vocabulary
+void fill_text(std::string& out, size_t size, Rng& rng) {
+    static const char* const words[] = {
+        "static", "inline", "const", "return", "struct", "void", "size_t", "namespace",
+        "template", "include", "nah", "runtime", "loader", "environment", "path", "version",
+        "{", "}", "(", ")", ";", "=", "==", "->", "if", "for", "while", "else",
+    };
+    out.clear();
+    while (out.size() < size) {
+        out += words[rng.next() % (sizeof(words) / sizeof(words[0]))];
+        out += rng.next() % 10 == 0 ? '\n' : ' ';
+    }
+    out.resize(size);
+}
+
+// About 60% of the bytes in 4-16 MiB libraries, the rest in 4-64 KiB text
+// files spread over 64 directories. Returns the number of files.
+size_t generate_nak(const std::string& root, std::uint64_t total) {
+    stdfs::create_directories(root + "/META");
+    std::ofstream(root + "/META/nak.json")
+        << R"({"nak": {"identity": {"id": "com.example.bench-sdk", "version": "1.0.0"}}})" << "\n";
+
+    Rng rng{0x9E3779B97F4A7C15ull};
+    std::string content;
+    std::uint64_t written = 0;
+    size_t files = 1;
+
+    stdfs::create_directories(root + "/lib");
+    while (written < total * 6 / 10) {
+        size_t size = static_cast<size_t>((4u << 20) + rng.next() % (12u << 20));
+        fill_binary(content, size, rng);
+        std::ofstream(root + "/lib/libbench" + std::to_string(files) + ".so", std::ios::binary) << content;
+        written += size;
+        ++files;
+    }
+    while (written < total) {
+        std::string dir = root + "/include/module" + std::to_string(files % 64);
+        stdfs::create_directories(dir);
+        size_t size = static_cast<size_t>((4u << 10) + rng.next() % (60u << 10));
+        fill_text(content, size, rng);
+        std::ofstream(dir + "/header" + std::to_string(files) + ".h", std::ios::binary) << content;
+        written += size;
+        ++files;
+    }
+    return files;
+}
+
+// ----------------------------------------------------------------------------
+// Pack and install
+// ----------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Writer>
+bool pack_with(Writer& writer, const std::string& tree, std::string& error) {
+    package::TarWriter tar([&](const uint8_t* data, size_t size) { return writer.write(data, size); });
+    return package::write_tree(tar, tree, error) && tar.finish() && writer.finish();
+}
+
+// Single-stream gzip through zlib's gzFile, standing in for `tar -czf`
+struct GzipStreamWriter {
+    gzFile file;
+    bool write(const uint8_t* data, size_t size) {
+        return gzwrite(file, data, static_cast<unsigned>(size)) == static_cast<int>(size);
+    }
+    bool finish() { return gzclose(file) == Z_OK; }
+};
+
+bool pack(const std::string& format, const std::string& tree, const std::string& output, std::string& error) {
+    if (format == "gzip-stream") {
+        GzipStreamWriter writer{gzopen(output.c_str(), "wb")};
+        return writer.file != nullptr && pack_with(writer, tree, error);
+    }
+
+    auto compression = package::parse_compression(format);
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (compression->format == package::CompressionFormat::Zstd) {
+        package::ZstdWriter writer(out, 0, compression->level);
+        return pack_with(writer, tree, error);
+    }
+    package::BlockGzipWriter writer(out, 0, compression->level);
+    return pack_with(writer, tree, error);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        usage();
+        return 2;
+    }
+
+    std::string work = args.dir.empty() ? (stdfs::temp_directory_path() / "nah-bench-package").string() : args.dir;
+    std::string tree = work + "/tree";
+    std::string dest = work + "/installed";
+    stdfs::remove_all(work);
+
+    std::uint64_t total = static_cast<std::uint64_t>(args.size_mb) << 20;
+    std::fprintf(stderr, "Generating %zu MiB NAK in %s...\n", args.size_mb, tree.c_str());
+    size_t files = generate_nak(tree, total);
+    double mib = static_cast<double>(total) / (1 << 20);
+
+    std::printf("NAK: %.0f MiB in %zu files, %u hardware threads, best of %zu run(s)\n", mib, files,
+                std::thread::hardware_concurrency(), args.runs);
+    std::printf("%-12s %9s %10s %7s %10s %14s\n", "format", "pack s", "size MiB", "ratio", "install s",
+                "install MiB/s");
+
+    int status = 0;
+    for (const auto& format : args.formats) {
+        std::string package_path = work + "/bench.nak";
+        std::string error;
+        auto start = Clock::now();
+        if (!pack(format, tree, package_path, error)) {
+            std::fprintf(stderr, "nah-bench-package: %s: pack failed: %s\n", format.c_str(), error.c_str());
+            status = 1;
+            continue;
+        }
+        double pack_s = seconds_since(start);
+        double size_mib = static_cast<double>(stdfs::file_size(package_path)) / (1 << 20);
+
+        double install_s = 0;
+        for (size_t run = 0; run < args.runs; ++run) {
+            stdfs::remove_all(dest);
+            start = Clock::now();
+            auto result = package::extract_package(package_path, dest, &error);
+            double elapsed = seconds_since(start);
+            if (result != package::ExtractStatus::Ok) {
+                std::fprintf(stderr, "nah-bench-package: %s: extract failed: %s\n", format.c_str(), error.c_str());
+                status = 1;
+                break;
+            }
+            install_s = run == 0 ? elapsed : std::min(install_s, elapsed);
+        }
+
+        std::printf("%-12s %9.2f %10.1f %7.2f %10.2f %14.0f\n", format.c_str(), pack_s, size_mib,
+                    mib / size_mib, install_s, mib / install_s);
+        std::fflush(stdout);
+        stdfs::remove(package_path);
+    }
+
+    stdfs::remove_all(work);
+    return status;
+}
@@ -0,0 +1,100 @@
+/*
+ * Synthetic NAH registry generator for nah-bench
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Writes a NAH root with `apps` app install records and `naks` NAK records,
+ * shaped like what `nah install` produces:
+ *
+ *     <root>/registry/apps/com.bench.app<N>@1.0.0.json
+ *     <root>/registry/naks/bench.nak<M>@1.<M>.0.json
+ *
+ * App N pins NAK N % naks. Only records are written; nothing under apps/ or
+ * naks/ is needed to look applications up or load the inventory.
+ */
+
+#ifndef NAH_BENCH_REGISTRY_GENERATOR_H
+#define NAH_BENCH_REGISTRY_GENERATOR_H
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace nah {
+namespace bench {
+
+inline std::string app_id(size_t i) { return "com.bench.app" + std::to_string(i); }
+inline std::string nak_id(size_t i) { return "bench.nak" + std::to_string(i); }
+inline std::string nak_version(size_t i) { return "1." + std::to_string(i) + ".0"; }
+
+inline std::string nak_record(size_t i, const std::string& root) {
+    std::string id = nak_id(i);
+    std::string version = nak_version(i);
+    std::string nak_root = root + "/naks/" + id + "/" + version;
+    return R"({"nak": {"id": ")" + id + R"(", "version": ")" + version +
+           R"("}, "paths": {"root": ")" + nak_root + R"(", "lib_dirs": [")" + nak_root +
+           R"(/lib"]}, "environment": {"BENCH_NAK_HOME": "{NAH_NAK_ROOT}", "PATH": {"op": "prepend", "value": "{NAH_NAK_ROOT}/bin"}},)"
+           R"( "loaders": {"default": {"exec_path": ")" + nak_root +
+           R"(/bin/run", "args_template": ["--app", "{NAH_APP_ENTRY}"]}}, "execution": {"cwd": "{NAH_APP_ROOT}"},)"
+           R"( "provenance": {"installed_at": "2025-01-01T00:00:00Z", "source": "bench"}})";
+}
+
+inline std::string app_record(size_t i, size_t naks, const std::string& root) {
+    std::string id = app_id(i);
+    std::string record = R"({"install": {"instance_id": "bench-)" +
+                         std::to_string(i) + R"("}, "app": {"id": ")" + id + R"(", "version": "1.0.0"},)";
+    if (naks > 0) {
+        size_t n = i % naks;
+        record += R"( "nak": {"id": ")" + nak_id(n) + R"(", "version": ")" + nak_version(n) +
+                  R"(", "record_ref": ")" + nak_id(n) + "@" + nak_version(n) +
+                  R"(.json", "loader": "default"},)";
+    }
+    record += R"( "paths": {"install_root": ")" + root + "/apps/" + id + R"(-1.0.0"},)"
+              R"( "trust": {"state": "verified", "source": "bench", "evaluated_at": "2025-01-01T00:00:00Z"}})";
+    return record;
+}
+
+// A NAH root in the system temp directory, removed on destruction
+class SyntheticRegistry {
+public:
+    SyntheticRegistry(size_t apps, size_t naks) : apps_(apps), naks_(naks) {
+        std::random_device rd;
+        root_ = (std::filesystem::temp_directory_path() /
+                 ("nah_bench_" + std::to_string(rd()))).generic_string();
+        std::filesystem::create_directories(root_ + "/registry/apps");
+        std::filesystem::create_directories(root_ + "/registry/naks");
+        std::filesystem::create_directories(root_ + "/apps");
+        std::filesystem::create_directories(root_ + "/naks");
+
+        for (size_t i = 0; i < naks; i++) {
+            std::ofstream(root_ + "/registry/naks/" + nak_id(i) + "@" + nak_version(i) + ".json")
+                << nak_record(i, root_);
+        }
+        for (size_t i = 0; i < apps; i++) {
+            std::ofstream(root_ + "/registry/apps/" + app_id(i) + "@1.0.0.json")
+                << app_record(i, naks, root_);
+        }
+    }
+
+    ~SyntheticRegistry() {
+        std::error_code ec;
+        std::filesystem::remove_all(root_, ec);
+    }
+
+    SyntheticRegistry(const SyntheticRegistry&) = delete;
+    SyntheticRegistry& operator=(const SyntheticRegistry&) = delete;
+
+    const std::string& root() const { return root_; }
+    size_t apps() const { return apps_; }
+    size_t naks() const { return naks_; }
+
+private:
+    std::string root_;
+    size_t apps_;
+    size_t naks_;
+};
+
+} // namespace bench
+} // namespace nah
+
+#endif // NAH_BENCH_REGISTRY_GENERATOR_H
@@ -17,6 +17,27 @@ if(NOT TARGET ZLIB::ZLIB)
     set(ZLIB_LIBRARIES zlibstatic)
 endif()
 
+# zstd for zstd-compressed packages (nah pack --compression=zstd), with
+# multithreaded compression
+FetchContent_Declare(
+    zstd
+    GIT_REPOSITORY https://github.com/facebook/zstd.git
+    GIT_TAG        v1.5.6
+    SOURCE_SUBDIR  build/cmake
+)
+set(ZSTD_BUILD_PROGRAMS OFF CACHE BOOL "")
+set(ZSTD_BUILD_TESTS OFF CACHE BOOL "")
+set(ZSTD_BUILD_SHARED OFF CACHE BOOL "")
+set(ZSTD_BUILD_STATIC ON CACHE BOOL "")
+set(ZSTD_LEGACY_SUPPORT OFF CACHE BOOL "")
+set(ZSTD_MULTITHREAD_SUPPORT ON CACHE BOOL "")
+FetchContent_MakeAvailable(zstd)
+
+if(NOT TARGET zstd::libzstd)
+    add_library(zstd::libzstd ALIAS libzstd_static)
+    set(ZSTD_INCLUDE_DIRS ${zstd_SOURCE_DIR}/lib)
+endif()
+
 # nlohmann_json for JSON parsing (header-only, required by nah_json.h)
 FetchContent_Declare(
     nlohmann_json
@@ -25,6 +46,23 @@ FetchContent_Declare(
 )
 FetchContent_MakeAvailable(nlohmann_json)
 
+# simdjson, only with -DNAH_JSON_BACKEND=simdjson
+if(NAH_JSON_BACKEND STREQUAL "simdjson")
+    FetchContent_Declare(
+        simdjson
+        GIT_REPOSITORY https://github.com/simdjson/simdjson.git
+        GIT_TAG        v3.10.1
+    )
+    FetchContent_MakeAvailable(simdjson)
+
+    # Mark simdjson's headers as system headers so the strict warning flags
+    # we build with don't fire inside them (FetchContent_Declare's SYSTEM
+    # option would do this, but needs CMake 3.25)
+    get_target_property(_simdjson_includes simdjson INTERFACE_INCLUDE_DIRECTORIES)
+    set_target_properties(simdjson PROPERTIES INTERFACE_SYSTEM_INCLUDE_DIRECTORIES "${_simdjson_includes}")
+    unset(_simdjson_includes)
+endif()
+
 # CLI11 for command-line parsing (only needed for tools)
 if(NAH_ENABLE_TOOLS)
     FetchContent_Declare(
@@ -136,6 +136,10 @@ class NahConan(ConanFile):
 
         # Requires C++17
         self.cpp_info.cxxflags = []
+
+        # nah_compose_batch() uses std::thread
+        if self.settings.os in ["Linux", "FreeBSD"]:
+            self.cpp_info.system_libs = ["pthread"]
         self.cpp_info.set_property("cmake_target_name", "nah::core")
 
         # Define NAH_CORE for consuming packages
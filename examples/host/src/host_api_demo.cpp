@@ -86,12 +86,12 @@ int main(int argc, char* argv[]) {
         std::cout << "  (no runtimes installed)\n";
     } else {
         for (const auto& [ref, runtime] : inventory.runtimes) {
-            std::cout << "  " << runtime.nak.id << "@" << runtime.nak.version << "\n";
-            std::cout << "    Root: " << runtime.paths.root << "\n";
-            if (!runtime.loaders.empty()) {
+            std::cout << "  " << runtime->nak.id << "@" << runtime->nak.version << "\n";
+            std::cout << "    Root: " << runtime->paths.root << "\n";
+            if (!runtime->loaders.empty()) {
                 std::cout << "    Loaders: ";
                 bool first = true;
-                for (const auto& [name, _] : runtime.loaders) {
+                for (const auto& [name, _] : runtime->loaders) {
                     if (!first) std::cout << ", ";
                     std::cout << name;
                     first = false;
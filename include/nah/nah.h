@@ -6,9 +6,11 @@
  * This header includes everything:
  *   - nah_core.h     : Pure computation (types, composition, validation)
  *   - nah_json.h     : JSON parsing (requires nlohmann/json)
+ *   - nah_binary.h   : Compact binary encoding of launch contracts
  *   - nah_fs.h       : Filesystem operations
  *   - nah_exec.h     : Contract execution
  *   - nah_overrides.h: NAH_OVERRIDE_* environment variable handling
+ *   - nah_registry.h : Persistent registry index (registry/index.bin)
  *   - nah_host.h     : High-level NahHost class
  * 
  * For pure/embeddable usage, include only nah_core.h.
@@ -66,6 +68,9 @@
 // JSON: Parsing and serialization (requires nlohmann/json)
 #include "nah_json.h"
 
+// Binary: Compact encoding of launch contracts and composition results
+#include "nah_binary.h"
+
 // Overrides: NAH_OVERRIDE_* parsing and application (requires nlohmann/json)
 #include "nah_overrides.h"
 
@@ -75,6 +80,9 @@
 // Execution: Process spawning (platform-specific)
 #include "nah_exec.h"
 
+// Registry: Binary index of installed apps and NAKs
+#include "nah_registry.h"
+
 // Host: High-level API for managing a NAH root
 #include "nah_host.h"
 
@@ -0,0 +1,687 @@
+/*
+ * NAH Binary - Compact Launch Contract Encoding
+ *
+ * A versioned binary form of LaunchContract and CompositionResult for
+ * caches, IPC and supervisors that pass contracts between processes. It
+ * carries everything serialize_contract() and serialize_result() write
+ * (traces excepted), but reading it back needs no parser: decoding is
+ * bounds-checked offset arithmetic, and view_contract() / view_result()
+ * return string_views into the buffer without copying a single string.
+ *
+ *     std::string bytes = nah::binary::encode_contract(contract);
+ *     auto view = nah::binary::view_contract(bytes);    // borrows from bytes
+ *     auto copy = nah::binary::decode_contract(bytes);  // owning LaunchContract
+ *
+ * Layout. Every integer is a little-endian u32 and every section starts on
+ * a 4-byte boundary, so a buffer can be used straight from mmap():
+ *
+ *     header   "NAHBIN01", format version, kind, total size,
+ *              body offset, body words,
+ *              string table offset, string count,
+ *              string data offset, string data size
+ *     body     the fields in a fixed order. A string is an index into the
+ *              string table; a list is a count followed by its items; maps
+ *              are written sorted by key.
+ *     table    (offset, length) of each string in the string data
+ *     data     every distinct string once, NUL-terminated
+ *
+ * Strings are deduplicated, so the paths that recur throughout a contract
+ * are stored once. The terminators mean a view's strings can be handed to
+ * exec() as C strings.
+ *
+ * Increment BINARY_FORMAT_VERSION whenever the layout or field order
+ * changes; decoders reject every other version.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NAH_BINARY_H
+#define NAH_BINARY_H
+
+#ifdef __cplusplus
+
+#include "nah_core.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nah {
+namespace binary {
+
+constexpr std::uint32_t BINARY_FORMAT_VERSION = 1;
+constexpr char BINARY_MAGIC[8] = {'N', 'A', 'H', 'B', 'I', 'N', '0', '1'};
+
+/// What an encoded buffer holds.
+enum class Kind : std::uint32_t {
+    Contract = 1,
+    Result = 2,
+};
+
+// ============================================================================
+// VIEWS
+// ============================================================================
+
+// A decoded LaunchContract whose strings point into the encoded buffer. It is
+// valid only while that buffer is alive and unmodified.
+struct LaunchContractView {
+    using StringPair = std::pair<std::string_view, std::string_view>;
+
+    struct {
+        std::string_view id;
+        std::string_view version;
+        std::string_view root;
+        std::string_view entrypoint;
+    } app;
+
+    struct {
+        std::string_view id;
+        std::string_view version;
+        std::string_view root;
+        std::string_view resource_root;
+        std::string_view record_ref;
+    } nak;
+
+    struct {
+        std::string_view binary;
+        std::vector<std::string_view> arguments;
+        std::string_view cwd;
+        std::string_view library_path_env_key;
+        std::vector<std::string_view> library_paths;
+    } execution;
+
+    std::vector<StringPair> environment;  ///< Sorted by key
+
+    struct {
+        std::vector<std::string_view> filesystem;
+        std::vector<std::string_view> network;
+    } enforcement;
+
+    struct {
+        core::TrustState state = core::TrustState::Unknown;
+        std::string_view source;
+        std::string_view evaluated_at;
+        std::string_view expires_at;
+        std::string_view inputs_hash;
+        std::vector<StringPair> details;  ///< Sorted by key
+    } trust;
+
+    struct Export {
+        std::string_view key;  ///< Key in LaunchContract::exports
+        std::string_view id;
+        std::string_view path;
+        std::string_view type;
+    };
+    std::vector<Export> exports;  ///< Sorted by key
+
+    struct {
+        bool present = false;
+        std::vector<std::string_view> required_capabilities;
+        std::vector<std::string_view> optional_capabilities;
+        std::vector<std::string_view> critical_capabilities;
+    } capability_usage;
+
+    /// Copy into an owning LaunchContract.
+    core::LaunchContract to_contract() const;
+};
+
+// A decoded CompositionResult whose strings point into the encoded buffer.
+struct CompositionResultView {
+    struct Warning {
+        std::string_view key;
+        std::string_view action;
+        std::vector<LaunchContractView::StringPair> fields;  ///< Sorted by key
+    };
+
+    struct PolicyViolation {
+        std::string_view type;
+        std::string_view target;
+        std::string_view context;
+    };
+
+    bool ok = false;
+    std::optional<core::CriticalError> critical_error;
+    std::string_view critical_error_context;
+    LaunchContractView contract;
+    std::vector<Warning> warnings;
+    std::vector<PolicyViolation> policy_violations;
+    core::Fingerprint contract_fingerprint;  ///< fingerprint(contract), recorded by the encoder (zero if !ok)
+
+    /// Copy into an owning CompositionResult.
+    core::CompositionResult to_result() const;
+};
+
+// ============================================================================
+// ENCODER / DECODER
+// ============================================================================
+
+namespace detail {
+
+constexpr std::size_t HEADER_SIZE = sizeof(BINARY_MAGIC) + 10 * 4;
+
+// Every size and offset is a u32, so no encoding may be larger. Each count,
+// index and offset is bounded by the total size, so checking it suffices.
+constexpr std::size_t MAX_ENCODED_SIZE = UINT32_MAX;
+
+inline void store_u32(char* out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((v >> (8 * i)) & 0xFFu);
+    }
+}
+
+inline std::uint32_t load_u32(const char* in) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return v;
+}
+
+// Truncates past 4 GiB; Encoder::finish() discards any such encoding
+inline std::uint32_t narrow(std::size_t n) {
+    return static_cast<std::uint32_t>(n);
+}
+
+// Collects the body and the deduplicated string table. Strings are indexed
+// by string_views into the value being encoded, which outlives the encoder.
+class Encoder {
+public:
+    void u32(std::uint32_t v) { body_.push_back(v); }
+    void flag(bool b) { u32(b ? 1u : 0u); }
+
+    void str(std::string_view s) {
+        auto [it, inserted] = index_.try_emplace(s, narrow(table_.size()));
+        if (inserted) {
+            table_.emplace_back(narrow(data_.size()), narrow(s.size()));
+            data_.append(s);
+            data_.push_back('\0');
+        }
+        u32(it->second);
+    }
+
+    void strings(const std::vector<std::string>& list) {
+        u32(narrow(list.size()));
+        for (const auto& s : list) str(s);
+    }
+
+    void string_map(const std::unordered_map<std::string, std::string>& map) {
+        std::vector<const std::pair<const std::string, std::string>*> sorted;
+        sorted.reserve(map.size());
+        for (const auto& kv : map) sorted.push_back(&kv);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto* a, const auto* b) { return a->first < b->first; });
+        u32(narrow(sorted.size()));
+        for (const auto* kv : sorted) {
+            str(kv->first);
+            str(kv->second);
+        }
+    }
+
+    // The encoded buffer, or an empty string if it would exceed `limit`
+    std::string finish(Kind kind, std::size_t limit = MAX_ENCODED_SIZE) const {
+        std::size_t body_offset = HEADER_SIZE;
+        std::size_t table_offset = body_offset + body_.size() * 4;
+        std::size_t data_offset = table_offset + table_.size() * 8;
+        std::size_t total = data_offset + ((data_.size() + 3) & ~std::size_t{3});
+        if (total > limit) {
+            return {};
+        }
+
+        std::string out(total, '\0');
+        char* p = out.data();
+        std::memcpy(p, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        std::uint32_t header[10] = {
+            BINARY_FORMAT_VERSION, static_cast<std::uint32_t>(kind), narrow(total),
+            narrow(body_offset), narrow(body_.size()),
+            narrow(table_offset), narrow(table_.size()),
+            narrow(data_offset), narrow(data_.size()),
+            0,  // reserved
+        };
+        for (std::size_t i = 0; i < 10; ++i) {
+            store_u32(p + sizeof(BINARY_MAGIC) + i * 4, header[i]);
+        }
+        for (std::size_t i = 0; i < body_.size(); ++i) {
+            store_u32(p + body_offset + i * 4, body_[i]);
+        }
+        for (std::size_t i = 0; i < table_.size(); ++i) {
+            store_u32(p + table_offset + i * 8, table_[i].first);
+            store_u32(p + table_offset + i * 8 + 4, table_[i].second);
+        }
+        std::memcpy(p + data_offset, data_.data(), data_.size());
+        return out;
+    }
+
+private:
+    std::vector<std::uint32_t> body_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> table_;
+    std::string data_;
+    std::unordered_map<std::string_view, std::uint32_t> index_;
+};
+
+// Bounds-checked cursor over an encoded buffer. Any malformed read clears ok.
+class Decoder {
+public:
+    Decoder(std::string_view bytes, Kind kind) {
+        if (bytes.size() < HEADER_SIZE || bytes.size() > UINT32_MAX ||
+            std::memcmp(bytes.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+            return;
+        }
+        const char* h = bytes.data() + sizeof(BINARY_MAGIC);
+        auto field = [&](int i) { return std::uint64_t{load_u32(h + i * 4)}; };
+        std::uint64_t size = bytes.size();
+        if (field(0) != BINARY_FORMAT_VERSION || field(1) != static_cast<std::uint32_t>(kind) ||
+            field(2) != size ||
+            field(3) + field(4) * 4 > size ||
+            field(5) + field(6) * 8 > size ||
+            field(7) + field(8) > size) {
+            return;
+        }
+        body_ = bytes.data() + field(3);
+        words_ = static_cast<std::size_t>(field(4));
+        table_ = bytes.data() + field(5);
+        count_ = static_cast<std::size_t>(field(6));
+        data_ = bytes.data() + field(7);
+        data_size_ = static_cast<std::size_t>(field(8));
+        ok_ = true;
+    }
+
+    bool ok() const { return ok_; }
+    void fail() { ok_ = false; }
+
+    // True once every body word has been consumed without error
+    bool done() const { return ok_ && pos_ == words_; }
+
+    std::uint32_t u32() {
+        if (!ok_ || pos_ >= words_) {
+            ok_ = false;
+            return 0;
+        }
+        return load_u32(body_ + 4 * pos_++);
+    }
+
+    bool flag() {
+        std::uint32_t v = u32();
+        if (v > 1) ok_ = false;
+        return v == 1;
+    }
+
+    std::string_view str() {
+        std::uint32_t i = u32();
+        if (!ok_ || i >= count_) {
+            ok_ = false;
+            return {};
+        }
+        std::size_t offset = load_u32(table_ + 8 * std::size_t{i});
+        std::size_t length = load_u32(table_ + 8 * std::size_t{i} + 4);
+        if (offset >= data_size_ || length >= data_size_ - offset || data_[offset + length] != '\0') {
+            ok_ = false;
+            return {};
+        }
+        return {data_ + offset, length};
+    }
+
+    // Read a list count, rejecting counts the remaining body can't hold so a
+    // corrupt buffer can't trigger a huge reserve()
+    std::size_t count(std::size_t words_per_item) {
+        std::uint32_t n = u32();
+        if (ok_ && std::uint64_t{n} * words_per_item > words_ - pos_) {
+            ok_ = false;
+        }
+        return ok_ ? n : 0;
+    }
+
+    void strings(std::vector<std::string_view>& out) {
+        std::size_t n = count(1);
+        out.reserve(n);
+        for (std::size_t i = 0; i < n && ok_; ++i) out.push_back(str());
+    }
+
+    void string_map(std::vector<LaunchContractView::StringPair>& out) {
+        std::size_t n = count(2);
+        out.reserve(n);
+        for (std::size_t i = 0; i < n && ok_; ++i) {
+            auto key = str();
+            auto value = str();
+            out.emplace_back(key, value);
+        }
+    }
+
+private:
+    bool ok_ = false;
+    const char* body_ = nullptr;
+    std::size_t words_ = 0;
+    std::size_t pos_ = 0;
+    const char* table_ = nullptr;
+    std::size_t count_ = 0;
+    const char* data_ = nullptr;
+    std::size_t data_size_ = 0;
+};
+
+inline void encode_contract_body(Encoder& e, const core::LaunchContract& c) {
+    e.str(c.app.id);
+    e.str(c.app.version);
+    e.str(c.app.root);
+    e.str(c.app.entrypoint);
+
+    e.str(c.nak.id);
+    e.str(c.nak.version);
+    e.str(c.nak.root);
+    e.str(c.nak.resource_root);
+    e.str(c.nak.record_ref);
+
+    e.str(c.execution.binary);
+    e.strings(c.execution.arguments);
+    e.str(c.execution.cwd);
+    e.str(c.execution.library_path_env_key);
+    e.strings(c.execution.library_paths);
+
+    e.u32(narrow(c.environment.size()));
+    for (const auto& [key, value] : c.environment) {
+        e.str(key);
+        e.str(value);
+    }
+
+    e.strings(c.enforcement.filesystem);
+    e.strings(c.enforcement.network);
+
+    e.u32(static_cast<std::uint32_t>(c.trust.state));
+    e.str(c.trust.source);
+    e.str(c.trust.evaluated_at);
+    e.str(c.trust.expires_at);
+    e.str(c.trust.inputs_hash);
+    e.string_map(c.trust.details);
+
+    std::vector<const std::pair<const std::string, core::AssetExport>*> exports;
+    exports.reserve(c.exports.size());
+    for (const auto& kv : c.exports) exports.push_back(&kv);
+    std::sort(exports.begin(), exports.end(),
+              [](const auto* a, const auto* b) { return a->first < b->first; });
+    e.u32(narrow(exports.size()));
+    for (const auto* kv : exports) {
+        e.str(kv->first);
+        e.str(kv->second.id);
+        e.str(kv->second.path);
+        e.str(kv->second.type);
+    }
+
+    e.flag(c.capability_usage.present);
+    e.strings(c.capability_usage.required_capabilities);
+    e.strings(c.capability_usage.optional_capabilities);
+    e.strings(c.capability_usage.critical_capabilities);
+}
+
+inline void decode_contract_body(Decoder& d, LaunchContractView& c) {
+    c.app.id = d.str();
+    c.app.version = d.str();
+    c.app.root = d.str();
+    c.app.entrypoint = d.str();
+
+    c.nak.id = d.str();
+    c.nak.version = d.str();
+    c.nak.root = d.str();
+    c.nak.resource_root = d.str();
+    c.nak.record_ref = d.str();
+
+    c.execution.binary = d.str();
+    d.strings(c.execution.arguments);
+    c.execution.cwd = d.str();
+    c.execution.library_path_env_key = d.str();
+    d.strings(c.execution.library_paths);
+
+    d.string_map(c.environment);
+
+    d.strings(c.enforcement.filesystem);
+    d.strings(c.enforcement.network);
+
+    std::uint32_t state = d.u32();
+    if (state > static_cast<std::uint32_t>(core::TrustState::Unknown)) {
+        d.fail();
+    }
+    c.trust.state = static_cast<core::TrustState>(state);
+    c.trust.source = d.str();
+    c.trust.evaluated_at = d.str();
+    c.trust.expires_at = d.str();
+    c.trust.inputs_hash = d.str();
+    d.string_map(c.trust.details);
+
+    std::size_t exports = d.count(4);
+    c.exports.reserve(exports);
+    for (std::size_t i = 0; i < exports && d.ok(); ++i) {
+        LaunchContractView::Export x;
+        x.key = d.str();
+        x.id = d.str();
+        x.path = d.str();
+        x.type = d.str();
+        c.exports.push_back(x);
+    }
+
+    c.capability_usage.present = d.flag();
+    d.strings(c.capability_usage.required_capabilities);
+    d.strings(c.capability_usage.optional_capabilities);
+    d.strings(c.capability_usage.critical_capabilities);
+}
+
+inline std::vector<std::string> to_strings(const std::vector<std::string_view>& views) {
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+inline std::unordered_map<std::string, std::string>
+to_string_map(const std::vector<LaunchContractView::StringPair>& pairs) {
+    std::unordered_map<std::string, std::string> map;
+    map.reserve(pairs.size());
+    for (const auto& [key, value] : pairs) map.emplace(key, value);
+    return map;
+}
+
+} // namespace detail
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+/// Encode a launch contract. Returns an empty string if the encoding would
+/// exceed 4 GiB, which no decoder accepts.
+inline std::string encode_contract(const core::LaunchContract& contract) {
+    detail::Encoder e;
+    detail::encode_contract_body(e, contract);
+    return e.finish(Kind::Contract);
+}
+
+/// Encode a composition result. Traces are not encoded. Returns an empty
+/// string if the encoding would exceed 4 GiB.
+inline std::string encode_result(const core::CompositionResult& result) {
+    detail::Encoder e;
+    e.flag(result.ok);
+    e.u32(result.critical_error ? static_cast<std::uint32_t>(*result.critical_error) + 1 : 0u);
+    e.str(result.critical_error_context);
+
+    e.u32(detail::narrow(result.warnings.size()));
+    for (const auto& w : result.warnings) {
+        e.str(w.key);
+        e.str(w.action);
+        e.string_map(w.fields);
+    }
+
+    e.u32(detail::narrow(result.policy_violations.size()));
+    for (const auto& v : result.policy_violations) {
+        e.str(v.type);
+        e.str(v.target);
+        e.str(v.context);
+    }
+
+    // Lets readers of a view compare contracts without decoding them
+    auto fp = result.ok ? core::fingerprint(result.contract) : core::Fingerprint{};
+    e.u32(static_cast<std::uint32_t>(fp.high >> 32));
+    e.u32(static_cast<std::uint32_t>(fp.high));
+    e.u32(static_cast<std::uint32_t>(fp.low >> 32));
+    e.u32(static_cast<std::uint32_t>(fp.low));
+
+    detail::encode_contract_body(e, result.contract);
+    return e.finish(Kind::Result);
+}
+
+/// View an encoded launch contract without copying its strings. Returns
+/// nullopt if the buffer is truncated, corrupt, of another kind or of
+/// another format version.
+inline std::optional<LaunchContractView> view_contract(std::string_view bytes) {
+    detail::Decoder d(bytes, Kind::Contract);
+    LaunchContractView view;
+    detail::decode_contract_body(d, view);
+    if (!d.done()) {
+        return std::nullopt;
+    }
+    return view;
+}
+
+/// View an encoded composition result without copying its strings.
+inline std::optional<CompositionResultView> view_result(std::string_view bytes) {
+    detail::Decoder d(bytes, Kind::Result);
+    CompositionResultView view;
+    view.ok = d.flag();
+
+    std::uint32_t error = d.u32();
+    if (error > static_cast<std::uint32_t>(core::CriticalError::NAK_LOADER_INVALID) + 1) {
+        return std::nullopt;
+    }
+    if (error != 0) {
+        view.critical_error = static_cast<core::CriticalError>(error - 1);
+    }
+    view.critical_error_context = d.str();
+
+    std::size_t warnings = d.count(3);
+    view.warnings.reserve(warnings);
+    for (std::size_t i = 0; i < warnings && d.ok(); ++i) {
+        CompositionResultView::Warning w;
+        w.key = d.str();
+        w.action = d.str();
+        d.string_map(w.fields);
+        view.warnings.push_back(std::move(w));
+    }
+
+    std::size_t violations = d.count(3);
+    view.policy_violations.reserve(violations);
+    for (std::size_t i = 0; i < violations && d.ok(); ++i) {
+        CompositionResultView::PolicyViolation v;
+        v.type = d.str();
+        v.target = d.str();
+        v.context = d.str();
+        view.policy_violations.push_back(v);
+    }
+
+    std::uint64_t words[4];
+    for (auto& w : words) w = d.u32();
+    view.contract_fingerprint.high = (words[0] << 32) | words[1];
+    view.contract_fingerprint.low = (words[2] << 32) | words[3];
+
+    detail::decode_contract_body(d, view.contract);
+    if (!d.done()) {
+        return std::nullopt;
+    }
+    return view;
+}
+
+/// Decode an encoded launch contract into an owning LaunchContract.
+inline std::optional<core::LaunchContract> decode_contract(std::string_view bytes) {
+    auto view = view_contract(bytes);
+    if (!view) {
+        return std::nullopt;
+    }
+    return view->to_contract();
+}
+
+/// Decode an encoded composition result into an owning CompositionResult.
+inline std::optional<core::CompositionResult> decode_result(std::string_view bytes) {
+    auto view = view_result(bytes);
+    if (!view) {
+        return std::nullopt;
+    }
+    return view->to_result();
+}
+
+// ============================================================================
+// VIEW CONVERSIONS
+// ============================================================================
+
+inline core::LaunchContract LaunchContractView::to_contract() const {
+    core::LaunchContract c;
+    c.app.id = app.id;
+    c.app.version = app.version;
+    c.app.root = app.root;
+    c.app.entrypoint = app.entrypoint;
+
+    c.nak.id = nak.id;
+    c.nak.version = nak.version;
+    c.nak.root = nak.root;
+    c.nak.resource_root = nak.resource_root;
+    c.nak.record_ref = nak.record_ref;
+
+    c.execution.binary = execution.binary;
+    c.execution.arguments = detail::to_strings(execution.arguments);
+    c.execution.cwd = execution.cwd;
+    c.execution.library_path_env_key = execution.library_path_env_key;
+    c.execution.library_paths = detail::to_strings(execution.library_paths);
+
+    std::size_t bytes = 0;
+    for (const auto& [key, value] : environment) bytes += key.size() + value.size() + 2;
+    c.environment.reserve(environment.size(), bytes);
+    for (const auto& [key, value] : environment) c.environment.set(key, value);
+
+    c.enforcement.filesystem = detail::to_strings(enforcement.filesystem);
+    c.enforcement.network = detail::to_strings(enforcement.network);
+
+    c.trust.state = trust.state;
+    c.trust.source = trust.source;
+    c.trust.evaluated_at = trust.evaluated_at;
+    c.trust.expires_at = trust.expires_at;
+    c.trust.inputs_hash = trust.inputs_hash;
+    c.trust.details = detail::to_string_map(trust.details);
+
+    c.exports.reserve(exports.size());
+    for (const auto& x : exports) {
+        c.exports.emplace(std::string(x.key),
+                          core::AssetExport{std::string(x.id), std::string(x.path), std::string(x.type)});
+    }
+
+    c.capability_usage.present = capability_usage.present;
+    c.capability_usage.required_capabilities = detail::to_strings(capability_usage.required_capabilities);
+    c.capability_usage.optional_capabilities = detail::to_strings(capability_usage.optional_capabilities);
+    c.capability_usage.critical_capabilities = detail::to_strings(capability_usage.critical_capabilities);
+    return c;
+}
+
+inline core::CompositionResult CompositionResultView::to_result() const {
+    core::CompositionResult r;
+    r.ok = ok;
+    r.critical_error = critical_error;
+    r.critical_error_context = critical_error_context;
+    r.contract = contract.to_contract();
+
+    r.warnings.reserve(warnings.size());
+    for (const auto& w : warnings) {
+        core::WarningObject warning;
+        warning.key = w.key;
+        warning.action = w.action;
+        warning.fields = detail::to_string_map(w.fields);
+        r.warnings.push_back(std::move(warning));
+    }
+
+    r.policy_violations.reserve(policy_violations.size());
+    for (const auto& v : policy_violations) {
+        r.policy_violations.push_back({std::string(v.type), std::string(v.target), std::string(v.context)});
+    }
+
+    return r;
+}
+
+} // namespace binary
+} // namespace nah
+
+#endif // __cplusplus
+
+#endif // NAH_BINARY_H
@@ -55,7 +55,7 @@
  *
  *      HostEnvironment host_env;  // Empty = no host overrides
  *      RuntimeInventory inventory;
- *      inventory.runtimes["lua@5.4.6.json"] = your_lua_runtime;
+ *      inventory.add("lua@5.4.6.json", your_lua_runtime);
  *
  * 3. Compose and use the contract:
  *
@@ -92,11 +92,21 @@
 #ifdef __cplusplus
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <exception>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -458,6 +468,122 @@ struct CompositionTrace {
     std::vector<std::string> decisions;  ///< Human-readable decision log
 };
 
+/**
+ * Decision points recorded during composition.
+ */
+enum class TraceDecision : std::uint8_t {
+    Started,
+    DeclarationInvalid,
+    DeclarationValidated,
+    InstallRecordInvalid,
+    InstallRecordValidated,
+    RuntimeResolved,
+    StandaloneApp,
+    RuntimeNotFound,
+    RuntimeInvalid,
+    PathBindingFailed,
+    PathsBound,
+    LoaderOverride,
+    LoaderAutoDefault,
+    LoaderAutoSingle,
+    LoaderAmbiguous,
+    LoaderPinned,
+    LoaderNotFound,
+    EntrypointAsBinary,
+    TrustExpired,
+    Completed,
+};
+
+/**
+ * Decision log text for a decision code. Decisions that carry a detail
+ * (runtime or loader name) are logged as "<text>: <detail>".
+ */
+inline const char* trace_decision_to_string(TraceDecision d) {
+    switch (d) {
+        case TraceDecision::Started: return "Starting composition";
+        case TraceDecision::DeclarationInvalid: return "FAILED: Declaration validation failed";
+        case TraceDecision::DeclarationValidated: return "Declaration validated";
+        case TraceDecision::InstallRecordInvalid: return "FAILED: Install record validation failed";
+        case TraceDecision::InstallRecordValidated: return "Install record validated";
+        case TraceDecision::RuntimeResolved: return "Runtime resolved";
+        case TraceDecision::StandaloneApp: return "Standalone app (no runtime)";
+        case TraceDecision::RuntimeNotFound: return "Runtime not found";
+        case TraceDecision::RuntimeInvalid: return "FAILED: Runtime validation failed";
+        case TraceDecision::PathBindingFailed: return "FAILED: Path binding failed";
+        case TraceDecision::PathsBound: return "Paths bound successfully";
+        case TraceDecision::LoaderOverride: return "Loader override requested";
+        case TraceDecision::LoaderAutoDefault: return "Auto-selected 'default' loader";
+        case TraceDecision::LoaderAutoSingle: return "Auto-selected single loader";
+        case TraceDecision::LoaderAmbiguous: return "WARNING: Multiple loaders, using entrypoint";
+        case TraceDecision::LoaderPinned: return "Using pinned loader";
+        case TraceDecision::LoaderNotFound: return "FAILED: Loader not found";
+        case TraceDecision::EntrypointAsBinary: return "Using app entrypoint as binary";
+        case TraceDecision::TrustExpired: return "WARNING: Trust verification has expired";
+        case TraceDecision::Completed: return "Composition completed successfully";
+    }
+    return "unknown";
+}
+
+/**
+ * Environment layers, in the order compose_environment() applies them.
+ */
+enum class TraceSource : std::uint8_t {
+    Host,
+    NakRecord,
+    Manifest,
+    InstallRecord,
+    NahStandard,
+};
+
+inline const char* trace_source_to_string(TraceSource s) {
+    switch (s) {
+        case TraceSource::Host: return trace_source::HOST;
+        case TraceSource::NakRecord: return trace_source::NAK_RECORD;
+        case TraceSource::Manifest: return trace_source::MANIFEST;
+        case TraceSource::InstallRecord: return trace_source::INSTALL_RECORD;
+        case TraceSource::NahStandard: return trace_source::NAH_STANDARD;
+    }
+    return "unknown";
+}
+
+/**
+ * One environment contribution in a compact trace. The variable is
+ * identified by the FNV-1a hash of its name; values are not recorded.
+ */
+struct CompactTraceContribution {
+    std::uint64_t key_hash = 0;       ///< fnv1a(variable name)
+    TraceSource source = TraceSource::Host;
+    std::uint8_t precedence_rank = 0; ///< Same ranks as TraceContribution
+    EnvOp operation = EnvOp::Set;
+    bool accepted = false;
+};
+
+/**
+ * Allocation-light trace: decision codes and environment contributions in
+ * the order they happened, with no strings. Cheap enough to leave on in
+ * production; render with trace_decision_to_string() when needed.
+ */
+struct CompactCompositionTrace {
+    std::vector<TraceDecision> decisions;
+    std::vector<CompactTraceContribution> environment;
+};
+
+namespace detail {
+
+constexpr std::uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+constexpr std::uint64_t FNV1A_PRIME = 1099511628211ull;
+
+/// 64-bit FNV-1a, optionally continuing from a previous hash
+inline std::uint64_t fnv1a(std::string_view data, std::uint64_t hash = FNV1A_OFFSET_BASIS) {
+    for (char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+} // namespace detail
+
 // ============================================================================
 // COMPONENT DECLARATION
 // ============================================================================
@@ -609,6 +735,26 @@ struct HostEnvironment {
     std::string source_path;  ///< For tracing (e.g., "/nah/host/host.json")
 };
 
+// ============================================================================
+// PLACEHOLDER TEMPLATES
+// ============================================================================
+
+// A {VAR} template split once into literal text and placeholder names, so it
+// can be expanded many times without rescanning. Built by compile_template()
+// and expanded by expand_template(); the result is identical to calling
+// expand_placeholders() on the source string.
+struct CompiledTemplate {
+    struct Segment {
+        std::string text;          ///< Literal text, or placeholder name without braces
+        bool placeholder = false;  ///< True if text names a variable
+    };
+    
+    std::string source;            ///< The template this was compiled from
+    std::vector<Segment> segments;
+    size_t literal_size = 0;       ///< Total length of literal segments
+    size_t placeholder_count = 0;  ///< Number of placeholder segments
+};
+
 // ============================================================================
 // LOADER CONFIGURATION
 // ============================================================================
@@ -621,9 +767,16 @@ struct HostEnvironment {
 //
 // The args_template supports {VAR} placeholders that are expanded from the
 // environment before execution.
+//
+// args_compiled holds args_template pre-split by compile_template(). Parsers
+// fill it when the descriptor is loaded. Each compiled entry is used only
+// while its source still equals the corresponding args_template string, so
+// editing args_template without recompiling is safe: the changed arguments
+// are expanded directly.
 struct LoaderConfig {
     std::string exec_path;                   ///< Absolute path to interpreter/runtime
     std::vector<std::string> args_template;  ///< Arguments with {VAR} placeholders
+    std::vector<CompiledTemplate> args_compiled;  ///< args_template, compiled
 };
 
 // ============================================================================
@@ -774,17 +927,28 @@ struct InstallRecord {
 
 // Collection of available runtimes on the host.
 //
-// Maps record_ref (e.g., "lua@5.4.6.json") to RuntimeDescriptor.
+// Maps record_ref (e.g., "lua@5.4.6.json") to a RuntimeDescriptor.
 // The InstallRecord's nak.record_ref is used as the key to look up the runtime.
 //
+// Descriptors are immutable and shared: copying an inventory, resolving a
+// runtime or composing a contract only copies pointers, never the loaders
+// and environment inside.
+//
 // Example:
 //
 //     RuntimeInventory inventory;
-//     inventory.runtimes["lua@5.4.6.json"] = lua_descriptor;
-//     inventory.runtimes["node@20.0.0.json"] = node_descriptor;
+//     inventory.add("lua@5.4.6.json", lua_descriptor);
+//     inventory.add("node@20.0.0.json", node_descriptor);
 //
+using RuntimeDescriptorPtr = std::shared_ptr<const RuntimeDescriptor>;
+
 struct RuntimeInventory {
-    std::unordered_map<std::string, RuntimeDescriptor> runtimes;
+    std::unordered_map<std::string, RuntimeDescriptorPtr> runtimes;
+
+    // Add or replace the runtime for record_ref
+    void add(const std::string& record_ref, RuntimeDescriptor runtime) {
+        runtimes[record_ref] = std::make_shared<const RuntimeDescriptor>(std::move(runtime));
+    }
 };
 
 // ============================================================================
@@ -879,6 +1043,259 @@ struct CapabilityUsage {
     std::vector<std::string> critical_capabilities;
 };
 
+// ============================================================================
+// FLAT ENVIRONMENT
+// ============================================================================
+
+// The environment of a launch contract, kept sorted by key.
+//
+// Every variable is stored as a NUL-terminated "KEY=VALUE" record in one
+// contiguous string, with a sorted index of (offset, key length, value
+// length) next to it. Lookups are a binary search, iteration is in key order
+// (so serialization is byte-stable), and envp() hands the records to exec
+// without building a "KEY=VALUE" string per variable.
+//
+//     FlatEnvironment env;
+//     env.set("PATH", "/usr/bin");
+//     env["HOME"] = "/home/user";
+//     for (const auto& [key, value] : env) { ... }   // string_views, sorted
+//     execve(binary, argv, env.envp().data());
+//
+// Keys and values are returned as string_views into the arena; they, like
+// iterators and envp() pointers, are invalidated by any modification.
+class FlatEnvironment {
+public:
+    using value_type = std::pair<std::string_view, std::string_view>;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatEnvironment::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator() = default;
+
+        value_type operator*() const { return {env_->key_at(index_), env_->value_at(index_)}; }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { auto tmp = *this; ++index_; return tmp; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class FlatEnvironment;
+        const_iterator(const FlatEnvironment* env, size_t index) : env_(env), index_(index) {}
+
+        const FlatEnvironment* env_ = nullptr;
+        size_t index_ = 0;
+    };
+
+    // Proxy returned by operator[]. Assigning sets the variable; reading a
+    // missing variable yields "" without inserting it.
+    class Ref {
+    public:
+        Ref& operator=(std::string_view value) { env_->set(key_, value); return *this; }
+        Ref& operator=(const Ref& other) { return *this = std::string(other); }
+
+        operator std::string_view() const {
+            auto it = env_->find(key_);
+            return it == env_->end() ? std::string_view() : (*it).second;
+        }
+        operator std::string() const { return std::string(std::string_view(*this)); }
+
+        friend bool operator==(const Ref& ref, std::string_view value) { return std::string_view(ref) == value; }
+        friend bool operator!=(const Ref& ref, std::string_view value) { return std::string_view(ref) != value; }
+
+    private:
+        friend class FlatEnvironment;
+        Ref(FlatEnvironment* env, std::string_view key) : env_(env), key_(key) {}
+
+        FlatEnvironment* env_;
+        std::string key_;
+    };
+
+    FlatEnvironment() = default;
+
+    FlatEnvironment(std::initializer_list<std::pair<std::string, std::string>> vars) {
+        for (const auto& [key, value] : vars) set(key, value);
+    }
+
+    FlatEnvironment(const std::unordered_map<std::string, std::string>& vars) {
+        std::vector<const std::pair<const std::string, std::string>*> sorted;
+        sorted.reserve(vars.size());
+        size_t bytes = 0;
+        for (const auto& kv : vars) {
+            sorted.push_back(&kv);
+            bytes += kv.first.size() + kv.second.size() + 2;
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto* a, const auto* b) { return a->first < b->first; });
+        reserve(sorted.size(), bytes);
+        for (const auto* kv : sorted) set(kv->first, kv->second);
+    }
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    void clear() {
+        entries_.clear();
+        arena_.clear();
+        garbage_ = 0;
+    }
+
+    // Reserve room for `count` variables totalling `bytes` of "KEY=VALUE\0"
+    void reserve(size_t count, size_t bytes) {
+        entries_.reserve(count);
+        arena_.reserve(bytes);
+    }
+
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, entries_.size()}; }
+
+    const_iterator find(std::string_view key) const {
+        size_t i = lower_bound(key);
+        return (i < entries_.size() && key_at(i) == key) ? const_iterator(this, i) : end();
+    }
+
+    size_t count(std::string_view key) const { return find(key) == end() ? 0 : 1; }
+
+    // Value of `key`; throws std::out_of_range if it is not set
+    std::string_view at(std::string_view key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatEnvironment::at: " + std::string(key));
+        }
+        return (*it).second;
+    }
+
+    Ref operator[](std::string_view key) { return Ref(this, key); }
+
+    // Set (insert or overwrite) a variable
+    void set(std::string_view key, std::string_view value) {
+        // The arena may reallocate below; copy views that point into it
+        if (points_into_arena(key) || points_into_arena(value)) {
+            std::string k(key), v(value);
+            set(k, v);
+            return;
+        }
+
+        size_t i = lower_bound(key);
+        bool exists = i < entries_.size() && key_at(i) == key;
+        if (exists && value_at(i) == value) {
+            return;
+        }
+
+        Entry entry{arena_.size(), key.size(), value.size()};
+        arena_.append(key.data(), key.size());
+        arena_ += '=';
+        arena_.append(value.data(), value.size());
+        arena_ += '\0';
+
+        if (exists) {
+            garbage_ += record_size(entries_[i]);
+            entries_[i] = entry;
+            maybe_compact();
+        } else {
+            entries_.insert(entries_.begin() + static_cast<std::ptrdiff_t>(i), entry);
+        }
+    }
+
+    // Remove a variable; returns false if it was not set
+    bool erase(std::string_view key) {
+        size_t i = lower_bound(key);
+        if (i >= entries_.size() || key_at(i) != key) {
+            return false;
+        }
+        garbage_ += record_size(entries_[i]);
+        entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(i));
+        maybe_compact();
+        return true;
+    }
+
+    // NUL-terminated "KEY=VALUE" pointers in key order, followed by nullptr
+    std::vector<char*> envp() const {
+        std::vector<char*> result;
+        result.reserve(entries_.size() + 1);
+        for (const auto& e : entries_) {
+            result.push_back(const_cast<char*>(arena_.data() + e.offset));
+        }
+        result.push_back(nullptr);
+        return result;
+    }
+
+    std::unordered_map<std::string, std::string> to_map() const {
+        std::unordered_map<std::string, std::string> result;
+        result.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); i++) {
+            result.emplace(key_at(i), value_at(i));
+        }
+        return result;
+    }
+
+    bool operator==(const FlatEnvironment& other) const {
+        if (size() != other.size()) return false;
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (key_at(i) != other.key_at(i) || value_at(i) != other.value_at(i)) return false;
+        }
+        return true;
+    }
+    bool operator!=(const FlatEnvironment& other) const { return !(*this == other); }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t key_size;
+        size_t value_size;
+    };
+
+    std::string_view key_at(size_t i) const {
+        return {arena_.data() + entries_[i].offset, entries_[i].key_size};
+    }
+
+    std::string_view value_at(size_t i) const {
+        const auto& e = entries_[i];
+        return {arena_.data() + e.offset + e.key_size + 1, e.value_size};
+    }
+
+    static size_t record_size(const Entry& e) { return e.key_size + e.value_size + 2; }
+
+    size_t lower_bound(std::string_view key) const {
+        size_t lo = 0, hi = entries_.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (key_at(mid) < key) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+    }
+
+    bool points_into_arena(std::string_view sv) const {
+        return !arena_.empty() && sv.data() >= arena_.data() &&
+               sv.data() < arena_.data() + arena_.size();
+    }
+
+    // Rewrite the arena without overwritten or erased records once they
+    // make up more than half of it
+    void maybe_compact() {
+        if (garbage_ < 4096 || garbage_ * 2 < arena_.size()) {
+            return;
+        }
+        std::string compacted;
+        compacted.reserve(arena_.size() - garbage_);
+        for (auto& e : entries_) {
+            size_t offset = compacted.size();
+            compacted.append(arena_, e.offset, record_size(e));
+            e.offset = offset;
+        }
+        arena_ = std::move(compacted);
+        garbage_ = 0;
+    }
+
+    std::string arena_;
+    std::vector<Entry> entries_;
+    size_t garbage_ = 0;
+};
+
 // ============================================================================
 // LAUNCH CONTRACT
 // ============================================================================
@@ -894,9 +1311,9 @@ struct CapabilityUsage {
 //     if (result.ok) {
 //         const auto& c = result.contract;
 //
-//         // Set environment
+//         // Set environment (sorted by key)
 //         for (const auto& [key, value] : c.environment) {
-//             setenv(key.c_str(), value.c_str(), 1);
+//             setenv(std::string(key).c_str(), std::string(value).c_str(), 1);
 //         }
 //
 //         // Set library path
@@ -949,8 +1366,8 @@ struct LaunchContract {
         std::vector<std::string> library_paths;  ///< Library search paths
     } execution;
 
-    // Complete environment map (ready to pass to exec)
-    std::unordered_map<std::string, std::string> environment;
+    // Complete environment, sorted by key (ready to pass to exec)
+    FlatEnvironment environment;
 
     // Capability/permission requirements for sandboxing
     struct {
@@ -968,6 +1385,318 @@ struct LaunchContract {
     CapabilityUsage capability_usage;
 };
 
+// ============================================================================
+// FINGERPRINTS
+// ============================================================================
+
+// A stable 128-bit hash of a NAH value, for deduplication, caching and change
+// detection without serializing.
+//
+//     auto a = fingerprint(result_a.contract);
+//     auto b = fingerprint(result_b.contract);
+//     if (a == b) { /* same launch, byte for byte */ }
+//     cache[a.low] = ...;   // 64-bit form
+//
+// Every field that carries a value is hashed, in a fixed order, with each
+// string length-prefixed. Unordered maps (exports, trust details, EnvMap,
+// loaders) are hashed entry by entry and combined order-independently, so
+// the fingerprint doesn't depend on hash-table iteration order. Tracing-only
+// fields (source_path) and derived ones (LoaderConfig::args_compiled) are
+// left out.
+//
+// Fingerprints are equal across platforms and runs for equal values. The
+// encoding is versioned by FINGERPRINT_VERSION, which is hashed in; compare
+// fingerprints only from the same version. Not a cryptographic hash.
+constexpr std::uint32_t FINGERPRINT_VERSION = 1;
+
+struct Fingerprint {
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;   ///< Usable on its own as a 64-bit fingerprint
+
+    // 32 lowercase hex digits, high half first
+    std::string hex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(32, '0');
+        for (int i = 0; i < 16; i++) {
+            out[static_cast<size_t>(15 - i)] = digits[(high >> (4 * i)) & 0xf];
+            out[static_cast<size_t>(31 - i)] = digits[(low >> (4 * i)) & 0xf];
+        }
+        return out;
+    }
+
+    bool operator==(const Fingerprint& o) const { return high == o.high && low == o.low; }
+    bool operator!=(const Fingerprint& o) const { return !(*this == o); }
+    bool operator<(const Fingerprint& o) const {
+        return high != o.high ? high < o.high : low < o.low;
+    }
+};
+
+namespace detail {
+
+// Two independently seeded 64-bit lanes fed a word at a time (xxHash64-style
+// rounds), with an avalanche finish. Input bytes are read little-endian so
+// the result doesn't depend on the host's byte order.
+class FingerprintHasher {
+public:
+    explicit FingerprintHasher(std::string_view domain) {
+        u64(FINGERPRINT_VERSION);
+        str(domain);
+    }
+
+    void u64(std::uint64_t v) {
+        a_ = round(a_, v, P2, P1);
+        b_ = round(b_, v, P3, P4);
+        length_ += 8;
+    }
+
+    void flag(bool v) { u64(v ? 1u : 0u); }
+
+    void str(std::string_view s) {
+        u64(s.size());
+        const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+        size_t n = s.size();
+        for (; n >= 8; p += 8, n -= 8) {
+            std::uint64_t w = 0;
+            for (int i = 7; i >= 0; i--) w = (w << 8) | p[i];
+            u64(w);
+        }
+        if (n > 0) {
+            std::uint64_t w = 0;
+            for (size_t i = n; i-- > 0;) w = (w << 8) | p[i];
+            u64(w);
+        }
+    }
+
+    void strings(const std::vector<std::string>& v) {
+        u64(v.size());
+        for (const auto& s : v) str(s);
+    }
+
+    // Hash each entry of an unordered container with `entry(hasher, item)`
+    // and fold the results in with a commutative sum
+    template <typename Map, typename Fn>
+    void unordered(const Map& map, Fn&& entry) {
+        std::uint64_t high = 0, low = 0;
+        for (const auto& item : map) {
+            FingerprintHasher h("entry");
+            entry(h, item);
+            auto f = h.finish();
+            high += f.high;
+            low += f.low;
+        }
+        u64(map.size());
+        u64(high);
+        u64(low);
+    }
+
+    Fingerprint finish() const {
+        return {avalanche(b_ ^ rotl(a_, 17) ^ length_), avalanche(a_ ^ length_)};
+    }
+
+private:
+    static constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+    static constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr std::uint64_t P3 = 0x165667B19E3779F9ull;
+    static constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t w, std::uint64_t m, std::uint64_t p) {
+        return rotl(acc + w * m, 31) * p;
+    }
+
+    static std::uint64_t avalanche(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    std::uint64_t a_ = 0x27D4EB2F165667C5ull;
+    std::uint64_t b_ = 0x61C8864E7A143579ull;
+    std::uint64_t length_ = 0;
+};
+
+inline void hash_env_map(FingerprintHasher& h, const EnvMap& env) {
+    h.unordered(env, [](FingerprintHasher& e, const auto& kv) {
+        e.str(kv.first);
+        e.u64(static_cast<std::uint64_t>(kv.second.op));
+        e.str(kv.second.value);
+        e.str(kv.second.separator);
+    });
+}
+
+inline void hash_string_map(FingerprintHasher& h, const std::unordered_map<std::string, std::string>& m) {
+    h.unordered(m, [](FingerprintHasher& e, const auto& kv) {
+        e.str(kv.first);
+        e.str(kv.second);
+    });
+}
+
+inline void hash_trust(FingerprintHasher& h, const TrustInfo& t) {
+    h.u64(static_cast<std::uint64_t>(t.state));
+    h.str(t.source);
+    h.str(t.evaluated_at);
+    h.str(t.expires_at);
+    h.str(t.inputs_hash);
+    hash_string_map(h, t.details);
+}
+
+} // namespace detail
+
+inline Fingerprint fingerprint(const LaunchContract& c) {
+    detail::FingerprintHasher h("LaunchContract");
+    h.str(c.app.id);
+    h.str(c.app.version);
+    h.str(c.app.root);
+    h.str(c.app.entrypoint);
+    h.str(c.nak.id);
+    h.str(c.nak.version);
+    h.str(c.nak.root);
+    h.str(c.nak.resource_root);
+    h.str(c.nak.record_ref);
+    h.str(c.execution.binary);
+    h.strings(c.execution.arguments);
+    h.str(c.execution.cwd);
+    h.str(c.execution.library_path_env_key);
+    h.strings(c.execution.library_paths);
+    // Already sorted by key
+    h.u64(c.environment.size());
+    for (const auto& [key, value] : c.environment) {
+        h.str(key);
+        h.str(value);
+    }
+    h.strings(c.enforcement.filesystem);
+    h.strings(c.enforcement.network);
+    detail::hash_trust(h, c.trust);
+    h.unordered(c.exports, [](detail::FingerprintHasher& e, const auto& kv) {
+        e.str(kv.first);
+        e.str(kv.second.id);
+        e.str(kv.second.path);
+        e.str(kv.second.type);
+    });
+    h.flag(c.capability_usage.present);
+    h.strings(c.capability_usage.required_capabilities);
+    h.strings(c.capability_usage.optional_capabilities);
+    h.strings(c.capability_usage.critical_capabilities);
+    return h.finish();
+}
+
+inline Fingerprint fingerprint(const AppDeclaration& d) {
+    detail::FingerprintHasher h("AppDeclaration");
+    h.str(d.id);
+    h.str(d.version);
+    h.str(d.entrypoint_path);
+    h.str(d.nak_id);
+    h.str(d.nak_version_req);
+    h.str(d.nak_loader);
+    h.strings(d.entrypoint_args);
+    h.strings(d.env_vars);
+    h.strings(d.lib_dirs);
+    h.strings(d.asset_dirs);
+    h.u64(d.asset_exports.size());
+    for (const auto& e : d.asset_exports) {
+        h.str(e.id);
+        h.str(e.path);
+        h.str(e.type);
+    }
+    h.strings(d.permissions_filesystem);
+    h.strings(d.permissions_network);
+    h.str(d.description);
+    h.str(d.author);
+    h.str(d.license);
+    h.str(d.homepage);
+    h.u64(d.components.size());
+    for (const auto& c : d.components) {
+        h.str(c.id);
+        h.str(c.name);
+        h.str(c.description);
+        h.str(c.icon);
+        h.str(c.entrypoint);
+        h.str(c.uri_pattern);
+        h.str(c.loader);
+        h.flag(c.standalone);
+        h.flag(c.hidden);
+        detail::hash_env_map(h, c.environment);
+        h.strings(c.permissions_filesystem);
+        h.strings(c.permissions_network);
+        detail::hash_string_map(h, c.metadata);
+    }
+    return h.finish();
+}
+
+inline Fingerprint fingerprint(const InstallRecord& r) {
+    detail::FingerprintHasher h("InstallRecord");
+    h.str(r.install.instance_id);
+    h.str(r.app.id);
+    h.str(r.app.version);
+    h.str(r.app.nak_id);
+    h.str(r.app.nak_version_req);
+    h.str(r.nak.id);
+    h.str(r.nak.version);
+    h.str(r.nak.record_ref);
+    h.str(r.nak.loader);
+    h.str(r.nak.selection_reason);
+    h.str(r.paths.install_root);
+    h.str(r.provenance.package_hash);
+    h.str(r.provenance.installed_at);
+    h.str(r.provenance.installed_by);
+    h.str(r.provenance.source);
+    detail::hash_trust(h, r.trust);
+    h.str(r.verification.last_verified_at);
+    h.str(r.verification.last_verifier_version);
+    detail::hash_env_map(h, r.overrides.environment);
+    h.strings(r.overrides.arguments.prepend);
+    h.strings(r.overrides.arguments.append);
+    h.strings(r.overrides.paths.library_prepend);
+    return h.finish();
+}
+
+inline Fingerprint fingerprint(const RuntimeDescriptor& r) {
+    detail::FingerprintHasher h("RuntimeDescriptor");
+    h.str(r.nak.id);
+    h.str(r.nak.version);
+    h.str(r.paths.root);
+    h.str(r.paths.resource_root);
+    h.strings(r.paths.lib_dirs);
+    detail::hash_env_map(h, r.environment);
+    h.unordered(r.loaders, [](detail::FingerprintHasher& e, const auto& kv) {
+        e.str(kv.first);
+        e.str(kv.second.exec_path);
+        e.strings(kv.second.args_template);
+    });
+    h.flag(r.execution.present);
+    h.str(r.execution.cwd);
+    h.str(r.provenance.package_hash);
+    h.str(r.provenance.installed_at);
+    h.str(r.provenance.installed_by);
+    h.str(r.provenance.source);
+    return h.finish();
+}
+
+inline Fingerprint fingerprint(const HostEnvironment& e) {
+    detail::FingerprintHasher h("HostEnvironment");
+    detail::hash_env_map(h, e.vars);
+    h.strings(e.paths.library_prepend);
+    h.strings(e.paths.library_append);
+    h.flag(e.overrides.allow_env_overrides);
+    h.strings(e.overrides.allowed_env_keys);
+    return h.finish();
+}
+
+inline Fingerprint fingerprint(const RuntimeInventory& inventory) {
+    detail::FingerprintHasher h("RuntimeInventory");
+    h.unordered(inventory.runtimes, [](detail::FingerprintHasher& e, const auto& kv) {
+        e.str(kv.first);
+        auto runtime = kv.second ? fingerprint(*kv.second) : Fingerprint{};
+        e.u64(runtime.high);
+        e.u64(runtime.low);
+    });
+    return h.finish();
+}
+
 // ============================================================================
 // POLICY VIOLATION
 // ============================================================================
@@ -986,8 +1715,16 @@ struct PolicyViolation {
 // Options passed to nah_compose().
 struct CompositionOptions {
     bool enable_trace = false;       ///< If true, result.trace will be populated
+    bool enable_compact_trace = false;  ///< If true (and not enable_trace), result.compact_trace will be populated
     std::string now;                 ///< Current time (RFC3339) for trust staleness checks
     std::string loader_override;     ///< Override loader selection (empty = use install record)
+
+    /// Memory for composition's intermediate state: the working environment,
+    /// sort order and expansion buffers (null = default resource). The result
+    /// never refers to it, so a monotonic_buffer_resource can be released as
+    /// soon as nah_compose() returns. Batches share it across workers, so it
+    /// must then be thread-safe (e.g. synchronized_pool_resource).
+    std::pmr::memory_resource* memory_resource = nullptr;
 };
 
 // ============================================================================
@@ -1022,6 +1759,95 @@ struct CompositionResult {
     std::vector<WarningObject> warnings;          ///< Non-fatal warnings
     std::vector<PolicyViolation> policy_violations;
     std::optional<CompositionTrace> trace;        ///< Detailed trace (if options.enable_trace)
+    std::optional<CompactCompositionTrace> compact_trace;  ///< Compact trace (if options.enable_compact_trace)
+};
+
+// ============================================================================
+// TRACE POLICIES
+// ============================================================================
+
+// Tracing is a compile-time policy of nah_compose<Trace>() and
+// compose_environment<Trace>(). Each policy attaches its storage to the
+// result and receives decisions and environment contributions:
+//
+//     NoTrace      - records nothing; every call is an empty inline function,
+//                    so the bookkeeping compiles away
+//     FullTrace    - fills result.trace with strings, as enable_trace always has
+//     CompactTrace - fills result.compact_trace with decision codes, source
+//                    ranks and key hashes
+//
+// Decision details are passed as callables so the strings are only built
+// when a policy actually keeps them.
+
+struct NoTrace {
+    static constexpr bool enabled = false;
+
+    static NoTrace attach(CompositionResult&) { return {}; }
+
+    // Take anything, convert nothing
+    template <typename... Args>
+    void decision(Args&&...) {}
+
+    template <typename... Args>
+    void env(Args&&...) {}
+};
+
+struct FullTrace {
+    static constexpr bool enabled = true;
+
+    CompositionTrace* trace;
+
+    static FullTrace attach(CompositionResult& result) {
+        result.trace.emplace();
+        return {&*result.trace};
+    }
+
+    void decision(TraceDecision d) {
+        trace->decisions.emplace_back(trace_decision_to_string(d));
+    }
+
+    template <typename DetailFn>
+    void decision(TraceDecision d, DetailFn&& detail) {
+        trace->decisions.push_back(std::string(trace_decision_to_string(d)) + ": " + detail());
+    }
+
+    void env(std::string_view key, std::string_view value, TraceSource source,
+             std::string_view path, int rank, EnvOp op, bool accepted) {
+        TraceContribution contrib;
+        contrib.value = std::string(value);
+        contrib.source_kind = trace_source_to_string(source);
+        contrib.source_path = std::string(path);
+        contrib.precedence_rank = rank;
+        contrib.operation = op;
+        contrib.accepted = accepted;
+        trace->environment[std::string(key)].history.push_back(std::move(contrib));
+    }
+};
+
+struct CompactTrace {
+    static constexpr bool enabled = true;
+
+    CompactCompositionTrace* trace;
+
+    static CompactTrace attach(CompositionResult& result) {
+        result.compact_trace.emplace();
+        return {&*result.compact_trace};
+    }
+
+    void decision(TraceDecision d) {
+        trace->decisions.push_back(d);
+    }
+
+    template <typename DetailFn>
+    void decision(TraceDecision d, DetailFn&&) {
+        trace->decisions.push_back(d);
+    }
+
+    void env(std::string_view key, std::string_view, TraceSource source,
+             std::string_view, int rank, EnvOp op, bool accepted) {
+        trace->environment.push_back({detail::fnv1a(key), source,
+                                      static_cast<std::uint8_t>(rank), op, accepted});
+    }
 };
 
 // ============================================================================
@@ -1342,92 +2168,325 @@ struct ExpansionResult {
 };
 
 /**
- * Expand {VAR} placeholders in a string.
+ * Why a placeholder expansion stopped. The names double as the
+ * invalid_configuration reasons composition reports.
+ */
+enum class ExpansionError : std::uint8_t {
+    none,
+    placeholder_limit,   ///< More than MAX_PLACEHOLDERS placeholders
+    expansion_overflow,  ///< Result longer than MAX_EXPANDED_SIZE bytes
+};
+
+inline const char* expansion_error_to_string(ExpansionError e) {
+    switch (e) {
+        case ExpansionError::none: return "none";
+        case ExpansionError::placeholder_limit: return "placeholder_limit";
+        case ExpansionError::expansion_overflow: return "expansion_overflow";
+    }
+    return "unknown";
+}
+
+/**
+ * Split a string into literal and {VAR} placeholder segments.
  * 
- * Single-pass, no recursion. Missing variables become empty strings.
- * Enforces size and count limits to prevent DoS.
+ * A '{' with no closing '}' is literal text, as in expand_placeholders().
  */
-inline ExpansionResult expand_placeholders(
-    const std::string& input,
-    const std::unordered_map<std::string, std::string>& env)
-{
-    ExpansionResult result;
-    result.value.reserve(input.size());
-    
-    size_t placeholder_count = 0;
-    size_t i = 0;
-    
-    while (i < input.size()) {
-        if (input[i] == '{') {
-            size_t end = input.find('}', i + 1);
-            if (end != std::string::npos) {
-                std::string var_name = input.substr(i + 1, end - i - 1);
-                
-                placeholder_count++;
-                if (placeholder_count > MAX_PLACEHOLDERS) {
-                    result.ok = false;
-                    result.error = "placeholder_limit";
-                    return result;
-                }
-                
-                auto it = env.find(var_name);
-                if (it != env.end()) {
-                    result.value += it->second;
-                }
-                
-                if (result.value.size() > MAX_EXPANDED_SIZE) {
-                    result.ok = false;
-                    result.error = "expansion_overflow";
-                    return result;
-                }
-                
-                i = end + 1;
-                continue;
-            }
+inline CompiledTemplate compile_template(const std::string& input) {
+    CompiledTemplate tmpl;
+    tmpl.source = input;
+    size_t literal_start = 0;
+    size_t i = input.find('{');
+    
+    while (i != std::string::npos) {
+        size_t end = input.find('}', i + 1);
+        if (end == std::string::npos) {
+            break;
         }
-        
-        result.value += input[i];
-        i++;
-        
-        if (result.value.size() > MAX_EXPANDED_SIZE) {
-            result.ok = false;
-            result.error = "expansion_overflow";
-            return result;
+        if (i > literal_start) {
+            tmpl.segments.push_back({input.substr(literal_start, i - literal_start), false});
+            tmpl.literal_size += i - literal_start;
         }
+        tmpl.segments.push_back({input.substr(i + 1, end - i - 1), true});
+        tmpl.placeholder_count++;
+        literal_start = end + 1;
+        i = input.find('{', literal_start);
     }
     
-    return result;
+    if (literal_start < input.size()) {
+        tmpl.segments.push_back({input.substr(literal_start), false});
+        tmpl.literal_size += input.size() - literal_start;
+    }
+    
+    return tmpl;
 }
 
 /**
- * Expand placeholders in a vector of strings.
+ * Compile each string in a vector.
  */
-inline std::vector<std::string> expand_string_vector(
-    const std::vector<std::string>& inputs,
-    const std::unordered_map<std::string, std::string>& env)
-{
-    std::vector<std::string> result;
+inline std::vector<CompiledTemplate> compile_templates(const std::vector<std::string>& inputs) {
+    std::vector<CompiledTemplate> result;
     result.reserve(inputs.size());
-    
     for (const auto& input : inputs) {
-        auto expanded = expand_placeholders(input, env);
-        result.push_back(expanded.ok ? expanded.value : input);
+        result.push_back(compile_template(input));
     }
-    
     return result;
 }
 
-// ============================================================================
-// PURE FUNCTIONS - Runtime Resolution
-// ============================================================================
-
-/**
- * Runtime resolution result.
+namespace detail {
+
+// Append the expansion of a compiled template to `out`. On error `out` holds
+// a partial expansion. `var_name` is scratch space for keys that are not
+// std::string.
+template <typename Env, typename Out>
+inline ExpansionError expand_template_into(
+    const CompiledTemplate& tmpl,
+    const Env& env,
+    Out& out,
+    typename Env::key_type& var_name)
+{
+    size_t placeholder_count = 0;
+    for (const auto& segment : tmpl.segments) {
+        if (segment.placeholder) {
+            if (++placeholder_count > MAX_PLACEHOLDERS) {
+                return ExpansionError::placeholder_limit;
+            }
+            typename Env::const_iterator it;
+            if constexpr (std::is_same_v<typename Env::key_type, std::string>) {
+                it = env.find(segment.text);
+            } else {
+                var_name.assign(segment.text);
+                it = env.find(var_name);
+            }
+            if (it != env.end()) {
+                out.append(it->second);
+            }
+        } else {
+            out.append(segment.text);
+        }
+        
+        if (out.size() > MAX_EXPANDED_SIZE) {
+            return ExpansionError::expansion_overflow;
+        }
+    }
+    return ExpansionError::none;
+}
+
+// Append the expansion of `input` to `out`, as expand_placeholders() does.
+template <typename Env, typename Out>
+inline ExpansionError expand_placeholders_into(
+    std::string_view input,
+    const Env& env,
+    Out& out,
+    typename Env::key_type& var_name)
+{
+    size_t placeholder_count = 0;
+    size_t literal_start = 0;
+    size_t i = input.find('{');
+    
+    while (i != std::string_view::npos) {
+        size_t end = input.find('}', i + 1);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        
+        out.append(input.substr(literal_start, i - literal_start));
+        if (out.size() > MAX_EXPANDED_SIZE) {
+            return ExpansionError::expansion_overflow;
+        }
+        
+        if (++placeholder_count > MAX_PLACEHOLDERS) {
+            return ExpansionError::placeholder_limit;
+        }
+        
+        var_name.assign(input.substr(i + 1, end - i - 1));
+        auto it = env.find(var_name);
+        if (it != env.end()) {
+            out.append(it->second);
+        }
+        
+        if (out.size() > MAX_EXPANDED_SIZE) {
+            return ExpansionError::expansion_overflow;
+        }
+        
+        literal_start = end + 1;
+        i = input.find('{', literal_start);
+    }
+    
+    out.append(input.substr(literal_start));
+    if (out.size() > MAX_EXPANDED_SIZE) {
+        return ExpansionError::expansion_overflow;
+    }
+    return ExpansionError::none;
+}
+
+} // namespace detail
+
+/**
+ * Expand a compiled template.
+ * 
+ * Same semantics and limits as expand_placeholders(): single-pass, missing
+ * variables become empty strings, and more than MAX_PLACEHOLDERS placeholders
+ * or more than MAX_EXPANDED_SIZE bytes of output is an error.
+ */
+inline ExpansionResult expand_template(
+    const CompiledTemplate& tmpl,
+    const std::unordered_map<std::string, std::string>& env)
+{
+    ExpansionResult result;
+    result.value.reserve(std::min(tmpl.literal_size, MAX_EXPANDED_SIZE + 1));
+    
+    std::string var_name;
+    auto error = detail::expand_template_into(tmpl, env, result.value, var_name);
+    if (error != ExpansionError::none) {
+        result.ok = false;
+        result.error = expansion_error_to_string(error);
+    }
+    return result;
+}
+
+/**
+ * Expand {VAR} placeholders in a string.
+ * 
+ * Single-pass, no recursion. Missing variables become empty strings.
+ * Enforces size and count limits to prevent DoS.
+ * 
+ * For a string that is expanded repeatedly, compile it once with
+ * compile_template() and use expand_template() instead.
+ */
+inline ExpansionResult expand_placeholders(
+    const std::string& input,
+    const std::unordered_map<std::string, std::string>& env)
+{
+    ExpansionResult result;
+    
+    // Nothing to expand; the common case for environment values
+    if (input.find('{') == std::string::npos) {
+        if (input.size() > MAX_EXPANDED_SIZE) {
+            result.ok = false;
+            result.error = "expansion_overflow";
+        } else {
+            result.value = input;
+        }
+        return result;
+    }
+    
+    result.value.reserve(std::min(input.size(), MAX_EXPANDED_SIZE + 1));
+    
+    std::string var_name;
+    auto error = detail::expand_placeholders_into(input, env, result.value, var_name);
+    if (error != ExpansionError::none) {
+        result.ok = false;
+        result.error = expansion_error_to_string(error);
+    }
+    return result;
+}
+
+namespace detail {
+
+// Expand one input and append it to `out`; an input that fails to expand
+// is kept verbatim, as in expand_string_vector()
+template <typename Env>
+inline void append_expanded_one(
+    std::vector<std::string>& out,
+    const std::string& input,
+    const Env& env,
+    typename Env::key_type& var_name)
+{
+    if (input.find('{') == std::string::npos) {
+        out.push_back(input);
+        return;
+    }
+    std::string value;
+    value.reserve(std::min(input.size(), MAX_EXPANDED_SIZE + 1));
+    auto error = expand_placeholders_into(input, env, value, var_name);
+    if (error != ExpansionError::none) {
+        out.push_back(input);
+    } else {
+        out.push_back(std::move(value));
+    }
+}
+
+// append_expanded_one() for each input
+template <typename Env>
+inline void append_expanded(
+    std::vector<std::string>& out,
+    const std::vector<std::string>& inputs,
+    const Env& env,
+    typename Env::key_type& var_name)
+{
+    for (const auto& input : inputs) {
+        append_expanded_one(out, input, env, var_name);
+    }
+}
+
+// Loader counterpart of append_expanded(), as in expand_loader_args()
+template <typename Env>
+inline void append_loader_args(
+    std::vector<std::string>& out,
+    const LoaderConfig& loader,
+    const Env& env,
+    typename Env::key_type& var_name)
+{
+    for (size_t i = 0; i < loader.args_template.size(); i++) {
+        // A template edited since it was compiled is expanded as written
+        if (i >= loader.args_compiled.size() || loader.args_compiled[i].source != loader.args_template[i]) {
+            append_expanded_one(out, loader.args_template[i], env, var_name);
+            continue;
+        }
+        const auto& tmpl = loader.args_compiled[i];
+        std::string value;
+        value.reserve(std::min(tmpl.literal_size, MAX_EXPANDED_SIZE + 1));
+        auto error = expand_template_into(tmpl, env, value, var_name);
+        if (error != ExpansionError::none) {
+            out.push_back(loader.args_template[i]);
+        } else {
+            out.push_back(std::move(value));
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Expand placeholders in a vector of strings.
+ */
+inline std::vector<std::string> expand_string_vector(
+    const std::vector<std::string>& inputs,
+    const std::unordered_map<std::string, std::string>& env)
+{
+    std::vector<std::string> result;
+    result.reserve(inputs.size());
+    std::string var_name;
+    detail::append_expanded(result, inputs, env, var_name);
+    return result;
+}
+
+/**
+ * Expand a loader's argument templates, using the precompiled form when it
+ * matches args_template. A template that fails to expand is kept verbatim.
+ */
+inline std::vector<std::string> expand_loader_args(
+    const LoaderConfig& loader,
+    const std::unordered_map<std::string, std::string>& env)
+{
+    std::vector<std::string> result;
+    result.reserve(loader.args_template.size());
+    std::string var_name;
+    detail::append_loader_args(result, loader, env, var_name);
+    return result;
+}
+
+// ============================================================================
+// PURE FUNCTIONS - Runtime Resolution
+// ============================================================================
+
+/**
+ * Runtime resolution result.
  */
 struct RuntimeResolutionResult {
     bool resolved = false;
     std::string record_ref;
-    RuntimeDescriptor runtime;
+    RuntimeDescriptorPtr runtime;  ///< Shared with the inventory; null for standalone apps
     std::string selection_reason;
     std::vector<std::string> warnings;
 };
@@ -1460,7 +2519,7 @@ inline RuntimeResolutionResult resolve_runtime(
     }
     
     auto it = inventory.runtimes.find(record_ref);
-    if (it == inventory.runtimes.end()) {
+    if (it == inventory.runtimes.end() || !it->second) {
         result.warnings.push_back("NAK not found in inventory: " + record_ref);
         return result;
     }
@@ -1568,64 +2627,55 @@ inline PathBindingResult bind_paths(
 // PURE FUNCTIONS - Environment Composition
 // ============================================================================
 
-/**
- * Compose environment from all sources.
- * 
- * Precedence (highest to lowest):
- * 1. NAH standard variables (NAH_APP_*, NAH_NAK_*)
- * 2. Install record overrides
- * 3. App manifest defaults (fill-only)
- * 4. NAK environment
- * 5. Host environment
- */
-inline std::unordered_map<std::string, std::string> compose_environment(
+namespace detail {
+
+// The working environment of one composition
+using ScratchEnvironment = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+
+// Compose the environment into `env`, which may be a std:: or std::pmr::
+// string map. Values are edited in place, so each layer costs no more than
+// the map node and strings it adds.
+template <typename Env, typename Trace>
+inline void compose_environment_into(
+    Env& env,
     const AppDeclaration& decl,
     const InstallRecord& install,
     const RuntimeDescriptor* runtime,
     const HostEnvironment& host_env,
     const LaunchContract& contract,
-    CompositionTrace* trace = nullptr)
+    Trace& trace)
 {
-    std::unordered_map<std::string, std::string> env;
+    typename Env::key_type key(env.get_allocator());
     
-    auto record = [&](const std::string& key, const std::string& value,
-                      const std::string& kind, const std::string& path,
-                      int rank, EnvOp op, bool accepted) {
-        if (trace) {
-            TraceContribution contrib;
-            contrib.value = value;
-            contrib.source_kind = kind;
-            contrib.source_path = path;
-            contrib.precedence_rank = rank;
-            contrib.operation = op;
-            contrib.accepted = accepted;
-            trace->environment[key].history.push_back(contrib);
+    auto apply = [&](const std::string& name, const EnvValue& val, TraceSource source,
+                     const std::string& path, int rank) {
+        key.assign(name);
+        if (val.op == EnvOp::Unset) {
+            env.erase(key);
+            trace.env(name, "", source, path, rank, val.op, true);
+            return;
         }
+        auto [it, inserted] = env.try_emplace(key);
+        auto& value = it->second;
+        if (inserted || value.empty() || val.op == EnvOp::Set) {
+            value.assign(val.value);
+        } else if (val.op == EnvOp::Prepend) {
+            value.insert(0, val.separator).insert(0, val.value);
+        } else {
+            value.append(val.separator).append(val.value);
+        }
+        trace.env(name, value, source, path, rank, val.op, true);
     };
     
     // Layer 1: Host environment (rank 5)
-    for (const auto& [key, val] : host_env.vars) {
-        auto result = apply_env_op(key, val, env);
-        if (result.has_value()) {
-            env[key] = *result;
-            record(key, *result, trace_source::HOST, host_env.source_path, 5, val.op, true);
-        } else {
-            env.erase(key);
-            record(key, "", trace_source::HOST, host_env.source_path, 5, val.op, true);
-        }
+    for (const auto& [name, val] : host_env.vars) {
+        apply(name, val, TraceSource::Host, host_env.source_path, 5);
     }
     
     // Layer 2: NAK environment (rank 4)
     if (runtime) {
-        for (const auto& [key, val] : runtime->environment) {
-            auto result = apply_env_op(key, val, env);
-            if (result.has_value()) {
-                env[key] = *result;
-                record(key, *result, trace_source::NAK_RECORD, runtime->source_path, 4, val.op, true);
-            } else {
-                env.erase(key);
-                record(key, "", trace_source::NAK_RECORD, runtime->source_path, 4, val.op, true);
-            }
+        for (const auto& [name, val] : runtime->environment) {
+            apply(name, val, TraceSource::NakRecord, runtime->source_path, 4);
         }
     }
     
@@ -1633,55 +2683,86 @@ inline std::unordered_map<std::string, std::string> compose_environment(
     for (const auto& env_var : decl.env_vars) {
         auto eq = env_var.find('=');
         if (eq != std::string::npos) {
-            std::string key = env_var.substr(0, eq);
-            std::string val = env_var.substr(eq + 1);
-            bool accepted = (env.find(key) == env.end());
+            std::string_view entry(env_var);
+            key.assign(entry.substr(0, eq));
+            auto [it, accepted] = env.try_emplace(key);
             if (accepted) {
-                env[key] = val;
+                it->second.assign(entry.substr(eq + 1));
             }
-            record(key, val, trace_source::MANIFEST, "manifest", 3, EnvOp::Set, accepted);
+            trace.env(entry.substr(0, eq), entry.substr(eq + 1), TraceSource::Manifest,
+                      "manifest", 3, EnvOp::Set, accepted);
         }
     }
     
     // Layer 4: Install record overrides (rank 2)
-    for (const auto& [key, val] : install.overrides.environment) {
-        auto result = apply_env_op(key, val, env);
-        if (result.has_value()) {
-            env[key] = *result;
-            record(key, *result, trace_source::INSTALL_RECORD, install.source_path, 2, val.op, true);
-        } else {
-            env.erase(key);
-            record(key, "", trace_source::INSTALL_RECORD, install.source_path, 2, val.op, true);
-        }
+    for (const auto& [name, val] : install.overrides.environment) {
+        apply(name, val, TraceSource::InstallRecord, install.source_path, 2);
     }
     
     // Layer 5: NAH standard variables (rank 1, always set)
-    env["NAH_APP_ID"] = contract.app.id;
-    record("NAH_APP_ID", contract.app.id, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
-    
-    env["NAH_APP_VERSION"] = contract.app.version;
-    record("NAH_APP_VERSION", contract.app.version, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
-    
-    env["NAH_APP_ROOT"] = contract.app.root;
-    record("NAH_APP_ROOT", contract.app.root, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
+    auto set_standard = [&](std::string_view name, const std::string& value) {
+        key.assign(name);
+        env[key].assign(value);
+        trace.env(name, value, TraceSource::NahStandard, "nah", 1, EnvOp::Set, true);
+    };
     
-    env["NAH_APP_ENTRY"] = contract.app.entrypoint;
-    record("NAH_APP_ENTRY", contract.app.entrypoint, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
+    set_standard("NAH_APP_ID", contract.app.id);
+    set_standard("NAH_APP_VERSION", contract.app.version);
+    set_standard("NAH_APP_ROOT", contract.app.root);
+    set_standard("NAH_APP_ENTRY", contract.app.entrypoint);
     
     if (runtime) {
-        env["NAH_NAK_ID"] = runtime->nak.id;
-        record("NAH_NAK_ID", runtime->nak.id, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
-        
-        env["NAH_NAK_VERSION"] = runtime->nak.version;
-        record("NAH_NAK_VERSION", runtime->nak.version, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
-        
-        env["NAH_NAK_ROOT"] = runtime->paths.root;
-        record("NAH_NAK_ROOT", runtime->paths.root, trace_source::NAH_STANDARD, "nah", 1, EnvOp::Set, true);
+        set_standard("NAH_NAK_ID", runtime->nak.id);
+        set_standard("NAH_NAK_VERSION", runtime->nak.version);
+        set_standard("NAH_NAK_ROOT", runtime->paths.root);
     }
-    
+}
+
+} // namespace detail
+
+/**
+ * Compose environment from all sources.
+ * 
+ * Precedence (highest to lowest):
+ * 1. NAH standard variables (NAH_APP_*, NAH_NAK_*)
+ * 2. Install record overrides
+ * 3. App manifest defaults (fill-only)
+ * 4. NAK environment
+ * 5. Host environment
+ */
+template <typename Trace>
+inline std::unordered_map<std::string, std::string> compose_environment(
+    const AppDeclaration& decl,
+    const InstallRecord& install,
+    const RuntimeDescriptor* runtime,
+    const HostEnvironment& host_env,
+    const LaunchContract& contract,
+    Trace& trace)
+{
+    std::unordered_map<std::string, std::string> env;
+    detail::compose_environment_into(env, decl, install, runtime, host_env, contract, trace);
     return env;
 }
 
+/**
+ * Compose the environment, recording into `trace` when it is non-null.
+ */
+inline std::unordered_map<std::string, std::string> compose_environment(
+    const AppDeclaration& decl,
+    const InstallRecord& install,
+    const RuntimeDescriptor* runtime,
+    const HostEnvironment& host_env,
+    const LaunchContract& contract,
+    CompositionTrace* trace = nullptr)
+{
+    if (trace) {
+        FullTrace policy{trace};
+        return compose_environment(decl, install, runtime, host_env, contract, policy);
+    }
+    NoTrace policy;
+    return compose_environment(decl, install, runtime, host_env, contract, policy);
+}
+
 // ============================================================================
 // PURE FUNCTIONS - Timestamp Comparison
 // ============================================================================
@@ -1733,6 +2814,10 @@ inline bool timestamp_before(const std::string& a, const std::string& b) {
 // always produce the same output. This makes it safe to call from any context
 // and easy to test.
 //
+// The Trace template parameter (NoTrace, FullTrace or CompactTrace) fixes at
+// compile time what is recorded; with NoTrace no tracing code is generated.
+// The non-template overload below picks a policy from options.
+//
 // Example:
 //
 //     AppDeclaration app;
@@ -1749,7 +2834,7 @@ inline bool timestamp_before(const std::string& a, const std::string& b) {
 //     HostEnvironment host_env;  // Empty = no host overrides
 //
 //     RuntimeInventory inventory;
-//     inventory.runtimes["lua@5.4.6.json"] = lua_runtime;
+//     inventory.add("lua@5.4.6.json", lua_runtime);
 //
 //     auto result = nah_compose(app, host_env, install, inventory);
 //     if (result.ok) {
@@ -1758,6 +2843,7 @@ inline bool timestamp_before(const std::string& a, const std::string& b) {
 //         // result.contract.environment = {"LUA_PATH": "...", "NAH_APP_ID": "com.example.game", ...}
 //     }
 //
+template <typename Trace>
 inline CompositionResult nah_compose(
     const AppDeclaration& app,
     const HostEnvironment& host_env,
@@ -1767,13 +2853,8 @@ inline CompositionResult nah_compose(
 {
     CompositionResult result;
     
-    // Initialize trace if enabled
-    CompositionTrace* trace_ptr = nullptr;
-    if (options.enable_trace) {
-        result.trace = CompositionTrace{};
-        trace_ptr = &(*result.trace);
-        trace_ptr->decisions.push_back("Starting composition");
-    }
+    Trace trace = Trace::attach(result);
+    trace.decision(TraceDecision::Started);
     
     // Validate declaration
     auto decl_valid = validate_declaration(app);
@@ -1786,10 +2867,10 @@ inline CompositionResult nah_compose(
                 warning_to_string(Warning::invalid_manifest), "error", {{"reason", err}}
             });
         }
-        if (trace_ptr) trace_ptr->decisions.push_back("FAILED: Declaration validation failed");
+        trace.decision(TraceDecision::DeclarationInvalid);
         return result;
     }
-    if (trace_ptr) trace_ptr->decisions.push_back("Declaration validated");
+    trace.decision(TraceDecision::DeclarationValidated);
     
     // Validate install record
     auto install_valid = validate_install_record(install);
@@ -1797,10 +2878,10 @@ inline CompositionResult nah_compose(
         result.critical_error = CriticalError::INSTALL_RECORD_INVALID;
         result.critical_error_context = install_valid.errors.empty() ?
             "invalid install record" : install_valid.errors[0];
-        if (trace_ptr) trace_ptr->decisions.push_back("FAILED: Install record validation failed");
+        trace.decision(TraceDecision::InstallRecordInvalid);
         return result;
     }
-    if (trace_ptr) trace_ptr->decisions.push_back("Install record validated");
+    trace.decision(TraceDecision::InstallRecordValidated);
     
     // Resolve runtime
     auto runtime_result = resolve_runtime(app, install, inventory);
@@ -1810,17 +2891,17 @@ inline CompositionResult nah_compose(
         });
     }
     
-    RuntimeDescriptor* runtime_ptr = runtime_result.resolved && !runtime_result.runtime.nak.id.empty()
-        ? &runtime_result.runtime : nullptr;
+    const RuntimeDescriptor* runtime_ptr = runtime_result.resolved && runtime_result.runtime &&
+        !runtime_result.runtime->nak.id.empty() ? runtime_result.runtime.get() : nullptr;
     
-    if (trace_ptr) {
-        if (runtime_ptr) {
-            trace_ptr->decisions.push_back("Runtime resolved: " + runtime_ptr->nak.id + "@" + runtime_ptr->nak.version);
-        } else if (app.nak_id.empty()) {
-            trace_ptr->decisions.push_back("Standalone app (no runtime)");
-        } else {
-            trace_ptr->decisions.push_back("Runtime not found");
-        }
+    if (runtime_ptr) {
+        trace.decision(TraceDecision::RuntimeResolved, [&] {
+            return runtime_ptr->nak.id + "@" + runtime_ptr->nak.version;
+        });
+    } else if (app.nak_id.empty()) {
+        trace.decision(TraceDecision::StandaloneApp);
+    } else {
+        trace.decision(TraceDecision::RuntimeNotFound);
     }
     
     // Validate runtime if present
@@ -1830,7 +2911,7 @@ inline CompositionResult nah_compose(
             result.critical_error = CriticalError::PATH_TRAVERSAL;
             result.critical_error_context = runtime_valid.errors.empty() ?
                 "invalid runtime" : runtime_valid.errors[0];
-            if (trace_ptr) trace_ptr->decisions.push_back("FAILED: Runtime validation failed");
+            trace.decision(TraceDecision::RuntimeInvalid);
             return result;
         }
     }
@@ -1858,24 +2939,32 @@ inline CompositionResult nah_compose(
         result.critical_error_context = paths.violations.empty() ?
             "path binding failed" : paths.violations[0].context;
         result.policy_violations = paths.violations;
-        if (trace_ptr) trace_ptr->decisions.push_back("FAILED: Path binding failed");
+        trace.decision(TraceDecision::PathBindingFailed);
         return result;
     }
     
     contract.app.entrypoint = paths.entrypoint;
-    contract.exports = paths.exports;
-    if (trace_ptr) trace_ptr->decisions.push_back("Paths bound successfully");
-    
-    // Compose environment
-    auto env = compose_environment(app, install, runtime_ptr, host_env, contract, trace_ptr);
-    
-    // Determine execution binary and arguments
+    contract.exports = std::move(paths.exports);
+    trace.decision(TraceDecision::PathsBound);
+    
+    // Compose environment. The working state lives in options.memory_resource;
+    // only what ends up in the contract is allocated from the heap.
+    std::pmr::memory_resource* scratch = options.memory_resource ?
+        options.memory_resource : std::pmr::get_default_resource();
+    detail::ScratchEnvironment env(scratch);
+    env.reserve(host_env.vars.size() + install.overrides.environment.size() +
+                app.env_vars.size() + (runtime_ptr ? runtime_ptr->environment.size() : 0) + 7);
+    detail::compose_environment_into(env, app, install, runtime_ptr, host_env, contract, trace);
+    std::pmr::string var_name(scratch);
+    
+    // Determine execution binary
     std::string pinned_loader = install.nak.loader;
+    const LoaderConfig* loader = nullptr;
     
     // Override loader if specified in options
     if (!options.loader_override.empty()) {
         pinned_loader = options.loader_override;
-        if (trace_ptr) trace_ptr->decisions.push_back("Loader override requested: " + pinned_loader);
+        trace.decision(TraceDecision::LoaderOverride, [&] { return pinned_loader; });
     }
     
     if (runtime_ptr && runtime_ptr->has_loaders()) {
@@ -1884,10 +2973,10 @@ inline CompositionResult nah_compose(
         if (effective_loader.empty()) {
             if (runtime_ptr->loaders.count("default")) {
                 effective_loader = "default";
-                if (trace_ptr) trace_ptr->decisions.push_back("Auto-selected 'default' loader");
+                trace.decision(TraceDecision::LoaderAutoDefault);
             } else if (runtime_ptr->loaders.size() == 1) {
                 effective_loader = runtime_ptr->loaders.begin()->first;
-                if (trace_ptr) trace_ptr->decisions.push_back("Auto-selected single loader: " + effective_loader);
+                trace.decision(TraceDecision::LoaderAutoSingle, [&] { return effective_loader; });
             } else {
                 result.warnings.push_back({
                     warning_to_string(Warning::nak_loader_required),
@@ -1895,10 +2984,10 @@ inline CompositionResult nah_compose(
                     {{"reason", "multiple loaders but none specified"}}
                 });
                 contract.execution.binary = contract.app.entrypoint;
-                if (trace_ptr) trace_ptr->decisions.push_back("WARNING: Multiple loaders, using entrypoint");
+                trace.decision(TraceDecision::LoaderAmbiguous);
             }
         } else {
-            if (trace_ptr) trace_ptr->decisions.push_back("Using pinned loader: " + effective_loader);
+            trace.decision(TraceDecision::LoaderPinned, [&] { return effective_loader; });
         }
         
         if (!effective_loader.empty()) {
@@ -1906,46 +2995,43 @@ inline CompositionResult nah_compose(
             if (it == runtime_ptr->loaders.end()) {
                 result.critical_error = CriticalError::NAK_LOADER_INVALID;
                 result.critical_error_context = "loader not found: " + effective_loader;
-                if (trace_ptr) trace_ptr->decisions.push_back("FAILED: Loader not found");
+                trace.decision(TraceDecision::LoaderNotFound);
                 return result;
             }
             
             contract.execution.binary = it->second.exec_path;
-            contract.execution.arguments = expand_string_vector(it->second.args_template, env);
+            loader = &it->second;
         }
     } else {
         contract.execution.binary = contract.app.entrypoint;
-        if (trace_ptr) trace_ptr->decisions.push_back("Using app entrypoint as binary");
+        trace.decision(TraceDecision::EntrypointAsBinary);
     }
     
-    // Apply argument overrides
-    auto expanded_prepend = expand_string_vector(install.overrides.arguments.prepend, env);
-    contract.execution.arguments.insert(
-        contract.execution.arguments.begin(),
-        expanded_prepend.begin(),
-        expanded_prepend.end());
-    
-    auto expanded_entry_args = expand_string_vector(app.entrypoint_args, env);
-    contract.execution.arguments.insert(
-        contract.execution.arguments.end(),
-        expanded_entry_args.begin(),
-        expanded_entry_args.end());
-    
-    auto expanded_append = expand_string_vector(install.overrides.arguments.append, env);
-    contract.execution.arguments.insert(
-        contract.execution.arguments.end(),
-        expanded_append.begin(),
-        expanded_append.end());
+    // Arguments: install prepend overrides, loader arguments, entrypoint
+    // arguments, install append overrides
+    auto& arguments = contract.execution.arguments;
+    arguments.reserve(install.overrides.arguments.prepend.size() +
+                      (loader ? loader->args_template.size() : 0) +
+                      app.entrypoint_args.size() +
+                      install.overrides.arguments.append.size());
+    detail::append_expanded(arguments, install.overrides.arguments.prepend, env, var_name);
+    if (loader) {
+        detail::append_loader_args(arguments, *loader, env, var_name);
+    }
+    detail::append_expanded(arguments, app.entrypoint_args, env, var_name);
+    detail::append_expanded(arguments, install.overrides.arguments.append, env, var_name);
     
     // Determine cwd
     if (runtime_ptr && runtime_ptr->execution.present && !runtime_ptr->execution.cwd.empty()) {
-        auto cwd_expanded = expand_placeholders(runtime_ptr->execution.cwd, env);
-        if (cwd_expanded.ok && is_absolute_path(cwd_expanded.value)) {
-            contract.execution.cwd = cwd_expanded.value;
-        } else if (cwd_expanded.ok) {
-            contract.execution.cwd = join_path(runtime_ptr->paths.root, cwd_expanded.value);
-        } else {
+        std::string cwd;
+        const auto& cwd_template = runtime_ptr->execution.cwd;
+        auto error = detail::expand_placeholders_into(cwd_template, env, cwd, var_name);
+        if (error != ExpansionError::none) {
             contract.execution.cwd = contract.app.root;
+        } else if (is_absolute_path(cwd)) {
+            contract.execution.cwd = std::move(cwd);
+        } else {
+            contract.execution.cwd = join_path(runtime_ptr->paths.root, cwd);
         }
     } else {
         contract.execution.cwd = contract.app.root;
@@ -1953,16 +3039,31 @@ inline CompositionResult nah_compose(
     
     // Library paths
     contract.execution.library_path_env_key = get_library_path_env_key();
-    contract.execution.library_paths = paths.library_paths;
-    
-    // Expand environment placeholders
-    for (auto& [key, val] : env) {
-        auto expanded = expand_placeholders(val, env);
-        if (expanded.ok) {
-            val = expanded.value;
+    contract.execution.library_paths = std::move(paths.library_paths);
+    
+    // Expand environment placeholders in key order against the unexpanded
+    // snapshot, so no value sees another's expansion (single-pass)
+    std::pmr::vector<const detail::ScratchEnvironment::value_type*> sorted_env(scratch);
+    sorted_env.reserve(env.size());
+    size_t env_bytes = 0;
+    for (const auto& kv : env) {
+        sorted_env.push_back(&kv);
+        env_bytes += kv.first.size() + kv.second.size() + 2;
+    }
+    std::sort(sorted_env.begin(), sorted_env.end(),
+              [](const auto* a, const auto* b) { return a->first < b->first; });
+    
+    contract.environment.reserve(sorted_env.size(), env_bytes);
+    std::pmr::string expanded(scratch);
+    for (const auto* kv : sorted_env) {
+        if (kv->second.find('{') == std::pmr::string::npos) {
+            contract.environment.set(kv->first, kv->second);
+            continue;
         }
+        expanded.clear();
+        auto error = detail::expand_placeholders_into(kv->second, env, expanded, var_name);
+        contract.environment.set(kv->first, error != ExpansionError::none ? kv->second : expanded);
     }
-    contract.environment = env;
     
     // Enforcement
     for (const auto& perm : app.permissions_filesystem) {
@@ -2009,197 +3110,525 @@ inline CompositionResult nah_compose(
     if (!install.trust.expires_at.empty() && !options.now.empty()) {
         if (timestamp_before(install.trust.expires_at, options.now)) {
             result.warnings.push_back({warning_to_string(Warning::trust_state_stale), "warn", {}});
-            if (trace_ptr) trace_ptr->decisions.push_back("WARNING: Trust verification has expired");
+            trace.decision(TraceDecision::TrustExpired);
         }
     }
     
-    if (trace_ptr) trace_ptr->decisions.push_back("Composition completed successfully");
+    trace.decision(TraceDecision::Completed);
     
     result.ok = true;
     return result;
 }
 
+/**
+ * Compose with the trace policy selected by options: FullTrace if
+ * enable_trace, else CompactTrace if enable_compact_trace, else NoTrace.
+ * Call nah_compose<Policy>() directly to fix the policy at compile time.
+ */
+inline CompositionResult nah_compose(
+    const AppDeclaration& app,
+    const HostEnvironment& host_env,
+    const InstallRecord& install,
+    const RuntimeInventory& inventory,
+    const CompositionOptions& options = {})
+{
+    if (options.enable_trace) {
+        return nah_compose<FullTrace>(app, host_env, install, inventory, options);
+    }
+    if (options.enable_compact_trace) {
+        return nah_compose<CompactTrace>(app, host_env, install, inventory, options);
+    }
+    return nah_compose<NoTrace>(app, host_env, install, inventory, options);
+}
+
+// ============================================================================
+// BATCH COMPOSITION
+// ============================================================================
+
+namespace detail {
+
+// Run fn(i) for every i in [0, count) on up to `workers` threads.
+//
+// workers == 0 uses std::thread::hardware_concurrency(). Indices are handed
+// out through a shared counter, so callers that write into slot i of a
+// pre-sized vector get results in input order regardless of scheduling.
+// The first exception thrown by fn is rethrown on the calling thread after
+// all workers have joined.
+template <typename Fn>
+inline void parallel_for(size_t count, size_t workers, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+    }
+    workers = std::max<size_t>(1, std::min(workers, count));
+
+    if (workers == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t t = 1; t < workers; ++t) {
+        threads.emplace_back(run);
+    }
+    run();
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace detail
+
+// One app to compose in a batch: its declaration and install record.
+// Host environment and inventory are shared across the whole batch.
+struct ComposeInput {
+    AppDeclaration app;
+    InstallRecord install;
+};
+
+// Options passed to nah_compose_batch().
+struct BatchCompositionOptions {
+    CompositionOptions compose;      ///< Applied to every composition in the batch
+    size_t workers = 0;              ///< Worker threads (0 = hardware concurrency)
+};
+
+// Compose launch contracts for many apps against one host environment and
+// one runtime inventory.
+//
+// Each input is composed with nah_compose(); the host environment and
+// inventory are only read, so they are shared by all workers without
+// copying. Results are returned in input order and are identical to what
+// calling nah_compose() on each input in sequence would produce.
+//
+// Example:
+//
+//     std::vector<ComposeInput> inputs = load_all_installed_apps();
+//     BatchCompositionOptions opts;
+//     opts.workers = 8;
+//     auto results = nah_compose_batch(inputs, host_env, inventory, opts);
+//     // results[i] corresponds to inputs[i]
+//
+inline std::vector<CompositionResult> nah_compose_batch(
+    const std::vector<ComposeInput>& inputs,
+    const HostEnvironment& host_env,
+    const RuntimeInventory& inventory,
+    const BatchCompositionOptions& options = {})
+{
+    std::vector<CompositionResult> results(inputs.size());
+    detail::parallel_for(inputs.size(), options.workers, [&](size_t i) {
+        results[i] = nah_compose(inputs[i].app, host_env, inputs[i].install,
+                                 inventory, options.compose);
+    });
+    return results;
+}
+
 // ============================================================================
 // JSON SERIALIZATION (Pure, No External Dependencies)
 // ============================================================================
 
 namespace json {
 
+namespace detail {
+
+// What each byte becomes inside a JSON string: 0 = itself, 'u' = \u00XX,
+// anything else = a backslash followed by that character
+struct EscapeTable {
+    char map[256] = {};
+
+    constexpr EscapeTable() {
+        for (int c = 0; c < 0x20; ++c) map[c] = 'u';
+        map[static_cast<unsigned char>('"')] = '"';
+        map[static_cast<unsigned char>('\\')] = '\\';
+        map[static_cast<unsigned char>('\b')] = 'b';
+        map[static_cast<unsigned char>('\f')] = 'f';
+        map[static_cast<unsigned char>('\n')] = 'n';
+        map[static_cast<unsigned char>('\r')] = 'r';
+        map[static_cast<unsigned char>('\t')] = 't';
+    }
+};
+
+inline constexpr EscapeTable escape_table{};
+
+} // namespace detail
+
+/**
+ * Append s to out, escaped for use inside a JSON string. Runs of bytes that
+ * need no escaping (nearly all of a path or value) are appended in one go.
+ */
+inline void escape_into(std::string& out, std::string_view s) {
+    static const char* hex = "0123456789abcdef";
+    const char* p = s.data();
+    const char* end = p + s.size();
+    while (p < end) {
+        const char* run = p;
+        while (p < end && detail::escape_table.map[static_cast<unsigned char>(*p)] == 0) ++p;
+        out.append(run, static_cast<size_t>(p - run));
+        if (p == end) break;
+
+        auto c = static_cast<unsigned char>(*p++);
+        char e = detail::escape_table.map[c];
+        out += '\\';
+        out += e;
+        if (e == 'u') {
+            out += "00";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+        }
+    }
+}
+
 /**
  * Escape a string for JSON output.
  */
 inline std::string escape(const std::string& s) {
     std::string result;
     result.reserve(s.size() + 16);
-    for (char c : s) {
-        switch (c) {
-            case '"': result += "\\\""; break;
-            case '\\': result += "\\\\"; break;
-            case '\b': result += "\\b"; break;
-            case '\f': result += "\\f"; break;
-            case '\n': result += "\\n"; break;
-            case '\r': result += "\\r"; break;
-            case '\t': result += "\\t"; break;
-            default:
-                if (static_cast<unsigned char>(c) < 0x20) {
-                    char buf[8];
-                    snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
-                    result += buf;
-                } else {
-                    result += c;
-                }
-        }
-    }
+    escape_into(result, s);
     return result;
 }
 
+/**
+ * Streaming JSON writer.
+ *
+ * Appends to a single buffer instead of building and concatenating a string
+ * per value. Constructed with a FILE*, it writes the buffer out whenever it
+ * grows past flush_threshold, so arbitrarily large documents are produced in
+ * bounded memory:
+ *
+ *     json::Writer out(stdout);
+ *     write_result(out, result);
+ *     out.raw("\n");
+ *
+ * Without a sink the document accumulates and take() returns it. The
+ * composite helpers (object(), array()) use the layout of serialize_contract():
+ * one entry per line, indented two spaces past `indent`, keys sorted.
+ */
+class Writer {
+public:
+    Writer() = default;
+
+    explicit Writer(std::FILE* sink, size_t flush_threshold = 64 * 1024)
+        : sink_(sink), flush_threshold_(flush_threshold) {
+        buffer_.reserve(flush_threshold);
+    }
+
+    ~Writer() { flush(); }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    Writer& raw(std::string_view s) {
+        buffer_.append(s);
+        return maybe_flush();
+    }
+
+    Writer& indent(size_t n) {
+        buffer_.append(n, ' ');
+        return *this;
+    }
+
+    /// A quoted, escaped JSON string
+    Writer& string(std::string_view s) {
+        buffer_ += '"';
+        escape_into(buffer_, s);
+        buffer_ += '"';
+        return maybe_flush();
+    }
+
+    Writer& boolean(bool b) { return raw(b ? "true" : "false"); }
+
+    /// `"key": ` at the given indent
+    Writer& key(std::string_view k, size_t indent_by) {
+        indent(indent_by);
+        string(k);
+        return raw(": ");
+    }
+
+    /// A string map as a JSON object, sorted by key
+    Writer& object(const std::unordered_map<std::string, std::string>& m, size_t indent_by = 0) {
+        if (m.empty()) return raw("{}");
+
+        std::vector<const std::pair<const std::string, std::string>*> sorted;
+        sorted.reserve(m.size());
+        for (const auto& kv : m) sorted.push_back(&kv);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        raw("{\n");
+        for (size_t i = 0; i < sorted.size(); i++) {
+            key(sorted[i]->first, indent_by + 2).string(sorted[i]->second);
+            raw(i + 1 < sorted.size() ? ",\n" : "\n");
+        }
+        return indent(indent_by).raw("}");
+    }
+
+    /// A flat environment as a JSON object (already sorted by key)
+    Writer& object(const FlatEnvironment& env, size_t indent_by = 0) {
+        if (env.empty()) return raw("{}");
+
+        raw("{\n");
+        size_t i = 0;
+        for (const auto& [k, v] : env) {
+            key(k, indent_by + 2).string(v);
+            raw(++i < env.size() ? ",\n" : "\n");
+        }
+        return indent(indent_by).raw("}");
+    }
+
+    /// A string vector as a JSON array
+    Writer& array(const std::vector<std::string>& v, size_t indent_by = 0) {
+        if (v.empty()) return raw("[]");
+
+        raw("[\n");
+        for (size_t i = 0; i < v.size(); i++) {
+            indent(indent_by + 2).string(v[i]);
+            raw(i + 1 < v.size() ? ",\n" : "\n");
+        }
+        return indent(indent_by).raw("]");
+    }
+
+    /// Write any buffered output to the sink. Returns false if a write has
+    /// failed; without a sink this does nothing.
+    bool flush() {
+        if (sink_ && !buffer_.empty()) {
+            if (std::fwrite(buffer_.data(), 1, buffer_.size(), sink_) != buffer_.size()) {
+                failed_ = true;
+            }
+            buffer_.clear();
+        }
+        return !failed_;
+    }
+
+    /// The document written so far (when there is no sink)
+    const std::string& buffer() const { return buffer_; }
+    std::string take() { return std::move(buffer_); }
+
+private:
+    Writer& maybe_flush() {
+        if (sink_ && buffer_.size() >= flush_threshold_) flush();
+        return *this;
+    }
+
+    std::string buffer_;
+    std::FILE* sink_ = nullptr;
+    size_t flush_threshold_ = 0;
+    bool failed_ = false;
+};
+
 /**
  * Format a string as JSON.
  */
 inline std::string str(const std::string& s) {
-    return "\"" + escape(s) + "\"";
+    Writer w;
+    w.string(s);
+    return w.take();
 }
 
 /**
  * Format a string map as JSON object (sorted keys).
  */
 inline std::string object(const std::unordered_map<std::string, std::string>& m, size_t indent = 0) {
-    if (m.empty()) return "{}";
-    
-    std::vector<std::string> keys;
-    for (const auto& [k, _] : m) keys.push_back(k);
-    std::sort(keys.begin(), keys.end());
-    
-    std::string pad(indent + 2, ' ');
-    std::string result = "{\n";
-    for (size_t i = 0; i < keys.size(); i++) {
-        result += pad + str(keys[i]) + ": " + str(m.at(keys[i]));
-        if (i < keys.size() - 1) result += ",";
-        result += "\n";
-    }
-    result += std::string(indent, ' ') + "}";
-    return result;
+    Writer w;
+    w.object(m, indent);
+    return w.take();
+}
+
+/**
+ * Format a flat environment as JSON object (already sorted by key).
+ */
+inline std::string object(const FlatEnvironment& env, size_t indent = 0) {
+    Writer w;
+    w.object(env, indent);
+    return w.take();
 }
 
 /**
  * Format a string vector as JSON array.
  */
 inline std::string array(const std::vector<std::string>& v, size_t indent = 0) {
-    if (v.empty()) return "[]";
-    
-    std::string pad(indent + 2, ' ');
-    std::string result = "[\n";
-    for (size_t i = 0; i < v.size(); i++) {
-        result += pad + str(v[i]);
-        if (i < v.size() - 1) result += ",";
-        result += "\n";
-    }
-    result += std::string(indent, ' ') + "]";
-    return result;
+    Writer w;
+    w.array(v, indent);
+    return w.take();
 }
 
 } // namespace json
 
 /**
- * Serialize a launch contract to JSON.
- * 
- * Produces deterministic output (sorted keys, consistent formatting).
+ * Write a launch contract as JSON. See serialize_contract().
  */
-inline std::string serialize_contract(const LaunchContract& c) {
-    std::ostringstream out;
-    out << "{\n";
-    out << "  \"schema\": \"" << NAH_CONTRACT_SCHEMA << "\",\n";
-    
+inline void write_contract(json::Writer& out, const LaunchContract& c) {
+    out.raw("{\n");
+    out.key("schema", 2).string(NAH_CONTRACT_SCHEMA).raw(",\n");
+
     // app
-    out << "  \"app\": {\n";
-    out << "    \"id\": " << json::str(c.app.id) << ",\n";
-    out << "    \"version\": " << json::str(c.app.version) << ",\n";
-    out << "    \"root\": " << json::str(c.app.root) << ",\n";
-    out << "    \"entrypoint\": " << json::str(c.app.entrypoint) << "\n";
-    out << "  },\n";
-    
+    out.raw("  \"app\": {\n");
+    out.key("id", 4).string(c.app.id).raw(",\n");
+    out.key("version", 4).string(c.app.version).raw(",\n");
+    out.key("root", 4).string(c.app.root).raw(",\n");
+    out.key("entrypoint", 4).string(c.app.entrypoint).raw("\n");
+    out.raw("  },\n");
+
     // nak
-    out << "  \"nak\": {\n";
-    out << "    \"id\": " << json::str(c.nak.id) << ",\n";
-    out << "    \"version\": " << json::str(c.nak.version) << ",\n";
-    out << "    \"root\": " << json::str(c.nak.root) << ",\n";
-    out << "    \"resource_root\": " << json::str(c.nak.resource_root) << ",\n";
-    out << "    \"record_ref\": " << json::str(c.nak.record_ref) << "\n";
-    out << "  },\n";
-    
+    out.raw("  \"nak\": {\n");
+    out.key("id", 4).string(c.nak.id).raw(",\n");
+    out.key("version", 4).string(c.nak.version).raw(",\n");
+    out.key("root", 4).string(c.nak.root).raw(",\n");
+    out.key("resource_root", 4).string(c.nak.resource_root).raw(",\n");
+    out.key("record_ref", 4).string(c.nak.record_ref).raw("\n");
+    out.raw("  },\n");
+
     // execution
-    out << "  \"execution\": {\n";
-    out << "    \"binary\": " << json::str(c.execution.binary) << ",\n";
-    out << "    \"arguments\": " << json::array(c.execution.arguments, 4) << ",\n";
-    out << "    \"cwd\": " << json::str(c.execution.cwd) << ",\n";
-    out << "    \"library_path_env_key\": " << json::str(c.execution.library_path_env_key) << ",\n";
-    out << "    \"library_paths\": " << json::array(c.execution.library_paths, 4) << "\n";
-    out << "  },\n";
-    
+    out.raw("  \"execution\": {\n");
+    out.key("binary", 4).string(c.execution.binary).raw(",\n");
+    out.key("arguments", 4).array(c.execution.arguments, 4).raw(",\n");
+    out.key("cwd", 4).string(c.execution.cwd).raw(",\n");
+    out.key("library_path_env_key", 4).string(c.execution.library_path_env_key).raw(",\n");
+    out.key("library_paths", 4).array(c.execution.library_paths, 4).raw("\n");
+    out.raw("  },\n");
+
     // environment
-    out << "  \"environment\": " << json::object(c.environment, 2) << ",\n";
-    
+    out.key("environment", 2).object(c.environment, 2).raw(",\n");
+
     // enforcement
-    out << "  \"enforcement\": {\n";
-    out << "    \"filesystem\": " << json::array(c.enforcement.filesystem, 4) << ",\n";
-    out << "    \"network\": " << json::array(c.enforcement.network, 4) << "\n";
-    out << "  },\n";
-    
+    out.raw("  \"enforcement\": {\n");
+    out.key("filesystem", 4).array(c.enforcement.filesystem, 4).raw(",\n");
+    out.key("network", 4).array(c.enforcement.network, 4).raw("\n");
+    out.raw("  },\n");
+
     // trust
-    out << "  \"trust\": {\n";
-    out << "    \"state\": " << json::str(trust_state_to_string(c.trust.state)) << ",\n";
-    out << "    \"source\": " << json::str(c.trust.source) << ",\n";
-    out << "    \"evaluated_at\": " << json::str(c.trust.evaluated_at) << ",\n";
-    out << "    \"expires_at\": " << json::str(c.trust.expires_at) << "\n";
-    out << "  },\n";
-    
+    out.raw("  \"trust\": {\n");
+    out.key("state", 4).string(trust_state_to_string(c.trust.state)).raw(",\n");
+    out.key("source", 4).string(c.trust.source).raw(",\n");
+    out.key("evaluated_at", 4).string(c.trust.evaluated_at).raw(",\n");
+    out.key("expires_at", 4).string(c.trust.expires_at).raw(",\n");
+    if (!c.trust.inputs_hash.empty()) {
+        out.key("inputs_hash", 4).string(c.trust.inputs_hash).raw(",\n");
+    }
+    out.key("details", 4).object(c.trust.details, 4).raw("\n");
+    out.raw("  },\n");
+
+    // exports (sorted by id)
+    if (c.exports.empty()) {
+        out.raw("  \"exports\": {},\n");
+    } else {
+        std::vector<const std::pair<const std::string, AssetExport>*> sorted;
+        sorted.reserve(c.exports.size());
+        for (const auto& kv : c.exports) sorted.push_back(&kv);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        out.raw("  \"exports\": {\n");
+        for (size_t i = 0; i < sorted.size(); i++) {
+            const auto& e = sorted[i]->second;
+            out.key(sorted[i]->first, 4).raw("{\n");
+            out.key("id", 6).string(e.id).raw(",\n");
+            out.key("path", 6).string(e.path).raw(",\n");
+            out.key("type", 6).string(e.type).raw("\n");
+            out.raw(i + 1 < sorted.size() ? "    },\n" : "    }\n");
+        }
+        out.raw("  },\n");
+    }
+
     // capability_usage
-    out << "  \"capability_usage\": {\n";
-    out << "    \"present\": " << (c.capability_usage.present ? "true" : "false") << ",\n";
-    out << "    \"required_capabilities\": " << json::array(c.capability_usage.required_capabilities, 4) << "\n";
-    out << "  }\n";
-    
-    out << "}";
-    return out.str();
+    out.raw("  \"capability_usage\": {\n");
+    out.key("present", 4).boolean(c.capability_usage.present).raw(",\n");
+    out.key("required_capabilities", 4).array(c.capability_usage.required_capabilities, 4).raw(",\n");
+    out.key("optional_capabilities", 4).array(c.capability_usage.optional_capabilities, 4).raw(",\n");
+    out.key("critical_capabilities", 4).array(c.capability_usage.critical_capabilities, 4).raw("\n");
+    out.raw("  }\n");
+
+    out.raw("}");
 }
 
 /**
- * Serialize a composition result to JSON.
+ * Write a composition result as JSON. See serialize_result().
+ *
+ * `extra_fields`, if set, is called after the last field to write more
+ * top-level fields (`out.key(name, 2)...`, separated by ",\n"), so callers
+ * can extend the object without editing the output.
  */
-inline std::string serialize_result(const CompositionResult& r) {
-    std::ostringstream out;
-    out << "{\n";
-    out << "  \"ok\": " << (r.ok ? "true" : "false") << ",\n";
-    
+inline void write_result(json::Writer& out, const CompositionResult& r,
+                         const std::function<void(json::Writer&)>& extra_fields = nullptr) {
+    out.raw("{\n");
+    out.key("ok", 2).boolean(r.ok).raw(",\n");
+
     if (r.critical_error.has_value()) {
-        out << "  \"critical_error\": " << json::str(critical_error_to_string(*r.critical_error)) << ",\n";
-        out << "  \"critical_error_context\": " << json::str(r.critical_error_context) << ",\n";
+        out.key("critical_error", 2).string(critical_error_to_string(*r.critical_error)).raw(",\n");
+        out.key("critical_error_context", 2).string(r.critical_error_context).raw(",\n");
     } else {
-        out << "  \"critical_error\": null,\n";
+        out.raw("  \"critical_error\": null,\n");
     }
-    
+
     // warnings
-    out << "  \"warnings\": [\n";
+    out.raw("  \"warnings\": [\n");
     for (size_t i = 0; i < r.warnings.size(); i++) {
         const auto& w = r.warnings[i];
-        out << "    {\n";
-        out << "      \"key\": " << json::str(w.key) << ",\n";
-        out << "      \"action\": " << json::str(w.action) << ",\n";
-        out << "      \"fields\": " << json::object(w.fields, 6) << "\n";
-        out << "    }";
-        if (i < r.warnings.size() - 1) out << ",";
-        out << "\n";
+        out.raw("    {\n");
+        out.key("key", 6).string(w.key).raw(",\n");
+        out.key("action", 6).string(w.action).raw(",\n");
+        out.key("fields", 6).object(w.fields, 6).raw("\n");
+        out.raw(i + 1 < r.warnings.size() ? "    },\n" : "    }\n");
     }
-    out << "  ],\n";
-    
+    out.raw("  ],\n");
+
     if (r.ok) {
-        out << "  \"contract\": " << serialize_contract(r.contract) << "\n";
+        out.raw("  \"contract\": ");
+        write_contract(out, r.contract);
     } else {
-        out << "  \"contract\": null\n";
+        out.raw("  \"contract\": null");
     }
-    
-    out << "}";
-    return out.str();
+
+    if (extra_fields) {
+        out.raw(",\n");
+        extra_fields(out);
+    }
+    out.raw("\n}");
+}
+
+/**
+ * Serialize a launch contract to JSON.
+ * 
+ * Produces deterministic output (sorted keys, consistent formatting).
+ */
+inline std::string serialize_contract(const LaunchContract& c) {
+    json::Writer out;
+    write_contract(out, c);
+    return out.take();
+}
+
+/**
+ * Serialize a composition result to JSON.
+ */
+inline std::string serialize_result(const CompositionResult& r) {
+    json::Writer out;
+    write_result(out, r);
+    return out.take();
 }
 
 } // namespace core
@@ -53,8 +53,12 @@ inline std::vector<std::string> build_environment(const core::LaunchContract& co
     std::vector<std::string> env;
     
     // Add all contract environment variables
+    env.reserve(contract.environment.size() + 1);
     for (const auto& [key, value] : contract.environment) {
-        env.push_back(key + "=" + value);
+        std::string entry;
+        entry.reserve(key.size() + value.size() + 1);
+        entry.append(key).append(1, '=').append(value);
+        env.push_back(std::move(entry));
     }
     
     // Build library path
@@ -88,6 +92,44 @@ inline std::vector<std::string> build_environment(const core::LaunchContract& co
     return env;
 }
 
+/**
+ * Build an envp array for execve.
+ * 
+ * Points straight into the contract's environment records. Only the library
+ * path variable is assembled separately, into `storage`, which must outlive
+ * the returned pointers (as must the contract).
+ */
+inline std::vector<char*> build_envp(const core::LaunchContract& contract, std::string& storage) {
+    auto envp = contract.environment.envp();
+    if (contract.execution.library_paths.empty()) {
+        return envp;
+    }
+    
+    char sep = core::get_path_separator();
+    const std::string& lib_key = contract.execution.library_path_env_key;
+    
+    storage = lib_key + "=";
+    for (size_t i = 0; i < contract.execution.library_paths.size(); i++) {
+        if (i > 0) storage += sep;
+        storage += contract.execution.library_paths[i];
+    }
+    
+    // Prepend to an existing value, replacing that record
+    size_t index = 0;
+    for (const auto& [key, value] : contract.environment) {
+        if (key == lib_key) {
+            storage += sep;
+            storage.append(value);
+            envp[index] = storage.data();
+            return envp;
+        }
+        index++;
+    }
+    
+    envp.insert(envp.end() - 1, storage.data());
+    return envp;
+}
+
 // ============================================================================
 // COMMAND LINE BUILDING
 // ============================================================================
@@ -120,7 +162,8 @@ inline ExecResult execute_unix(const core::LaunchContract& contract, bool wait_f
     ExecResult result;
     
     auto argv_strings = build_argv(contract);
-    auto env_strings = build_environment(contract);
+    std::string lib_path_storage;
+    auto envp = build_envp(contract, lib_path_storage);
     
     // Build C-style arrays
     std::vector<char*> argv;
@@ -129,12 +172,6 @@ inline ExecResult execute_unix(const core::LaunchContract& contract, bool wait_f
     }
     argv.push_back(nullptr);
     
-    std::vector<char*> envp;
-    for (auto& s : env_strings) {
-        envp.push_back(const_cast<char*>(s.c_str()));
-    }
-    envp.push_back(nullptr);
-    
     pid_t pid = fork();
     
     if (pid == -1) {
@@ -193,7 +230,8 @@ inline ExecResult exec_replace_unix(const core::LaunchContract& contract) {
     ExecResult result;
     
     auto argv_strings = build_argv(contract);
-    auto env_strings = build_environment(contract);
+    std::string lib_path_storage;
+    auto envp = build_envp(contract, lib_path_storage);
     
     std::vector<char*> argv;
     for (auto& s : argv_strings) {
@@ -201,12 +239,6 @@ inline ExecResult exec_replace_unix(const core::LaunchContract& contract) {
     }
     argv.push_back(nullptr);
     
-    std::vector<char*> envp;
-    for (auto& s : env_strings) {
-        envp.push_back(const_cast<char*>(s.c_str()));
-    }
-    envp.push_back(nullptr);
-    
     // Change directory
     if (!contract.execution.cwd.empty()) {
         if (chdir(contract.execution.cwd.c_str()) != 0) {
@@ -15,13 +15,28 @@
 #include "nah_core.h"
 #include "nah_json.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <optional>
-#include <sstream>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#ifndef _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace nah
 {
     namespace fs
@@ -33,19 +48,219 @@ namespace nah
         // FILE OPERATIONS
         // ============================================================================
 
+        /**
+         * Files at least this large are memory-mapped by read_file_view();
+         * smaller ones are cheaper to read with a single sized read.
+         */
+        constexpr size_t MMAP_THRESHOLD = 64 * 1024;
+
+        /**
+         * Read-only contents of a whole file, either mapped or read into an
+         * owned buffer. Move-only; a mapping is released on destruction.
+         */
+        class MappedFile
+        {
+        public:
+            MappedFile() = default;
+            ~MappedFile() { release(); }
+
+            MappedFile(MappedFile &&other) noexcept
+                : map_(other.map_), size_(other.size_), buffer_(std::move(other.buffer_))
+            {
+                other.map_ = nullptr;
+                other.size_ = 0;
+            }
+
+            MappedFile &operator=(MappedFile &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    map_ = other.map_;
+                    size_ = other.size_;
+                    buffer_ = std::move(other.buffer_);
+                    other.map_ = nullptr;
+                    other.size_ = 0;
+                }
+                return *this;
+            }
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+
+            const char *data() const { return map_ ? map_ : buffer_.data(); }
+            size_t size() const { return map_ ? size_ : buffer_.size(); }
+            bool empty() const { return size() == 0; }
+            bool mapped() const { return map_ != nullptr; }
+
+            std::string_view view() const { return std::string_view(data(), size()); }
+            operator std::string_view() const { return view(); }
+
+        private:
+            friend std::optional<MappedFile> read_file_view(const std::string &path, size_t mmap_threshold);
+
+            void release()
+            {
+#ifndef _WIN32
+                if (map_)
+                {
+                    ::munmap(const_cast<char *>(map_), size_);
+                }
+#endif
+                map_ = nullptr;
+                size_ = 0;
+            }
+
+            const char *map_ = nullptr;
+            size_t size_ = 0;
+            std::string buffer_;
+        };
+
+        namespace detail
+        {
+#ifndef _WIN32
+            struct FileDescriptor
+            {
+                int fd = -1;
+                ~FileDescriptor()
+                {
+                    if (fd >= 0)
+                    {
+                        ::close(fd);
+                    }
+                }
+            };
+
+            // Open for reading; fails for missing files and directories
+            inline bool open_for_read(const std::string &path, FileDescriptor &file, struct stat &st)
+            {
+                do
+                {
+                    file.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                } while (file.fd < 0 && errno == EINTR);
+                return file.fd >= 0 && ::fstat(file.fd, &st) == 0 && !S_ISDIR(st.st_mode);
+            }
+
+            // Read `size` bytes with as few reads as possible, or until EOF
+            // when the size is unknown (0, as for pipes and /proc files)
+            inline bool read_fd(int fd, std::string &out, size_t size)
+            {
+                out.resize(size);
+                size_t done = 0;
+                for (;;)
+                {
+                    if (done == out.size())
+                    {
+                        if (size > 0)
+                        {
+                            break;
+                        }
+                        out.resize(done + MMAP_THRESHOLD);
+                    }
+                    ssize_t n = ::read(fd, &out[done], out.size() - done);
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        return false;
+                    }
+                    if (n == 0)
+                    {
+                        break;
+                    }
+                    done += static_cast<size_t>(n);
+                }
+                out.resize(done);
+                return true;
+            }
+#else
+            inline bool read_stream(const std::string &path, std::string &out)
+            {
+                std::ifstream file(path, std::ios::binary | std::ios::ate);
+                if (!file)
+                {
+                    return false;
+                }
+                std::streamoff size = file.tellg();
+                if (size < 0)
+                {
+                    return false;
+                }
+                out.resize(static_cast<size_t>(size));
+                file.seekg(0);
+                file.read(out.data(), size);
+                return file.gcount() == size;
+            }
+#endif
+        } // namespace detail
+
         /**
          * Read entire file contents as string.
          */
         inline std::optional<std::string> read_file(const std::string &path)
         {
-            std::ifstream file(path);
-            if (!file)
+            std::string content;
+#ifndef _WIN32
+            detail::FileDescriptor file;
+            struct stat st;
+            if (!detail::open_for_read(path, file, st) ||
+                !detail::read_fd(file.fd, content, S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0))
+            {
+                return std::nullopt;
+            }
+#else
+            if (!detail::read_stream(path, content))
+            {
+                return std::nullopt;
+            }
+#endif
+            return content;
+        }
+
+        /**
+         * Read entire file contents without copying them where possible.
+         * Regular files of at least `mmap_threshold` bytes are mapped
+         * read-only; everything else, and any file mmap refuses, is read
+         * into the returned buffer. Returns nullopt if the file cannot be
+         * opened or read, or is a directory.
+         */
+        inline std::optional<MappedFile> read_file_view(const std::string &path,
+                                                        size_t mmap_threshold = MMAP_THRESHOLD)
+        {
+            MappedFile result;
+#ifndef _WIN32
+            detail::FileDescriptor file;
+            struct stat st;
+            if (!detail::open_for_read(path, file, st))
+            {
+                return std::nullopt;
+            }
+            size_t size = S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0;
+            if (size > 0 && size >= mmap_threshold)
+            {
+                void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+                if (map != MAP_FAILED)
+                {
+                    result.map_ = static_cast<const char *>(map);
+                    result.size_ = size;
+                    return result;
+                }
+                // Not mappable here; read it instead
+            }
+            if (!detail::read_fd(file.fd, result.buffer_, size))
+            {
+                return std::nullopt;
+            }
+#else
+            (void)mmap_threshold;
+            if (!detail::read_stream(path, result.buffer_))
             {
                 return std::nullopt;
             }
-            std::stringstream ss;
-            ss << file.rdbuf();
-            return ss.str();
+#endif
+            return result;
         }
 
         /**
@@ -62,6 +277,96 @@ namespace nah
             return file.good();
         }
 
+        /**
+         * Write string to file atomically.
+         * Content goes to a temporary sibling first and is renamed over the
+         * target, so readers see either the old or the new file, never a
+         * partial write.
+         */
+        inline bool write_file_atomic(const std::string &path, const std::string &content)
+        {
+            std::random_device rd;
+            std::string tmp_path = path + ".tmp." + std::to_string(rd());
+            {
+                std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+                if (!file)
+                {
+                    return false;
+                }
+                file.write(content.data(), static_cast<std::streamsize>(content.size()));
+                if (!file.good())
+                {
+                    file.close();
+                    std::error_code ec;
+                    stdfs::remove(tmp_path, ec);
+                    return false;
+                }
+            }
+
+            std::error_code ec;
+            stdfs::rename(tmp_path, path, ec);
+            if (ec)
+            {
+                stdfs::remove(tmp_path, ec);
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * Exclusive advisory lock on a file, held until destruction.
+         * The constructor creates the file if needed and blocks until no
+         * other process holds it. The lock is released by the kernel if the
+         * process dies. Windows has no locking: locked() is always false.
+         */
+        class FileLock
+        {
+        public:
+            explicit FileLock(const std::string &path)
+            {
+#ifndef _WIN32
+                do
+                {
+                    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+                } while (fd_ < 0 && errno == EINTR);
+                if (fd_ < 0)
+                {
+                    return;
+                }
+                int rc;
+                do
+                {
+                    rc = ::flock(fd_, LOCK_EX);
+                } while (rc != 0 && errno == EINTR);
+                if (rc != 0)
+                {
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+#else
+                (void)path;
+#endif
+            }
+
+            ~FileLock()
+            {
+#ifndef _WIN32
+                if (fd_ >= 0)
+                {
+                    ::close(fd_);
+                }
+#endif
+            }
+
+            FileLock(const FileLock &) = delete;
+            FileLock &operator=(const FileLock &) = delete;
+
+            bool locked() const { return fd_ >= 0; }
+
+        private:
+            int fd_ = -1;
+        };
+
         /**
          * Check if path exists.
          */
@@ -108,6 +413,22 @@ namespace nah
             return size;
         }
 
+        /**
+         * Get last modification time as a raw filesystem clock tick count.
+         * Only meaningful for comparing against another value from this
+         * function (e.g. cache invalidation), not as a wall-clock time.
+         */
+        inline std::optional<std::int64_t> last_write_time(const std::string &path)
+        {
+            std::error_code ec;
+            auto time = stdfs::last_write_time(path, ec);
+            if (ec)
+            {
+                return std::nullopt;
+            }
+            return static_cast<std::int64_t>(time.time_since_epoch().count());
+        }
+
         /**
          * Get parent directory of a path.
          */
@@ -193,6 +514,150 @@ namespace nah
             return entries;
         }
 
+        /**
+         * Kind of a directory entry as reported by the directory listing
+         * itself. Unknown means the filesystem did not say (DT_UNKNOWN), and
+         * the caller has to stat the entry if it cares.
+         */
+        enum class EntryType
+        {
+            Unknown,
+            File,
+            Directory,
+            Symlink,
+            Other
+        };
+
+        /**
+         * One entry seen by for_each_entry(). `name` is the bare filename and
+         * points into the listing buffer: it is only valid during the callback.
+         */
+        struct DirEntry
+        {
+            std::string_view name;
+            EntryType type = EntryType::Unknown;
+        };
+
+        /**
+         * Call `fn(const DirEntry&)` for each entry of `dir` whose name ends
+         * with `suffix` (and is longer than it), skipping "." and "..".
+         * An empty suffix matches everything. Entries come in directory
+         * order. If `fn` returns bool, returning false stops the listing.
+         *
+         * Unlike list_directory() nothing is allocated per entry: names are
+         * read straight from readdir(). Returns false if `dir` cannot be
+         * opened.
+         */
+        template <typename Fn>
+        inline bool for_each_entry(const std::string &dir, std::string_view suffix, Fn &&fn)
+        {
+            auto matches = [&](std::string_view name)
+            {
+                if (name == "." || name == "..")
+                {
+                    return false;
+                }
+                return suffix.empty() ||
+                       (name.size() > suffix.size() &&
+                        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+            };
+            auto visit = [&](const DirEntry &entry)
+            {
+                if constexpr (std::is_same_v<std::invoke_result_t<Fn &, const DirEntry &>, bool>)
+                {
+                    return fn(entry);
+                }
+                else
+                {
+                    fn(entry);
+                    return true;
+                }
+            };
+
+#ifndef _WIN32
+            DIR *handle = ::opendir(dir.c_str());
+            if (!handle)
+            {
+                return false;
+            }
+            while (const struct dirent *ent = ::readdir(handle))
+            {
+                std::string_view name(ent->d_name);
+                if (!matches(name))
+                {
+                    continue;
+                }
+                DirEntry entry;
+                entry.name = name;
+#ifdef DT_UNKNOWN
+                switch (ent->d_type)
+                {
+                case DT_REG:
+                    entry.type = EntryType::File;
+                    break;
+                case DT_DIR:
+                    entry.type = EntryType::Directory;
+                    break;
+                case DT_LNK:
+                    entry.type = EntryType::Symlink;
+                    break;
+                case DT_UNKNOWN:
+                    break;
+                default:
+                    entry.type = EntryType::Other;
+                    break;
+                }
+#endif
+                if (!visit(entry))
+                {
+                    break;
+                }
+            }
+            ::closedir(handle);
+            return true;
+#else
+            std::error_code ec;
+            stdfs::directory_iterator it(dir, ec);
+            if (ec)
+            {
+                return false;
+            }
+            std::string name;
+            for (; it != stdfs::directory_iterator(); it.increment(ec))
+            {
+                name = it->path().filename().string();
+                if (!matches(name))
+                {
+                    continue;
+                }
+                DirEntry entry;
+                entry.name = name;
+                std::error_code type_ec;
+                if (it->is_symlink(type_ec))
+                {
+                    entry.type = EntryType::Symlink;
+                }
+                else if (it->is_regular_file(type_ec))
+                {
+                    entry.type = EntryType::File;
+                }
+                else if (it->is_directory(type_ec))
+                {
+                    entry.type = EntryType::Directory;
+                }
+                else if (!type_ec)
+                {
+                    entry.type = EntryType::Other;
+                }
+                if (!visit(entry))
+                {
+                    break;
+                }
+            }
+            return !ec;
+#endif
+        }
+
         /**
          * Get current working directory.
          */
@@ -260,6 +725,13 @@ namespace nah
         // RUNTIME INVENTORY LOADING
         // ============================================================================
 
+        /**
+         * Records per worker thread below which load_inventory_from_directory()
+         * does not start another thread: parsing a handful of records takes less
+         * time than starting one.
+         */
+        constexpr size_t INVENTORY_RECORDS_PER_WORKER = 16;
+
         /**
          * Load a RuntimeInventory from a directory of NAK install records.
          *
@@ -268,10 +740,15 @@ namespace nah
          *     <nak_id>@<version>.json  (e.g., lua@5.4.6.json)
          *
          * Each JSON file should be a valid RuntimeDescriptor.
+         *
+         * Records are read and parsed on up to `workers` threads (0 = hardware
+         * concurrency, 1 = the calling thread only). The inventory does not
+         * depend on the worker count, and errors are reported in filename order.
          */
         inline core::RuntimeInventory load_inventory_from_directory(
             const std::string &nak_records_dir,
-            std::vector<std::string> *errors = nullptr)
+            std::vector<std::string> *errors = nullptr,
+            size_t workers = 0)
         {
             core::RuntimeInventory inventory;
 
@@ -284,37 +761,71 @@ namespace nah
                 return inventory;
             }
 
-            for (const auto &entry : list_directory(nak_records_dir))
+            // Only process .json files
+            std::string prefix = core::normalize_separators(nak_records_dir);
+            if (!prefix.empty() && prefix.back() != '/')
+            {
+                prefix += '/';
+            }
+            std::vector<std::string> files;
+            for_each_entry(nak_records_dir, ".json", [&](const DirEntry &entry)
             {
-                // Only process .json files
-                if (entry.size() < 5 || entry.substr(entry.size() - 5) != ".json")
+                if (entry.type != EntryType::Directory)
                 {
-                    continue;
+                    files.emplace_back(prefix).append(entry.name);
                 }
+            });
+            std::sort(files.begin(), files.end());
 
-                auto content = read_file(entry);
+            // Each worker fills the slots of the files it takes; merged below
+            struct LoadedRecord
+            {
+                core::RuntimeDescriptorPtr runtime;
+                std::string error;
+            };
+            std::vector<LoadedRecord> loaded(files.size());
+
+            if (workers == 0)
+            {
+                workers = std::thread::hardware_concurrency();
+            }
+            size_t useful_workers =
+                (files.size() + INVENTORY_RECORDS_PER_WORKER - 1) / INVENTORY_RECORDS_PER_WORKER;
+            workers = std::max<size_t>(1, std::min(workers, useful_workers));
+
+            core::detail::parallel_for(files.size(), workers, [&](size_t i)
+            {
+                const std::string &entry = files[i];
+                auto content = read_file_view(entry);
                 if (!content)
                 {
-                    if (errors)
-                    {
-                        errors->push_back("Failed to read: " + entry);
-                    }
-                    continue;
+                    loaded[i].error = "Failed to read: " + entry;
+                    return;
                 }
 
-                // Extract record_ref from filename
-                std::string record_ref = filename(entry);
-
-                // Parse the RuntimeDescriptor JSON
-                auto result = json::parse_runtime_descriptor(*content, entry);
+                auto result = json::parse_runtime_descriptor(content->view(), entry);
                 if (result.ok)
                 {
                     result.value.source_path = entry; // Track source for debugging
-                    inventory.runtimes[record_ref] = result.value;
+                    loaded[i].runtime = std::make_shared<const core::RuntimeDescriptor>(std::move(result.value));
+                }
+                else
+                {
+                    loaded[i].error = "Failed to parse " + entry + ": " + result.error;
+                }
+            });
+
+            inventory.runtimes.reserve(files.size());
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                if (loaded[i].runtime)
+                {
+                    // Keyed by record_ref, the filename
+                    inventory.runtimes[filename(files[i])] = std::move(loaded[i].runtime);
                 }
                 else if (errors)
                 {
-                    errors->push_back("Failed to parse " + entry + ": " + result.error);
+                    errors->push_back(std::move(loaded[i].error));
                 }
             }
 
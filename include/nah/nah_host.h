@@ -16,6 +16,8 @@
 #include "nah_fs.h"
 #include "nah_exec.h"
 #include "nah_semver.h"
+#include "nah_overrides.h"
+#include "nah_registry.h"
 
 #include <string>
 #include <vector>
@@ -23,6 +25,9 @@
 #include <optional>
 #include <functional>
 #include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
 
 namespace nah {
 namespace host {
@@ -57,6 +62,7 @@ struct AppInfo {
     std::string install_root;
     std::string record_path;
     std::string metadata_json;
+    std::string package_hash;  ///< "sha256:<hex>" of the installed package; empty for directory installs
 };
 
 // ============================================================================
@@ -122,11 +128,14 @@ public:
 
     /**
      * List all installed applications
+     * Ordered by id, then by version (highest first).
      */
     std::vector<AppInfo> listApplications() const;
 
     /**
      * Find an installed application by ID
+     * Lookups go through an in-memory index of registry/apps that is built on
+     * first use and rebuilt whenever the directory's mtime changes.
      * @param id Application identifier (e.g., "com.example.app")
      * @param version Optional specific version (empty = latest)
      * @return AppInfo if found, nullopt otherwise
@@ -134,6 +143,21 @@ public:
     std::optional<AppInfo> findApplication(const std::string& id,
                                           const std::string& version = "") const;
 
+    /**
+     * Drop the in-memory registry index and NAK inventory so the next lookup
+     * or composition rescans registry/apps and registry/naks. Only needed
+     * when records are edited in place, which does not change the directory
+     * mtime.
+     */
+    void refreshIndex() const;
+
+    /**
+     * Enable or disable the on-disk launch contract cache (enabled by
+     * default). When disabled, getLaunchContract() always recomposes and
+     * leaves registry/contracts untouched.
+     */
+    void setContractCacheEnabled(bool enabled) { contract_cache_enabled_ = enabled; }
+
     /**
      * Get the host environment from host.json
      */
@@ -153,6 +177,10 @@ public:
 
     /**
      * Get launch contract for an application with options
+     * Successful results are cached in registry/contracts and reused until
+     * the manifest, install record, pinned NAK record, host.json, installed
+     * NAK set, loader override or NAH_OVERRIDE_ENVIRONMENT change. Traced
+     * compositions and those with options.now set always recompose.
      * @param app_id Application identifier
      * @param version Optional specific version (empty = latest)
      * @param options Composition options (trace, loader override, etc.)
@@ -163,6 +191,18 @@ public:
         const std::string& version,
         const nah::core::CompositionOptions& options) const;
 
+    /**
+     * Generate launch contracts for many applications at once
+     * The registry, host environment and inventory are read once and shared;
+     * install records and manifests are loaded and composed on a worker pool.
+     * @param app_ids Application identifiers (latest installed version of each)
+     * @param options Composition options and worker count for the batch
+     * @return One composition result per id, in the same order as app_ids
+     */
+    std::vector<nah::core::CompositionResult> getLaunchContracts(
+        const std::vector<std::string>& app_ids,
+        const nah::core::BatchCompositionOptions& options = {}) const;
+
     /**
      * Execute an application directly (compose and run)
      * @param app_id Application identifier
@@ -200,6 +240,14 @@ public:
      */
     nah::core::RuntimeInventory getInventory() const;
 
+    /**
+     * Get the inventory of installed NAKs without copying it
+     * Loaded on first use, with records parsed on a worker pool, and shared
+     * by every composition until registry/naks changes (see refreshIndex()).
+     * Keep the pointer to compose many apps against one snapshot.
+     */
+    std::shared_ptr<const nah::core::RuntimeInventory> sharedInventory() const;
+
     /**
      * Validate NAH root structure
      * @return Error message if invalid, empty string if valid
@@ -258,7 +306,47 @@ private:
 
     std::string extractMetadataJson(const std::string& app_dir) const;
 
+    // Index entry; the NAK pin is kept for contract cache keys
+    struct IndexedApp : AppInfo {
+        std::string nak_record_ref;  // Pinned NAK record file, empty if unpinned
+    };
+
+    // app id -> installed versions (highest first); metadata_json left empty
+    struct RegistryIndex {
+        std::optional<std::int64_t> apps_mtime;
+        std::map<std::string, std::vector<IndexedApp>> apps;
+    };
+
+    // Current index, rebuilt if registry/apps changed since it was built
+    std::shared_ptr<const RegistryIndex> registryIndex() const;
+
+    // Loaded NAK inventory and the registry/naks mtime it was loaded at
+    struct InventorySnapshot {
+        std::optional<std::int64_t> naks_mtime;
+        nah::core::RuntimeInventory inventory;
+    };
+
+    // Index lookup without reading nap.json metadata
+    std::optional<IndexedApp> findIndexedApplication(const std::string& id,
+                                                     const std::string& version = "") const;
+
+    // Contract cache key for composing an indexed app with the given options
+    std::string contractCacheKey(const IndexedApp& app_info,
+                                 const nah::core::CompositionOptions& options) const;
+
+    // Load record and manifest for a found app and compose against shared inputs
+    nah::core::CompositionResult composeApplication(
+        const AppInfo& app_info,
+        const nah::core::HostEnvironment& host_env,
+        const nah::core::RuntimeInventory& inventory,
+        const nah::core::CompositionOptions& options) const;
+
     std::string root_;
+    bool contract_cache_enabled_ = true;
+    mutable std::mutex index_mutex_;
+    mutable std::shared_ptr<const RegistryIndex> index_;
+    mutable std::mutex inventory_mutex_;
+    mutable std::shared_ptr<const InventorySnapshot> inventory_;
 };
 
 // ============================================================================
@@ -312,64 +400,92 @@ inline std::unique_ptr<NahHost> NahHost::create(const std::string& root_path) {
     return std::unique_ptr<NahHost>(new NahHost(resolved_root));
 }
 
+inline std::shared_ptr<const NahHost::RegistryIndex> NahHost::registryIndex() const {
+    std::string apps_dir = nah::registry::apps_dir(root_);
+
+    // Read the mtime before loading so a change made meanwhile is picked up
+    // by the next call rather than lost.
+    auto apps_mtime = nah::fs::last_write_time(apps_dir);
+
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (index_ && apps_mtime && index_->apps_mtime == apps_mtime) {
+        return index_;
+    }
+
+    auto index = std::make_shared<RegistryIndex>();
+    index->apps_mtime = apps_mtime;
+
+    // registry/index.bin when fresh, otherwise a scan of the records.
+    // Entries arrive sorted by id, then version (highest first).
+    auto registry = nah::registry::load_or_scan(root_);
+    for (const auto& entry : registry.apps) {
+        IndexedApp info;
+        info.id = entry.id;
+        info.version = entry.version;
+        info.instance_id = entry.instance_id;
+        info.install_root = entry.install_root;
+        if (!info.install_root.empty() && !nah::fs::is_absolute_path(info.install_root)) {
+            info.install_root = nah::fs::absolute_path(nah::fs::join_paths(root_, info.install_root));
+        }
+        info.record_path = apps_dir + "/" + entry.record_file;
+        info.nak_record_ref = entry.nak_pin.record_ref;
+        info.package_hash = entry.package_hash;
+        index->apps[info.id].push_back(std::move(info));
+    }
+
+    index_ = std::move(index);
+    return index_;
+}
+
+inline void NahHost::refreshIndex() const {
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        index_.reset();
+    }
+    std::lock_guard<std::mutex> lock(inventory_mutex_);
+    inventory_.reset();
+}
+
 inline std::vector<AppInfo> NahHost::listApplications() const {
     std::vector<AppInfo> apps;
-    std::string apps_dir = root_ + "/registry/apps";
-
-    if (!nah::fs::exists(apps_dir)) {
-        return apps;
-    }
-
-    auto files = nah::fs::list_directory(apps_dir);
-    for (const auto& entry : files) {
-        if (entry.size() > 5 && entry.substr(entry.size() - 5) == ".json") {
-            auto record = loadInstallRecord(entry);
-            if (record) {
-                AppInfo info;
-                info.id = record->app.id;
-                info.version = record->app.version;
-                info.instance_id = record->install.instance_id;
-                info.install_root = record->paths.install_root;
-                info.record_path = entry;
-                info.metadata_json = extractMetadataJson(record->paths.install_root);
-                apps.push_back(info);
-            }
+    auto index = registryIndex();
+
+    for (const auto& [id, versions] : index->apps) {
+        for (const auto& info : versions) {
+            apps.push_back(info);
+            apps.back().metadata_json = extractMetadataJson(info.install_root);
         }
     }
 
     return apps;
 }
 
-inline std::optional<AppInfo> NahHost::findApplication(const std::string& id,
-                                                      const std::string& version) const {
-    auto apps = listApplications();
+inline std::optional<NahHost::IndexedApp> NahHost::findIndexedApplication(
+    const std::string& id, const std::string& version) const {
+    auto index = registryIndex();
 
-    std::vector<AppInfo> matches;
-    for (const auto& app : apps) {
-        if (app.id == id) {
-            if (version.empty() || app.version == version) {
-                matches.push_back(app);
-            }
-        }
+    auto it = index->apps.find(id);
+    if (it == index->apps.end()) {
+        return std::nullopt;
     }
 
-    if (matches.empty()) {
-        return std::nullopt;
+    // Versions are kept highest first, so the front is the latest
+    for (const auto& info : it->second) {
+        if (version.empty() || info.version == version) {
+            return info;
+        }
     }
 
-    // If multiple versions, sort by semver and return the highest
-    if (matches.size() > 1 && version.empty()) {
-        std::sort(matches.begin(), matches.end(), [](const AppInfo& a, const AppInfo& b) {
-            auto va = nah::semver::parse_version(a.version);
-            auto vb = nah::semver::parse_version(b.version);
-            if (va && vb) {
-                return *va > *vb;  // Descending order (highest first)
-            }
-            // Fallback to string comparison if parsing fails
-            return a.version > b.version;
-        });
+    return std::nullopt;
+}
+
+inline std::optional<AppInfo> NahHost::findApplication(const std::string& id,
+                                                      const std::string& version) const {
+    auto app_info = findIndexedApplication(id, version);
+    if (app_info) {
+        app_info->metadata_json = extractMetadataJson(app_info->install_root);
     }
-    return matches[0];
+    return app_info;
 }
 
 inline nah::core::HostEnvironment NahHost::getHostEnvironment() const {
@@ -394,8 +510,18 @@ inline nah::core::CompositionResult NahHost::getLaunchContract(
     const std::string& version,
     bool enable_trace) const {
 
+    nah::core::CompositionOptions opts;
+    opts.enable_trace = enable_trace;
+    return getLaunchContract(app_id, version, opts);
+}
+
+inline nah::core::CompositionResult NahHost::getLaunchContract(
+    const std::string& app_id,
+    const std::string& version,
+    const nah::core::CompositionOptions& options) const {
+
     // Find the application
-    auto app_info = findApplication(app_id, version);
+    auto app_info = findIndexedApplication(app_id, version);
     if (!app_info) {
         nah::core::CompositionResult result;
         result.ok = false;
@@ -404,56 +530,81 @@ inline nah::core::CompositionResult NahHost::getLaunchContract(
         return result;
     }
 
-    // Load install record
-    auto record = loadInstallRecord(app_info->record_path);
-    if (!record) {
-        nah::core::CompositionResult result;
-        result.ok = false;
-        result.critical_error = nah::core::CriticalError::INSTALL_RECORD_INVALID;
-        result.critical_error_context = "Failed to load install record";
-        return result;
+    // Reuse the cached contract if none of its inputs have changed
+    std::string cache_key;
+    if (contract_cache_enabled_ && !options.enable_trace && !options.enable_compact_trace &&
+        options.now.empty()) {
+        cache_key = contractCacheKey(*app_info, options);
+        auto cached = nah::registry::load_cached_result(
+            root_, app_info->id, app_info->version, cache_key);
+
+        // The key covers the JSON inputs only: a contract whose binary or
+        // entrypoint has since been removed is recomposed, not served
+        auto present = [](const std::string& path) { return path.empty() || nah::fs::exists(path); };
+        if (cached && present(cached->contract.execution.binary) && present(cached->contract.app.entrypoint)) {
+            return std::move(*cached);
+        }
     }
 
-    // Load app manifest
-    auto app_decl = loadAppManifest(app_info->install_root);
-    if (!app_decl) {
-        nah::core::CompositionResult result;
-        result.ok = false;
-        result.critical_error = nah::core::CriticalError::MANIFEST_MISSING;
-        result.critical_error_context = "Failed to load app manifest";
-        return result;
+    // Use provided options (including loader_override)
+    auto result = composeApplication(*app_info, getHostEnvironment(), *sharedInventory(), options);
+
+    if (!cache_key.empty()) {
+        nah::registry::store_cached_result(
+            root_, app_info->id, app_info->version, cache_key, result);
     }
+    return result;
+}
 
-    // Load host environment
-    auto host_env = getHostEnvironment();
+inline std::string NahHost::contractCacheKey(
+    const IndexedApp& app_info,
+    const nah::core::CompositionOptions& options) const {
 
-    // Get inventory
-    auto inventory = getInventory();
+    nah::registry::ContractCacheInputs inputs;
+    inputs.manifest_path = app_info.install_root + "/nap.json";
+    inputs.record_path = app_info.record_path;
+    if (!app_info.nak_record_ref.empty()) {
+        inputs.nak_record_path = nah::registry::naks_dir(root_) + "/" + app_info.nak_record_ref;
+    }
+    inputs.host_path = root_ + "/host/host.json";
+    inputs.loader_override = options.loader_override;
+    inputs.env_override = nah::overrides::detail::safe_getenv("NAH_OVERRIDE_ENVIRONMENT");
+    return nah::registry::contract_cache_key(root_, inputs);
+}
 
-    // Compose
-    nah::core::CompositionOptions opts;
-    opts.enable_trace = enable_trace;
+inline std::vector<nah::core::CompositionResult> NahHost::getLaunchContracts(
+    const std::vector<std::string>& app_ids,
+    const nah::core::BatchCompositionOptions& options) const {
 
-    return nah::core::nah_compose(*app_decl, host_env, *record, inventory, opts);
+    // Resolve every id against one snapshot of the registry index
+    auto index = registryIndex();
+
+    // Shared, read-only inputs for every composition
+    auto host_env = getHostEnvironment();
+    auto inventory = sharedInventory();
+
+    std::vector<nah::core::CompositionResult> results(app_ids.size());
+    nah::core::detail::parallel_for(app_ids.size(), options.workers, [&](size_t i) {
+        auto it = index->apps.find(app_ids[i]);
+        if (it == index->apps.end()) {
+            results[i].ok = false;
+            results[i].critical_error = nah::core::CriticalError::MANIFEST_MISSING;
+            results[i].critical_error_context = "Application not found: " + app_ids[i];
+            return;
+        }
+        results[i] = composeApplication(it->second.front(), host_env, *inventory, options.compose);
+    });
+
+    return results;
 }
 
-inline nah::core::CompositionResult NahHost::getLaunchContract(
-    const std::string& app_id,
-    const std::string& version,
+inline nah::core::CompositionResult NahHost::composeApplication(
+    const AppInfo& app_info,
+    const nah::core::HostEnvironment& host_env,
+    const nah::core::RuntimeInventory& inventory,
     const nah::core::CompositionOptions& options) const {
 
-    // Find the application
-    auto app_info = findApplication(app_id, version);
-    if (!app_info) {
-        nah::core::CompositionResult result;
-        result.ok = false;
-        result.critical_error = nah::core::CriticalError::MANIFEST_MISSING;
-        result.critical_error_context = "Application not found: " + app_id;
-        return result;
-    }
-
-    // Load install record
-    auto record = loadInstallRecord(app_info->record_path);
+    auto record = loadInstallRecord(app_info.record_path);
     if (!record) {
         nah::core::CompositionResult result;
         result.ok = false;
@@ -462,8 +613,7 @@ inline nah::core::CompositionResult NahHost::getLaunchContract(
         return result;
     }
 
-    // Load app manifest
-    auto app_decl = loadAppManifest(app_info->install_root);
+    auto app_decl = loadAppManifest(app_info.install_root);
     if (!app_decl) {
         nah::core::CompositionResult result;
         result.ok = false;
@@ -472,13 +622,6 @@ inline nah::core::CompositionResult NahHost::getLaunchContract(
         return result;
     }
 
-    // Load host environment
-    auto host_env = getHostEnvironment();
-
-    // Get inventory
-    auto inventory = getInventory();
-
-    // Use provided options (including loader_override)
     return nah::core::nah_compose(*app_decl, host_env, *record, inventory, options);
 }
 
@@ -520,63 +663,75 @@ inline int NahHost::executeContract(
 
 inline bool NahHost::isApplicationInstalled(const std::string& app_id,
                                            const std::string& version) const {
-    return findApplication(app_id, version).has_value();
+    return findIndexedApplication(app_id, version).has_value();
 }
 
 inline nah::core::RuntimeInventory NahHost::getInventory() const {
-    nah::core::RuntimeInventory inventory;
+    return *sharedInventory();
+}
+
+inline std::shared_ptr<const nah::core::RuntimeInventory> NahHost::sharedInventory() const {
     std::string naks_dir = root_ + "/registry/naks";
 
-    if (!nah::fs::exists(naks_dir)) {
-        return inventory;
-    }
-
-    auto files = nah::fs::list_directory(naks_dir);
-    for (const auto& entry : files) {
-        // list_directory returns full paths, so use entry directly
-        if (entry.size() > 5 && entry.substr(entry.size() - 5) == ".json") {
-            // NAH v2.0: Registry files ARE the runtime descriptors
-            // Parse the registry file directly as a RuntimeDescriptor
-            auto runtime_content = nah::fs::read_file(entry);
-            if (runtime_content) {
-                // Extract record_ref from filename
-                std::string basename = entry;
-                size_t last_slash = entry.rfind('/');
-                if (last_slash != std::string::npos) {
-                    basename = entry.substr(last_slash + 1);
+    // Read the mtime before loading so a change made meanwhile is picked up
+    // by the next call rather than lost.
+    auto naks_mtime = nah::fs::last_write_time(naks_dir);
+
+    std::lock_guard<std::mutex> lock(inventory_mutex_);
+    if (!inventory_ || !naks_mtime || inventory_->naks_mtime != naks_mtime) {
+        auto snapshot = std::make_shared<InventorySnapshot>();
+        snapshot->naks_mtime = naks_mtime;
+
+        // NAH v2.0: Registry files ARE the runtime descriptors
+        if (nah::fs::exists(naks_dir)) {
+            snapshot->inventory = nah::fs::load_inventory_from_directory(naks_dir);
+        }
+
+        auto is_relative = [](const std::string& path) {
+            return !path.empty() && !nah::fs::is_absolute_path(path);
+        };
+        auto has_relative_paths = [&](const nah::core::RuntimeDescriptor& runtime) {
+            return is_relative(runtime.paths.root) ||
+                   std::any_of(runtime.paths.lib_dirs.begin(), runtime.paths.lib_dirs.end(), is_relative) ||
+                   std::any_of(runtime.loaders.begin(), runtime.loaders.end(),
+                               [&](const auto& kv) { return is_relative(kv.second.exec_path); });
+        };
+
+        for (auto& [record_ref, shared] : snapshot->inventory.runtimes) {
+            // Descriptors are shared and immutable, so records with relative
+            // paths are resolved into a copy
+            if (!has_relative_paths(*shared)) {
+                continue;
+            }
+            auto runtime = std::make_shared<nah::core::RuntimeDescriptor>(*shared);
+
+            // Resolve relative paths to absolute (for sandbox/portability support)
+            if (is_relative(runtime->paths.root)) {
+                runtime->paths.root = nah::fs::absolute_path(nah::fs::join_paths(root_, runtime->paths.root));
+            }
+
+            // Resolve relative lib_dirs
+            for (auto& lib_dir : runtime->paths.lib_dirs) {
+                if (is_relative(lib_dir)) {
+                    lib_dir = nah::fs::absolute_path(nah::fs::join_paths(runtime->paths.root, lib_dir));
                 }
-                std::string record_ref = basename;
-
-                auto result = nah::json::parse_runtime_descriptor(*runtime_content, entry);
-                if (result.ok) {
-                    result.value.source_path = entry;
-                    
-                    // Resolve relative paths to absolute (for sandbox/portability support)
-                    if (!result.value.paths.root.empty() && !nah::fs::is_absolute_path(result.value.paths.root)) {
-                        result.value.paths.root = nah::fs::absolute_path(nah::fs::join_paths(root_, result.value.paths.root));
-                    }
-                    
-                    // Resolve relative lib_dirs
-                    for (auto& lib_dir : result.value.paths.lib_dirs) {
-                        if (!lib_dir.empty() && !nah::fs::is_absolute_path(lib_dir)) {
-                            lib_dir = nah::fs::absolute_path(nah::fs::join_paths(result.value.paths.root, lib_dir));
-                        }
-                    }
-                    
-                    // Resolve relative loader exec_paths
-                    for (auto& [name, loader] : result.value.loaders) {
-                        if (!loader.exec_path.empty() && !nah::fs::is_absolute_path(loader.exec_path)) {
-                            loader.exec_path = nah::fs::absolute_path(nah::fs::join_paths(result.value.paths.root, loader.exec_path));
-                        }
-                    }
-                    
-                    inventory.runtimes[record_ref] = result.value;
+            }
+
+            // Resolve relative loader exec_paths
+            for (auto& [name, loader] : runtime->loaders) {
+                if (is_relative(loader.exec_path)) {
+                    loader.exec_path = nah::fs::absolute_path(nah::fs::join_paths(runtime->paths.root, loader.exec_path));
                 }
             }
+
+            shared = std::move(runtime);
         }
+
+        inventory_ = std::move(snapshot);
     }
 
-    return inventory;
+    // Aliases the snapshot, which stays alive while the caller holds this
+    return std::shared_ptr<const nah::core::RuntimeInventory>(inventory_, &inventory_->inventory);
 }
 
 inline std::string NahHost::validateRoot() const {
@@ -638,12 +793,12 @@ inline std::unique_ptr<NahHost> NahHost::discover(const std::vector<std::string>
 }
 
 inline std::optional<nah::core::InstallRecord> NahHost::loadInstallRecord(const std::string& path) const {
-    auto content = nah::fs::read_file(path);
+    auto content = nah::fs::read_file_view(path);
     if (!content) {
         return std::nullopt;
     }
 
-    auto result = nah::json::parse_install_record(*content);
+    auto result = nah::json::parse_install_record(content->view());
     if (result.ok) {
         // Ensure absolute paths (portable check for both Unix and Windows)
         if (!result.value.paths.install_root.empty() && !nah::fs::is_absolute_path(result.value.paths.install_root)) {
@@ -656,9 +811,9 @@ inline std::optional<nah::core::InstallRecord> NahHost::loadInstallRecord(const
 }
 
 inline std::optional<nah::core::AppDeclaration> NahHost::loadAppManifest(const std::string& app_dir) const {
-    auto json_content = nah::fs::read_file(app_dir + "/nap.json");
+    auto json_content = nah::fs::read_file_view(app_dir + "/nap.json");
     if (json_content) {
-        auto result = nah::json::parse_app_declaration(*json_content);
+        auto result = nah::json::parse_app_declaration(json_content->view());
         if (result.ok) {
             return result.value;
         }
@@ -736,7 +891,7 @@ inline nah::core::CompositionResult NahHost::composeComponentLaunch(
     }
     
     // 2. Find application
-    auto app_info = findApplication(parsed.app_id);
+    auto app_info = findIndexedApplication(parsed.app_id);
     if (!app_info) {
         nah::core::CompositionResult result;
         result.ok = false;
@@ -818,11 +973,11 @@ inline nah::core::CompositionResult NahHost::composeComponentLaunch(
     
     // 7. Get host environment and inventory
     auto host_env = getHostEnvironment();
-    auto inventory = getInventory();
+    auto inventory = sharedInventory();
     
     // 8. Compose using the standard nah_compose function
     nah::core::CompositionOptions comp_opts;
-    auto result = nah::core::nah_compose(component_app, host_env, *install_record, inventory, comp_opts);
+    auto result = nah::core::nah_compose(component_app, host_env, *install_record, *inventory, comp_opts);
     
     if (!result.ok) {
         return result;
@@ -869,7 +1024,7 @@ inline bool NahHost::canHandleComponentUri(const std::string& uri) const {
         return false;
     }
     
-    auto app_info = findApplication(parsed.app_id);
+    auto app_info = findIndexedApplication(parsed.app_id);
     if (!app_info) {
         return false;
     }
@@ -3,6 +3,10 @@
  * 
  * This file provides JSON serialization and deserialization for all NAH types.
  * Requires nlohmann/json.
+ *
+ * Define NAH_JSON_BACKEND_SIMDJSON (CMake: -DNAH_JSON_BACKEND=simdjson) to
+ * read manifests and records with simdjson instead. nlohmann/json is still
+ * required: it reports parse errors and handles launch contracts.
  * 
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -15,6 +19,16 @@
 #include "nah_core.h"
 #include <nlohmann/json.hpp>
 
+#ifdef NAH_JSON_BACKEND_SIMDJSON
+#include <simdjson.h>
+#endif
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace nah {
 namespace json {
 
@@ -135,6 +149,7 @@ inline core::LoaderConfig parse_loader_config(const json& j) {
     core::LoaderConfig lc;
     lc.exec_path = detail::get_string(j, "exec_path");
     lc.args_template = detail::get_string_array(j, "args_template");
+    lc.args_compiled = core::compile_templates(lc.args_template);
     return lc;
 }
 
@@ -182,7 +197,12 @@ inline core::ComponentDecl parse_component(const json& j) {
 // APP DECLARATION PARSING
 // ============================================================================
 
-inline ParseResult<core::AppDeclaration> parse_app_declaration(const std::string& json_str) {
+// The parse_*_dom() functions below build an nlohmann::json document and
+// read fields from it. They are the reference behaviour: the streaming
+// parsers further down must agree with them on every input, and fall back
+// to them to report errors.
+
+inline ParseResult<core::AppDeclaration> parse_app_declaration_dom(const std::string& json_str) {
     ParseResult<core::AppDeclaration> result;
 
     try {
@@ -374,8 +394,8 @@ inline ParseResult<core::HostEnvironment> parse_host_environment(const json& j,
     return result;
 }
 
-inline ParseResult<core::HostEnvironment> parse_host_environment(const std::string& json_str,
-                                                                  const std::string& source_path = "") {
+inline ParseResult<core::HostEnvironment> parse_host_environment_dom(const std::string& json_str,
+                                                                      const std::string& source_path = "") {
     ParseResult<core::HostEnvironment> result;
     
     try {
@@ -392,8 +412,8 @@ inline ParseResult<core::HostEnvironment> parse_host_environment(const std::stri
 // INSTALL RECORD PARSING
 // ============================================================================
 
-inline ParseResult<core::InstallRecord> parse_install_record(const std::string& json_str,
-                                                              const std::string& source_path = "") {
+inline ParseResult<core::InstallRecord> parse_install_record_dom(const std::string& json_str,
+                                                                  const std::string& source_path = "") {
     ParseResult<core::InstallRecord> result;
     
     try {
@@ -446,7 +466,13 @@ inline ParseResult<core::InstallRecord> parse_install_record(const std::string&
             ir.provenance.installed_by = detail::get_string(j["provenance"], "installed_by");
             ir.provenance.source = detail::get_string(j["provenance"], "source");
         }
-        
+
+        // Verification section
+        if (j.contains("verification") && j["verification"].is_object()) {
+            ir.verification.last_verified_at = detail::get_string(j["verification"], "last_verified_at");
+            ir.verification.last_verifier_version = detail::get_string(j["verification"], "last_verifier_version");
+        }
+
         // Trust section
         if (j.contains("trust") && j["trust"].is_object()) {
             ir.trust = parse_trust_info(j["trust"]);
@@ -483,8 +509,8 @@ inline ParseResult<core::InstallRecord> parse_install_record(const std::string&
 // RUNTIME DESCRIPTOR PARSING
 // ============================================================================
 
-inline ParseResult<core::RuntimeDescriptor> parse_runtime_descriptor(const std::string& json_str,
-                                                                      const std::string& source_path = "") {
+inline ParseResult<core::RuntimeDescriptor> parse_runtime_descriptor_dom(const std::string& json_str,
+                                                                          const std::string& source_path = "") {
     ParseResult<core::RuntimeDescriptor> result;
     
     try {
@@ -559,6 +585,1019 @@ inline ParseResult<core::RuntimeDescriptor> parse_runtime_descriptor(const std::
     return result;
 }
 
+// ============================================================================
+// STREAMING PARSERS
+// ============================================================================
+//
+// parse_app_declaration(), parse_host_environment(), parse_install_record()
+// and parse_runtime_descriptor() walk the text once through detail::Reader
+// and assign each field straight into the result struct: no nlohmann
+// document is built, each key is compared once, and values that aren't
+// needed are skipped. detail::Reader is a small strict tokenizer by default,
+// or simdjson with NAH_JSON_BACKEND_SIMDJSON.
+//
+// They produce exactly what the parse_*_dom() functions do, including for
+// duplicate keys (the last one wins) and values of the wrong type (treated
+// as absent). Malformed JSON and inputs that fail validation are handed to
+// the DOM parser, so errors (including nlohmann's parse error messages) are
+// identical too.
+
+namespace detail {
+
+#ifdef NAH_JSON_BACKEND_SIMDJSON
+
+// Reader over a simdjson document. simdjson validates the whole text up
+// front (structure, UTF-8, escapes, numbers), so the field readers below only
+// walk the parsed tree; skipping a value costs nothing. Anything simdjson
+// rejects, including inputs nlohmann would accept such as integers wider than
+// 64 bits, clears ok() and the caller falls back to the DOM parser.
+class Reader {
+public:
+    explicit Reader(std::string_view text) {
+        // One parser per thread: it keeps its buffers between documents
+        static thread_local simdjson::dom::parser parser;
+        if (parser.parse(text.data(), text.size()).get(current_) != simdjson::SUCCESS) {
+            fail();
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    bool fail() {
+        ok_ = false;
+        return false;
+    }
+
+    // First character the current value would have in JSON text
+    char peek() const {
+        if (!ok_) return '\0';
+        switch (current_.type()) {
+            case simdjson::dom::element_type::OBJECT: return '{';
+            case simdjson::dom::element_type::ARRAY: return '[';
+            case simdjson::dom::element_type::STRING: return '"';
+            case simdjson::dom::element_type::BOOL: return current_.get_bool().value_unsafe() ? 't' : 'f';
+            case simdjson::dom::element_type::NULL_VALUE: return 'n';
+            default: return '0';
+        }
+    }
+
+    // simdjson rejects trailing content while parsing
+    bool at_end() const { return ok_; }
+
+    bool string(std::string& out) {
+        std::string_view value;
+        if (!ok_ || current_.get_string().get(value) != simdjson::SUCCESS) return fail();
+        out.assign(value.data(), value.size());
+        return true;
+    }
+
+    bool boolean(bool& out) {
+        if (!ok_ || current_.get_bool().get(out) != simdjson::SUCCESS) return fail();
+        return true;
+    }
+
+    bool skip() { return ok_; }
+
+    template <typename F>
+    bool object(F&& on_member) {
+        simdjson::dom::object members;
+        if (!ok_ || current_.get_object().get(members) != simdjson::SUCCESS) return fail();
+        simdjson::dom::element self = current_;
+        for (auto member : members) {
+            current_ = member.value;
+            on_member(member.key);
+            if (!ok_) return false;
+        }
+        current_ = self;
+        return true;
+    }
+
+    template <typename F>
+    bool array(F&& on_item) {
+        simdjson::dom::array items;
+        if (!ok_ || current_.get_array().get(items) != simdjson::SUCCESS) return fail();
+        simdjson::dom::element self = current_;
+        for (simdjson::dom::element item : items) {
+            current_ = item;
+            on_item();
+            if (!ok_) return false;
+        }
+        current_ = self;
+        return true;
+    }
+
+private:
+    simdjson::dom::element current_;
+    bool ok_ = true;
+};
+
+#else
+
+// Pull reader over JSON text. It accepts exactly what nlohmann::json::parse()
+// accepts, or less: anything it does not handle (a syntax error, an exponent,
+// very deep nesting) clears ok() and the caller falls back to the DOM parser.
+class Reader {
+public:
+    explicit Reader(std::string_view text) : p_(text.data()), end_(text.data() + text.size()) {
+        if (text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            p_ += 3;  // nlohmann skips a UTF-8 BOM
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    bool fail() {
+        ok_ = false;
+        p_ = end_;
+        return false;
+    }
+
+    // First character of the next value ('{', '[', '"', 't', ...), or '\0'
+    char peek() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+        return p_ < end_ ? *p_ : '\0';
+    }
+
+    // True if only whitespace remains
+    bool at_end() {
+        peek();
+        return ok_ && p_ == end_;
+    }
+
+    bool string(std::string& out) {
+        out.clear();
+        return peek() == '"' ? scan_string(&out) : fail();
+    }
+
+    bool boolean(bool& out) {
+        char c = peek();
+        if (c == 't' && literal("true")) {
+            out = true;
+            return true;
+        }
+        if (c == 'f' && literal("false")) {
+            out = false;
+            return true;
+        }
+        return fail();
+    }
+
+    // Skip one value of any type
+    bool skip() {
+        switch (peek()) {
+            case '{': return object([this](std::string_view) { skip(); });
+            case '[': return array([this] { skip(); });
+            case '"': return scan_string(nullptr);
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            default: return number();
+        }
+    }
+
+    // Read an object, calling on_member(key) with the cursor on each value.
+    // on_member must consume exactly one value.
+    template <typename F>
+    bool object(F&& on_member) {
+        if (peek() != '{' || !enter()) return fail();
+        ++p_;
+        std::string key;
+        if (peek() == '}') {
+            ++p_;
+            return leave();
+        }
+        for (;;) {
+            if (!string(key) || peek() != ':') return fail();
+            ++p_;
+            on_member(key);
+            if (!ok_) return false;
+            char c = peek();
+            ++p_;
+            if (c == '}') return leave();
+            if (c != ',') return fail();
+        }
+    }
+
+    // Read an array, calling on_item() with the cursor on each element
+    template <typename F>
+    bool array(F&& on_item) {
+        if (peek() != '[' || !enter()) return fail();
+        ++p_;
+        if (peek() == ']') {
+            ++p_;
+            return leave();
+        }
+        for (;;) {
+            on_item();
+            if (!ok_) return false;
+            char c = peek();
+            ++p_;
+            if (c == ']') return leave();
+            if (c != ',') return fail();
+        }
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 256;
+
+    bool enter() { return ++depth_ <= MAX_DEPTH; }
+    bool leave() {
+        --depth_;
+        return true;
+    }
+
+    bool literal(std::string_view word) {
+        if (static_cast<size_t>(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word) {
+            return fail();
+        }
+        p_ += word.size();
+        return true;
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)? -- exponents, and integers long enough to
+    // overflow a double, are left to the DOM parser
+    bool number() {
+        auto digit = [this] { return p_ < end_ && *p_ >= '0' && *p_ <= '9'; };
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (!digit()) return fail();
+        const char* start = p_;
+        if (*p_ == '0') {
+            ++p_;
+        } else {
+            while (digit()) ++p_;
+        }
+        if (p_ - start > 300) return fail();
+        if (p_ < end_ && *p_ == '.') {
+            ++p_;
+            if (!digit()) return fail();
+            while (digit()) ++p_;
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) return fail();
+        return true;
+    }
+
+    bool hex4(unsigned& out) {
+        if (end_ - p_ < 4) return fail();
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p_++;
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f') out |= static_cast<unsigned>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') out |= static_cast<unsigned>(c - 'A' + 10);
+            else return fail();
+        }
+        return true;
+    }
+
+    static void append_utf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // Length of the well-formed UTF-8 sequence at p_ (RFC 3629, as nlohmann
+    // checks it), or 0
+    size_t utf8_sequence() const {
+        auto byte = [this](size_t i) {
+            return p_ + i < end_ ? static_cast<unsigned char>(p_[i]) : 0u;
+        };
+        auto in = [](unsigned b, unsigned lo, unsigned hi) { return b >= lo && b <= hi; };
+        unsigned b0 = byte(0);
+        if (in(b0, 0xC2, 0xDF)) return in(byte(1), 0x80, 0xBF) ? 2 : 0;
+        if (b0 == 0xE0) return in(byte(1), 0xA0, 0xBF) && in(byte(2), 0x80, 0xBF) ? 3 : 0;
+        if (in(b0, 0xE1, 0xEC) || in(b0, 0xEE, 0xEF)) {
+            return in(byte(1), 0x80, 0xBF) && in(byte(2), 0x80, 0xBF) ? 3 : 0;
+        }
+        if (b0 == 0xED) return in(byte(1), 0x80, 0x9F) && in(byte(2), 0x80, 0xBF) ? 3 : 0;
+        if (b0 == 0xF0) {
+            return in(byte(1), 0x90, 0xBF) && in(byte(2), 0x80, 0xBF) && in(byte(3), 0x80, 0xBF) ? 4 : 0;
+        }
+        if (in(b0, 0xF1, 0xF3)) {
+            return in(byte(1), 0x80, 0xBF) && in(byte(2), 0x80, 0xBF) && in(byte(3), 0x80, 0xBF) ? 4 : 0;
+        }
+        if (b0 == 0xF4) {
+            return in(byte(1), 0x80, 0x8F) && in(byte(2), 0x80, 0xBF) && in(byte(3), 0x80, 0xBF) ? 4 : 0;
+        }
+        return 0;
+    }
+
+    // Scan the string at p_, decoding into out unless it is null
+    bool scan_string(std::string* out) {
+        ++p_;  // opening quote
+        for (;;) {
+            const char* run = p_;
+            while (p_ < end_) {
+                auto c = static_cast<unsigned char>(*p_);
+                if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) break;
+                ++p_;
+            }
+            if (out) out->append(run, static_cast<size_t>(p_ - run));
+            if (p_ >= end_) return fail();
+
+            auto c = static_cast<unsigned char>(*p_);
+            if (c == '"') {
+                ++p_;
+                return true;
+            }
+            if (c < 0x20) return fail();
+            if (c >= 0x80) {
+                size_t n = utf8_sequence();
+                if (n == 0) return fail();
+                if (out) out->append(p_, n);
+                p_ += n;
+                continue;
+            }
+
+            // Escape sequence
+            if (++p_ >= end_) return fail();
+            char e = *p_++;
+            char decoded = 0;
+            switch (e) {
+                case '"': decoded = '"'; break;
+                case '\\': decoded = '\\'; break;
+                case '/': decoded = '/'; break;
+                case 'b': decoded = '\b'; break;
+                case 'f': decoded = '\f'; break;
+                case 'n': decoded = '\n'; break;
+                case 'r': decoded = '\r'; break;
+                case 't': decoded = '\t'; break;
+                case 'u': {
+                    unsigned cp = 0;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        unsigned low = 0;
+                        if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') return fail();
+                        p_ += 2;
+                        if (!hex4(low)) return false;
+                        if (low < 0xDC00 || low > 0xDFFF) return fail();
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        return fail();
+                    }
+                    if (out) append_utf8(*out, cp);
+                    continue;
+                }
+                default: return fail();
+            }
+            if (out) *out += decoded;
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+    int depth_ = 0;
+    bool ok_ = true;
+};
+
+#endif // NAH_JSON_BACKEND_SIMDJSON
+
+// Field readers. Each consumes one value; a value of the wrong type is
+// skipped and leaves the field at its default, as get_string() & co. do.
+
+inline void read_string(Reader& r, std::string& out, const char* default_val = "") {
+    if (r.peek() == '"') {
+        r.string(out);
+    } else {
+        r.skip();
+        out = default_val;
+    }
+}
+
+inline void read_bool(Reader& r, bool& out, bool default_val) {
+    char c = r.peek();
+    if (c == 't' || c == 'f') {
+        r.boolean(out);
+    } else {
+        r.skip();
+        out = default_val;
+    }
+}
+
+inline void read_string_array(Reader& r, std::vector<std::string>& out) {
+    out.clear();
+    if (r.peek() != '[') {
+        r.skip();
+        return;
+    }
+    r.array([&] {
+        if (r.peek() == '"') {
+            out.emplace_back();
+            r.string(out.back());
+        } else {
+            r.skip();
+        }
+    });
+}
+
+// Read an object member by member; anything else is skipped. Returns whether
+// the value was an object.
+template <typename F>
+bool read_object(Reader& r, F&& on_member) {
+    if (r.peek() != '{') {
+        r.skip();
+        return false;
+    }
+    r.object(on_member);
+    return true;
+}
+
+// String values of an object; keys whose last value isn't a string are absent
+inline void read_string_map(Reader& r, std::unordered_map<std::string, std::string>& out) {
+    out.clear();
+    read_object(r, [&](std::string_view key) {
+        if (r.peek() == '"') {
+            r.string(out[std::string(key)]);
+        } else {
+            r.skip();
+            out.erase(std::string(key));
+        }
+    });
+}
+
+inline void read_env_value(Reader& r, core::EnvValue& ev) {
+    ev = core::EnvValue();
+    if (r.peek() == '"') {
+        r.string(ev.value);
+        return;
+    }
+    std::string op = "set";
+    read_object(r, [&](std::string_view key) {
+        if (key == "op") read_string(r, op, "set");
+        else if (key == "value") read_string(r, ev.value);
+        else if (key == "separator") read_string(r, ev.separator, ":");
+        else r.skip();
+    });
+    ev.op = core::parse_env_op(op).value_or(core::EnvOp::Set);
+}
+
+inline void read_env_map(Reader& r, core::EnvMap& out) {
+    out.clear();
+    read_object(r, [&](std::string_view key) { read_env_value(r, out[std::string(key)]); });
+}
+
+inline void read_trust_info(Reader& r, core::TrustInfo& ti) {
+    ti = core::TrustInfo();
+    std::string state = "unknown";
+    read_object(r, [&](std::string_view key) {
+        if (key == "state") read_string(r, state, "unknown");
+        else if (key == "source") read_string(r, ti.source);
+        else if (key == "evaluated_at") read_string(r, ti.evaluated_at);
+        else if (key == "expires_at") read_string(r, ti.expires_at);
+        else if (key == "inputs_hash") read_string(r, ti.inputs_hash);
+        else if (key == "details") read_string_map(r, ti.details);
+        else r.skip();
+    });
+    ti.state = core::parse_trust_state(state).value_or(core::TrustState::Unknown);
+}
+
+inline void read_loader_config(Reader& r, core::LoaderConfig& lc) {
+    lc = core::LoaderConfig();
+    read_object(r, [&](std::string_view key) {
+        if (key == "exec_path") read_string(r, lc.exec_path);
+        else if (key == "args_template") read_string_array(r, lc.args_template);
+        else r.skip();
+    });
+    lc.args_compiled = core::compile_templates(lc.args_template);
+}
+
+inline void read_component(Reader& r, core::ComponentDecl& comp) {
+    comp = core::ComponentDecl();
+    read_object(r, [&](std::string_view key) {
+        if (key == "id") read_string(r, comp.id);
+        else if (key == "name") read_string(r, comp.name);
+        else if (key == "description") read_string(r, comp.description);
+        else if (key == "icon") read_string(r, comp.icon);
+        else if (key == "entrypoint") read_string(r, comp.entrypoint);
+        else if (key == "uri_pattern") read_string(r, comp.uri_pattern);
+        else if (key == "loader") read_string(r, comp.loader);
+        else if (key == "standalone") read_bool(r, comp.standalone, true);
+        else if (key == "hidden") read_bool(r, comp.hidden, false);
+        else if (key == "environment") read_env_map(r, comp.environment);
+        else if (key == "permissions") {
+            comp.permissions_filesystem.clear();
+            comp.permissions_network.clear();
+            read_object(r, [&](std::string_view k) {
+                if (k == "filesystem") read_string_array(r, comp.permissions_filesystem);
+                else if (k == "network") read_string_array(r, comp.permissions_network);
+                else r.skip();
+            });
+        }
+        else if (key == "metadata") read_string_map(r, comp.metadata);
+        else r.skip();
+    });
+}
+
+inline void read_asset_export(Reader& r, core::AssetExportDecl& aed) {
+    aed = core::AssetExportDecl();
+    read_object(r, [&](std::string_view key) {
+        if (key == "id") read_string(r, aed.id);
+        else if (key == "path") read_string(r, aed.path);
+        else if (key == "type") read_string(r, aed.type);
+        else r.skip();
+    });
+}
+
+// The members of one manifest object. A manifest may spell the same field
+// several ways (app.identity.id, id; execution.entrypoint, entrypoint,
+// entrypoint_path, ...), and which spelling counts depends on what else is
+// present, so every spelling is kept until the object has been read.
+struct ManifestFields {
+    struct Identity { std::string id, version, nak_id, nak_version_req; };
+    struct Nak { std::string id, version_req; };
+    struct Execution { std::string entrypoint, loader; std::vector<std::string> args; };
+    struct Entrypoint { bool is_object = false, is_string = false; std::string path; std::vector<std::string> args; };
+    struct Dirs { std::vector<std::string> lib_dirs, asset_dirs; };
+    struct Permissions { std::vector<std::string> filesystem, network; };
+    struct Metadata { std::string description, author, license, homepage; };
+
+    std::optional<Identity> identity;
+    std::string id, version, nak_id, nak_version_req;
+    std::optional<Nak> nak;
+    std::optional<Execution> execution;
+    std::optional<Entrypoint> entrypoint;
+    std::string entrypoint_path;
+    std::vector<std::string> entrypoint_args;
+    std::optional<Dirs> layout;
+    Dirs dirs;
+    std::vector<std::string> env_vars;
+    std::optional<std::map<std::string, std::optional<std::string>>> environment;  ///< Sorted, as DOM iteration is
+    std::optional<std::vector<core::AssetExportDecl>> exports, asset_exports;
+    std::optional<Permissions> permissions;
+    std::optional<Metadata> metadata;
+    Metadata flat_metadata;
+    std::optional<std::vector<core::ComponentDecl>> components;  ///< components.provides
+};
+
+// Read `section` as an object into a fresh T, or reset it if the value is
+// anything else
+template <typename T, typename F>
+void read_section(Reader& r, std::optional<T>& section, F&& on_member) {
+    if (r.peek() == '{') {
+        section.emplace();
+        r.object([&](std::string_view key) { on_member(*section, key); });
+    } else {
+        section.reset();
+        r.skip();
+    }
+}
+
+template <typename T, typename F>
+void read_list(Reader& r, std::optional<std::vector<T>>& list, F&& read_item) {
+    if (r.peek() == '[') {
+        list.emplace();
+        r.array([&] {
+            list->emplace_back();
+            read_item(list->back());
+        });
+    } else {
+        list.reset();
+        r.skip();
+    }
+}
+
+inline void read_manifest_member(Reader& r, ManifestFields& f, std::string_view key) {
+    using F = ManifestFields;
+    if (key == "identity") {
+        read_section(r, f.identity, [&](F::Identity& s, std::string_view k) {
+            if (k == "id") read_string(r, s.id);
+            else if (k == "version") read_string(r, s.version);
+            else if (k == "nak_id") read_string(r, s.nak_id);
+            else if (k == "nak_version_req") read_string(r, s.nak_version_req);
+            else r.skip();
+        });
+    } else if (key == "id") {
+        read_string(r, f.id);
+    } else if (key == "version") {
+        read_string(r, f.version);
+    } else if (key == "nak") {
+        read_section(r, f.nak, [&](F::Nak& s, std::string_view k) {
+            if (k == "id") read_string(r, s.id);
+            else if (k == "version_req") read_string(r, s.version_req);
+            else r.skip();
+        });
+    } else if (key == "nak_id") {
+        read_string(r, f.nak_id);
+    } else if (key == "nak_version_req") {
+        read_string(r, f.nak_version_req);
+    } else if (key == "execution") {
+        read_section(r, f.execution, [&](F::Execution& s, std::string_view k) {
+            if (k == "entrypoint") read_string(r, s.entrypoint);
+            else if (k == "args") read_string_array(r, s.args);
+            else if (k == "loader") read_string(r, s.loader);
+            else r.skip();
+        });
+    } else if (key == "entrypoint") {
+        f.entrypoint.emplace();
+        if (r.peek() == '"') {
+            f.entrypoint->is_string = true;
+            r.string(f.entrypoint->path);
+        } else {
+            f.entrypoint->is_object = read_object(r, [&](std::string_view k) {
+                if (k == "path") read_string(r, f.entrypoint->path);
+                else if (k == "args") read_string_array(r, f.entrypoint->args);
+                else r.skip();
+            });
+        }
+    } else if (key == "entrypoint_path") {
+        read_string(r, f.entrypoint_path);
+    } else if (key == "entrypoint_args") {
+        read_string_array(r, f.entrypoint_args);
+    } else if (key == "layout") {
+        read_section(r, f.layout, [&](F::Dirs& s, std::string_view k) {
+            if (k == "lib_dirs") read_string_array(r, s.lib_dirs);
+            else if (k == "asset_dirs") read_string_array(r, s.asset_dirs);
+            else r.skip();
+        });
+    } else if (key == "lib_dirs") {
+        read_string_array(r, f.dirs.lib_dirs);
+    } else if (key == "asset_dirs") {
+        read_string_array(r, f.dirs.asset_dirs);
+    } else if (key == "env_vars") {
+        read_string_array(r, f.env_vars);
+    } else if (key == "environment") {
+        read_section(r, f.environment,
+                     [&](std::map<std::string, std::optional<std::string>>& env, std::string_view k) {
+            auto& value = env[std::string(k)];
+            if (r.peek() == '"') {
+                value.emplace();
+                r.string(*value);
+            } else {
+                value.reset();
+                r.skip();
+            }
+        });
+    } else if (key == "exports") {
+        read_list(r, f.exports, [&](core::AssetExportDecl& aed) { read_asset_export(r, aed); });
+    } else if (key == "asset_exports") {
+        read_list(r, f.asset_exports, [&](core::AssetExportDecl& aed) { read_asset_export(r, aed); });
+    } else if (key == "permissions") {
+        read_section(r, f.permissions, [&](F::Permissions& s, std::string_view k) {
+            if (k == "filesystem") read_string_array(r, s.filesystem);
+            else if (k == "network") read_string_array(r, s.network);
+            else r.skip();
+        });
+    } else if (key == "metadata") {
+        read_section(r, f.metadata, [&](F::Metadata& s, std::string_view k) {
+            if (k == "description") read_string(r, s.description);
+            else if (k == "author") read_string(r, s.author);
+            else if (k == "license") read_string(r, s.license);
+            else if (k == "homepage") read_string(r, s.homepage);
+            else r.skip();
+        });
+    } else if (key == "description") {
+        read_string(r, f.flat_metadata.description);
+    } else if (key == "author") {
+        read_string(r, f.flat_metadata.author);
+    } else if (key == "license") {
+        read_string(r, f.flat_metadata.license);
+    } else if (key == "homepage") {
+        read_string(r, f.flat_metadata.homepage);
+    } else if (key == "components") {
+        f.components.reset();
+        read_object(r, [&](std::string_view k) {
+            if (k == "provides") {
+                read_list(r, f.components, [&](core::ComponentDecl& c) { read_component(r, c); });
+            } else {
+                r.skip();
+            }
+        });
+    } else {
+        r.skip();
+    }
+}
+
+// Resolve the spellings the same way parse_app_declaration_dom() does.
+// Returns false where it would report a missing field.
+inline bool resolve_manifest(ManifestFields& f, core::AppDeclaration& app) {
+    if (f.identity) {
+        app.id = std::move(f.identity->id);
+        app.version = std::move(f.identity->version);
+        app.nak_id = std::move(f.identity->nak_id);
+        app.nak_version_req = std::move(f.identity->nak_version_req);
+    } else {
+        app.id = std::move(f.id);
+        app.version = std::move(f.version);
+        if (f.nak) {
+            app.nak_id = std::move(f.nak->id);
+            app.nak_version_req = std::move(f.nak->version_req);
+        } else {
+            app.nak_id = std::move(f.nak_id);
+            app.nak_version_req = std::move(f.nak_version_req);
+        }
+    }
+    if (app.id.empty() || app.version.empty()) {
+        return false;
+    }
+
+    if (f.execution) {
+        app.entrypoint_path = std::move(f.execution->entrypoint);
+        app.entrypoint_args = std::move(f.execution->args);
+        app.nak_loader = std::move(f.execution->loader);
+    } else if (f.entrypoint) {
+        if (f.entrypoint->is_object || f.entrypoint->is_string) {
+            app.entrypoint_path = std::move(f.entrypoint->path);
+            app.entrypoint_args = std::move(f.entrypoint->args);
+        }
+    } else {
+        app.entrypoint_path = std::move(f.entrypoint_path);
+        app.entrypoint_args = std::move(f.entrypoint_args);
+    }
+    if (app.entrypoint_path.empty()) {
+        return false;
+    }
+
+    ManifestFields::Dirs& dirs = f.layout ? *f.layout : f.dirs;
+    app.lib_dirs = std::move(dirs.lib_dirs);
+    app.asset_dirs = std::move(dirs.asset_dirs);
+
+    app.env_vars = std::move(f.env_vars);
+    if (f.environment) {
+        for (auto& [key, value] : *f.environment) {
+            if (value) app.env_vars.push_back(key + "=" + *value);
+        }
+    }
+
+    if (f.exports) {
+        app.asset_exports = std::move(*f.exports);
+    } else if (f.asset_exports) {
+        app.asset_exports = std::move(*f.asset_exports);
+    }
+
+    if (f.permissions) {
+        app.permissions_filesystem = std::move(f.permissions->filesystem);
+        app.permissions_network = std::move(f.permissions->network);
+    }
+
+    ManifestFields::Metadata& meta = f.metadata ? *f.metadata : f.flat_metadata;
+    app.description = std::move(meta.description);
+    app.author = std::move(meta.author);
+    app.license = std::move(meta.license);
+    app.homepage = std::move(meta.homepage);
+
+    if (f.components) {
+        app.components = std::move(*f.components);
+    }
+    return true;
+}
+
+inline bool read_app_declaration(std::string_view text, core::AppDeclaration& app) {
+    Reader r(text);
+    ManifestFields top;
+    std::optional<ManifestFields> nested;  // "app": {...}, which replaces the top level
+    bool ok = r.object([&](std::string_view key) {
+        if (key != "app") {
+            read_manifest_member(r, top, key);
+        } else if (r.peek() == '{') {
+            nested.emplace();
+            r.object([&](std::string_view k) { read_manifest_member(r, *nested, k); });
+        } else {
+            nested.reset();
+            r.skip();
+        }
+    });
+    if (!ok || !r.at_end()) {
+        return false;
+    }
+    return resolve_manifest(nested ? *nested : top, app);
+}
+
+inline bool read_host_environment(std::string_view text, core::HostEnvironment& host_env) {
+    Reader r(text);
+    bool ok = r.object([&](std::string_view key) {
+        if (key == "environment") {
+            read_env_map(r, host_env.vars);
+        } else if (key == "paths") {
+            host_env.paths = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "library_prepend") read_string_array(r, host_env.paths.library_prepend);
+                else if (k == "library_append") read_string_array(r, host_env.paths.library_append);
+                else r.skip();
+            });
+        } else if (key == "overrides") {
+            host_env.overrides = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "allow_env_overrides") read_bool(r, host_env.overrides.allow_env_overrides, true);
+                else if (k == "allowed_env_keys") read_string_array(r, host_env.overrides.allowed_env_keys);
+                else r.skip();
+            });
+        } else {
+            r.skip();
+        }
+    });
+    return ok && r.at_end();
+}
+
+inline bool read_install_record(std::string_view text, core::InstallRecord& ir) {
+    Reader r(text);
+    bool ok = r.object([&](std::string_view key) {
+        if (key == "install") {
+            ir.install = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "instance_id") read_string(r, ir.install.instance_id);
+                else r.skip();
+            });
+        } else if (key == "app") {
+            ir.app = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "id") read_string(r, ir.app.id);
+                else if (k == "version") read_string(r, ir.app.version);
+                else if (k == "nak_id") read_string(r, ir.app.nak_id);
+                else if (k == "nak_version_req") read_string(r, ir.app.nak_version_req);
+                else r.skip();
+            });
+        } else if (key == "nak") {
+            ir.nak = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "id") read_string(r, ir.nak.id);
+                else if (k == "version") read_string(r, ir.nak.version);
+                else if (k == "record_ref") read_string(r, ir.nak.record_ref);
+                else if (k == "loader") read_string(r, ir.nak.loader);
+                else if (k == "selection_reason") read_string(r, ir.nak.selection_reason);
+                else r.skip();
+            });
+        } else if (key == "paths") {
+            ir.paths = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "install_root") read_string(r, ir.paths.install_root);
+                else r.skip();
+            });
+        } else if (key == "provenance") {
+            ir.provenance = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "package_hash") read_string(r, ir.provenance.package_hash);
+                else if (k == "installed_at") read_string(r, ir.provenance.installed_at);
+                else if (k == "installed_by") read_string(r, ir.provenance.installed_by);
+                else if (k == "source") read_string(r, ir.provenance.source);
+                else r.skip();
+            });
+        } else if (key == "verification") {
+            ir.verification = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "last_verified_at") read_string(r, ir.verification.last_verified_at);
+                else if (k == "last_verifier_version") read_string(r, ir.verification.last_verifier_version);
+                else r.skip();
+            });
+        } else if (key == "trust") {
+            read_trust_info(r, ir.trust);
+        } else if (key == "overrides") {
+            ir.overrides = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "environment") {
+                    read_env_map(r, ir.overrides.environment);
+                } else if (k == "arguments") {
+                    ir.overrides.arguments = {};
+                    read_object(r, [&](std::string_view a) {
+                        if (a == "prepend") read_string_array(r, ir.overrides.arguments.prepend);
+                        else if (a == "append") read_string_array(r, ir.overrides.arguments.append);
+                        else r.skip();
+                    });
+                } else if (k == "paths") {
+                    ir.overrides.paths = {};
+                    read_object(r, [&](std::string_view p) {
+                        if (p == "library_prepend") read_string_array(r, ir.overrides.paths.library_prepend);
+                        else r.skip();
+                    });
+                } else {
+                    r.skip();
+                }
+            });
+        } else {
+            r.skip();
+        }
+    });
+    return ok && r.at_end() && !ir.install.instance_id.empty() && !ir.paths.install_root.empty();
+}
+
+inline bool read_runtime_descriptor(std::string_view text, core::RuntimeDescriptor& rd) {
+    Reader r(text);
+    bool ok = r.object([&](std::string_view key) {
+        if (key == "nak") {
+            rd.nak = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "id") read_string(r, rd.nak.id);
+                else if (k == "version") read_string(r, rd.nak.version);
+                else r.skip();
+            });
+        } else if (key == "paths") {
+            rd.paths = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "root") read_string(r, rd.paths.root);
+                else if (k == "resource_root") read_string(r, rd.paths.resource_root);
+                else if (k == "lib_dirs") read_string_array(r, rd.paths.lib_dirs);
+                else r.skip();
+            });
+        } else if (key == "environment") {
+            read_env_map(r, rd.environment);
+        } else if (key == "loaders") {
+            rd.loaders.clear();
+            read_object(r, [&](std::string_view name) { read_loader_config(r, rd.loaders[std::string(name)]); });
+        } else if (key == "execution") {
+            rd.execution = {};
+            rd.execution.present = read_object(r, [&](std::string_view k) {
+                if (k == "cwd") read_string(r, rd.execution.cwd);
+                else r.skip();
+            });
+        } else if (key == "provenance") {
+            rd.provenance = {};
+            read_object(r, [&](std::string_view k) {
+                if (k == "package_hash") read_string(r, rd.provenance.package_hash);
+                else if (k == "installed_at") read_string(r, rd.provenance.installed_at);
+                else if (k == "installed_by") read_string(r, rd.provenance.installed_by);
+                else if (k == "source") read_string(r, rd.provenance.source);
+                else r.skip();
+            });
+        } else {
+            r.skip();
+        }
+    });
+    if (!ok || !r.at_end() || rd.nak.id.empty() || rd.nak.version.empty() || rd.paths.root.empty()) {
+        return false;
+    }
+    if (rd.paths.resource_root.empty()) {
+        rd.paths.resource_root = rd.paths.root;
+    }
+    return true;
+}
+
+} // namespace detail
+
+// The public parsers take a view so callers can hand over a mapped file
+// (nah::fs::read_file_view) without copying it. The DOM fallback copies the
+// text only when the streaming pass rejects it.
+
+/**
+ * Parse an app manifest (nap.json).
+ */
+inline ParseResult<core::AppDeclaration> parse_app_declaration(std::string_view json_str) {
+    ParseResult<core::AppDeclaration> result;
+    if (!detail::read_app_declaration(json_str, result.value)) {
+        return parse_app_declaration_dom(std::string(json_str));
+    }
+    result.ok = true;
+    return result;
+}
+
+/**
+ * Parse host.json.
+ */
+inline ParseResult<core::HostEnvironment> parse_host_environment(std::string_view json_str,
+                                                                  const std::string& source_path = "") {
+    ParseResult<core::HostEnvironment> result;
+    if (!detail::read_host_environment(json_str, result.value)) {
+        return parse_host_environment_dom(std::string(json_str), source_path);
+    }
+    result.value.source_path = source_path;
+    result.ok = true;
+    return result;
+}
+
+// Exact match for strings, which would otherwise be ambiguous with the json overload
+inline ParseResult<core::HostEnvironment> parse_host_environment(const std::string& json_str,
+                                                                  const std::string& source_path = "") {
+    return parse_host_environment(std::string_view(json_str), source_path);
+}
+
+/**
+ * Parse an app install record (registry/apps/<id>@<version>.json).
+ */
+inline ParseResult<core::InstallRecord> parse_install_record(std::string_view json_str,
+                                                              const std::string& source_path = "") {
+    ParseResult<core::InstallRecord> result;
+    if (!detail::read_install_record(json_str, result.value)) {
+        return parse_install_record_dom(std::string(json_str), source_path);
+    }
+    result.value.source_path = source_path;
+    result.ok = true;
+    return result;
+}
+
+/**
+ * Parse a NAK install record (registry/naks/<id>@<version>.json).
+ */
+inline ParseResult<core::RuntimeDescriptor> parse_runtime_descriptor(std::string_view json_str,
+                                                                      const std::string& source_path = "") {
+    ParseResult<core::RuntimeDescriptor> result;
+    if (!detail::read_runtime_descriptor(json_str, result.value)) {
+        return parse_runtime_descriptor_dom(std::string(json_str), source_path);
+    }
+    result.value.source_path = source_path;
+    result.ok = true;
+    return result;
+}
+
 // ============================================================================
 // LAUNCH CONTRACT SERIALIZATION (already in nah_core.h, re-export here)
 // ============================================================================
@@ -570,72 +1609,140 @@ using core::serialize_result;
 // LAUNCH CONTRACT PARSING (for cached contracts)
 // ============================================================================
 
-inline ParseResult<core::LaunchContract> parse_launch_contract(const std::string& json_str) {
-    ParseResult<core::LaunchContract> result;
+namespace detail {
+
+inline core::LaunchContract launch_contract_from_json(const json& j) {
+    core::LaunchContract c;
     
-    try {
-        json j = json::parse(json_str);
-        auto& c = result.value;
-        
-        // App section
-        if (j.contains("app") && j["app"].is_object()) {
-            c.app.id = detail::get_string(j["app"], "id");
-            c.app.version = detail::get_string(j["app"], "version");
-            c.app.root = detail::get_string(j["app"], "root");
-            c.app.entrypoint = detail::get_string(j["app"], "entrypoint");
-        }
-        
-        // NAK section
-        if (j.contains("nak") && j["nak"].is_object()) {
-            c.nak.id = detail::get_string(j["nak"], "id");
-            c.nak.version = detail::get_string(j["nak"], "version");
-            c.nak.root = detail::get_string(j["nak"], "root");
-            c.nak.resource_root = detail::get_string(j["nak"], "resource_root");
-            c.nak.record_ref = detail::get_string(j["nak"], "record_ref");
+    // App section
+    if (j.contains("app") && j["app"].is_object()) {
+        c.app.id = get_string(j["app"], "id");
+        c.app.version = get_string(j["app"], "version");
+        c.app.root = get_string(j["app"], "root");
+        c.app.entrypoint = get_string(j["app"], "entrypoint");
+    }
+    
+    // NAK section
+    if (j.contains("nak") && j["nak"].is_object()) {
+        c.nak.id = get_string(j["nak"], "id");
+        c.nak.version = get_string(j["nak"], "version");
+        c.nak.root = get_string(j["nak"], "root");
+        c.nak.resource_root = get_string(j["nak"], "resource_root");
+        c.nak.record_ref = get_string(j["nak"], "record_ref");
+    }
+    
+    // Execution section
+    if (j.contains("execution") && j["execution"].is_object()) {
+        c.execution.binary = get_string(j["execution"], "binary");
+        c.execution.arguments = get_string_array(j["execution"], "arguments");
+        c.execution.cwd = get_string(j["execution"], "cwd");
+        c.execution.library_path_env_key = get_string(j["execution"], "library_path_env_key");
+        c.execution.library_paths = get_string_array(j["execution"], "library_paths");
+    }
+    
+    // Environment section
+    if (j.contains("environment") && j["environment"].is_object()) {
+        for (auto& [key, val] : j["environment"].items()) {
+            if (val.is_string()) {
+                c.environment[key] = val.get<std::string>();
+            }
         }
-        
-        // Execution section
-        if (j.contains("execution") && j["execution"].is_object()) {
-            c.execution.binary = detail::get_string(j["execution"], "binary");
-            c.execution.arguments = detail::get_string_array(j["execution"], "arguments");
-            c.execution.cwd = detail::get_string(j["execution"], "cwd");
-            c.execution.library_path_env_key = detail::get_string(j["execution"], "library_path_env_key");
-            c.execution.library_paths = detail::get_string_array(j["execution"], "library_paths");
+    }
+    
+    // Enforcement section
+    if (j.contains("enforcement") && j["enforcement"].is_object()) {
+        c.enforcement.filesystem = get_string_array(j["enforcement"], "filesystem");
+        c.enforcement.network = get_string_array(j["enforcement"], "network");
+    }
+    
+    // Trust section
+    if (j.contains("trust") && j["trust"].is_object()) {
+        c.trust = parse_trust_info(j["trust"]);
+    }
+    
+    // Exports section
+    if (j.contains("exports") && j["exports"].is_object()) {
+        for (auto& [key, val] : j["exports"].items()) {
+            if (val.is_object()) {
+                c.exports[key] = {get_string(val, "id", key),
+                                  get_string(val, "path"),
+                                  get_string(val, "type")};
+            }
         }
-        
-        // Environment section
-        if (j.contains("environment") && j["environment"].is_object()) {
-            for (auto& [key, val] : j["environment"].items()) {
-                if (val.is_string()) {
-                    c.environment[key] = val.get<std::string>();
+    }
+    
+    // Capability usage section
+    if (j.contains("capability_usage") && j["capability_usage"].is_object()) {
+        c.capability_usage.present = get_bool(j["capability_usage"], "present");
+        c.capability_usage.required_capabilities = 
+            get_string_array(j["capability_usage"], "required_capabilities");
+        c.capability_usage.optional_capabilities = 
+            get_string_array(j["capability_usage"], "optional_capabilities");
+        c.capability_usage.critical_capabilities = 
+            get_string_array(j["capability_usage"], "critical_capabilities");
+    }
+    
+    return c;
+}
+
+inline core::CompositionResult composition_result_from_json(const json& j) {
+    core::CompositionResult r;
+    r.ok = get_bool(j, "ok");
+    
+    if (j.contains("critical_error") && j["critical_error"].is_string()) {
+        r.critical_error = core::parse_critical_error(j["critical_error"].get<std::string>());
+        r.critical_error_context = get_string(j, "critical_error_context");
+    }
+    
+    if (j.contains("warnings") && j["warnings"].is_array()) {
+        for (const auto& w : j["warnings"]) {
+            if (!w.is_object()) continue;
+            core::WarningObject warning;
+            warning.key = get_string(w, "key");
+            warning.action = get_string(w, "action");
+            if (w.contains("fields") && w["fields"].is_object()) {
+                for (auto& [key, val] : w["fields"].items()) {
+                    if (val.is_string()) {
+                        warning.fields[key] = val.get<std::string>();
+                    }
                 }
             }
+            r.warnings.push_back(std::move(warning));
         }
-        
-        // Enforcement section
-        if (j.contains("enforcement") && j["enforcement"].is_object()) {
-            c.enforcement.filesystem = detail::get_string_array(j["enforcement"], "filesystem");
-            c.enforcement.network = detail::get_string_array(j["enforcement"], "network");
-        }
-        
-        // Trust section
-        if (j.contains("trust") && j["trust"].is_object()) {
-            c.trust = parse_trust_info(j["trust"]);
-        }
-        
-        // Capability usage section
-        if (j.contains("capability_usage") && j["capability_usage"].is_object()) {
-            c.capability_usage.present = detail::get_bool(j["capability_usage"], "present");
-            c.capability_usage.required_capabilities = 
-                detail::get_string_array(j["capability_usage"], "required_capabilities");
-            c.capability_usage.optional_capabilities = 
-                detail::get_string_array(j["capability_usage"], "optional_capabilities");
-            c.capability_usage.critical_capabilities = 
-                detail::get_string_array(j["capability_usage"], "critical_capabilities");
-        }
-        
+    }
+    
+    if (j.contains("contract") && j["contract"].is_object()) {
+        r.contract = launch_contract_from_json(j["contract"]);
+    }
+    
+    return r;
+}
+
+} // namespace detail
+
+inline ParseResult<core::LaunchContract> parse_launch_contract(const std::string& json_str) {
+    ParseResult<core::LaunchContract> result;
+    
+    try {
+        result.value = detail::launch_contract_from_json(json::parse(json_str));
+        result.ok = true;
+    } catch (const json::exception& e) {
+        result.error = std::string("JSON parse error: ") + e.what();
+    }
+    
+    return result;
+}
+
+/**
+ * Parse the output of core::serialize_result() back into a CompositionResult.
+ * The trace, if any, is not part of the serialized form and is not restored.
+ */
+inline ParseResult<core::CompositionResult> parse_composition_result(const std::string& json_str) {
+    ParseResult<core::CompositionResult> result;
+    
+    try {
+        result.value = detail::composition_result_from_json(json::parse(json_str));
         result.ok = true;
-        
     } catch (const json::exception& e) {
         result.error = std::string("JSON parse error: ") + e.what();
     }
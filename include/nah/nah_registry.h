@@ -0,0 +1,792 @@
+/*
+ * NAH Registry - Persistent Registry Index
+ *
+ * registry/apps and registry/naks hold one JSON record per installed app or
+ * NAK. Answering "which versions of X are installed?" from those directories
+ * means reading and parsing every record. This file maintains a compact
+ * binary summary of both directories in registry/index.bin, so lookups take
+ * one file read and no JSON parsing.
+ *
+ * The index is a cache, never the source of truth. It stores the mtime of
+ * both registry directories, and load_index() rejects it as soon as either
+ * directory has changed. Callers then fall back to scan_registry(), which
+ * reads the records directly. `nah install` and `nah uninstall` keep the
+ * index current with update_index(), under an IndexLock so concurrent
+ * commands cannot overwrite each other's changes.
+ *
+ * The same directory also holds registry/contracts/, a cache of composed
+ * launch contracts keyed by the files each composition read (see
+ * contract_cache_key()).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NAH_REGISTRY_H
+#define NAH_REGISTRY_H
+
+#ifdef __cplusplus
+
+#include "nah_core.h"
+#include "nah_binary.h"
+#include "nah_json.h"
+#include "nah_fs.h"
+#include "nah_semver.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nah {
+namespace registry {
+
+// ============================================================================
+// INDEX TYPES
+// ============================================================================
+
+enum class EntryKind : std::uint8_t {
+    App = 0,
+    Nak = 1,
+};
+
+/**
+ * Summary of one registry record.
+ */
+struct IndexEntry {
+    EntryKind kind = EntryKind::App;
+    std::string id;
+    std::string version;
+    std::string record_file;    ///< Record filename in registry/apps or registry/naks
+    std::string install_root;   ///< App install_root or NAK paths.root, as stored in the record
+    std::string instance_id;    ///< Install instance id (apps only)
+    std::string nak_id;         ///< NAK id the app declares (apps only)
+
+    struct {
+        std::string id;
+        std::string version;
+        std::string record_ref;
+        std::string loader;
+    } nak_pin;                  ///< NAK pinned by the install record (apps only)
+
+    std::vector<std::string> lib_dirs;  ///< NAK library dirs (naks only)
+    std::string package_hash;   ///< provenance.package_hash, "sha256:<hex>" or empty
+};
+
+/**
+ * In-memory form of registry/index.bin.
+ *
+ * Both entry lists are kept sorted by id, then by version (highest first),
+ * so the first match for an id is its latest version.
+ */
+struct RegistryIndex {
+    std::optional<std::int64_t> apps_mtime;  ///< registry/apps mtime when indexed
+    std::optional<std::int64_t> naks_mtime;  ///< registry/naks mtime when indexed
+    std::vector<IndexEntry> apps;
+    std::vector<IndexEntry> naks;
+
+    /**
+     * Find an app by id; empty version selects the latest.
+     */
+    const IndexEntry* find_app(const std::string& id, const std::string& version = "") const {
+        return find(apps, id, version);
+    }
+
+    /**
+     * Find a NAK by id; empty version selects the latest.
+     */
+    const IndexEntry* find_nak(const std::string& id, const std::string& version = "") const {
+        return find(naks, id, version);
+    }
+
+    /**
+     * Insert an entry, replacing any entry with the same kind, id and version.
+     */
+    void upsert(IndexEntry entry) {
+        auto& list = entries(entry.kind);
+        remove(entry.kind, entry.id, entry.version);
+        auto pos = std::lower_bound(list.begin(), list.end(), entry, entry_less);
+        list.insert(pos, std::move(entry));
+    }
+
+    /**
+     * Remove the entry with the given kind, id and version.
+     * @return true if an entry was removed
+     */
+    bool remove(EntryKind kind, const std::string& id, const std::string& version) {
+        auto& list = entries(kind);
+        auto it = std::find_if(list.begin(), list.end(), [&](const IndexEntry& e) {
+            return e.id == id && e.version == version;
+        });
+        if (it == list.end()) {
+            return false;
+        }
+        list.erase(it);
+        return true;
+    }
+
+    /**
+     * Restore sort order after entries were appended directly.
+     */
+    void sort() {
+        std::sort(apps.begin(), apps.end(), entry_less);
+        std::sort(naks.begin(), naks.end(), entry_less);
+    }
+
+    std::vector<IndexEntry>& entries(EntryKind kind) {
+        return kind == EntryKind::App ? apps : naks;
+    }
+
+private:
+    static bool entry_less(const IndexEntry& a, const IndexEntry& b) {
+        if (a.id != b.id) {
+            return a.id < b.id;
+        }
+        if (a.version != b.version) {
+            return nah::semver::version_greater(a.version, b.version);
+        }
+        return a.record_file < b.record_file;
+    }
+
+    static const IndexEntry* find(const std::vector<IndexEntry>& list,
+                                  const std::string& id,
+                                  const std::string& version) {
+        auto it = std::lower_bound(list.begin(), list.end(), id,
+            [](const IndexEntry& e, const std::string& key) { return e.id < key; });
+        for (; it != list.end() && it->id == id; ++it) {
+            if (version.empty() || it->version == version) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// ============================================================================
+// PATHS
+// ============================================================================
+
+inline std::string apps_dir(const std::string& nah_root) {
+    return nah_root + "/registry/apps";
+}
+
+inline std::string naks_dir(const std::string& nah_root) {
+    return nah_root + "/registry/naks";
+}
+
+inline std::string index_path(const std::string& nah_root) {
+    return nah_root + "/registry/index.bin";
+}
+
+inline std::string index_lock_path(const std::string& nah_root) {
+    return nah_root + "/registry/locks/index.lock";
+}
+
+inline std::string contracts_dir(const std::string& nah_root) {
+    return nah_root + "/registry/contracts";
+}
+
+inline std::string contract_cache_path(const std::string& nah_root,
+                                       const std::string& id,
+                                       const std::string& version) {
+    return contracts_dir(nah_root) + "/" + id + "@" + version + ".bin";
+}
+
+// ============================================================================
+// ENTRY CONSTRUCTION
+// ============================================================================
+
+inline IndexEntry entry_from_install_record(const core::InstallRecord& record,
+                                            const std::string& record_file) {
+    IndexEntry entry;
+    entry.kind = EntryKind::App;
+    entry.id = record.app.id;
+    entry.version = record.app.version;
+    entry.record_file = record_file;
+    entry.install_root = record.paths.install_root;
+    entry.instance_id = record.install.instance_id;
+    entry.nak_id = record.app.nak_id;
+    entry.nak_pin.id = record.nak.id;
+    entry.nak_pin.version = record.nak.version;
+    entry.nak_pin.record_ref = record.nak.record_ref;
+    entry.nak_pin.loader = record.nak.loader;
+    entry.package_hash = record.provenance.package_hash;
+    return entry;
+}
+
+inline IndexEntry entry_from_runtime(const core::RuntimeDescriptor& runtime,
+                                     const std::string& record_file) {
+    IndexEntry entry;
+    entry.kind = EntryKind::Nak;
+    entry.id = runtime.nak.id;
+    entry.version = runtime.nak.version;
+    entry.record_file = record_file;
+    entry.install_root = runtime.paths.root;
+    entry.lib_dirs = runtime.paths.lib_dirs;
+    entry.package_hash = runtime.provenance.package_hash;
+    return entry;
+}
+
+/**
+ * Entry for a NAK record that does not parse as a runtime descriptor, such
+ * as the flat {"id", "version"} records written by older tools. These are
+ * still listed and can be uninstalled, as before the index existed; a
+ * missing id or version reads "unknown". Returns nullopt if the record is
+ * not a JSON object.
+ */
+inline std::optional<IndexEntry> entry_from_legacy_nak(std::string_view json,
+                                                       const std::string& record_file) {
+    auto j = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+    if (!j.is_object()) {
+        return std::nullopt;
+    }
+    const auto& identity = j.contains("nak") && j["nak"].is_object() ? j["nak"] : j;
+    auto text = [](const nlohmann::json& obj, const char* key) {
+        auto it = obj.find(key);
+        return it != obj.end() && it->is_string() ? it->get<std::string>() : std::string("unknown");
+    };
+
+    IndexEntry entry;
+    entry.kind = EntryKind::Nak;
+    entry.id = text(identity, "id");
+    entry.version = text(identity, "version");
+    entry.record_file = record_file;
+    if (j.contains("paths") && j["paths"].is_object()) {
+        auto root = j["paths"].find("root");
+        if (root != j["paths"].end() && root->is_string()) {
+            entry.install_root = root->get<std::string>();
+        }
+    }
+    return entry;
+}
+
+// ============================================================================
+// BINARY FORMAT
+// ============================================================================
+//
+// All integers are little-endian. Strings are a u32 length followed by the
+// bytes. Layout:
+//
+//   "NAHIDX01"                     magic
+//   u32  format version            (INDEX_FORMAT_VERSION)
+//   u8   has_apps_mtime, i64 apps_mtime
+//   u8   has_naks_mtime, i64 naks_mtime
+//   u32  app count, u32 nak count
+//   entries (apps, then naks):
+//     u8 kind, str id, str version, str record_file, str install_root,
+//     str instance_id, str nak_id, str pin.id, str pin.version,
+//     str pin.record_ref, str pin.loader, u32 lib_dir count, str lib_dir...,
+//     str package_hash
+
+constexpr const char* INDEX_MAGIC = "NAHIDX01";
+constexpr std::uint32_t INDEX_FORMAT_VERSION = 2;
+
+namespace detail {
+
+inline void put_u8(std::string& out, std::uint8_t v) {
+    out.push_back(static_cast<char>(v));
+}
+
+inline void put_u32(std::string& out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xFFu));
+    }
+}
+
+inline void put_i64(std::string& out, std::int64_t v) {
+    auto u = static_cast<std::uint64_t>(v);
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((u >> (8 * i)) & 0xFFu));
+    }
+}
+
+inline void put_str(std::string& out, const std::string& s) {
+    put_u32(out, static_cast<std::uint32_t>(s.size()));
+    out.append(s);
+}
+
+inline void put_mtime(std::string& out, const std::optional<std::int64_t>& mtime) {
+    put_u8(out, mtime ? 1 : 0);
+    put_i64(out, mtime.value_or(0));
+}
+
+// Bounds-checked cursor over an encoded index. Any short read clears ok.
+struct Reader {
+    const char* pos;
+    const char* end;
+    bool ok = true;
+
+    bool take(size_t n) {
+        if (!ok || static_cast<size_t>(end - pos) < n) {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    std::uint8_t u8() {
+        if (!take(1)) return 0;
+        return static_cast<std::uint8_t>(*pos++);
+    }
+
+    std::uint32_t u32() {
+        if (!take(4)) return 0;
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) {
+            v |= static_cast<std::uint32_t>(static_cast<unsigned char>(*pos++)) << (8 * i);
+        }
+        return v;
+    }
+
+    std::int64_t i64() {
+        if (!take(8)) return 0;
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) {
+            v |= static_cast<std::uint64_t>(static_cast<unsigned char>(*pos++)) << (8 * i);
+        }
+        return static_cast<std::int64_t>(v);
+    }
+
+    std::string str() {
+        std::uint32_t n = u32();
+        if (!take(n)) return {};
+        std::string s(pos, n);
+        pos += n;
+        return s;
+    }
+
+    std::optional<std::int64_t> mtime() {
+        bool present = u8() != 0;
+        std::int64_t value = i64();
+        if (!present) return std::nullopt;
+        return value;
+    }
+};
+
+inline void put_entry(std::string& out, const IndexEntry& e) {
+    put_u8(out, static_cast<std::uint8_t>(e.kind));
+    put_str(out, e.id);
+    put_str(out, e.version);
+    put_str(out, e.record_file);
+    put_str(out, e.install_root);
+    put_str(out, e.instance_id);
+    put_str(out, e.nak_id);
+    put_str(out, e.nak_pin.id);
+    put_str(out, e.nak_pin.version);
+    put_str(out, e.nak_pin.record_ref);
+    put_str(out, e.nak_pin.loader);
+    put_u32(out, static_cast<std::uint32_t>(e.lib_dirs.size()));
+    for (const auto& dir : e.lib_dirs) {
+        put_str(out, dir);
+    }
+    put_str(out, e.package_hash);
+}
+
+inline IndexEntry read_entry(Reader& in) {
+    IndexEntry e;
+    std::uint8_t kind = in.u8();
+    if (kind > static_cast<std::uint8_t>(EntryKind::Nak)) {
+        in.ok = false;
+        return e;
+    }
+    e.kind = static_cast<EntryKind>(kind);
+    e.id = in.str();
+    e.version = in.str();
+    e.record_file = in.str();
+    e.install_root = in.str();
+    e.instance_id = in.str();
+    e.nak_id = in.str();
+    e.nak_pin.id = in.str();
+    e.nak_pin.version = in.str();
+    e.nak_pin.record_ref = in.str();
+    e.nak_pin.loader = in.str();
+    std::uint32_t lib_count = in.u32();
+    for (std::uint32_t i = 0; i < lib_count && in.ok; ++i) {
+        e.lib_dirs.push_back(in.str());
+    }
+    e.package_hash = in.str();
+    return e;
+}
+
+} // namespace detail
+
+/**
+ * Encode an index into its on-disk form.
+ */
+inline std::string encode_index(const RegistryIndex& index) {
+    std::string out(INDEX_MAGIC);
+    detail::put_u32(out, INDEX_FORMAT_VERSION);
+    detail::put_mtime(out, index.apps_mtime);
+    detail::put_mtime(out, index.naks_mtime);
+    detail::put_u32(out, static_cast<std::uint32_t>(index.apps.size()));
+    detail::put_u32(out, static_cast<std::uint32_t>(index.naks.size()));
+    for (const auto& e : index.apps) {
+        detail::put_entry(out, e);
+    }
+    for (const auto& e : index.naks) {
+        detail::put_entry(out, e);
+    }
+    return out;
+}
+
+/**
+ * Decode an index. Returns nullopt on bad magic, unknown format version or
+ * truncated/corrupt data.
+ */
+inline std::optional<RegistryIndex> decode_index(std::string_view data) {
+    std::string_view magic(INDEX_MAGIC);
+    if (data.size() < magic.size() || data.compare(0, magic.size(), magic) != 0) {
+        return std::nullopt;
+    }
+
+    detail::Reader in{data.data() + magic.size(), data.data() + data.size()};
+    if (in.u32() != INDEX_FORMAT_VERSION) {
+        return std::nullopt;
+    }
+
+    RegistryIndex index;
+    index.apps_mtime = in.mtime();
+    index.naks_mtime = in.mtime();
+    std::uint32_t app_count = in.u32();
+    std::uint32_t nak_count = in.u32();
+
+    for (std::uint32_t i = 0; i < app_count && in.ok; ++i) {
+        index.apps.push_back(detail::read_entry(in));
+    }
+    for (std::uint32_t i = 0; i < nak_count && in.ok; ++i) {
+        index.naks.push_back(detail::read_entry(in));
+    }
+
+    if (!in.ok || in.pos != in.end) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+// ============================================================================
+// LOADING AND SCANNING
+// ============================================================================
+
+/**
+ * Build an index by reading every record in registry/apps and registry/naks.
+ * Unreadable or invalid records are skipped and reported through errors.
+ */
+inline RegistryIndex scan_registry(const std::string& nah_root,
+                                   std::vector<std::string>* errors = nullptr) {
+    RegistryIndex index;
+    std::string apps = apps_dir(nah_root);
+    std::string naks = naks_dir(nah_root);
+
+    // Stamp before reading so changes made during the scan make it stale
+    index.apps_mtime = nah::fs::last_write_time(apps);
+    index.naks_mtime = nah::fs::last_write_time(naks);
+
+    // One path buffer per directory, reused for every record
+    std::string path;
+
+    if (index.apps_mtime) {
+        path = apps + "/";
+        const size_t dir_len = path.size();
+        nah::fs::for_each_entry(apps, ".json", [&](const nah::fs::DirEntry& entry) {
+            if (entry.type == nah::fs::EntryType::Directory) {
+                return;
+            }
+            path.resize(dir_len);
+            path.append(entry.name);
+            auto content = nah::fs::read_file_view(path);
+            if (!content) {
+                if (errors) errors->push_back("Failed to read: " + path);
+                return;
+            }
+            auto result = nah::json::parse_install_record(content->view());
+            if (!result.ok) {
+                if (errors) errors->push_back("Invalid install record " + path + ": " + result.error);
+                return;
+            }
+            index.apps.push_back(entry_from_install_record(result.value, std::string(entry.name)));
+        });
+    }
+
+    if (index.naks_mtime) {
+        path = naks + "/";
+        const size_t dir_len = path.size();
+        nah::fs::for_each_entry(naks, ".json", [&](const nah::fs::DirEntry& entry) {
+            if (entry.type == nah::fs::EntryType::Directory) {
+                return;
+            }
+            path.resize(dir_len);
+            path.append(entry.name);
+            auto content = nah::fs::read_file_view(path);
+            if (!content) {
+                if (errors) errors->push_back("Failed to read: " + path);
+                return;
+            }
+            auto result = nah::json::parse_runtime_descriptor(content->view(), path);
+            if (!result.ok) {
+                auto legacy = entry_from_legacy_nak(content->view(), std::string(entry.name));
+                if (!legacy) {
+                    if (errors) errors->push_back("Invalid NAK record " + path + ": " + result.error);
+                    return;
+                }
+                index.naks.push_back(std::move(*legacy));
+                return;
+            }
+            index.naks.push_back(entry_from_runtime(result.value, std::string(entry.name)));
+        });
+    }
+
+    index.sort();
+    return index;
+}
+
+/**
+ * Load registry/index.bin if it is present and still matches both registry
+ * directories. Returns nullopt if it is missing, corrupt or stale.
+ */
+inline std::optional<RegistryIndex> load_index(const std::string& nah_root) {
+    auto apps_mtime = nah::fs::last_write_time(apps_dir(nah_root));
+    auto naks_mtime = nah::fs::last_write_time(naks_dir(nah_root));
+    if (!apps_mtime || !naks_mtime) {
+        return std::nullopt;
+    }
+
+    auto data = nah::fs::read_file_view(index_path(nah_root));
+    if (!data) {
+        return std::nullopt;
+    }
+
+    auto index = decode_index(data->view());
+    if (!index || index->apps_mtime != apps_mtime || index->naks_mtime != naks_mtime) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+/**
+ * Load the persisted index, or scan the registry if it is missing or stale.
+ * Never writes; use update_index() from code that modifies the registry.
+ */
+inline RegistryIndex load_or_scan(const std::string& nah_root,
+                                  std::vector<std::string>* errors = nullptr) {
+    auto index = load_index(nah_root);
+    if (index) {
+        return *index;
+    }
+    return scan_registry(nah_root, errors);
+}
+
+/**
+ * Write registry/index.bin atomically.
+ */
+inline bool save_index(const std::string& nah_root, const RegistryIndex& index) {
+    return nah::fs::write_file_atomic(index_path(nah_root), encode_index(index));
+}
+
+namespace detail {
+
+// Lock file path, creating registry/locks/ on first use
+inline std::string prepare_index_lock(const std::string& nah_root) {
+    nah::fs::create_directories(nah_root + "/registry/locks");
+    return index_lock_path(nah_root);
+}
+
+} // namespace detail
+
+/**
+ * Exclusive hold on the registry index for one change to the records.
+ *
+ * The constructor takes the index lock (registry/locks/index.lock), waiting
+ * for any other holder, and only then loads the index into `before`. Hold
+ * it from before the records are touched until update_index() has saved,
+ * so no other command can change the registry between the snapshot and
+ * the save.
+ */
+struct IndexLock {
+    explicit IndexLock(const std::string& root)
+        : nah_root(root), lock(detail::prepare_index_lock(root)), before(load_index(root)) {}
+
+    std::string nah_root;
+    nah::fs::FileLock lock;
+    std::optional<RegistryIndex> before;  ///< Index as of taking the lock
+};
+
+/**
+ * Bring the persisted index up to date after modifying registry records.
+ *
+ * If the index loaded by `held` was fresh, `apply` patches it (e.g. upsert
+ * or remove the changed entry) and it is restamped with the current
+ * directory mtimes. Otherwise, or if the lock could not be taken, the
+ * registry is rescanned. The result is written atomically.
+ *
+ * Example:
+ *
+ *     nah::registry::IndexLock held(root);
+ *     nah::fs::write_file_atomic(record_path, record_json);
+ *     nah::registry::update_index(held, [&](RegistryIndex& idx) {
+ *         idx.upsert(nah::registry::entry_from_install_record(record, file));
+ *     });
+ */
+inline bool update_index(IndexLock& held, const std::function<void(RegistryIndex&)>& apply) {
+    const auto& nah_root = held.nah_root;
+    RegistryIndex index;
+    if (held.before && held.lock.locked()) {
+        index = std::move(*held.before);
+        apply(index);
+        index.apps_mtime = nah::fs::last_write_time(apps_dir(nah_root));
+        index.naks_mtime = nah::fs::last_write_time(naks_dir(nah_root));
+    } else {
+        index = scan_registry(nah_root);
+    }
+    held.before.reset();
+    return save_index(nah_root, index);
+}
+
+// ============================================================================
+// CONTRACT CACHE
+// ============================================================================
+//
+// registry/contracts/<id>@<version>.bin holds the last successful
+// composition of an app, tagged with a key derived from everything the
+// composition read. A lookup whose key matches skips loading the manifest,
+// install record, host.json and NAK inventory entirely, and decoding the
+// entry (the key, then nah::binary::encode_result()) involves no parsing.
+//
+// Keys are built from the content of each input file, so an edit that
+// keeps a file's size and mtime still misses. The inputs are a few small
+// JSON files: hashing them costs a few reads and no parsing. Like the
+// registry index, the cache is disposable: a missing, corrupt or mismatched
+// entry just means composing again.
+
+/// Inputs that determine the result of composing one installed app.
+struct ContractCacheInputs {
+    std::string manifest_path;     ///< <install_root>/nap.json
+    std::string record_path;       ///< registry/apps/<id>@<version>.json
+    std::string nak_record_path;   ///< Pinned NAK record (empty if unpinned)
+    std::string host_path;         ///< host/host.json
+    std::string loader_override;   ///< CompositionOptions::loader_override
+    std::string env_override;      ///< NAH_OVERRIDE_ENVIRONMENT
+};
+
+/// Increment when the cache payload or key derivation changes.
+constexpr std::uint32_t CONTRACT_CACHE_VERSION = 3;
+
+namespace detail {
+
+// Hash one key field; each is terminated so ("ab", "c") and ("a", "bc") differ
+inline void hash_field(std::uint64_t& h, const std::string& s) {
+    h = core::detail::fnv1a(s, h);
+    h = core::detail::fnv1a(std::string_view("\xff", 1), h);
+}
+
+// Path plus a hash of the file's content, or a marker if it is unreadable
+inline std::string file_identity(const std::string& path) {
+    auto content = nah::fs::read_file_view(path);
+    if (!content) {
+        return path + ":-";
+    }
+    return path + ":" + std::to_string(content->size()) + ":" +
+           std::to_string(core::detail::fnv1a(content->view()));
+}
+
+} // namespace detail
+
+/**
+ * Compute the cache key for a composition from the content of its input
+ * files and the overrides. The NAK directory mtime is part of the key so
+ * that installing or removing a NAK invalidates apps whose runtime is
+ * resolved from the inventory rather than pinned.
+ */
+inline std::string contract_cache_key(const std::string& nah_root,
+                                      const ContractCacheInputs& inputs) {
+    std::uint64_t h = core::detail::FNV1A_OFFSET_BASIS;
+    detail::hash_field(h, std::to_string(CONTRACT_CACHE_VERSION));
+    detail::hash_field(h, nah_root);
+    detail::hash_field(h, detail::file_identity(inputs.manifest_path));
+    detail::hash_field(h, detail::file_identity(inputs.record_path));
+    detail::hash_field(h, inputs.nak_record_path.empty() ?
+        std::string() : detail::file_identity(inputs.nak_record_path));
+    detail::hash_field(h, detail::file_identity(inputs.host_path));
+    auto naks_mtime = nah::fs::last_write_time(naks_dir(nah_root));
+    detail::hash_field(h, naks_mtime ? std::to_string(*naks_mtime) : "-");
+    detail::hash_field(h, inputs.loader_override);
+    detail::hash_field(h, inputs.env_override);
+
+    static const char* digits = "0123456789abcdef";
+    std::string key(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        key[static_cast<size_t>(i)] = digits[h & 0xf];
+        h >>= 4;
+    }
+    return key;
+}
+
+/**
+ * Load a cached composition result. Returns nullopt if there is no entry,
+ * it cannot be parsed, or it was stored under a different key.
+ */
+inline std::optional<core::CompositionResult> load_cached_result(const std::string& nah_root,
+                                                                 const std::string& id,
+                                                                 const std::string& version,
+                                                                 const std::string& key) {
+    auto content = nah::fs::read_file_view(contract_cache_path(nah_root, id, version));
+    if (!content) {
+        return std::nullopt;
+    }
+
+    detail::Reader r{content->data(), content->data() + content->size()};
+    if (r.str() != key || !r.ok) {
+        return std::nullopt;
+    }
+    auto result = nah::binary::decode_result(
+        std::string_view(r.pos, static_cast<size_t>(r.end - r.pos)));
+    if (!result || !result->ok) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+/**
+ * Store a successful composition result under `key`. Failed results and
+ * traces are never cached. Writing is best effort; returns false if the
+ * entry could not be written.
+ */
+inline bool store_cached_result(const std::string& nah_root,
+                                const std::string& id,
+                                const std::string& version,
+                                const std::string& key,
+                                const core::CompositionResult& result) {
+    if (!result.ok) {
+        return false;
+    }
+    if (!nah::fs::create_directories(contracts_dir(nah_root))) {
+        return false;
+    }
+
+    std::string encoded = nah::binary::encode_result(result);
+    if (encoded.empty()) {
+        return false;
+    }
+
+    std::string content;
+    detail::put_str(content, key);
+    content += encoded;
+    return nah::fs::write_file_atomic(contract_cache_path(nah_root, id, version), content);
+}
+
+/**
+ * Drop the cached composition for an app version, if any.
+ */
+inline void remove_cached_result(const std::string& nah_root,
+                                 const std::string& id,
+                                 const std::string& version) {
+    nah::fs::remove_file(contract_cache_path(nah_root, id, version));
+}
+
+} // namespace registry
+} // namespace nah
+
+#endif // __cplusplus
+
+#endif // NAH_REGISTRY_H
@@ -25,6 +25,7 @@
 #ifdef __cplusplus
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -201,6 +202,13 @@ struct VersionRange {
  */
 inline std::optional<Version> parse_version(const std::string& str);
 
+/**
+ * Order two version strings: semver precedence when both parse, plain
+ * string comparison otherwise. Used to pick the latest installed version.
+ * @return true if `a` is the later version
+ */
+inline bool version_greater(const std::string& a, const std::string& b);
+
 /**
  * Parse a version range string
  * @param str Range string (e.g., ">=1.0.0 <2.0.0", "^1.2.0", "~1.2.3")
@@ -507,6 +515,15 @@ inline std::optional<Version> parse_version(const std::string& str) {
     return detail::parse_version_impl(str);
 }
 
+inline bool version_greater(const std::string& a, const std::string& b) {
+    auto va = parse_version(a);
+    auto vb = parse_version(b);
+    if (va && vb) {
+        return *va > *vb;
+    }
+    return a > b;
+}
+
 inline std::optional<VersionRange> parse_range(const std::string& str) {
     std::string s = detail::trim(str);
     if (s.empty()) return std::nullopt;
@@ -617,10 +634,24 @@ struct NakSelectionResult {
     std::string error;               ///< Error message if not found
 };
 
+namespace detail {
+
+// The runtime a map value refers to: the value itself, or what a pointer
+// such as RuntimeDescriptorPtr points at (nullptr if it is null)
+template<typename T>
+inline const T* runtime_of(const T& runtime) { return &runtime; }
+
+template<typename T>
+inline const T* runtime_of(const std::shared_ptr<T>& runtime) { return runtime.get(); }
+
+} // namespace detail
+
 /**
  * Select best NAK from a map of record_ref -> (id, version) pairs.
  * 
  * @tparam RuntimeMap Map type with .first=record_ref, .second having .nak.id and .nak.version
+ *                    (or pointing to something that does, as RuntimeInventory::runtimes;
+ *                    null pointers are skipped)
  */
 template<typename RuntimeMap>
 inline NakSelectionResult select_nak_from_inventory(
@@ -641,14 +672,16 @@ inline NakSelectionResult select_nak_from_inventory(
     // Find all matching versions
     std::vector<std::pair<Version, std::string>> matches; // (version, record_ref)
     
-    for (const auto& [record_ref, runtime] : runtimes) {
-        // Check if this runtime matches the NAK ID
-        if (runtime.nak.id != nak_id) {
+    for (const auto& [record_ref, entry] : runtimes) {
+        const auto* runtime = detail::runtime_of(entry);
+
+        // Check if this runtime matches the NAK ID (skipping null entries)
+        if (!runtime || runtime->nak.id != nak_id) {
             continue;
         }
         
         // Parse the runtime version
-        auto version = parse_version(runtime.nak.version);
+        auto version = parse_version(runtime->nak.version);
         if (!version) {
             continue; // Skip invalid versions
         }
@@ -656,7 +689,7 @@ inline NakSelectionResult select_nak_from_inventory(
         // Check if it satisfies the requirement
         if (satisfies(*version, *range)) {
             matches.push_back({*version, record_ref});
-            result.candidates.push_back(runtime.nak.version);
+            result.candidates.push_back(runtime->nak.version);
         }
     }
     
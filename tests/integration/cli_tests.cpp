@@ -8,6 +8,8 @@
 #include <nah/nah_host.h>
 #include <nah/nah_fs.h>
 #include <nah/nah_core.h>
+#include "sha256.hpp"
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
 #include <filesystem>
@@ -353,17 +355,24 @@ TEST_CASE("nah list")
         CHECK(combined.find("2.0.0") != std::string::npos);
     }
 
-    // TODO: Add --json flag support to list command
-    // SUBCASE("list with --json flag") {
-    //     env.createTestApp("com.test.app", "1.0.0");
-    //
-    //     auto result = execute_command("./nah list --json");
-    //     CHECK(result.exit_code == 0);
-    //     std::string combined = result.output + result.error;
-    //     CHECK(combined.find("[") != std::string::npos); // JSON array
-    //     CHECK(combined.find("com.test.app") != std::string::npos);
-    //     CHECK(combined.find("1.0.0") != std::string::npos);
-    // }
+    SUBCASE("list with --json flag")
+    {
+        env.createTestApp("com.test.app", "1.0.0");
+
+        auto result = execute_command(get_nah_executable() + " --json list");
+        CHECK(result.exit_code == 0);
+        CHECK(result.output.find("\"apps\": [") != std::string::npos);
+        CHECK(result.output.find("\"id\": \"com.test.app\"") != std::string::npos);
+        CHECK(result.output.find("\"version\": \"1.0.0\"") != std::string::npos);
+        CHECK(result.output.find("\"naks\": []") != std::string::npos);
+    }
+
+    SUBCASE("list --json with nothing installed")
+    {
+        auto result = execute_command(get_nah_executable() + " --json list");
+        CHECK(result.exit_code == 0);
+        CHECK(result.output == "{\n  \"apps\": [],\n  \"naks\": []\n}\n");
+    }
 }
 
 // Test the show command
@@ -1258,4 +1267,466 @@ TEST_CASE("app loader preference from manifest")
             CHECK(record_content->find("\"loader\": \"" + expected_loader + "\"") != std::string::npos);
         }
     }
-}
\ No newline at end of file
+}
+// Test registry/index.bin maintenance by install and uninstall
+TEST_CASE("registry index")
+{
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    auto createSourceApp = [&](const std::string& id, const std::string& version) {
+        std::string app_dir = env.root + "/src-" + id + "-" + version;
+        std::filesystem::create_directories(app_dir + "/bin");
+        std::ofstream manifest(app_dir + "/nap.json");
+        manifest << "{\"app\": {\"identity\": {\"id\": \"" << id << "\", \"version\": \"" << version
+                 << "\"}, \"execution\": {\"entrypoint\": \"bin/app\"}}}\n";
+        manifest.close();
+        std::ofstream exec_file(app_dir + "/bin/app");
+        exec_file << "#!/bin/sh\n";
+        exec_file.close();
+        return app_dir;
+    };
+
+    SUBCASE("install and uninstall keep the index fresh")
+    {
+        auto v1 = createSourceApp("com.test.indexed", "1.0.0");
+        auto v2 = createSourceApp("com.test.indexed", "2.0.0");
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + v1).exit_code == 0);
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + v2).exit_code == 0);
+
+        auto index = nah::registry::load_index(env.root);
+        REQUIRE(index.has_value());
+        REQUIRE(index->find_app("com.test.indexed") != nullptr);
+        CHECK(index->find_app("com.test.indexed")->version == "2.0.0");
+
+        auto which = execute_command(get_nah_executable() + " --root " + env.root + " --json which com.test.indexed");
+        CHECK(which.exit_code == 0);
+        CHECK(which.output.find("\"version\": \"2.0.0\"") != std::string::npos);
+
+        auto uninstall = execute_command(get_nah_executable() + " --root " + env.root + " uninstall com.test.indexed@2.0.0");
+        CHECK(uninstall.exit_code == 0);
+        CHECK(!std::filesystem::exists(env.root + "/apps/com.test.indexed-2.0.0"));
+
+        index = nah::registry::load_index(env.root);
+        REQUIRE(index.has_value());
+        REQUIRE(index->find_app("com.test.indexed") != nullptr);
+        CHECK(index->find_app("com.test.indexed")->version == "1.0.0");
+
+        auto list = execute_command(get_nah_executable() + " --root " + env.root + " list");
+        CHECK(list.output.find("com.test.indexed@1.0.0") != std::string::npos);
+        CHECK(list.output.find("com.test.indexed@2.0.0") == std::string::npos);
+    }
+
+    SUBCASE("uninstall without a version removes the latest")
+    {
+        auto v1 = createSourceApp("com.test.indexed", "1.10.0");
+        auto v2 = createSourceApp("com.test.indexed", "1.9.0");
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + v1).exit_code == 0);
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + v2).exit_code == 0);
+
+        auto uninstall = execute_command(get_nah_executable() + " --root " + env.root + " uninstall com.test.indexed");
+        CHECK(uninstall.exit_code == 0);
+        CHECK(uninstall.output.find("com.test.indexed@1.10.0") != std::string::npos);
+        CHECK(!std::filesystem::exists(env.root + "/apps/com.test.indexed-1.10.0"));
+        CHECK(std::filesystem::exists(env.root + "/apps/com.test.indexed-1.9.0"));
+    }
+
+    SUBCASE("list shows legacy NAK records")
+    {
+        std::ofstream(env.root + "/registry/naks/com.test.legacy@0.9.0.json")
+            << R"({"id": "com.test.legacy", "version": "0.9.0"})";
+
+        auto list = execute_command(get_nah_executable() + " --root " + env.root + " list --naks");
+        CHECK(list.output.find("com.test.legacy@0.9.0") != std::string::npos);
+    }
+
+    SUBCASE("records added behind the index's back are still found")
+    {
+        auto v1 = createSourceApp("com.test.indexed", "1.0.0");
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + v1).exit_code == 0);
+
+        env.createTestApp("com.test.manual", "1.0.0");
+        auto apps_dir = std::filesystem::path(env.root) / "registry" / "apps";
+        std::filesystem::last_write_time(apps_dir,
+            std::filesystem::last_write_time(apps_dir) + std::chrono::seconds(5));
+
+        auto list = execute_command(get_nah_executable() + " --root " + env.root + " list");
+        CHECK(list.output.find("com.test.manual@1.0.0") != std::string::npos);
+        CHECK(list.output.find("com.test.indexed@1.0.0") != std::string::npos);
+    }
+}
+
+TEST_CASE("launch contract cache")
+{
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    std::string app_dir = env.root + "/src-cached";
+    std::filesystem::create_directories(app_dir + "/bin");
+    std::ofstream manifest(app_dir + "/nap.json");
+    manifest << "{\"app\": {\"identity\": {\"id\": \"com.test.cached\", \"version\": \"1.0.0\"}, "
+             << "\"execution\": {\"entrypoint\": \"bin/app\"}}}\n";
+    manifest.close();
+    std::ofstream exec_file(app_dir + "/bin/app");
+    exec_file << "#!/bin/sh\necho cached-app-ran\n";
+    exec_file.close();
+    std::filesystem::permissions(app_dir + "/bin/app",
+        std::filesystem::perms::owner_all, std::filesystem::perm_options::add);
+
+    REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + app_dir).exit_code == 0);
+    std::string cache_path = env.root + "/registry/contracts/com.test.cached@1.0.0.bin";
+
+#ifndef _WIN32
+    SUBCASE("run populates and reuses the cache")
+    {
+        auto first = execute_command(get_nah_executable() + " --root " + env.root + " run com.test.cached");
+        CHECK(first.exit_code == 0);
+        CHECK(first.output.find("cached-app-ran") != std::string::npos);
+        CHECK(std::filesystem::exists(cache_path));
+
+        auto second = execute_command(get_nah_executable() + " --root " + env.root + " run com.test.cached");
+        CHECK(second.exit_code == 0);
+        CHECK(second.output.find("cached-app-ran") != std::string::npos);
+
+        auto fresh = execute_command(get_nah_executable() + " --root " + env.root + " run --no-cache com.test.cached");
+        CHECK(fresh.exit_code == 0);
+        CHECK(fresh.output.find("cached-app-ran") != std::string::npos);
+    }
+
+    SUBCASE("uninstall drops the cache entry")
+    {
+        execute_command(get_nah_executable() + " --root " + env.root + " run com.test.cached");
+        REQUIRE(std::filesystem::exists(cache_path));
+
+        CHECK(execute_command(get_nah_executable() + " --root " + env.root + " uninstall com.test.cached").exit_code == 0);
+        CHECK(!std::filesystem::exists(cache_path));
+    }
+#endif
+
+    SUBCASE("--no-cache leaves the cache untouched")
+    {
+        execute_command(get_nah_executable() + " --root " + env.root + " run --no-cache com.test.cached");
+        CHECK(!std::filesystem::exists(cache_path));
+    }
+}
+
+#ifndef _WIN32
+TEST_CASE("package install")
+{
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    std::string app_dir = env.root + "/src-packaged";
+    std::filesystem::create_directories(app_dir + "/bin");
+    std::filesystem::create_directories(app_dir + "/share/data");
+    std::ofstream manifest(app_dir + "/nap.json");
+    manifest << "{\"app\": {\"identity\": {\"id\": \"com.test.packaged\", \"version\": \"1.0.0\"}, "
+             << "\"execution\": {\"entrypoint\": \"bin/app\"}}}\n";
+    manifest.close();
+    std::ofstream exec_file(app_dir + "/bin/app");
+    exec_file << "#!/bin/sh\necho packaged-app-ran\n";
+    exec_file.close();
+    std::filesystem::permissions(app_dir + "/bin/app",
+        std::filesystem::perms::owner_all, std::filesystem::perm_options::add);
+
+    // Larger than the streaming buffers, so entries span chunks
+    std::string blob(1u << 20, '\0');
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<char>((i * 2654435761u) >> 13);
+    }
+    std::ofstream(app_dir + "/share/data/blob.bin", std::ios::binary) << blob;
+
+    std::string package = env.root + "/packaged.nap";
+    REQUIRE(execute_command(get_nah_executable() + " pack " + app_dir + " -o " + package).exit_code == 0);
+
+    SUBCASE("installs files and permissions from the package")
+    {
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install " + package);
+        CHECK(result.exit_code == 0);
+
+        std::string install_dir = env.root + "/apps/com.test.packaged-1.0.0";
+        auto installed = nah::fs::read_file(install_dir + "/share/data/blob.bin");
+        REQUIRE(installed.has_value());
+        CHECK(*installed == blob);
+
+        auto perms = std::filesystem::status(install_dir + "/bin/app").permissions();
+        CHECK((perms & std::filesystem::perms::owner_exec) != std::filesystem::perms::none);
+
+        auto run = execute_command(get_nah_executable() + " --root " + env.root + " run com.test.packaged");
+        CHECK(run.output.find("packaged-app-ran") != std::string::npos);
+    }
+
+    SUBCASE("records the package hash")
+    {
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + package).exit_code == 0);
+
+        auto bytes = nah::fs::read_file(package);
+        REQUIRE(bytes.has_value());
+        nah::cli::sha256::Sha256 hash;
+        hash.update(bytes->data(), bytes->size());
+        std::string expected = "sha256:" + nah::cli::sha256::to_hex(hash.finish());
+
+        auto record = nah::fs::read_file(env.root + "/registry/apps/com.test.packaged@1.0.0.json");
+        REQUIRE(record.has_value());
+        CHECK(record->find("\"package_hash\": \"" + expected + "\"") != std::string::npos);
+
+        auto show = execute_command(get_nah_executable() + " --root " + env.root + " show com.test.packaged");
+        CHECK(show.output.find("Package: " + expected) != std::string::npos);
+
+        auto show_json = execute_command(get_nah_executable() + " --root " + env.root + " --json show com.test.packaged");
+        auto doc = nlohmann::json::parse(show_json.output, nullptr, false);
+        REQUIRE(!doc.is_discarded());
+        CHECK(doc["ok"] == true);
+        CHECK(doc["contract"].is_object());
+        CHECK(doc["provenance"]["package_hash"] == expected);
+
+        auto host = nah::host::NahHost::create(env.root);
+        auto app = host->findApplication("com.test.packaged");
+        REQUIRE(app.has_value());
+        CHECK(app->package_hash == expected);
+    }
+
+    SUBCASE("records the absolute package path as the source")
+    {
+        // Installed by a path relative to the caller's directory
+        std::string nah = std::filesystem::absolute(get_nah_executable()).string();
+        auto result = execute_command("cd " + env.root + " && " + nah + " --root " + env.root + " install ./packaged.nap");
+        REQUIRE(result.exit_code == 0);
+
+        auto show_json = execute_command(get_nah_executable() + " --root " + env.root + " --json show com.test.packaged");
+        auto doc = nlohmann::json::parse(show_json.output, nullptr, false);
+        REQUIRE(!doc.is_discarded());
+        auto expected = std::filesystem::absolute(package).lexically_normal().string();
+        CHECK(doc["provenance"]["source"] == expected);
+    }
+
+    SUBCASE("package is block-gzip that gzip readers accept")
+    {
+        auto content = nah::fs::read_file(package);
+        REQUIRE(content.has_value());
+        REQUIRE(content->size() > 14);
+        CHECK(static_cast<unsigned char>((*content)[0]) == 0x1f);
+        CHECK(static_cast<unsigned char>((*content)[1]) == 0x8b);
+        CHECK((*content)[12] == 'N');
+        CHECK((*content)[13] == 'B');
+
+        std::string listing = env.root + "/listing.txt";
+        CHECK(std::system(("tar -tzf " + package + " > " + listing).c_str()) == 0);
+        auto names = nah::fs::read_file(listing);
+        REQUIRE(names.has_value());
+        CHECK(names->find("share/data/blob.bin") != std::string::npos);
+    }
+
+    SUBCASE("pack output is deterministic")
+    {
+        std::filesystem::last_write_time(app_dir + "/nap.json",
+            std::filesystem::file_time_type::clock::now() - std::chrono::hours(24));
+        std::string again = env.root + "/again.nap";
+        REQUIRE(execute_command(get_nah_executable() + " pack " + app_dir + " -o " + again).exit_code == 0);
+        CHECK(nah::fs::read_file(again) == nah::fs::read_file(package));
+    }
+
+    SUBCASE("pack rejects symlinks")
+    {
+        std::filesystem::create_symlink("bin/app", app_dir + "/link");
+        std::string linked = env.root + "/linked.nap";
+        auto result = execute_command(get_nah_executable() + " pack " + app_dir + " -o " + linked);
+        CHECK(result.exit_code != 0);
+        CHECK(!std::filesystem::exists(linked));
+        std::filesystem::remove(app_dir + "/link");
+    }
+
+    SUBCASE("single-stream gzip packages still install")
+    {
+        std::string plain = env.root + "/plain.nap";
+        REQUIRE(std::system(("tar -czf " + plain + " -C " + app_dir + " .").c_str()) == 0);
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install " + plain);
+        CHECK(result.exit_code == 0);
+        auto installed = nah::fs::read_file(env.root + "/apps/com.test.packaged-1.0.0/share/data/blob.bin");
+        REQUIRE(installed.has_value());
+        CHECK(*installed == blob);
+    }
+
+    SUBCASE("zstd packages install")
+    {
+        std::string zstd = env.root + "/packaged-zstd.nap";
+        REQUIRE(execute_command(get_nah_executable() + " pack " + app_dir + " -o " + zstd +
+                                " --compression=zstd:9").exit_code == 0);
+        auto content = nah::fs::read_file(zstd);
+        REQUIRE(content.has_value());
+        REQUIRE(content->size() > 4);
+        CHECK(content->compare(0, 4, "\x28\xb5\x2f\xfd") == 0);
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install " + zstd);
+        CHECK(result.exit_code == 0);
+        auto installed = nah::fs::read_file(env.root + "/apps/com.test.packaged-1.0.0/share/data/blob.bin");
+        REQUIRE(installed.has_value());
+        CHECK(*installed == blob);
+
+        std::string truncated = env.root + "/truncated-zstd.nap";
+        std::ofstream(truncated, std::ios::binary) << content->substr(0, content->size() - 8);
+        result = execute_command(get_nah_executable() + " --root " + env.root + " install --force " + truncated);
+        CHECK(result.exit_code != 0);
+        CHECK(std::filesystem::is_empty(env.root + "/staging"));
+    }
+
+    SUBCASE("pack rejects unknown compression")
+    {
+        std::string bad = env.root + "/bad.nap";
+        auto result = execute_command(get_nah_executable() + " pack " + app_dir + " -o " + bad + " --compression=lz4");
+        CHECK(result.exit_code != 0);
+        CHECK(!std::filesystem::exists(bad));
+    }
+
+    SUBCASE("reinstall replaces the tree through staging")
+    {
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + package).exit_code == 0);
+        std::string install_dir = env.root + "/apps/com.test.packaged-1.0.0";
+        std::ofstream(install_dir + "/stale.txt") << "left over";
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install --force " + package);
+        CHECK(result.exit_code == 0);
+        CHECK(std::filesystem::exists(install_dir + "/nap.json"));
+        CHECK(!std::filesystem::exists(install_dir + "/stale.txt"));
+        CHECK(std::filesystem::is_empty(env.root + "/staging"));
+    }
+
+    SUBCASE("a reinstall that fails to record keeps the previous install")
+    {
+        REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + package).exit_code == 0);
+        std::string install_dir = env.root + "/apps/com.test.packaged-1.0.0";
+        std::string digests_path = env.root + "/registry/digests/apps/com.test.packaged@1.0.0.json";
+        std::ofstream(install_dir + "/previous.txt") << "previous install";
+        std::ofstream(digests_path) << "{\"algorithm\": \"sha256\", \"files\": {}}";
+
+        // A directory where the install record goes makes writing it fail
+        std::string record_path = env.root + "/registry/apps/com.test.packaged@1.0.0.json";
+        std::filesystem::remove(record_path);
+        std::filesystem::create_directories(record_path + "/blocker");
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install --force " + package);
+        CHECK(result.exit_code != 0);
+        CHECK(std::filesystem::exists(install_dir + "/previous.txt"));
+        CHECK(nah::fs::read_file(digests_path) == std::optional<std::string>("{\"algorithm\": \"sha256\", \"files\": {}}"));
+        CHECK(std::filesystem::is_empty(env.root + "/staging"));
+    }
+
+    SUBCASE("truncated package is rejected")
+    {
+        auto content = nah::fs::read_file(package);
+        REQUIRE(content.has_value());
+        std::string truncated = env.root + "/truncated.nap";
+        std::ofstream(truncated, std::ios::binary) << content->substr(0, content->size() / 2);
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " install " + truncated);
+        CHECK(result.exit_code != 0);
+        CHECK(!std::filesystem::exists(env.root + "/registry/apps/com.test.packaged@1.0.0.json"));
+        CHECK(!std::filesystem::exists(env.root + "/apps/com.test.packaged-1.0.0"));
+        CHECK(std::filesystem::is_empty(env.root + "/staging"));
+    }
+}
+#endif
+
+TEST_CASE("verify")
+{
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    std::string app_dir = env.root + "/src-verified";
+    std::filesystem::create_directories(app_dir + "/bin");
+    std::ofstream manifest(app_dir + "/nap.json");
+    manifest << "{\"app\": {\"identity\": {\"id\": \"com.test.verified\", \"version\": \"1.0.0\"}, "
+             << "\"execution\": {\"entrypoint\": \"bin/app\"}}}\n";
+    manifest.close();
+    std::ofstream(app_dir + "/bin/app") << "#!/bin/sh\n";
+    std::ofstream(app_dir + "/bin/data") << "original\n";
+
+    std::string nak_dir = env.root + "/src-verified-sdk";
+    std::filesystem::create_directories(nak_dir + "/lib");
+    std::ofstream(nak_dir + "/nak.json")
+        << "{\"nak\": {\"identity\": {\"id\": \"com.test.verified-sdk\", \"version\": \"1.0.0\"}}}\n";
+    std::ofstream(nak_dir + "/lib/libsdk.so") << "library\n";
+
+    REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + app_dir).exit_code == 0);
+    REQUIRE(execute_command(get_nah_executable() + " --root " + env.root + " install " + nak_dir).exit_code == 0);
+
+    std::string install_dir = env.root + "/apps/com.test.verified-1.0.0";
+    std::string record_path = env.root + "/registry/apps/com.test.verified@1.0.0.json";
+
+    SUBCASE("install records a digest manifest")
+    {
+        auto digests = nah::fs::read_file(env.root + "/registry/digests/apps/com.test.verified@1.0.0.json");
+        REQUIRE(digests.has_value());
+        CHECK(digests->find("\"bin/data\"") != std::string::npos);
+        CHECK(digests->find("\"nap.json\"") != std::string::npos);
+        CHECK(std::filesystem::exists(env.root + "/registry/digests/naks/com.test.verified-sdk@1.0.0.json"));
+    }
+
+    SUBCASE("untouched installs pass and the record is stamped")
+    {
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " verify --all");
+        CHECK(result.exit_code == 0);
+        CHECK(result.output.find("OK     com.test.verified@1.0.0") != std::string::npos);
+        CHECK(result.output.find("OK     NAK com.test.verified-sdk@1.0.0") != std::string::npos);
+
+        auto record = nah::json::parse_install_record(*nah::fs::read_file(record_path));
+        REQUIRE(record.ok);
+        CHECK(!record.value.verification.last_verified_at.empty());
+        CHECK(!record.value.verification.last_verifier_version.empty());
+
+        // The index was restamped, not invalidated
+        auto index = nah::registry::load_index(env.root);
+        REQUIRE(index.has_value());
+        CHECK(index->find_app("com.test.verified") != nullptr);
+    }
+
+    SUBCASE("modified, missing and added files are reported")
+    {
+        std::ofstream(install_dir + "/bin/data") << "tampered\n";
+        std::filesystem::remove(install_dir + "/bin/app");
+        std::ofstream(install_dir + "/bin/extra") << "extra\n";
+
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " verify com.test.verified");
+        CHECK(result.exit_code != 0);
+        CHECK(result.output.find("FAILED com.test.verified@1.0.0") != std::string::npos);
+        CHECK(result.output.find("modified:   bin/data") != std::string::npos);
+        CHECK(result.output.find("missing:    bin/app") != std::string::npos);
+        CHECK(result.output.find("added:      bin/extra") != std::string::npos);
+
+        auto record = nah::json::parse_install_record(*nah::fs::read_file(record_path));
+        REQUIRE(record.ok);
+        CHECK(record.value.verification.last_verified_at.empty());
+
+        auto json = execute_command(get_nah_executable() + " --root " + env.root +
+                                    " --json verify --nak com.test.verified-sdk");
+        CHECK(json.exit_code == 0);
+        CHECK(json.output.find("\"status\": \"ok\"") != std::string::npos);
+    }
+
+    SUBCASE("installs without a digest manifest are reported, not failed")
+    {
+        std::filesystem::remove(env.root + "/registry/digests/apps/com.test.verified@1.0.0.json");
+        auto result = execute_command(get_nah_executable() + " --root " + env.root + " verify --all");
+        CHECK(result.exit_code == 0);
+        CHECK(result.output.find("NO DIGESTS com.test.verified@1.0.0") != std::string::npos);
+        CHECK(result.output.find("1 without digests") != std::string::npos);
+
+        auto json = execute_command(get_nah_executable() + " --root " + env.root + " --json verify --all");
+        CHECK(json.exit_code == 0);
+        CHECK(json.output.find("\"no_digests\": 1") != std::string::npos);
+        CHECK(json.output.find("\"failed\": 0") != std::string::npos);
+    }
+
+    SUBCASE("uninstall removes the digest manifest")
+    {
+        CHECK(execute_command(get_nah_executable() + " --root " + env.root + " uninstall com.test.verified").exit_code == 0);
+        CHECK(!std::filesystem::exists(env.root + "/registry/digests/apps/com.test.verified@1.0.0.json"));
+    }
+
+    SUBCASE("a target or --all is required")
+    {
+        CHECK(execute_command(get_nah_executable() + " --root " + env.root + " verify").exit_code != 0);
+        CHECK(execute_command(get_nah_executable() + " --root " + env.root + " verify com.test.absent").exit_code != 0);
+    }
+}
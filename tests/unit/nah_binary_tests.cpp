@@ -0,0 +1,181 @@
+/**
+ * Unit tests for nah_binary.h contract encoding
+ */
+
+#include <nah/nah_binary.h>
+#include <doctest/doctest.h>
+#include <string>
+
+using namespace nah::core;
+using namespace nah::binary;
+
+namespace {
+
+LaunchContract make_contract() {
+    LaunchContract c;
+    c.app.id = "com.example.app";
+    c.app.version = "1.2.3";
+    c.app.root = "/nah/apps/com.example.app-1.2.3";
+    c.app.entrypoint = "/nah/apps/com.example.app-1.2.3/bin/main.lua";
+    c.nak.id = "lua";
+    c.nak.version = "5.4.6";
+    c.nak.root = "/nah/naks/lua/5.4.6";
+    c.nak.resource_root = "/nah/naks/lua/5.4.6";
+    c.nak.record_ref = "lua@5.4.6.json";
+    c.execution.binary = "/nah/naks/lua/5.4.6/bin/lua";
+    c.execution.arguments = {"/nah/apps/com.example.app-1.2.3/bin/main.lua", "--verbose", ""};
+    c.execution.cwd = "/nah/apps/com.example.app-1.2.3";
+    c.execution.library_path_env_key = "LD_LIBRARY_PATH";
+    c.execution.library_paths = {"/nah/naks/lua/5.4.6/lib"};
+    c.environment.set("PATH", "/nah/naks/lua/5.4.6/bin:/usr/bin");
+    c.environment.set("NAH_APP_ID", "com.example.app");
+    c.environment.set("EMPTY", "");
+    c.enforcement.filesystem = {"read:/data"};
+    c.enforcement.network = {"connect:https://api.example.com"};
+    c.trust.state = TrustState::Verified;
+    c.trust.source = "ci";
+    c.trust.evaluated_at = "2025-01-01T00:00:00Z";
+    c.trust.details = {{"signer", "release"}, {"pipeline", "main"}};
+    c.exports["icon"] = AssetExport{"icon", "/nah/apps/com.example.app-1.2.3/icon.png", "image/png"};
+    c.exports["schema"] = AssetExport{"schema", "/nah/apps/com.example.app-1.2.3/schema.json", ""};
+    c.capability_usage.present = true;
+    c.capability_usage.required_capabilities = {"fs.read"};
+    c.capability_usage.critical_capabilities = {"net.connect"};
+    return c;
+}
+
+CompositionResult make_result() {
+    CompositionResult r;
+    r.ok = true;
+    r.contract = make_contract();
+    r.warnings.push_back({"nak_not_found", "warn", {{"nak_id", "lua"}, {"reason", "missing"}}});
+    r.policy_violations.push_back({"path_traversal", "library_path", "../lib escapes root"});
+    return r;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Binary: contract round trip matches JSON") {
+    LaunchContract original = make_contract();
+    std::string bytes = encode_contract(original);
+
+    CHECK(bytes.compare(0, 8, "NAHBIN01") == 0);
+    CHECK(bytes.size() % 4 == 0);
+
+    auto decoded = decode_contract(bytes);
+    REQUIRE(decoded.has_value());
+    CHECK(serialize_contract(*decoded) == serialize_contract(original));
+    CHECK(fingerprint(*decoded) == fingerprint(original));
+
+    // Same input, same bytes
+    CHECK(encode_contract(*decoded) == bytes);
+
+    LaunchContract empty;
+    auto decoded_empty = decode_contract(encode_contract(empty));
+    REQUIRE(decoded_empty.has_value());
+    CHECK(serialize_contract(*decoded_empty) == serialize_contract(empty));
+}
+
+TEST_CASE("Binary: result round trip matches JSON") {
+    SUBCASE("successful result") {
+        CompositionResult original = make_result();
+        auto decoded = decode_result(encode_result(original));
+        REQUIRE(decoded.has_value());
+        CHECK(serialize_result(*decoded) == serialize_result(original));
+        CHECK(fingerprint(decoded->contract) == fingerprint(original.contract));
+    }
+
+    SUBCASE("failed result") {
+        CompositionResult original;
+        original.critical_error = CriticalError::NAK_LOADER_INVALID;
+        original.critical_error_context = "no loader named 'jit'";
+        auto decoded = decode_result(encode_result(original));
+        REQUIRE(decoded.has_value());
+        CHECK(!decoded->ok);
+        CHECK(decoded->critical_error == CriticalError::NAK_LOADER_INVALID);
+        CHECK(serialize_result(*decoded) == serialize_result(original));
+    }
+}
+
+TEST_CASE("Binary: views borrow from the buffer") {
+    std::string bytes = encode_result(make_result());
+    auto view = view_result(bytes);
+    REQUIRE(view.has_value());
+
+    auto inside = [&](std::string_view s) {
+        return s.data() >= bytes.data() && s.data() + s.size() < bytes.data() + bytes.size() &&
+               s.data()[s.size()] == '\0';
+    };
+
+    CHECK(view->ok);
+    CHECK(view->contract_fingerprint == fingerprint(make_contract()));
+    CHECK(view->contract.app.id == "com.example.app");
+    CHECK(inside(view->contract.app.id));
+    CHECK(inside(view->contract.execution.binary));
+    REQUIRE(view->contract.execution.arguments.size() == 3u);
+    CHECK(inside(view->contract.execution.arguments[1]));
+
+    REQUIRE(view->contract.environment.size() == 3u);
+    CHECK(view->contract.environment[0].first == "EMPTY");
+    CHECK(view->contract.environment[2].first == "PATH");
+    CHECK(inside(view->contract.environment[2].second));
+
+    REQUIRE(view->contract.exports.size() == 2u);
+    CHECK(view->contract.exports[0].key == "icon");
+    CHECK(view->contract.trust.state == TrustState::Verified);
+    REQUIRE(view->warnings.size() == 1u);
+    CHECK(view->warnings[0].fields[0].first == "nak_id");
+    REQUIRE(view->policy_violations.size() == 1u);
+    CHECK(view->policy_violations[0].target == "library_path");
+
+    // Repeated strings are stored once
+    CHECK(view->contract.app.root.data() == view->contract.execution.cwd.data());
+    CHECK(view->contract.nak.root.data() == view->contract.nak.resource_root.data());
+}
+
+TEST_CASE("Binary: decode rejects bad data") {
+    std::string bytes = encode_contract(make_contract());
+
+    CHECK(!view_contract("").has_value());
+    CHECK(!view_contract("NAHBIN01").has_value());
+    CHECK(!view_contract(std::string(bytes.size(), '\0')).has_value());
+    CHECK(!view_contract(bytes.substr(0, bytes.size() - 1)).has_value());
+    CHECK(!view_contract(bytes + "xxxx").has_value());
+
+    // Wrong kind
+    CHECK(!view_result(bytes).has_value());
+    CHECK(!view_contract(encode_result(make_result())).has_value());
+
+    // Other format version
+    std::string other_version = bytes;
+    other_version[8] = static_cast<char>(BINARY_FORMAT_VERSION + 1);
+    CHECK(!view_contract(other_version).has_value());
+
+    // String index past the table
+    std::string bad_index = bytes;
+    std::uint32_t body = nah::binary::detail::load_u32(bytes.data() + 8 + 12);
+    nah::binary::detail::store_u32(bad_index.data() + body, 0xFFFFFFFFu);
+    CHECK(!view_contract(bad_index).has_value());
+
+    // List count larger than the body
+    std::string bad_count = bytes;
+    nah::binary::detail::store_u32(bad_count.data() + body + 10 * 4, 0x7FFFFFFFu);
+    CHECK(!view_contract(bad_count).has_value());
+
+    // Every truncation is rejected rather than read out of bounds
+    for (size_t n = 0; n < bytes.size(); n += 7) {
+        CHECK(!decode_contract(bytes.substr(0, n)).has_value());
+    }
+}
+
+TEST_CASE("Binary: oversized encodings are refused") {
+    // The same check that keeps encodings under 4 GiB, with a smaller limit
+    nah::binary::detail::Encoder e;
+    nah::binary::detail::encode_contract_body(e, make_contract());
+    std::string full = e.finish(Kind::Contract);
+    REQUIRE(!full.empty());
+
+    CHECK(e.finish(Kind::Contract, full.size()) == full);
+    CHECK(e.finish(Kind::Contract, full.size() - 1).empty());
+    CHECK(!view_contract(e.finish(Kind::Contract, full.size() - 1)).has_value());
+}
@@ -16,6 +16,8 @@
 #include "nah/nah_core.h"
 
 #include <doctest/doctest.h>
+#include <cstdio>
+#include <memory_resource>
 #include <sstream>
 
 using namespace nah::core;
@@ -235,6 +237,152 @@ TEST_CASE("PlaceholderExpansion: VectorExpansion") {
     CHECK(result[2] == "static");
 }
 
+TEST_CASE("PlaceholderExpansion: CompiledTemplateSegments") {
+    auto tmpl = compile_template("--root={ROOT}/x{}{open");
+    
+    REQUIRE(tmpl.segments.size() == 5u);
+    CHECK(tmpl.segments[0].text == "--root=");
+    CHECK_FALSE(tmpl.segments[0].placeholder);
+    CHECK(tmpl.segments[1].text == "ROOT");
+    CHECK(tmpl.segments[1].placeholder);
+    CHECK(tmpl.segments[2].text == "/x");
+    CHECK(tmpl.segments[3].text == "");
+    CHECK(tmpl.segments[3].placeholder);
+    CHECK(tmpl.segments[4].text == "{open");
+    CHECK(tmpl.placeholder_count == 2u);
+    CHECK(tmpl.literal_size == 14u);
+}
+
+TEST_CASE("PlaceholderExpansion: CompiledMatchesDirect") {
+    std::unordered_map<std::string, std::string> env;
+    env["A"] = "alpha";
+    env["B"] = "{A}";  // Expanded values are not rescanned
+    env[""] = "empty-name";
+    env["LARGE"] = std::string(MAX_EXPANDED_SIZE, 'x');
+    
+    std::string many;
+    for (size_t i = 0; i <= MAX_PLACEHOLDERS; i++) {
+        many += "{A}";
+    }
+    
+    std::vector<std::string> inputs = {
+        "", "plain", "{A}", "{A}{B}", "pre{A}mid{MISSING}post", "{}", "{A", "}{A}{",
+        "{{A}}", "{LARGE}", "{LARGE}y", many, std::string(MAX_EXPANDED_SIZE + 1, 'z')
+    };
+    
+    for (const auto& input : inputs) {
+        CAPTURE(input.substr(0, 32));
+        auto direct = expand_placeholders(input, env);
+        auto compiled = expand_template(compile_template(input), env);
+        CHECK(direct.ok == compiled.ok);
+        CHECK(direct.error == compiled.error);
+        if (direct.ok) {
+            CHECK(direct.value == compiled.value);
+        }
+    }
+    
+    CHECK(expand_placeholders("{A}{B}", env).value == "alpha{A}");
+    CHECK(expand_placeholders("{{A}}", env).value == "}");
+    CHECK(expand_placeholders("{LARGE}y", env).error == "expansion_overflow");
+}
+
+TEST_CASE("PlaceholderExpansion: LoaderArgs") {
+    std::unordered_map<std::string, std::string> env;
+    env["NAH_APP_ENTRY"] = "/app/main.lua";
+    
+    LoaderConfig loader;
+    loader.args_template = {"--entry", "{NAH_APP_ENTRY}"};
+    
+    // Without precompiled templates
+    auto plain = expand_loader_args(loader, env);
+    REQUIRE(plain.size() == 2u);
+    CHECK(plain[1] == "/app/main.lua");
+    
+    // With precompiled templates
+    loader.args_compiled = compile_templates(loader.args_template);
+    CHECK(expand_loader_args(loader, env) == plain);
+    
+    // Out of step with args_template: expanded directly
+    loader.args_template.push_back("{NAH_APP_ENTRY}.bak");
+    auto grown = expand_loader_args(loader, env);
+    REQUIRE(grown.size() == 3u);
+    CHECK(grown[2] == "/app/main.lua.bak");
+    
+    // Edited in place, same count: the edit wins over the stale compilation
+    loader.args_compiled = compile_templates(loader.args_template);
+    loader.args_template[1] = "{NAH_APP_ENTRY}.new";
+    auto edited = expand_loader_args(loader, env);
+    REQUIRE(edited.size() == 3u);
+    CHECK(edited[1] == "/app/main.lua.new");
+    CHECK(edited[2] == "/app/main.lua.bak");
+}
+
+// ============================================================================
+// FLAT ENVIRONMENT
+// ============================================================================
+
+TEST_CASE("FlatEnvironment: SortedLookupAndIteration") {
+    FlatEnvironment env;
+    env.set("PATH", "/usr/bin");
+    env.set("HOME", "/home/user");
+    env["A_FIRST"] = "1";
+    
+    REQUIRE(env.size() == 3u);
+    CHECK(env.at("PATH") == "/usr/bin");
+    CHECK(env.count("HOME") == 1u);
+    CHECK(env.count("MISSING") == 0u);
+    CHECK(env.find("MISSING") == env.end());
+    CHECK(env["MISSING"] == "");
+    CHECK(env.size() == 3u);  // Reading through [] does not insert
+    CHECK_THROWS_AS(env.at("MISSING"), std::out_of_range);
+    
+    std::vector<std::string> keys;
+    for (const auto& [key, value] : env) {
+        keys.emplace_back(key);
+    }
+    CHECK(keys == std::vector<std::string>{"A_FIRST", "HOME", "PATH"});
+}
+
+TEST_CASE("FlatEnvironment: OverwriteEraseAndCompaction") {
+    FlatEnvironment env;
+    env.set("KEY", "old");
+    env.set("KEY", "new");
+    env.set("SELF", "copy-me");
+    env.set("OTHER", env.at("SELF"));  // View into the arena
+    
+    CHECK(env.at("KEY") == "new");
+    CHECK(env.at("OTHER") == "copy-me");
+    CHECK(env.erase("KEY"));
+    CHECK_FALSE(env.erase("KEY"));
+    CHECK(env.size() == 2u);
+    
+    // Enough rewrites to trigger compaction; contents must survive it
+    std::string big(1000, 'x');
+    for (int i = 0; i < 20; i++) {
+        env.set("BIG", big + std::to_string(i));
+    }
+    CHECK(env.at("BIG") == big + "19");
+    CHECK(env.at("OTHER") == "copy-me");
+    CHECK(env.at("SELF") == "copy-me");
+}
+
+TEST_CASE("FlatEnvironment: EnvpAndConversions") {
+    std::unordered_map<std::string, std::string> map = {{"B", "2"}, {"A", "1"}, {"C", ""}};
+    FlatEnvironment env(map);
+    
+    auto envp = env.envp();
+    REQUIRE(envp.size() == 4u);
+    CHECK(std::string(envp[0]) == "A=1");
+    CHECK(std::string(envp[1]) == "B=2");
+    CHECK(std::string(envp[2]) == "C=");
+    CHECK(envp[3] == nullptr);
+    
+    CHECK(env.to_map() == map);
+    CHECK(env == FlatEnvironment{{"C", ""}, {"A", "1"}, {"B", "2"}});
+    CHECK(env != FlatEnvironment{{"A", "1"}});
+    CHECK(json::object(env) == json::object(map));
+}
+
 // ============================================================================
 // VALIDATION
 // ============================================================================
@@ -477,7 +625,7 @@ TEST_CASE("Composition: AppWithRuntime") {
     lua.loaders["default"] = loader;
     
     RuntimeInventory inventory;
-    inventory.runtimes["lua@5.4.6.json"] = lua;
+    inventory.add("lua@5.4.6.json", lua);
     
     auto result = nah_compose(app, profile, install, inventory);
     
@@ -497,6 +645,34 @@ TEST_CASE("Composition: AppWithRuntime") {
     CHECK(result.contract.execution.library_paths[0] == "/nah/nak/lua/5.4.6/lib");
 }
 
+TEST_CASE("Composition: RuntimeResolutionSharesDescriptor") {
+    AppDeclaration app;
+    app.id = "com.example.game";
+    app.nak_id = "lua";
+
+    InstallRecord install;
+    install.nak.record_ref = "lua@5.4.6.json";
+
+    RuntimeDescriptor lua;
+    lua.nak.id = "lua";
+    lua.nak.version = "5.4.6";
+
+    RuntimeInventory inventory;
+    inventory.add("lua@5.4.6.json", lua);
+    RuntimeInventory copy = inventory;
+
+    auto resolved = resolve_runtime(app, install, copy);
+    REQUIRE(resolved.resolved);
+    CHECK(resolved.runtime == inventory.runtimes.at("lua@5.4.6.json"));
+    CHECK(resolved.runtime->nak.version == "5.4.6");
+
+    // A null entry is treated as missing rather than dereferenced
+    inventory.runtimes["lua@5.4.6.json"] = nullptr;
+    auto missing = resolve_runtime(app, install, inventory);
+    CHECK(!missing.resolved);
+    REQUIRE(missing.warnings.size() == 1u);
+}
+
 // ============================================================================
 // COMPOSITION - PATH TRAVERSAL
 // ============================================================================
@@ -562,6 +738,53 @@ TEST_CASE("Composition: EnvironmentPrecedence") {
     CHECK(result.contract.environment.at("NAH_APP_ID") == "com.example.env");
 }
 
+TEST_CASE("Composition: EnvironmentPlaceholdersUseSnapshot") {
+    AppDeclaration app;
+    app.id = "com.example.env";
+    app.version = "1.0.0";
+    app.entrypoint_path = "bin/run";
+    app.env_vars = {"A=a", "B={A}-b", "C={B}-c"};
+    
+    InstallRecord install;
+    install.install.instance_id = "inst-005";
+    install.paths.install_root = "/apps/env";
+    
+    auto result = nah_compose(app, HostEnvironment{}, install, RuntimeInventory{});
+    REQUIRE(result.ok);
+    
+    // Every value expands against the unexpanded environment
+    CHECK(result.contract.environment.at("B") == "a-b");
+    CHECK(result.contract.environment.at("C") == "{A}-b-c");
+}
+
+TEST_CASE("Composition: ExpansionLimitsKeepValues") {
+    std::string many;
+    for (size_t i = 0; i <= MAX_PLACEHOLDERS; i++) {
+        many += "{A}";
+    }
+    
+    AppDeclaration app;
+    app.id = "com.example.env";
+    app.version = "1.0.0";
+    app.entrypoint_path = "bin/run";
+    app.entrypoint_args = {many};
+    app.env_vars = {"A=a", "BIG=" + std::string(MAX_EXPANDED_SIZE, 'x') + "{A}"};
+    
+    InstallRecord install;
+    install.install.instance_id = "inst-005";
+    install.paths.install_root = "/apps/env";
+    
+    auto result = nah_compose(app, HostEnvironment{}, install, RuntimeInventory{});
+    REQUIRE(result.ok);
+    
+    // Values that hit a limit are kept verbatim, without a warning
+    CHECK(result.contract.execution.arguments.back() == many);
+    CHECK(result.contract.environment.at("BIG").size() == MAX_EXPANDED_SIZE + 3);
+    for (const auto& w : result.warnings) {
+        CHECK(w.key != "invalid_configuration");
+    }
+}
+
 // ============================================================================
 // COMPOSITION - LOADER SELECTION
 // ============================================================================
@@ -597,7 +820,7 @@ TEST_CASE("Composition: LoaderAutoSelectDefault") {
     runtime.loaders["other"] = other_loader;
     
     RuntimeInventory inventory;
-    inventory.runtimes["runtime@1.0.json"] = runtime;
+    inventory.add("runtime@1.0.json", runtime);
     
     HostEnvironment profile;
     
@@ -632,7 +855,7 @@ TEST_CASE("Composition: LoaderAutoSelectSingle") {
     runtime.loaders["only"] = only_loader;
     
     RuntimeInventory inventory;
-    inventory.runtimes["runtime@1.0.json"] = runtime;
+    inventory.add("runtime@1.0.json", runtime);
     
     HostEnvironment profile;
     
@@ -671,7 +894,7 @@ TEST_CASE("Composition: LoaderMultipleNoDefault") {
     runtime.loaders["two"] = loader2;
     
     RuntimeInventory inventory;
-    inventory.runtimes["runtime@1.0.json"] = runtime;
+    inventory.add("runtime@1.0.json", runtime);
     
     HostEnvironment profile;
     
@@ -811,6 +1034,238 @@ TEST_CASE("Composition: Tracing") {
     CHECK(result.trace->decisions[0] == "Starting composition");
 }
 
+TEST_CASE("Composition: TracePolicies") {
+    AppDeclaration app;
+    app.id = "com.example.app";
+    app.version = "1.0.0";
+    app.entrypoint_path = "bin/run";
+    app.env_vars = {"APP_VAR=from_app", "PROFILE_VAR=shadowed"};
+    
+    HostEnvironment profile;
+    profile.vars["PROFILE_VAR"] = EnvValue(EnvOp::Set, "from_profile");
+    
+    InstallRecord install;
+    install.install.instance_id = "inst-011";
+    install.paths.install_root = "/apps/app";
+    
+    RuntimeInventory inventory;
+    
+    auto none = nah_compose<NoTrace>(app, profile, install, inventory);
+    auto full = nah_compose<FullTrace>(app, profile, install, inventory);
+    auto compact = nah_compose<CompactTrace>(app, profile, install, inventory);
+    
+    REQUIRE(none.ok);
+    REQUIRE(full.ok);
+    REQUIRE(compact.ok);
+    CHECK_FALSE(none.trace.has_value());
+    CHECK_FALSE(none.compact_trace.has_value());
+    CHECK_FALSE(compact.trace.has_value());
+    REQUIRE(full.trace.has_value());
+    REQUIRE(compact.compact_trace.has_value());
+    
+    // Tracing never changes the contract
+    CHECK(serialize_result(none) == serialize_result(full));
+    CHECK(serialize_result(none) == serialize_result(compact));
+    
+    // The runtime switch matches the compile-time policies
+    CompositionOptions options;
+    options.enable_trace = true;
+    CHECK(nah_compose(app, profile, install, inventory, options).trace->decisions == full.trace->decisions);
+    options.enable_trace = false;
+    options.enable_compact_trace = true;
+    CHECK(nah_compose(app, profile, install, inventory, options).compact_trace.has_value());
+    
+    // Compact decisions render to the same log as the full trace
+    const auto& codes = compact.compact_trace->decisions;
+    REQUIRE(codes.size() == full.trace->decisions.size());
+    for (size_t i = 0; i < codes.size(); i++) {
+        CHECK(full.trace->decisions[i].rfind(trace_decision_to_string(codes[i]), 0) == 0);
+    }
+    CHECK(codes.front() == TraceDecision::Started);
+    CHECK(codes.back() == TraceDecision::Completed);
+    
+    // One compact contribution per full history entry
+    size_t history = 0;
+    for (const auto& [key, entry] : full.trace->environment) {
+        history += entry.history.size();
+    }
+    CHECK(compact.compact_trace->environment.size() == history);
+    
+    bool saw_rejected_manifest = false;
+    for (const auto& c : compact.compact_trace->environment) {
+        if (c.key_hash == detail::fnv1a("PROFILE_VAR") && c.source == TraceSource::Manifest) {
+            saw_rejected_manifest = true;
+            CHECK_FALSE(c.accepted);
+            CHECK(c.precedence_rank == 3);
+        }
+    }
+    CHECK(saw_rejected_manifest);
+}
+
+namespace {
+
+// Counts what composition draws from a memory resource
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace
+
+TEST_CASE("Composition: MemoryResource") {
+    AppDeclaration app;
+    app.id = "com.example.app";
+    app.version = "1.0.0";
+    app.nak_id = "lua";
+    app.entrypoint_path = "main.lua";
+    app.entrypoint_args = {"--root={NAH_APP_ROOT}"};
+    app.env_vars = {"APP_HOME={NAH_APP_ROOT}/home"};
+    
+    HostEnvironment profile;
+    profile.vars["PATH"] = EnvValue(EnvOp::Set, "/usr/bin");
+    
+    InstallRecord install;
+    install.install.instance_id = "inst-012";
+    install.paths.install_root = "/apps/app";
+    install.nak.record_ref = "lua@5.4.6.json";
+    install.overrides.environment["PATH"] = EnvValue(EnvOp::Append, "/extra", ":");
+    install.overrides.arguments.prepend = {"-E"};
+    
+    RuntimeDescriptor lua;
+    lua.nak.id = "lua";
+    lua.nak.version = "5.4.6";
+    lua.paths.root = "/nah/naks/lua/5.4.6";
+    lua.environment["PATH"] = EnvValue(EnvOp::Prepend, "{NAH_NAK_ROOT}/bin", ":");
+    LoaderConfig loader;
+    loader.exec_path = "/nah/naks/lua/5.4.6/bin/lua";
+    loader.args_template = {"{NAH_APP_ENTRY}"};
+    lua.loaders["default"] = loader;
+    
+    RuntimeInventory inventory;
+    inventory.add("lua@5.4.6.json", lua);
+    
+    auto heap = nah_compose(app, profile, install, inventory);
+    REQUIRE(heap.ok);
+    CHECK(heap.contract.environment.at("PATH") == "/nah/naks/lua/5.4.6/bin:/usr/bin:/extra");
+    CHECK(heap.contract.environment.at("APP_HOME") == "/apps/app/home");
+    CHECK(heap.contract.execution.arguments ==
+          std::vector<std::string>{"-E", "/apps/app/main.lua", "--root=/apps/app"});
+    
+    SUBCASE("scratch state comes from the resource") {
+        CountingResource counting;
+        CompositionOptions options;
+        options.memory_resource = &counting;
+        auto result = nah_compose(app, profile, install, inventory, options);
+        REQUIRE(result.ok);
+        CHECK(counting.allocations > 0);
+        CHECK(serialize_result(result) == serialize_result(heap));
+    }
+    
+    SUBCASE("the result outlives a released monotonic buffer") {
+        CompositionOptions options;
+        options.enable_trace = true;
+        auto traced = nah_compose(app, profile, install, inventory, options);
+        
+        CompositionResult result;
+        {
+            std::pmr::monotonic_buffer_resource arena;
+            options.memory_resource = &arena;
+            result = nah_compose(app, profile, install, inventory, options);
+        }
+        REQUIRE(result.ok);
+        CHECK(serialize_result(result) == serialize_result(traced));
+        CHECK(result.trace->decisions == traced.trace->decisions);
+    }
+}
+
+// ============================================================================
+// FINGERPRINTS
+// ============================================================================
+
+TEST_CASE("Fingerprint: StableAndVersioned") {
+    // Pinned so an accidental encoding change is caught; bump
+    // FINGERPRINT_VERSION and these values together
+    CHECK(FINGERPRINT_VERSION == 1u);
+    CHECK(fingerprint(LaunchContract{}).hex() == "e97b7118a70d98c7c090a231800048cb");
+    CHECK(fingerprint(AppDeclaration{}).hex() == "bfd5f877bdbe9e4a8ef12ebe5bbb3e27");
+    
+    // Each type hashes into its own domain
+    CHECK(fingerprint(AppDeclaration{}) != fingerprint(InstallRecord{}));
+    CHECK(fingerprint(HostEnvironment{}) != fingerprint(RuntimeDescriptor{}));
+    
+    // Strings are length-prefixed
+    LaunchContract a, b;
+    a.execution.arguments = {"ab", "c"};
+    b.execution.arguments = {"a", "bc"};
+    CHECK(fingerprint(a) != fingerprint(b));
+}
+
+TEST_CASE("Fingerprint: IndependentOfMapOrder") {
+    LaunchContract a, b;
+    a.exports.reserve(4);
+    b.exports.reserve(512);
+    for (int i = 0; i < 20; i++) {
+        std::string id = "asset" + std::to_string(i);
+        a.exports[id] = {id, "/apps/x/" + id, "text/plain"};
+    }
+    for (int i = 19; i >= 0; i--) {
+        std::string id = "asset" + std::to_string(i);
+        b.exports[id] = {id, "/apps/x/" + id, "text/plain"};
+    }
+    a.environment.set("B", "2");
+    a.environment.set("A", "1");
+    b.environment.set("A", "1");
+    b.environment.set("B", "2");
+    CHECK(fingerprint(a) == fingerprint(b));
+    
+    b.exports["asset3"].type = "image/png";
+    CHECK(fingerprint(a) != fingerprint(b));
+    
+    HostEnvironment h1, h2;
+    h1.vars["X"] = EnvValue(EnvOp::Prepend, "/x");
+    h1.vars["Y"] = "y";
+    h2.vars["Y"] = "y";
+    h2.vars["X"] = EnvValue(EnvOp::Prepend, "/x");
+    CHECK(fingerprint(h1) == fingerprint(h2));
+    h2.vars["X"].separator = ";";
+    CHECK(fingerprint(h1) != fingerprint(h2));
+}
+
+TEST_CASE("Fingerprint: composed contracts") {
+    AppDeclaration app;
+    app.id = "com.example.app";
+    app.version = "1.0.0";
+    app.entrypoint_path = "bin/run";
+    app.env_vars = {"MODE=a"};
+    
+    InstallRecord install;
+    install.install.instance_id = "inst-013";
+    install.paths.install_root = "/apps/app";
+    
+    auto first = nah_compose(app, HostEnvironment{}, install, RuntimeInventory{});
+    auto second = nah_compose(app, HostEnvironment{}, install, RuntimeInventory{});
+    REQUIRE(first.ok);
+    CHECK(fingerprint(first.contract) == fingerprint(second.contract));
+    CHECK(fingerprint(first.contract).hex().size() == 32u);
+    
+    app.env_vars = {"MODE=b"};
+    auto changed = nah_compose(app, HostEnvironment{}, install, RuntimeInventory{});
+    CHECK(fingerprint(changed.contract) != fingerprint(first.contract));
+    CHECK(fingerprint(app) != fingerprint(AppDeclaration{}));
+}
+
 // ============================================================================
 // JSON SERIALIZATION
 // ============================================================================
@@ -842,6 +1297,24 @@ TEST_CASE("JsonSerialization: SerializeContract") {
     CHECK(json_str.find("\"state\": \"verified\"") != std::string::npos);
 }
 
+TEST_CASE("JsonSerialization: SerializeContractExports") {
+    LaunchContract contract;
+    contract.exports["splash"] = {"splash", "/apps/app/splash.png", "image/png"};
+    contract.exports["icon"] = {"icon", "/apps/app/icon.png", ""};
+    contract.capability_usage.optional_capabilities = {"net.connect:example.com"};
+    
+    std::string json_str = serialize_contract(contract);
+    
+    // Export ids serialize in sorted order
+    auto icon = json_str.find("\"icon\": {");
+    auto splash = json_str.find("\"splash\": {");
+    REQUIRE(icon != std::string::npos);
+    REQUIRE(splash != std::string::npos);
+    CHECK(icon < splash);
+    CHECK(json_str.find("\"path\": \"/apps/app/splash.png\"") != std::string::npos);
+    CHECK(json_str.find("\"net.connect:example.com\"") != std::string::npos);
+}
+
 TEST_CASE("JsonSerialization: SerializeResult") {
     CompositionResult result;
     result.ok = true;
@@ -875,6 +1348,53 @@ TEST_CASE("JsonSerialization: SerializeFailedResult") {
     CHECK(json_str.find("\"contract\": null") != std::string::npos);
 }
 
+TEST_CASE("JsonSerialization: Escape") {
+    CHECK(json::escape("plain/path") == "plain/path");
+    CHECK(json::escape("a\"b\\c") == "a\\\"b\\\\c");
+    CHECK(json::escape("\b\f\n\r\t") == "\\b\\f\\n\\r\\t");
+    CHECK(json::escape(std::string("\x00\x01\x1f", 3)) == "\\u0000\\u0001\\u001f");
+    CHECK(json::escape("\x7f\xc3\xa9") == "\x7f\xc3\xa9");  // DEL and UTF-8 pass through
+    CHECK(json::str("x\ny") == "\"x\\ny\"");
+}
+
+TEST_CASE("JsonSerialization: StreamingWriter") {
+    CompositionResult result;
+    result.ok = true;
+    result.contract.app.id = "com.example.app";
+    for (int i = 0; i < 2000; i++) {
+        result.contract.environment.set("VAR_" + std::to_string(i), "/opt/value\t" + std::to_string(i));
+    }
+    result.contract.trust.details = {{"b", "2"}, {"a", "1"}};
+    std::string expected = serialize_result(result);
+
+    SUBCASE("buffered output matches serialize_result") {
+        json::Writer out;
+        write_result(out, result);
+        CHECK(out.buffer() == expected);
+    }
+
+    SUBCASE("a FILE sink receives the same bytes in bounded chunks") {
+        std::FILE* f = std::tmpfile();
+        REQUIRE(f != nullptr);
+        {
+            json::Writer out(f, 256);
+            write_result(out, result);
+            CHECK(out.buffer().size() < 256 + 4096);
+            CHECK(out.flush());
+            CHECK(out.buffer().empty());
+        }
+        std::rewind(f);
+        std::string written;
+        char chunk[4096];
+        size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            written.append(chunk, n);
+        }
+        std::fclose(f);
+        CHECK(written == expected);
+    }
+}
+
 // ============================================================================
 // DETERMINISM
 // ============================================================================
@@ -912,6 +1432,81 @@ TEST_CASE("Determinism: SameInputsSameOutput") {
     CHECK(json1 == json2);
 }
 
+// ============================================================================
+// BATCH COMPOSITION
+// ============================================================================
+
+TEST_CASE("BatchComposition: MatchesSequentialInInputOrder") {
+    HostEnvironment profile;
+    profile.vars["HOST_VAR"] = EnvValue(EnvOp::Set, "host");
+
+    RuntimeDescriptor lua;
+    lua.nak.id = "lua";
+    lua.nak.version = "5.4.6";
+    lua.paths.root = "/nah/nak/lua/5.4.6";
+    LoaderConfig loader;
+    loader.exec_path = "/nah/nak/lua/5.4.6/bin/lua";
+    loader.args_template = {"{NAH_APP_ENTRY}"};
+    lua.loaders["default"] = loader;
+
+    RuntimeInventory inventory;
+    inventory.add("lua@5.4.6.json", lua);
+
+    std::vector<ComposeInput> inputs;
+    for (int i = 0; i < 64; ++i) {
+        ComposeInput input;
+        input.app.id = "com.example.batch" + std::to_string(i);
+        input.app.version = "1.0." + std::to_string(i);
+        input.app.entrypoint_path = "main.lua";
+        input.app.env_vars = {"INDEX=" + std::to_string(i)};
+        input.install.install.instance_id = "inst-batch-" + std::to_string(i);
+        input.install.paths.install_root = "/apps/batch" + std::to_string(i);
+        if (i % 2 == 0) {
+            input.app.nak_id = "lua";
+            input.install.nak.record_ref = "lua@5.4.6.json";
+        }
+        if (i == 7) {
+            input.app.entrypoint_path = "../escape";  // Fails composition
+        }
+        inputs.push_back(input);
+    }
+
+    BatchCompositionOptions opts;
+    opts.workers = 4;
+    auto results = nah_compose_batch(inputs, profile, inventory, opts);
+
+    REQUIRE(results.size() == inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        auto expected = nah_compose(inputs[i].app, profile, inputs[i].install, inventory);
+        CHECK(results[i].ok == expected.ok);
+        CHECK(serialize_result(results[i]) == serialize_result(expected));
+    }
+    CHECK_FALSE(results[7].ok);
+    CHECK(results[8].contract.app.id == "com.example.batch8");
+    CHECK(results[8].contract.execution.binary == "/nah/nak/lua/5.4.6/bin/lua");
+}
+
+TEST_CASE("BatchComposition: EmptyAndSingleWorker") {
+    HostEnvironment profile;
+    RuntimeInventory inventory;
+
+    CHECK(nah_compose_batch({}, profile, inventory).empty());
+
+    ComposeInput input;
+    input.app.id = "com.example.one";
+    input.app.version = "1.0.0";
+    input.app.entrypoint_path = "bin/run";
+    input.install.install.instance_id = "inst-one";
+    input.install.paths.install_root = "/apps/one";
+
+    BatchCompositionOptions opts;
+    opts.workers = 1;
+    auto results = nah_compose_batch({input, input}, profile, inventory, opts);
+    REQUIRE(results.size() == 2u);
+    CHECK(results[0].ok);
+    CHECK(serialize_result(results[0]) == serialize_result(results[1]));
+}
+
 // ============================================================================
 // EDGE CASES
 // ============================================================================
@@ -973,7 +1568,7 @@ TEST_CASE("EdgeCases: LibsOnlyNak") {
     // No loaders
     
     RuntimeInventory inventory;
-    inventory.runtimes["libs@1.0.json"] = libs;
+    inventory.add("libs@1.0.json", libs);
     
     auto result = nah_compose(app, profile, install, inventory);
     
@@ -1011,7 +1606,7 @@ TEST_CASE("EdgeCases: LoaderNotFound") {
     runtime.loaders["existing"] = loader;
     
     RuntimeInventory inventory;
-    inventory.runtimes["runtime@1.0.json"] = runtime;
+    inventory.add("runtime@1.0.json", runtime);
     
     HostEnvironment profile;
     
@@ -5,6 +5,7 @@
 #define NAH_FS_IMPLEMENTATION
 #include <nah/nah_fs.h>
 #include <doctest/doctest.h>
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <cstdlib>
@@ -179,6 +180,83 @@ TEST_CASE("nah::fs::read_file")
         REQUIRE(result.has_value());
         CHECK(*result == content);
     }
+
+    SUBCASE("directory is not readable")
+    {
+        CHECK(!nah::fs::read_file(temp_dir.path).has_value());
+    }
+}
+
+TEST_CASE("nah::fs::read_file_view")
+{
+    TempTestDir temp_dir;
+    REQUIRE(!temp_dir.path.empty());
+
+    SUBCASE("small file is read into a buffer")
+    {
+        std::string small_file = temp_dir.path + "/small.json";
+        std::ofstream(small_file) << "{\"a\": 1}";
+
+        auto result = nah::fs::read_file_view(small_file);
+        REQUIRE(result.has_value());
+        CHECK(!result->mapped());
+        CHECK(result->view() == "{\"a\": 1}");
+    }
+
+    SUBCASE("large file matches read_file")
+    {
+        std::string large_file = temp_dir.path + "/large.bin";
+        std::string content;
+        for (size_t i = 0; content.size() < nah::fs::MMAP_THRESHOLD * 3; ++i)
+        {
+            content += std::to_string(i);
+            content += '\0';
+        }
+        std::ofstream(large_file, std::ios::binary) << content;
+
+        auto result = nah::fs::read_file_view(large_file);
+        REQUIRE(result.has_value());
+#ifndef _WIN32
+        CHECK(result->mapped());
+#endif
+        CHECK(result->size() == content.size());
+        CHECK(result->view() == content);
+
+        // Moving keeps the mapping alive exactly once
+        nah::fs::MappedFile moved = std::move(*result);
+        CHECK(moved.view() == content);
+        CHECK(result->empty());
+    }
+
+    SUBCASE("threshold is configurable")
+    {
+        std::string file = temp_dir.path + "/tiny.txt";
+        std::ofstream(file) << "tiny";
+
+        auto result = nah::fs::read_file_view(file, 1);
+        REQUIRE(result.has_value());
+#ifndef _WIN32
+        CHECK(result->mapped());
+#endif
+        CHECK(std::string_view(*result) == "tiny");
+    }
+
+    SUBCASE("empty file")
+    {
+        std::string empty_file = temp_dir.path + "/empty.txt";
+        std::ofstream(empty_file).close();
+
+        auto result = nah::fs::read_file_view(empty_file, 0);
+        REQUIRE(result.has_value());
+        CHECK(!result->mapped());
+        CHECK(result->empty());
+    }
+
+    SUBCASE("missing file and directory")
+    {
+        CHECK(!nah::fs::read_file_view(temp_dir.path + "/non_existent.txt").has_value());
+        CHECK(!nah::fs::read_file_view(temp_dir.path).has_value());
+    }
 }
 
 TEST_CASE("nah::fs::write_file")
@@ -293,6 +371,68 @@ TEST_CASE("nah::fs::list_directory")
     }
 }
 
+TEST_CASE("nah::fs::for_each_entry")
+{
+    TempTestDir temp_dir;
+    REQUIRE(!temp_dir.path.empty());
+
+    std::ofstream(temp_dir.path + "/a.json") << "{}";
+    std::ofstream(temp_dir.path + "/b.json") << "{}";
+    std::ofstream(temp_dir.path + "/c.txt") << "text";
+    std::ofstream(temp_dir.path + "/.json") << "{}";
+    std::filesystem::create_directory(temp_dir.path + "/dir.json");
+
+    SUBCASE("empty suffix lists every entry")
+    {
+        size_t count = 0;
+        CHECK(nah::fs::for_each_entry(temp_dir.path, "", [&](const nah::fs::DirEntry &entry)
+                                      {
+                                          CHECK(entry.name != ".");
+                                          CHECK(entry.name != "..");
+                                          ++count; }));
+        CHECK(count == 5);
+    }
+
+    SUBCASE("suffix filters by name")
+    {
+        std::vector<std::string> names;
+        nah::fs::for_each_entry(temp_dir.path, ".json", [&](const nah::fs::DirEntry &entry)
+                                { names.emplace_back(entry.name); });
+        std::sort(names.begin(), names.end());
+        CHECK(names == std::vector<std::string>{"a.json", "b.json", "dir.json"});
+    }
+
+    SUBCASE("type hint distinguishes files and directories")
+    {
+        nah::fs::for_each_entry(temp_dir.path, ".json", [&](const nah::fs::DirEntry &entry)
+                                {
+            if (entry.type == nah::fs::EntryType::Unknown) {
+                return; // Filesystem gives no hint
+            }
+            if (entry.name == "dir.json") {
+                CHECK(entry.type == nah::fs::EntryType::Directory);
+            } else {
+                CHECK(entry.type == nah::fs::EntryType::File);
+            } });
+    }
+
+    SUBCASE("returning false stops the listing")
+    {
+        size_t count = 0;
+        nah::fs::for_each_entry(temp_dir.path, "", [&](const nah::fs::DirEntry &)
+                                { return ++count < 2; });
+        CHECK(count == 2);
+    }
+
+    SUBCASE("non-existent directory")
+    {
+        bool called = false;
+        CHECK_FALSE(nah::fs::for_each_entry(temp_dir.path + "/non_existent", "", [&](const nah::fs::DirEntry &)
+                                            { called = true; }));
+        CHECK_FALSE(called);
+    }
+}
+
 // Note: make_executable not in current nah_fs.h API
 
 TEST_CASE("nah::fs::current_path")
@@ -534,4 +674,53 @@ TEST_CASE("nah::fs::absolute_path")
         CHECK(result == path);
 #endif
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("nah::fs::load_inventory_from_directory")
+{
+    TempTestDir temp;
+
+    // Enough records for several workers, plus two broken ones
+    for (int i = 0; i < 40; i++)
+    {
+        std::string version = "1." + std::to_string(i) + ".0";
+        std::ofstream(temp.path + "/nak" + std::to_string(i) + "@" + version + ".json")
+            << R"({"nak": {"id": "nak)" << i << R"(", "version": ")" << version
+            << R"("}, "paths": {"root": "/naks/)" << i << R"("}, "loaders": {"default": {"exec_path": "/bin/run"}}})";
+    }
+    std::ofstream(temp.path + "/b-broken@1.0.0.json") << "{not json";
+    std::ofstream(temp.path + "/a-missing@1.0.0.json") << R"({"nak": {"id": "a"}})";
+    std::ofstream(temp.path + "/README.txt") << "not a record";
+
+    SUBCASE("same inventory and errors for any worker count")
+    {
+        std::vector<std::string> serial_errors;
+        auto serial = nah::fs::load_inventory_from_directory(temp.path, &serial_errors, 1);
+        REQUIRE(serial.runtimes.size() == 40u);
+        CHECK(serial.runtimes.at("nak7@1.7.0.json")->nak.id == "nak7");
+        CHECK(serial.runtimes.at("nak7@1.7.0.json")->source_path == temp.path + "/nak7@1.7.0.json");
+
+        // Errors in filename order
+        REQUIRE(serial_errors.size() == 2u);
+        CHECK(serial_errors[0].find("a-missing@1.0.0.json") != std::string::npos);
+        CHECK(serial_errors[0].find("nak.version") != std::string::npos);
+        CHECK(serial_errors[1].find("b-broken@1.0.0.json") != std::string::npos);
+
+        for (size_t workers : {size_t{0}, size_t{2}, size_t{8}})
+        {
+            std::vector<std::string> errors;
+            auto parallel = nah::fs::load_inventory_from_directory(temp.path, &errors, workers);
+            CHECK(nah::core::fingerprint(parallel) == nah::core::fingerprint(serial));
+            CHECK(errors == serial_errors);
+        }
+    }
+
+    SUBCASE("missing directory")
+    {
+        std::vector<std::string> errors;
+        auto inventory = nah::fs::load_inventory_from_directory(temp.path + "/nope", &errors);
+        CHECK(inventory.runtimes.empty());
+        REQUIRE(errors.size() == 1u);
+        CHECK(errors[0].find("does not exist") != std::string::npos);
+    }
+}
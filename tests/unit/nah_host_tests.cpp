@@ -5,6 +5,7 @@
 #define NAH_HOST_IMPLEMENTATION
 #include <nah/nah_host.h>
 #include <doctest/doctest.h>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -142,6 +143,9 @@ public:
         record << "  \"paths\": {\n";
         record << "    \"install_root\": \"" << json_escape_path(app_dir) << "\"\n";
         record << "  },\n";
+        record << "  \"provenance\": {\n";
+        record << "    \"package_hash\": \"sha256:" << id << "-" << version << "\"\n";
+        record << "  },\n";
         record << "  \"trust\": {\n";
         record << "    \"state\": \"unknown\"\n";
         record << "  }\n";
@@ -298,6 +302,12 @@ TEST_CASE("NahHost::findApplication") {
         CHECK(app->version == "1.0.0");
     }
 
+    SUBCASE("package hash comes from the install record") {
+        auto app = host->findApplication("com.test.app", "1.0.0");
+        REQUIRE(app.has_value());
+        CHECK(app->package_hash == "sha256:com.test.app-1.0.0");
+    }
+
     SUBCASE("find non-existent app returns nullopt") {
         auto app = host->findApplication("com.test.nonexistent");
         CHECK(!app.has_value());
@@ -410,6 +420,31 @@ TEST_CASE("NahHost::getInventory") {
         // and provide an inventory object (even if empty in tests)
         CHECK(inventory.runtimes.size() >= 0);
     }
+
+    SUBCASE("shared inventory is reused until registry/naks changes") {
+        env.installTestNak("com.test.runtime", "1.0.0");
+
+        auto host = nah::host::NahHost::create(env.root);
+        REQUIRE(host != nullptr);
+
+        auto first = host->sharedInventory();
+        REQUIRE(first->runtimes.size() == 1u);
+        CHECK(host->sharedInventory() == first);
+        CHECK(nah::core::fingerprint(host->getInventory()) == nah::core::fingerprint(*first));
+
+        env.installTestNak("com.test.runtime", "1.1.0");
+        auto naks_dir = std::filesystem::path(env.root) / "registry" / "naks";
+        std::filesystem::last_write_time(naks_dir,
+            std::filesystem::last_write_time(naks_dir) + std::chrono::seconds(5));
+
+        auto second = host->sharedInventory();
+        CHECK(second != first);
+        CHECK(second->runtimes.size() == 2u);
+        CHECK(first->runtimes.size() == 1u);  // Earlier snapshot is untouched
+
+        host->refreshIndex();
+        CHECK(host->sharedInventory() != second);
+    }
 }
 
 TEST_CASE("NahHost::getLaunchContract") {
@@ -444,6 +479,42 @@ TEST_CASE("NahHost::getLaunchContract") {
     }
 }
 
+TEST_CASE("NahHost::getLaunchContracts") {
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    env.installTestApp("com.test.alpha", "1.0.0");
+    env.installTestApp("com.test.beta", "1.0.0");
+    env.installTestApp("com.test.beta", "2.0.0");
+
+    auto host = nah::host::NahHost::create(env.root);
+    REQUIRE(host != nullptr);
+
+    SUBCASE("results follow input order and match single lookups") {
+        nah::core::BatchCompositionOptions opts;
+        opts.workers = 3;
+        std::vector<std::string> ids = {"com.test.beta", "com.test.missing", "com.test.alpha"};
+        auto results = host->getLaunchContracts(ids, opts);
+
+        REQUIRE(results.size() == 3u);
+        REQUIRE(results[0].ok);
+        CHECK(results[0].contract.app.id == "com.test.beta");
+        CHECK(results[0].contract.app.version == "2.0.0");
+        CHECK(!results[1].ok);
+        CHECK(results[1].critical_error_context == "Application not found: com.test.missing");
+        REQUIRE(results[2].ok);
+        CHECK(results[2].contract.app.id == "com.test.alpha");
+
+        auto single = host->getLaunchContract("com.test.beta");
+        CHECK(nah::core::serialize_contract(single.contract) ==
+              nah::core::serialize_contract(results[0].contract));
+    }
+
+    SUBCASE("empty id list") {
+        CHECK(host->getLaunchContracts({}).empty());
+    }
+}
+
 TEST_CASE("NahHost convenience functions") {
     TestNahEnvironment env;
     REQUIRE(!env.root.empty());
@@ -712,6 +783,166 @@ TEST_CASE("NahHost with multiple versions") {
     }
 }
 
+TEST_CASE("NahHost registry index") {
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    env.installTestApp("com.test.indexed", "1.0.0");
+    env.installTestApp("com.test.indexed", "1.10.0");
+    env.installTestApp("com.test.indexed", "1.9.0");
+
+    auto host = nah::host::NahHost::create(env.root);
+    REQUIRE(host != nullptr);
+
+    SUBCASE("latest version uses semver ordering") {
+        auto app = host->findApplication("com.test.indexed");
+        REQUIRE(app.has_value());
+        CHECK(app->version == "1.10.0");
+        CHECK(app->metadata_json == "{}");
+    }
+
+    SUBCASE("listing is grouped by id with highest version first") {
+        auto apps = host->listApplications();
+        REQUIRE(apps.size() == 3u);
+        CHECK(apps[0].version == "1.10.0");
+        CHECK(apps[1].version == "1.9.0");
+        CHECK(apps[2].version == "1.0.0");
+    }
+
+    SUBCASE("index follows installs and removals") {
+        CHECK(!host->isApplicationInstalled("com.test.later"));
+
+        env.installTestApp("com.test.later", "1.0.0");
+        host->refreshIndex();  // Same-tick mtime is possible on coarse filesystems
+        CHECK(host->isApplicationInstalled("com.test.later"));
+
+        std::filesystem::remove(env.root + "/registry/apps/com.test.later@1.0.0.json");
+        host->refreshIndex();
+        CHECK(!host->isApplicationInstalled("com.test.later"));
+    }
+
+    SUBCASE("directory mtime change triggers a rebuild") {
+        CHECK(host->findApplication("com.test.indexed").has_value());
+
+        env.installTestApp("com.test.mtime", "1.0.0");
+        auto apps_dir = std::filesystem::path(env.root) / "registry" / "apps";
+        std::filesystem::last_write_time(apps_dir,
+            std::filesystem::last_write_time(apps_dir) + std::chrono::seconds(5));
+
+        CHECK(host->isApplicationInstalled("com.test.mtime"));
+    }
+}
+
+TEST_CASE("NahHost contract cache") {
+    TestNahEnvironment env;
+    REQUIRE(!env.root.empty());
+
+    env.installTestApp("com.test.cached", "1.0.0");
+    std::string cache_path = env.root + "/registry/contracts/com.test.cached@1.0.0.bin";
+
+    auto host = nah::host::NahHost::create(env.root);
+    REQUIRE(host != nullptr);
+
+    // Replace the cached binary so a cache hit is observable. Hits are only
+    // served while the binary exists.
+    std::string cached_binary = env.root + "/cached-binary";
+    std::ofstream(cached_binary) << "#!/bin/sh\n";
+    auto tamper_cache = [&]() {
+        auto content = nah::fs::read_file(cache_path);
+        REQUIRE(content.has_value());
+        nah::registry::detail::Reader in{content->data(), content->data() + content->size()};
+        std::string key = in.str();
+        auto cached = nah::binary::decode_result(
+            std::string_view(in.pos, static_cast<size_t>(in.end - in.pos)));
+        REQUIRE(cached.has_value());
+        cached->contract.execution.binary = cached_binary;
+        REQUIRE(nah::registry::store_cached_result(env.root, "com.test.cached", "1.0.0", key, *cached));
+    };
+
+    auto first = host->getLaunchContract("com.test.cached");
+    REQUIRE(first.ok);
+    REQUIRE(std::filesystem::exists(cache_path));
+
+    SUBCASE("unchanged inputs are served from the cache") {
+        auto second = host->getLaunchContract("com.test.cached");
+        REQUIRE(second.ok);
+        CHECK(nah::core::serialize_result(second) == nah::core::serialize_result(first));
+
+        tamper_cache();
+        auto third = host->getLaunchContract("com.test.cached");
+        REQUIRE(third.ok);
+        CHECK(third.contract.execution.binary == cached_binary);
+    }
+
+    SUBCASE("a removed binary or entrypoint invalidates the entry") {
+        tamper_cache();
+        std::filesystem::remove(cached_binary);
+        auto result = host->getLaunchContract("com.test.cached");
+        REQUIRE(result.ok);
+        CHECK(result.contract.execution.binary == first.contract.execution.binary);
+
+        tamper_cache();
+        std::ofstream(cached_binary) << "#!/bin/sh\n";
+        REQUIRE(std::filesystem::remove(first.contract.app.entrypoint));
+        result = host->getLaunchContract("com.test.cached");
+        CHECK(result.contract.execution.binary != cached_binary);
+    }
+
+    SUBCASE("changing the manifest invalidates the entry") {
+        tamper_cache();
+
+        auto manifest = std::filesystem::path(env.root) / "apps" / "com.test.cached-1.0.0" / "nap.json";
+        std::ofstream(manifest, std::ios::app) << "\n";
+        std::filesystem::last_write_time(manifest,
+            std::filesystem::last_write_time(manifest) + std::chrono::seconds(5));
+
+        auto result = host->getLaunchContract("com.test.cached");
+        REQUIRE(result.ok);
+        CHECK(result.contract.execution.binary == first.contract.execution.binary);
+    }
+
+    SUBCASE("an edit that keeps size and mtime invalidates the entry") {
+        tamper_cache();
+
+        auto manifest = std::filesystem::path(env.root) / "apps" / "com.test.cached-1.0.0" / "nap.json";
+        auto mtime = std::filesystem::last_write_time(manifest);
+        auto content = nah::fs::read_file(manifest.string());
+        REQUIRE(content.has_value());
+        auto space = content->find(' ');
+        REQUIRE(space != std::string::npos);
+        (*content)[space] = '\n';
+        std::ofstream(manifest, std::ios::binary | std::ios::trunc) << *content;
+        std::filesystem::last_write_time(manifest, mtime);
+
+        auto result = host->getLaunchContract("com.test.cached");
+        REQUIRE(result.ok);
+        CHECK(result.contract.execution.binary == first.contract.execution.binary);
+    }
+
+    SUBCASE("loader override is part of the key") {
+        tamper_cache();
+
+        nah::core::CompositionOptions opts;
+        opts.loader_override = "other";
+        auto result = host->getLaunchContract("com.test.cached", "", opts);
+        CHECK(result.contract.execution.binary != cached_binary);
+    }
+
+    SUBCASE("disabled cache and traces always recompose") {
+        tamper_cache();
+
+        auto traced = host->getLaunchContract("com.test.cached", "", true);
+        REQUIRE(traced.ok);
+        CHECK(traced.trace.has_value());
+        CHECK(traced.contract.execution.binary == first.contract.execution.binary);
+
+        host->setContractCacheEnabled(false);
+        auto result = host->getLaunchContract("com.test.cached");
+        REQUIRE(result.ok);
+        CHECK(result.contract.execution.binary == first.contract.execution.binary);
+    }
+}
+
 TEST_CASE("NahHost app metadata") {
     TestNahEnvironment env;
     REQUIRE(!env.root.empty());
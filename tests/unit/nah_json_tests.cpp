@@ -237,6 +237,10 @@ TEST_CASE("parse_install_record") {
                 "state": "verified",
                 "source": "local_install",
                 "evaluated_at": "2024-01-01T00:00:00Z"
+            },
+            "verification": {
+                "last_verified_at": "2024-02-01T00:00:00Z",
+                "last_verifier_version": "1.1.0"
             }
         })";
 
@@ -249,6 +253,8 @@ TEST_CASE("parse_install_record") {
         CHECK(result.value.nak.version == "1.2.0");
         CHECK(result.value.paths.install_root == "/apps/test");
         CHECK(result.value.trust.state == nah::core::TrustState::Verified);
+        CHECK(result.value.verification.last_verified_at == "2024-02-01T00:00:00Z");
+        CHECK(result.value.verification.last_verifier_version == "1.1.0");
     }
 
     SUBCASE("install record with overrides") {
@@ -305,6 +311,8 @@ TEST_CASE("parse_runtime_descriptor") {
         CHECK(result.value.paths.root == "/naks/runtime");
         CHECK(result.value.loaders.size() == 1);
         CHECK(result.value.loaders.at("default").exec_path == "/naks/runtime/bin/runtime");
+        REQUIRE(result.value.loaders.at("default").args_compiled.size() == 1);
+        CHECK(result.value.loaders.at("default").args_compiled[0].segments[0].text == "--exec");
     }
 
     SUBCASE("runtime with multiple loaders") {
@@ -368,6 +376,54 @@ TEST_CASE("parse_launch_contract") {
     }
 }
 
+TEST_CASE("parse_composition_result") {
+    SUBCASE("round trips serialize_result") {
+        nah::core::CompositionResult original;
+        original.ok = true;
+        original.contract.app.id = "com.test.app";
+        original.contract.app.version = "1.0.0";
+        original.contract.execution.binary = "/apps/test/bin/app";
+        original.contract.execution.arguments = {"--flag", "a \"quoted\" arg"};
+        original.contract.execution.library_paths = {"/apps/test/lib"};
+        original.contract.environment = {{"A", "1"}, {"B", "line\nbreak"}};
+        original.contract.trust.state = nah::core::TrustState::Verified;
+        original.contract.trust.details = {{"signer", "ci"}};
+        original.contract.exports["icon"] = {"icon", "/apps/test/icon.png", "image/png"};
+        original.contract.capability_usage.present = true;
+        original.contract.capability_usage.required_capabilities = {"fs.read:/data"};
+        original.warnings.push_back({"missing_env_var", "warn", {{"missing", "HOME"}}});
+
+        std::string serialized = nah::core::serialize_result(original);
+        auto parsed = nah::json::parse_composition_result(serialized);
+        REQUIRE(parsed.ok);
+        CHECK(parsed.value.ok);
+        CHECK(!parsed.value.critical_error.has_value());
+        CHECK(parsed.value.contract.exports.at("icon").type == "image/png");
+        CHECK(parsed.value.contract.trust.details.at("signer") == "ci");
+        CHECK(parsed.value.warnings == original.warnings);
+        CHECK(nah::core::serialize_result(parsed.value) == serialized);
+        CHECK(nah::core::fingerprint(parsed.value.contract) == nah::core::fingerprint(original.contract));
+    }
+
+    SUBCASE("failed result keeps the critical error") {
+        nah::core::CompositionResult original;
+        original.critical_error = nah::core::CriticalError::PATH_TRAVERSAL;
+        original.critical_error_context = "path escapes root";
+
+        auto parsed = nah::json::parse_composition_result(nah::core::serialize_result(original));
+        REQUIRE(parsed.ok);
+        CHECK(!parsed.value.ok);
+        CHECK(parsed.value.critical_error == nah::core::CriticalError::PATH_TRAVERSAL);
+        CHECK(parsed.value.critical_error_context == "path escapes root");
+    }
+
+    SUBCASE("malformed input") {
+        auto parsed = nah::json::parse_composition_result("{not json");
+        CHECK(!parsed.ok);
+        CHECK(parsed.error.find("JSON parse error") != std::string::npos);
+    }
+}
+
 TEST_CASE("JSON error messages") {
     SUBCASE("malformed JSON") {
         std::string json = "{invalid json}";
@@ -415,4 +471,132 @@ TEST_CASE("warning key parsing") {
         CHECK(!nah::core::parse_warning_key("").has_value());
         CHECK(!nah::core::parse_warning_key("not_a_warning").has_value());
     }
-}
\ No newline at end of file
+}
+namespace {
+
+// The streaming parsers must give exactly what the DOM parsers give
+template <typename Result>
+void check_same(const Result& fast, const Result& dom) {
+    CHECK(fast.ok == dom.ok);
+    CHECK(fast.error == dom.error);
+    if (fast.ok && dom.ok) {
+        CHECK(nah::core::fingerprint(fast.value) == nah::core::fingerprint(dom.value));
+    }
+}
+
+template <typename Result>
+void check_same_with_source(const Result& fast, const Result& dom) {
+    check_same(fast, dom);
+    CHECK(fast.value.source_path == dom.value.source_path);
+}
+
+void check_app(const std::string& text) {
+    CAPTURE(text);
+    check_same(nah::json::parse_app_declaration(text), nah::json::parse_app_declaration_dom(text));
+}
+
+void check_install(const std::string& text) {
+    CAPTURE(text);
+    check_same_with_source(nah::json::parse_install_record(text, "/r/a.json"),
+                           nah::json::parse_install_record_dom(text, "/r/a.json"));
+}
+
+void check_runtime(const std::string& text) {
+    CAPTURE(text);
+    check_same_with_source(nah::json::parse_runtime_descriptor(text, "/r/n.json"),
+                           nah::json::parse_runtime_descriptor_dom(text, "/r/n.json"));
+}
+
+void check_host(const std::string& text) {
+    CAPTURE(text);
+    check_same_with_source(nah::json::parse_host_environment(text, "/h.json"),
+                           nah::json::parse_host_environment_dom(text, "/h.json"));
+}
+
+} // anonymous namespace
+
+TEST_CASE("streaming parsers match DOM parsers") {
+    SUBCASE("app declarations") {
+        check_app(R"({"id": "a", "version": "1", "entrypoint": "bin/a"})");
+        check_app(R"({"app": {"identity": {"id": "a", "version": "1", "nak_id": "lua", "nak_version_req": ">=5"},
+                     "execution": {"entrypoint": "main.lua", "args": ["-v", 3, "x"], "loader": "jit"},
+                     "layout": {"lib_dirs": ["lib"], "asset_dirs": ["share"]},
+                     "environment": {"Z": "1", "A": "2", "N": null},
+                     "exports": [{"id": "icon", "path": "icon.png", "type": "image/png"}, 7],
+                     "permissions": {"filesystem": ["read:/data"], "network": ["connect:*"]},
+                     "metadata": {"description": "d", "author": "me", "license": "MIT", "homepage": "h"},
+                     "components": {"provides": [
+                         {"id": "c", "standalone": false, "hidden": true, "environment": {"K": {"op": "append", "value": "v"}},
+                          "permissions": {"network": ["x"]}, "metadata": {"k": "v", "n": 1}}, "junk"]}},
+                     "id": "ignored"})");
+        check_app(R"({"id": "a", "version": "1", "nak": {"id": "lua", "version_req": "^5"},
+                     "entrypoint": {"path": "bin/a", "args": ["--x"]}, "env_vars": ["A=1"],
+                     "asset_exports": [{"id": "e"}], "description": "flat", "lib_dirs": ["l"]})");
+        check_app(R"({"id": "a", "version": "1", "nak_id": "n", "nak_version_req": "1", "entrypoint_path": "p",
+                     "entrypoint_args": ["q"], "exports": {}, "asset_exports": [{"id": "e"}]})");
+
+        // Duplicate keys: the last one wins, a wrong type means absent
+        check_app(R"({"id": "a", "id": "b", "version": "1", "entrypoint": "x", "entrypoint": {"path": "y"}})");
+        check_app(R"({"id": "a", "version": "1", "entrypoint": "x", "metadata": {"author": "a"}, "metadata": 5, "author": "b"})");
+        check_app(R"({"app": {"id": "a", "version": "1", "entrypoint": "x"}, "app": null, "id": "t", "version": "2", "entrypoint": "y"})");
+        check_app(R"({"id": "a", "version": "1", "entrypoint": "x", "environment": {"K": "1", "K": 2}, "components": {"provides": [{}]}, "components": []})");
+
+        // Unicode
+        check_app("\xEF\xBB\xBF{\"id\": \"caf\\u00e9 \\ud83d\\ude00 \xE2\x82\xAC\", \"version\": \"1\", \"entrypoint\": \"a\\/b\\u0000\"}");
+
+        // Numbers, nesting and values that are skipped
+        check_app(R"({"id": "a", "version": "1", "entrypoint": "x", "extra": [-0, 1.5, 10, {"a": [true, false, null]}], "big": 1e400})");
+
+        // Missing fields
+        check_app(R"({"version": "1", "entrypoint": "x"})");
+        check_app(R"({"id": "a", "entrypoint": "x"})");
+        check_app(R"({"id": "a", "version": "1", "entrypoint": 5})");
+        check_app(R"({"id": "a", "version": "1", "execution": {"args": []}, "entrypoint": "x"})");
+        check_app(R"([1, 2])");
+    }
+
+    SUBCASE("install records") {
+        check_install(R"({"install": {"instance_id": "i"}, "app": {"id": "a", "version": "1"},
+                         "nak": {"id": "n", "version": "2", "record_ref": "n@2.json", "loader": "l", "selection_reason": "s"},
+                         "paths": {"install_root": "/r"}, "provenance": {"package_hash": "sha256:x", "source": "s"},
+                         "trust": {"state": "verified", "details": {"a": "b", "c": 1}},
+                         "overrides": {"environment": {"X": "1"}, "arguments": {"prepend": ["a"], "append": ["b"]},
+                                       "paths": {"library_prepend": ["/l"]}}})");
+        check_install(R"({"install": {"instance_id": "i"}, "paths": {"install_root": "/r"},
+                         "verification": {"last_verified_at": "t", "last_verifier_version": "1.0.0", "extra": [1]}})");
+        check_install(R"({"install": {"instance_id": "i"}, "paths": {"install_root": "/r"}, "trust": "verified"})");
+        check_install(R"({"install": {"instance_id": "i"}, "paths": {"install_root": "/r"}, "trust": {"state": "bogus"}})");
+        check_install(R"({"install": {"instance_id": "i"}, "install": {}, "paths": {"install_root": "/r"}})");
+        check_install(R"({"install": {"instance_id": "i"}})");
+    }
+
+    SUBCASE("runtime descriptors") {
+        check_runtime(R"({"nak": {"id": "n", "version": "1"}, "paths": {"root": "/n", "lib_dirs": ["/n/lib"]},
+                         "environment": {"PATH": {"op": "prepend", "value": "/n/bin", "separator": ";"}, "B": {"op": "bogus"}, "C": 1},
+                         "loaders": {"default": {"exec_path": "/n/bin/run", "args_template": ["{NAH_APP_ENTRY}"]}, "odd": 3},
+                         "execution": {"cwd": "{NAH_APP_ROOT}"}, "provenance": {"installed_at": "t"}})");
+        check_runtime(R"({"nak": {"id": "n", "version": "1"}, "paths": {"root": "/n", "resource_root": "/res"}, "execution": []})");
+        check_runtime(R"({"nak": {"id": "n"}, "paths": {"root": "/n"}})");
+        check_runtime(R"({"nak": {"id": "n", "version": "1"}})");
+    }
+
+    SUBCASE("host environments") {
+        check_host(R"({"environment": {"A": "1"}, "paths": {"library_prepend": ["/p"], "library_append": ["/a"]},
+                      "overrides": {"allow_env_overrides": false, "allowed_env_keys": ["A"]}})");
+        check_host(R"({"overrides": {"allowed_env_keys": ["A"]}})");
+        check_host(R"({"overrides": {"allow_env_overrides": "no"}})");
+        check_host("{}");
+    }
+
+    SUBCASE("malformed input reports the DOM parser's error") {
+        for (const char* text : {"", "   ", "{", "{\"id\": }", "{\"id\": \"a\",}", "{\"a\": 01}", "{\"a\": tru}",
+                                 "{\"a\": \"\\x\"}", "{\"a\": \"\\ud800\"}", "{\"a\": \"\\udc00\"}", "{\"a\": \"\t\"}",
+                                 "{\"a\": \"\xC0\xAF\"}", "{\"a\": \"\xED\xA0\x80\"}", "{\"a\": \"\xF4\x90\x80\x80\"}",
+                                 "{} {}", "{\"a\": 1} x", "\xEF\xBB{}"}) {
+            check_app(text);
+            check_install(text);
+            check_runtime(text);
+            check_host(text);
+        }
+    }
+}
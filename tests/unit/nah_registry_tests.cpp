@@ -0,0 +1,258 @@
+/**
+ * Unit tests for nah_registry.h persistent registry index
+ */
+
+#include <nah/nah_registry.h>
+#include <doctest/doctest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nah::registry;
+
+namespace {
+
+// Temporary NAH root with empty registry directories
+class TempRegistry {
+public:
+    TempRegistry() {
+        std::random_device rd;
+        root = (std::filesystem::temp_directory_path() /
+                ("nah_registry_test_" + std::to_string(rd()))).generic_string();
+        std::filesystem::create_directories(root + "/registry/apps");
+        std::filesystem::create_directories(root + "/registry/naks");
+    }
+
+    ~TempRegistry() {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+
+    void writeApp(const std::string& id, const std::string& version,
+                  const std::string& nak_id = "") {
+        std::ofstream f(root + "/registry/apps/" + id + "@" + version + ".json");
+        f << R"({"install": {"instance_id": "inst-)" << id << version << R"("},)"
+          << R"("app": {"id": ")" << id << R"(", "version": ")" << version << R"("},)";
+        if (!nak_id.empty()) {
+            f << R"("nak": {"id": ")" << nak_id << R"(", "version": "1.0.0", "record_ref": ")"
+              << nak_id << R"(@1.0.0.json", "loader": "default"},)";
+        }
+        f << R"("paths": {"install_root": "apps/)" << id << "-" << version << R"("},)"
+          << R"("provenance": {"package_hash": "sha256:)" << id << version << R"("}})";
+    }
+
+    void writeNak(const std::string& id, const std::string& version) {
+        std::ofstream f(root + "/registry/naks/" + id + "@" + version + ".json");
+        f << R"({"nak": {"id": ")" << id << R"(", "version": ")" << version << R"("},)"
+          << R"("paths": {"root": "naks/)" << id << "/" << version << R"(", "lib_dirs": ["lib"]}})";
+    }
+
+    // Push the directory mtime forward so coarse timestamps can't hide a change
+    void touchApps() {
+        auto dir = std::filesystem::path(root) / "registry" / "apps";
+        std::filesystem::last_write_time(dir,
+            std::filesystem::last_write_time(dir) + std::chrono::seconds(5));
+    }
+
+    std::string root;
+};
+
+} // anonymous namespace
+
+TEST_CASE("RegistryIndex: encode/decode round trip") {
+    RegistryIndex index;
+    index.apps_mtime = 123456789;
+    index.naks_mtime = std::nullopt;
+
+    IndexEntry app;
+    app.kind = EntryKind::App;
+    app.id = "com.example.app";
+    app.version = "1.2.3";
+    app.record_file = "com.example.app@1.2.3.json";
+    app.install_root = "apps/com.example.app-1.2.3";
+    app.instance_id = "abc";
+    app.nak_id = "lua";
+    app.nak_pin.id = "lua";
+    app.nak_pin.version = "5.4.6";
+    app.nak_pin.record_ref = "lua@5.4.6.json";
+    app.nak_pin.loader = "default";
+    app.package_hash = "sha256:0123abcd";
+    index.apps.push_back(app);
+
+    IndexEntry nak;
+    nak.kind = EntryKind::Nak;
+    nak.id = "lua";
+    nak.version = "5.4.6";
+    nak.record_file = "lua@5.4.6.json";
+    nak.install_root = "naks/lua/5.4.6";
+    nak.lib_dirs = {"lib", "lib64"};
+    index.naks.push_back(nak);
+
+    auto decoded = decode_index(encode_index(index));
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->apps_mtime == index.apps_mtime);
+    CHECK(!decoded->naks_mtime.has_value());
+    REQUIRE(decoded->apps.size() == 1u);
+    REQUIRE(decoded->naks.size() == 1u);
+    CHECK(decoded->apps[0].id == "com.example.app");
+    CHECK(decoded->apps[0].nak_pin.record_ref == "lua@5.4.6.json");
+    CHECK(decoded->apps[0].package_hash == "sha256:0123abcd");
+    CHECK(decoded->naks[0].kind == EntryKind::Nak);
+    CHECK(decoded->naks[0].package_hash.empty());
+    CHECK(decoded->naks[0].lib_dirs == std::vector<std::string>{"lib", "lib64"});
+}
+
+TEST_CASE("RegistryIndex: decode rejects bad data") {
+    RegistryIndex index;
+    IndexEntry app;
+    app.id = "a";
+    app.version = "1.0.0";
+    index.apps.push_back(app);
+    std::string data = encode_index(index);
+
+    CHECK(!decode_index("").has_value());
+    CHECK(!decode_index("NOTANIDX").has_value());
+    CHECK(!decode_index(data.substr(0, data.size() - 1)).has_value());
+    CHECK(!decode_index(data + "x").has_value());
+}
+
+TEST_CASE("RegistryIndex: lookup and upsert keep latest first") {
+    RegistryIndex index;
+    for (const char* v : {"1.0.0", "1.10.0", "1.9.0"}) {
+        IndexEntry e;
+        e.id = "com.example.app";
+        e.version = v;
+        index.upsert(e);
+    }
+    IndexEntry other;
+    other.id = "com.example.aaa";
+    other.version = "2.0.0";
+    index.upsert(other);
+
+    REQUIRE(index.apps.size() == 4u);
+    CHECK(index.apps[0].id == "com.example.aaa");
+    REQUIRE(index.find_app("com.example.app") != nullptr);
+    CHECK(index.find_app("com.example.app")->version == "1.10.0");
+    CHECK(index.find_app("com.example.app", "1.9.0") != nullptr);
+    CHECK(index.find_app("com.example.app", "3.0.0") == nullptr);
+    CHECK(index.find_app("com.example") == nullptr);
+
+    CHECK(index.remove(EntryKind::App, "com.example.app", "1.10.0"));
+    CHECK(!index.remove(EntryKind::App, "com.example.app", "1.10.0"));
+    CHECK(index.find_app("com.example.app")->version == "1.9.0");
+}
+
+TEST_CASE("RegistryIndex: scan, persist and staleness") {
+    TempRegistry reg;
+    reg.writeNak("lua", "5.4.6");
+    reg.writeApp("com.example.app", "1.0.0", "lua");
+    reg.writeApp("com.example.app", "2.0.0", "lua");
+
+    SUBCASE("scan reads records") {
+        auto index = scan_registry(reg.root);
+        REQUIRE(index.apps.size() == 2u);
+        REQUIRE(index.naks.size() == 1u);
+        CHECK(index.apps[0].version == "2.0.0");
+        CHECK(index.apps[0].record_file == "com.example.app@2.0.0.json");
+        CHECK(index.apps[0].install_root == "apps/com.example.app-2.0.0");
+        CHECK(index.apps[0].nak_pin.id == "lua");
+        CHECK(index.apps[0].package_hash == "sha256:com.example.app2.0.0");
+        CHECK(index.naks[0].install_root == "naks/lua/5.4.6");
+    }
+
+    SUBCASE("scan keeps legacy NAK records") {
+        std::ofstream(reg.root + "/registry/naks/old@1.0.0.json") << R"({"id": "old", "version": "1.0.0"})";
+        std::ofstream(reg.root + "/registry/naks/broken@1.0.0.json") << "{not json";
+
+        std::vector<std::string> errors;
+        auto index = scan_registry(reg.root, &errors);
+        REQUIRE(index.naks.size() == 2u);
+        const auto* old = index.find_nak("old");
+        REQUIRE(old != nullptr);
+        CHECK(old->version == "1.0.0");
+        CHECK(old->record_file == "old@1.0.0.json");
+        CHECK(old->install_root.empty());
+        REQUIRE(errors.size() == 1u);
+        CHECK(errors[0].find("broken@1.0.0.json") != std::string::npos);
+    }
+
+    SUBCASE("missing index is not loaded") {
+        CHECK(!load_index(reg.root).has_value());
+    }
+
+    SUBCASE("saved index loads until the registry changes") {
+        REQUIRE(save_index(reg.root, scan_registry(reg.root)));
+        auto loaded = load_index(reg.root);
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->apps.size() == 2u);
+
+        reg.writeApp("com.example.new", "1.0.0");
+        reg.touchApps();
+        CHECK(!load_index(reg.root).has_value());
+
+        auto fallback = load_or_scan(reg.root);
+        CHECK(fallback.find_app("com.example.new") != nullptr);
+    }
+
+    SUBCASE("update_index patches a fresh index") {
+        REQUIRE(save_index(reg.root, scan_registry(reg.root)));
+        IndexLock held(reg.root);
+        REQUIRE(held.before.has_value());
+        CHECK(std::filesystem::exists(index_lock_path(reg.root)));
+
+        std::filesystem::remove(reg.root + "/registry/apps/com.example.app@2.0.0.json");
+        reg.touchApps();
+        REQUIRE(update_index(held, [](RegistryIndex& idx) {
+            idx.remove(EntryKind::App, "com.example.app", "2.0.0");
+        }));
+
+        auto after = load_index(reg.root);
+        REQUIRE(after.has_value());
+        REQUIRE(after->find_app("com.example.app") != nullptr);
+        CHECK(after->find_app("com.example.app")->version == "1.0.0");
+    }
+
+    SUBCASE("update_index rescans when there was no fresh index") {
+        IndexLock held(reg.root);
+        CHECK(!held.before.has_value());
+        reg.writeApp("com.example.other", "1.0.0");
+        REQUIRE(update_index(held, [](RegistryIndex&) {}));
+
+        auto after = load_index(reg.root);
+        REQUIRE(after.has_value());
+        CHECK(after->apps.size() == 3u);
+    }
+
+#ifndef _WIN32
+    SUBCASE("concurrent updates are not lost") {
+        REQUIRE(save_index(reg.root, scan_registry(reg.root)));
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 8; ++i) {
+            writers.emplace_back([&reg, i] {
+                std::string version = std::to_string(i) + ".0.0";
+                IndexLock held(reg.root);
+                reg.writeApp("com.example.concurrent", version);
+                reg.touchApps();
+                update_index(held, [&](RegistryIndex& idx) {
+                    IndexEntry entry;
+                    entry.id = "com.example.concurrent";
+                    entry.version = version;
+                    entry.record_file = "com.example.concurrent@" + version + ".json";
+                    idx.upsert(entry);
+                });
+            });
+        }
+        for (auto& t : writers) {
+            t.join();
+        }
+
+        auto after = load_index(reg.root);
+        REQUIRE(after.has_value());
+        CHECK(after->apps.size() == 10u);
+    }
+#endif
+}
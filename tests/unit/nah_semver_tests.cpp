@@ -4,6 +4,7 @@
 
 #include <nah/nah_semver.h>
 #include <doctest/doctest.h>
+#include <memory>
 #include <unordered_map>
 
 using namespace nah::semver;
@@ -203,6 +204,20 @@ TEST_CASE("select_best") {
     }
 }
 
+TEST_CASE("version_greater") {
+    SUBCASE("semver precedence when both parse") {
+        CHECK(version_greater("10.0.0", "9.0.0"));
+        CHECK(version_greater("1.0.0", "1.0.0-rc.1"));
+        CHECK(!version_greater("1.2.0", "1.10.0"));
+        CHECK(!version_greater("1.0.0", "1.0.0"));
+    }
+
+    SUBCASE("string comparison otherwise") {
+        CHECK(version_greater("beta", "alpha"));
+        CHECK(!version_greater("1.0", "2"));
+    }
+}
+
 TEST_CASE("VersionRange::min_version") {
     SUBCASE("simple range") {
         auto range = parse_range(">=1.2.3");
@@ -282,4 +297,19 @@ TEST_CASE("select_nak_from_inventory") {
         REQUIRE(result.found);
         CHECK(result.nak_version == "18.0.0");
     }
+
+    SUBCASE("skips null entries in a pointer map") {
+        std::unordered_map<std::string, std::shared_ptr<const MockRuntime>> pointers;
+        for (const auto& [record_ref, runtime] : inventory) {
+            pointers[record_ref] = std::make_shared<const MockRuntime>(runtime);
+        }
+        pointers["lua@9.9.9.json"] = nullptr;
+
+        auto result = select_nak_from_inventory(pointers, "lua", ">=5.4.0");
+
+        REQUIRE(result.found);
+        CHECK(result.nak_version == "5.4.6");
+        CHECK(result.record_ref == "lua@5.4.6.json");
+        CHECK(result.candidates.size() == 2);
+    }
 }
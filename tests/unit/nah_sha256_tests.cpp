@@ -0,0 +1,122 @@
+/**
+ * Unit tests for the CLI's SHA-256 (tools/nah/sha256.hpp)
+ *
+ * Every block function compiled into this build is run directly, not just
+ * the one select_blocks() picks on the test machine.
+ */
+
+#include "sha256.hpp"
+#include <doctest/doctest.h>
+#include <string>
+#include <vector>
+
+using namespace nah::cli::sha256;
+
+namespace {
+
+struct BlockImpl {
+    const char* name;
+    detail::BlockFn fn;
+};
+
+std::vector<BlockImpl> block_functions() {
+    std::vector<BlockImpl> fns = {{"portable", detail::blocks_portable}};
+#if defined(NAH_SHA256_X86)
+    if (detail::cpu_has_sha()) {
+        fns.push_back({"x86", detail::blocks_x86});
+    }
+#elif defined(NAH_SHA256_ARM)
+    fns.push_back({"arm", detail::blocks_arm});
+#endif
+    return fns;
+}
+
+std::string hex_of(detail::BlockFn fn, const std::string& data) {
+    Sha256 hash(fn);
+    hash.update(data.data(), data.size());
+    return to_hex(hash.finish());
+}
+
+// 0..200 bytes covers both padding branches and one to four blocks
+std::string pattern(size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>((i * 7 + 3) & 0xff);
+    }
+    return data;
+}
+
+} // anonymous namespace
+
+TEST_CASE("sha256: NIST vectors") {
+    for (const auto& impl : block_functions()) {
+        INFO(impl.name);
+        CHECK(hex_of(impl.fn, "") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        CHECK(hex_of(impl.fn, "abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        CHECK(hex_of(impl.fn, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+        CHECK(hex_of(impl.fn, "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                         "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu") ==
+              "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+        CHECK(hex_of(impl.fn, std::string(1000000, 'a')) ==
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    }
+}
+
+TEST_CASE("sha256: every length up to 200 bytes") {
+    auto data = pattern(200);
+    auto fns = block_functions();
+
+    SUBCASE("chained digests match the reference") {
+        // SHA-256 over the raw digests of data[0..n) for n = 0..200, from
+        // Python's hashlib
+        for (const auto& impl : fns) {
+            INFO(impl.name);
+            Sha256 chain(impl.fn);
+            for (size_t n = 0; n <= data.size(); ++n) {
+                Sha256 hash(impl.fn);
+                hash.update(data.data(), n);
+                auto digest = hash.finish();
+                chain.update(digest.data(), digest.size());
+            }
+            CHECK(to_hex(chain.finish()) == "3275febb4612d86d586eb9f11cd21e648a9fc7d95e0f6b8d362786e28c9c5b79");
+        }
+    }
+
+    SUBCASE("block functions agree") {
+        for (size_t n = 0; n <= data.size(); ++n) {
+            CAPTURE(n);
+            auto expected = hex_of(detail::blocks_portable, data.substr(0, n));
+            for (const auto& impl : fns) {
+                INFO(impl.name);
+                CHECK(hex_of(impl.fn, data.substr(0, n)) == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("sha256: split updates") {
+    auto data = pattern(200);
+
+    for (const auto& impl : block_functions()) {
+        INFO(impl.name);
+        for (size_t n : {0u, 1u, 55u, 56u, 63u, 64u, 65u, 119u, 120u, 127u, 128u, 129u, 200u}) {
+            auto expected = hex_of(impl.fn, data.substr(0, n));
+            for (size_t split = 0; split <= n; ++split) {
+                CAPTURE(n);
+                CAPTURE(split);
+                Sha256 hash(impl.fn);
+                hash.update(data.data(), split);
+                hash.update(data.data() + split, n - split);
+                CHECK(to_hex(hash.finish()) == expected);
+            }
+
+            // Byte at a time goes through the partial-block buffer only
+            Sha256 bytewise(impl.fn);
+            for (size_t i = 0; i < n; ++i) {
+                bytewise.update(data.data() + i, 1);
+            }
+            CHECK(to_hex(bytewise.finish()) == expected);
+        }
+    }
+}
@@ -5,17 +5,23 @@
  */
 
 #include "../common.hpp"
+#include "../digests.hpp"
+#include "../package.hpp"
 #include <CLI/CLI.hpp>
 #include <filesystem>
 #include <fstream>
+#include <optional>
 #include <random>
 #include <vector>
-#include <cstring>
-#include <zlib.h>
 
 #ifndef _WIN32
 #include <sys/stat.h>  // For chmod()
 #endif
+#ifdef __linux__
+#include <cerrno>
+#include <cstdio>   // For renameat2()
+#include <fcntl.h>  // For AT_FDCWD
+#endif
 
 namespace nah::cli::commands {
 
@@ -92,135 +98,163 @@ void fix_permissions_recursive(const std::filesystem::path& dir, const std::file
 #endif
 }
 
-// Gzip decompression
-std::optional<std::vector<uint8_t>> gzip_decompress(const std::vector<uint8_t>& compressed) {
-    z_stream stream;
-    std::memset(&stream, 0, sizeof(stream));
-
-    // 16 + MAX_WBITS tells zlib to handle gzip format
-    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
-        return std::nullopt;
+// Rename the directory `from` over the existing directory `to`, leaving the
+// tree it replaces at `displaced`. On Linux the two are swapped with one
+// renameat2(RENAME_EXCHANGE), so `to` never stops existing and `displaced`
+// is `from`. Elsewhere, or where the filesystem cannot exchange, `to` is
+// first renamed to `aside`.
+bool replace_directory(const std::string& from, const std::string& to, const std::string& aside,
+                       std::string& displaced, std::error_code& ec) {
+    namespace stdfs = std::filesystem;
+    ec.clear();
+#if defined(__linux__) && defined(RENAME_EXCHANGE)
+    if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_EXCHANGE) == 0) {
+        displaced = from;
+        return true;
     }
-
-    stream.next_in = const_cast<Bytef*>(compressed.data());
-    stream.avail_in = static_cast<uInt>(compressed.size());
-
-    std::vector<uint8_t> decompressed;
-    const size_t CHUNK = 16384;
-    uint8_t out[CHUNK];
-
-    int ret;
-    do {
-        stream.avail_out = CHUNK;
-        stream.next_out = out;
-
-        ret = inflate(&stream, Z_NO_FLUSH);
-        if (ret == Z_STREAM_ERROR || ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
-            inflateEnd(&stream);
-            return std::nullopt;
-        }
-
-        size_t have = CHUNK - stream.avail_out;
-        decompressed.insert(decompressed.end(), out, out + have);
-    } while (stream.avail_out == 0);
-
-    inflateEnd(&stream);
-
-    if (ret != Z_STREAM_END) {
-        return std::nullopt;
+    if (errno != EINVAL && errno != ENOSYS) {
+        ec.assign(errno, std::generic_category());
+        return false;
     }
-
-    return decompressed;
+#endif
+    stdfs::rename(to, aside, ec);
+    if (ec) {
+        return false;
+    }
+    stdfs::rename(from, to, ec);
+    if (ec) {
+        std::error_code restore_ec;
+        stdfs::rename(aside, to, restore_ec);
+        return false;
+    }
+    displaced = aside;
+    return true;
 }
 
-// Simple tar extraction
-bool extract_tar(const std::vector<uint8_t>& tar_data, const std::string& dest_dir) {
-    size_t offset = 0;
+// A tree placed at install_dir whose install is not committed yet. The
+// install it replaced, and the registry files guarded with guard_file(),
+// are kept until commit(); if the install is abandoned first, they are put
+// back and the new tree is removed.
+class PlacedTree {
+public:
+    PlacedTree() = default;
+    PlacedTree(const PlacedTree&) = delete;
+    PlacedTree& operator=(const PlacedTree&) = delete;
+    ~PlacedTree() { rollback(); }
+
+    // Remember the current content of `path` (or that it does not exist)
+    void guard_file(const std::string& path) {
+        guarded_.push_back({path, nah::fs::read_file(path)});
+    }
 
-    std::filesystem::create_directories(dest_dir);
+    // The record and digests are in place: drop the replaced install
+    void commit() {
+        if (!previous_.empty()) {
+            std::error_code ec;
+            std::filesystem::remove_all(previous_, ec);
+        }
+        install_dir_.clear();
+        guarded_.clear();
+    }
 
-    while (offset + 512 <= tar_data.size()) {
-        // Read header (512 bytes)
-        const uint8_t* header = tar_data.data() + offset;
-        offset += 512;
+private:
+    friend bool place_install_tree(const std::string&, const std::string&, const std::string&, bool,
+                                   PlacedTree&, std::string&);
 
-        // Check for end of archive (two zero blocks)
-        bool all_zero = true;
-        for (size_t i = 0; i < 512; ++i) {
-            if (header[i] != 0) {
-                all_zero = false;
-                break;
+    void rollback() {
+        if (install_dir_.empty()) {
+            return;
+        }
+        std::error_code ec;
+        if (previous_.empty()) {
+            std::filesystem::remove_all(install_dir_, ec);
+        } else {
+            std::string displaced;
+            if (replace_directory(previous_, install_dir_, previous_ + ".new", displaced, ec)) {
+                std::filesystem::remove_all(displaced, ec);
             }
         }
-        if (all_zero) break;
-
-        // Parse header
-        char name[101] = {0};
-        std::memcpy(name, header, 100);
-
-        char mode_octal[9] = {0};
-        std::memcpy(mode_octal, header + 100, 8);
-        unsigned int mode = static_cast<unsigned int>(std::stoul(mode_octal, nullptr, 8));
-
-        char size_octal[13] = {0};
-        std::memcpy(size_octal, header + 124, 12);
-        size_t size = std::stoull(size_octal, nullptr, 8);
-
-        uint8_t typeflag = header[156];
-
-        if (name[0] == '\0') break;
-
-        // Calculate padded size (512-byte blocks)
-        size_t padded_size = ((size + 511) / 512) * 512;
-
-        if (offset + padded_size > tar_data.size()) {
-            return false; // Corrupted tar
+        for (const auto& [path, content] : guarded_) {
+            if (content) {
+                nah::fs::write_file_atomic(path, *content);
+            } else {
+                std::filesystem::remove(path, ec);
+            }
         }
+        install_dir_.clear();
+    }
 
-        std::filesystem::path file_path = std::filesystem::path(dest_dir) / name;
+    std::string install_dir_;  // Empty once committed or rolled back
+    std::string previous_;     // The replaced install, empty if there was none
+    std::vector<std::pair<std::string, std::optional<std::string>>> guarded_;
+};
 
-        // Type: '0' or '\0' = regular file, '5' = directory
-        if (typeflag == '5') {
-            // Directory
-            std::filesystem::create_directories(file_path);
-        } else if (typeflag == '0' || typeflag == '\0') {
-            // Regular file
-            std::filesystem::create_directories(file_path.parent_path());
+// Put a complete tree at install_dir without ever exposing a partial one.
+// The tree is assembled in the staging directory, which sits on the same
+// filesystem as the install roots, and renamed into place; an existing
+// install is swapped out in the same step where the platform allows it and
+// kept in staging until `placed` is committed. With `move_staged`,
+// source_dir is already a private staging directory and is moved as is;
+// otherwise it is copied into staging first.
+bool place_install_tree(const std::string& source_dir, const std::string& install_dir,
+                        const std::string& staging_dir, bool move_staged, PlacedTree& placed,
+                        std::string& error) {
+    namespace stdfs = std::filesystem;
+    std::error_code ec;
+
+    std::string staged = source_dir;
+    if (!move_staged) {
+        staged = nah::fs::join_paths(staging_dir, generate_uuid());
+        stdfs::copy(source_dir, staged, stdfs::copy_options::recursive, ec);
+        if (ec) {
+            stdfs::remove_all(staged, ec);
+            error = "Failed to copy " + source_dir + " into staging";
+            return false;
+        }
 
-            std::ofstream file(file_path, std::ios::binary);
-            if (!file) {
-                return false;
-            }
+        // Fix permissions after copy (needed for Docker Desktop Mac fakeowner mounts)
+        fix_permissions_recursive(staged, source_dir);
+    }
 
-            file.write(reinterpret_cast<const char*>(tar_data.data() + offset), static_cast<std::streamsize>(size));
-            file.close();
+    stdfs::create_directories(stdfs::path(install_dir).parent_path(), ec);
 
-            // Apply permissions from tar header
-            if (mode == 0) {
-                // If mode is 0, tar header might be corrupted or missing permissions
-                // Default to 0644 for regular files
-                mode = 0644;
-            }
-            
-            // Use POSIX chmod directly on Unix-like systems for maximum compatibility
-            // Some filesystems (like Docker Desktop Mac's fakeowner) don't properly support
-            // std::filesystem::permissions(), but do support POSIX chmod()
-#ifdef _WIN32
-            // Windows: use std::filesystem::permissions (no POSIX chmod available)
-            std::error_code perm_ec;
-            std::filesystem::permissions(file_path,
-                static_cast<std::filesystem::perms>(mode),
-                std::filesystem::perm_options::replace,
-                perm_ec);
-#else
-            // Unix/Linux/Mac: use POSIX chmod for best compatibility
-            chmod(file_path.string().c_str(), static_cast<mode_t>(mode));
-#endif
+    std::string previous;
+    if (stdfs::exists(install_dir)) {
+        if (!replace_directory(staged, install_dir, nah::fs::join_paths(staging_dir, generate_uuid()),
+                               previous, ec)) {
+            error = "Failed to replace existing install " + install_dir + ": " + ec.message();
         }
-
-        offset += padded_size;
+    } else {
+        stdfs::rename(staged, install_dir, ec);
+        if (ec) {
+            error = "Failed to move staged install into " + install_dir + ": " + ec.message();
+        }
+    }
+    if (ec) {
+        if (!move_staged) {
+            stdfs::remove_all(staged, ec);
+        }
+        return false;
     }
 
+    placed.install_dir_ = install_dir;
+    placed.previous_ = previous;
+    return true;
+}
+
+// Hash every file of a freshly placed tree into its digest manifest in the
+// registry, which nah verify checks the tree against later
+bool write_tree_digests(const std::string& install_dir, const std::string& manifest_path, PlacedTree& placed,
+                        std::string& error) {
+    auto tree = digests::hash_tree(install_dir, 0, &error);
+    if (!tree) {
+        return false;
+    }
+    placed.guard_file(manifest_path);
+    if (!digests::write_manifest(manifest_path, *tree)) {
+        error = "Failed to write digest manifest: " + manifest_path;
+        return false;
+    }
     return true;
 }
 
@@ -267,21 +301,24 @@ SourceType detect_source_type(const std::string& source) {
     return SourceType::Directory; // Default
 }
 
+// With a non-empty `package_path`, source_dir is a staging directory the
+// package was extracted into: it is moved into place rather than copied.
 int install_from_directory(const GlobalOptions& opts, const InstallOptions& install_opts,
-                           const std::string& source_dir, const std::string& nah_root) {
+                           const std::string& source_dir, const std::string& nah_root,
+                           const std::string& package_path = "", const std::string& package_hash = "") {
     init_warning_collector(opts.json, opts.quiet);
     auto paths = get_nah_paths(nah_root);
 
     // Try NAH-specific manifest files (names match package extensions)
-    auto manifest_content = nah::fs::read_file(nah::fs::join_paths(source_dir, "nap.json"));
+    auto manifest_content = nah::fs::read_file_view(nah::fs::join_paths(source_dir, "nap.json"));
     std::string manifest_type = "nap";
     
     if (!manifest_content) {
-        manifest_content = nah::fs::read_file(nah::fs::join_paths(source_dir, "nak.json"));
+        manifest_content = nah::fs::read_file_view(nah::fs::join_paths(source_dir, "nak.json"));
         manifest_type = "nak";
     }
     if (!manifest_content) {
-        manifest_content = nah::fs::read_file(nah::fs::join_paths(source_dir, "nah.json"));
+        manifest_content = nah::fs::read_file_view(nah::fs::join_paths(source_dir, "nah.json"));
         manifest_type = "nah";
     }
     
@@ -294,7 +331,7 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
     // Parse JSON manifest
     nlohmann::json manifest;
     try {
-        manifest = nlohmann::json::parse(*manifest_content);
+        manifest = nlohmann::json::parse(manifest_content->data(), manifest_content->data() + manifest_content->size());
     } catch (const std::exception& e) {
         print_error("Failed to parse manifest JSON: " + std::string(e.what()) + "\n"
                    "Please check the manifest syntax at https://docs.nah.io/manifest", opts.json);
@@ -355,6 +392,13 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
     // Ensure NAH structure
     ensure_nah_structure(nah_root);
 
+    // Recorded as provenance.source, absolute so that it still names the
+    // package when read from another directory
+    std::error_code source_ec;
+    std::string source = std::filesystem::absolute(package_path.empty() ? source_dir : package_path, source_ec)
+                             .lexically_normal()
+                             .string();
+
     if (is_nak) {
         // Install as NAK
         std::string install_dir = nah::fs::absolute_path(nah::fs::join_paths(nah::fs::join_paths(paths.naks, id), version));
@@ -366,18 +410,21 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
             return 1;
         }
 
-        // Remove existing
-        if (nah::fs::exists(install_dir)) {
-            std::filesystem::remove_all(install_dir);
+        // Stage and rename into place, replacing any existing install
+        // Until commit(), any return restores the previous install
+        PlacedTree placed;
+        std::string place_error;
+        if (!place_install_tree(source_dir, install_dir, paths.staging, !package_path.empty(), placed,
+                                place_error)) {
+            print_error(place_error, opts.json);
+            return 1;
+        }
+        if (!write_tree_digests(install_dir, digests::manifest_path(nah_root, nah::registry::EntryKind::Nak,
+                                                                    nah::fs::filename(record_path)),
+                                placed, place_error)) {
+            print_error(place_error, opts.json);
+            return 1;
         }
-
-        // Copy to install location
-        std::filesystem::create_directories(install_dir);
-        std::filesystem::copy(source_dir, install_dir,
-            std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing);
-
-        // Fix permissions after copy (needed for Docker Desktop Mac fakeowner mounts)
-        fix_permissions_recursive(install_dir, source_dir);
 
         // Create NAK descriptor (registry record)
         nah::core::RuntimeDescriptor runtime;
@@ -409,6 +456,7 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
                     for (const auto& arg : loader_json["args_template"]) {
                         loader.args_template.push_back(arg.get<std::string>());
                     }
+                    loader.args_compiled = nah::core::compile_templates(loader.args_template);
                 }
                 runtime.loaders[name] = loader;
             }
@@ -437,9 +485,27 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
             }
         }
 
-        std::ofstream record_file(record_path);
-        record_file << nak_record.dump(2);
-        record_file.close();
+        runtime.provenance.package_hash = package_hash;
+        runtime.provenance.installed_at = nah::core::get_current_timestamp();
+        runtime.provenance.installed_by = "nah_cli";
+        runtime.provenance.source = source;
+        nak_record["provenance"]["package_hash"] = runtime.provenance.package_hash;
+        nak_record["provenance"]["installed_at"] = runtime.provenance.installed_at;
+        nak_record["provenance"]["installed_by"] = runtime.provenance.installed_by;
+        nak_record["provenance"]["source"] = runtime.provenance.source;
+
+        // Hold the index from its snapshot until it is saved, so that it can
+        // be patched instead of rebuilt
+        nah::registry::IndexLock index_lock(nah_root);
+        if (!nah::fs::write_file_atomic(record_path, nak_record.dump(2))) {
+            print_error("Failed to write NAK record: " + record_path, opts.json);
+            return 1;
+        }
+
+        nah::registry::update_index(index_lock, [&](nah::registry::RegistryIndex& index) {
+            index.upsert(nah::registry::entry_from_runtime(runtime, nah::fs::filename(record_path)));
+        });
+        placed.commit();
 
         if (opts.json) {
             nlohmann::json j;
@@ -462,18 +528,21 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
             return 1;
         }
 
-        // Remove existing
-        if (nah::fs::exists(install_dir)) {
-            std::filesystem::remove_all(install_dir);
+        // Stage and rename into place, replacing any existing install
+        // Until commit(), any return restores the previous install
+        PlacedTree placed;
+        std::string place_error;
+        if (!place_install_tree(source_dir, install_dir, paths.staging, !package_path.empty(), placed,
+                                place_error)) {
+            print_error(place_error, opts.json);
+            return 1;
+        }
+        if (!write_tree_digests(install_dir, digests::manifest_path(nah_root, nah::registry::EntryKind::App,
+                                                                    nah::fs::filename(record_path)),
+                                placed, place_error)) {
+            print_error(place_error, opts.json);
+            return 1;
         }
-
-        // Copy to install location
-        std::filesystem::create_directories(install_dir);
-        std::filesystem::copy(source_dir, install_dir,
-            std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing);
-
-        // Fix permissions after copy (needed for Docker Desktop Mac fakeowner mounts)
-        fix_permissions_recursive(install_dir, source_dir);
 
         // Create install record
         nah::core::InstallRecord record;
@@ -497,37 +566,33 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
 
             // Try to find and pin NAK
             std::string nak_id = record.app.nak_id;
-            auto nak_files = nah::fs::list_directory(paths.registry_naks);
+            std::string nak_prefix = nak_id + "@";
             bool nak_found = false;
-            for (const auto& f : nak_files) {
-                // Extract basename from full path
-                std::string basename = f;
-                size_t last_slash = f.rfind('/');
-                if (last_slash != std::string::npos) {
-                    basename = f.substr(last_slash + 1);
+            nah::fs::for_each_entry(paths.registry_naks, ".json", [&](const nah::fs::DirEntry& entry) {
+                if (entry.name.size() <= nak_prefix.size() + 5 ||
+                    entry.name.compare(0, nak_prefix.size(), nak_prefix) != 0) {
+                    return true;
                 }
-                
-                if (basename.find(nak_id + "@") == 0 && basename.substr(basename.size() - 5) == ".json") {
-                    // Extract version from filename
-                    std::string nak_version = basename.substr(nak_id.size() + 1, basename.size() - nak_id.size() - 6);
-                    record.nak.id = nak_id;
-                    record.nak.version = nak_version;
-                    record.nak.record_ref = basename;  // Store just the basename
-                    
-                    // Loader priority: CLI flag > App manifest > "default"
-                    if (!install_opts.loader.empty()) {
-                        record.nak.loader = install_opts.loader;
-                    } else if (!app_loader_preference.empty()) {
-                        record.nak.loader = app_loader_preference;
-                    } else {
-                        record.nak.loader = "default";
-                    }
-                    
-                    record.nak.selection_reason = "matched_requirement";
-                    nak_found = true;
-                    break;
+
+                // Extract version from filename
+                record.nak.id = nak_id;
+                record.nak.version = std::string(entry.name.substr(
+                    nak_prefix.size(), entry.name.size() - nak_prefix.size() - 5));
+                record.nak.record_ref = std::string(entry.name);  // Store just the basename
+
+                // Loader priority: CLI flag > App manifest > "default"
+                if (!install_opts.loader.empty()) {
+                    record.nak.loader = install_opts.loader;
+                } else if (!app_loader_preference.empty()) {
+                    record.nak.loader = app_loader_preference;
+                } else {
+                    record.nak.loader = "default";
                 }
-            }
+
+                record.nak.selection_reason = "matched_requirement";
+                nak_found = true;
+                return false;
+            });
             
             if (!nak_found) {
                 print_warning("NAK '" + nak_id + "' not found. App may fail to run until NAK is installed.", opts.json);
@@ -564,10 +629,10 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
         record.trust.evaluated_at = nah::core::get_current_timestamp();
 
         // Provenance (not metadata)
-        record.provenance.package_hash = "";
+        record.provenance.package_hash = package_hash;
         record.provenance.installed_at = record.trust.evaluated_at;
         record.provenance.installed_by = "nah_cli";
-        record.provenance.source = source_dir;
+        record.provenance.source = source;
 
         // Write registry record (manually serialize since no serialization function exists)
         nlohmann::json install_record;
@@ -644,9 +709,18 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
         install_record["provenance"]["installed_by"] = record.provenance.installed_by;
         install_record["provenance"]["source"] = record.provenance.source;
 
-        std::ofstream record_file(record_path);
-        record_file << install_record.dump(2);
-        record_file.close();
+        // Hold the index from its snapshot until it is saved, so that it can
+        // be patched instead of rebuilt
+        nah::registry::IndexLock index_lock(nah_root);
+        if (!nah::fs::write_file_atomic(record_path, install_record.dump(2))) {
+            print_error("Failed to write install record: " + record_path, opts.json);
+            return 1;
+        }
+
+        nah::registry::update_index(index_lock, [&](nah::registry::RegistryIndex& index) {
+            index.upsert(nah::registry::entry_from_install_record(record, nah::fs::filename(record_path)));
+        });
+        placed.commit();
 
         if (opts.json) {
             nlohmann::json j;
@@ -666,46 +740,42 @@ int install_from_directory(const GlobalOptions& opts, const InstallOptions& inst
 int install_from_package(const GlobalOptions& opts, const InstallOptions& install_opts,
                          const std::string& package_path, const std::string& nah_root,
                          bool /* is_nak_package */) {
-    // Read package file
-    std::ifstream file(package_path, std::ios::binary | std::ios::ate);
-    if (!file) {
-        print_error("Cannot open package file: " + package_path, opts.json);
-        return 1;
-    }
-
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<uint8_t> compressed(static_cast<size_t>(size));
-    if (!file.read(reinterpret_cast<char*>(compressed.data()), size)) {
-        print_error("Failed to read package file", opts.json);
-        return 1;
-    }
-    file.close();
-
-    // Decompress gzip
-    auto decompressed_opt = gzip_decompress(compressed);
-    if (!decompressed_opt) {
-        print_error("Failed to decompress package file", opts.json);
-        return 1;
-    }
-
-    // Create temporary directory for extraction
-    std::string temp_dir = "/tmp/nah_install_" + std::to_string(std::time(nullptr));
-    std::filesystem::create_directories(temp_dir);
-
-    // Extract tar
-    if (!extract_tar(*decompressed_opt, temp_dir)) {
-        std::filesystem::remove_all(temp_dir);
-        print_error("Failed to extract package contents", opts.json);
+    // Extract into the staging directory under the NAH root: on the same
+    // filesystem as apps/ and naks/, so the tree can be renamed into place
+    // instead of copied
+    ensure_nah_structure(nah_root);
+    auto paths = get_nah_paths(nah_root);
+    std::string staging_dir = nah::fs::join_paths(paths.staging, generate_uuid());
+
+    // Stream the package: read, inflate and untar in fixed-size chunks,
+    // hashing the package bytes as they are read
+    std::string extract_error;
+    sha256::Digest digest;
+    auto status = package::extract_package(package_path, staging_dir, &extract_error, &digest);
+    if (status != package::ExtractStatus::Ok) {
+        std::filesystem::remove_all(staging_dir);
+        switch (status) {
+            case package::ExtractStatus::OpenFailed:
+                print_error("Cannot open package file: " + package_path, opts.json);
+                break;
+            case package::ExtractStatus::DecompressFailed:
+                print_error("Failed to decompress package file", opts.json);
+                break;
+            default:
+                print_error("Failed to extract package contents" +
+                            (extract_error.empty() ? std::string() : ": " + extract_error), opts.json);
+                break;
+        }
         return 1;
     }
 
-    // Install from extracted directory
-    int result = install_from_directory(opts, install_opts, temp_dir, nah_root);
+    // Install from the extracted tree, which is moved into place
+    int result = install_from_directory(opts, install_opts, staging_dir, nah_root, package_path,
+                                        "sha256:" + sha256::to_hex(digest));
 
-    // Clean up temp directory
-    std::filesystem::remove_all(temp_dir);
+    // Whatever was not moved (dry run, errors) is dropped
+    std::error_code ec;
+    std::filesystem::remove_all(staging_dir, ec);
 
     return result;
 }
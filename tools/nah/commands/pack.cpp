@@ -5,8 +5,11 @@
  */
 
 #include "../common.hpp"
+#include "../package.hpp"
 #include <CLI/CLI.hpp>
+#include <filesystem>
 #include <fstream>
+#include <vector>
 
 namespace nah::cli::commands {
 
@@ -15,12 +18,20 @@ namespace {
 struct PackOptions {
     std::string dir;
     std::string output;
+    std::string compression = "gzip";
 };
 
 int cmd_pack(const GlobalOptions& opts, const PackOptions& pack_opts) {
     init_warning_collector(opts.json, opts.quiet);
     
     std::string source_dir = pack_opts.dir;
+
+    auto compression = package::parse_compression(pack_opts.compression);
+    if (!compression) {
+        print_error("Invalid compression: " + pack_opts.compression +
+                    " (expected gzip, gzip:<1-9>, zstd or zstd:<level>)", opts.json);
+        return 1;
+    }
     
     // Detect manifest type by filename (names match package extensions)
     std::string manifest_path;
@@ -83,15 +94,51 @@ int cmd_pack(const GlobalOptions& opts, const PackOptions& pack_opts) {
         output_path = id + "-" + version + ext;
     }
     
-    // Create tar.gz package using system tar command
-    // Use deterministic flags for reproducible builds
-    std::string tar_cmd = "tar --sort=name --owner=0 --group=0 --numeric-owner "
-                          "--mtime='1970-01-01' -czf " + output_path + 
-                          " -C " + source_dir + " .";
-    
-    int result = std::system(tar_cmd.c_str());
-    
-    if (result == 0) {
+    // Write the tarball in-process, deterministically, straight into the
+    // compressor: files are read while earlier data compresses
+    std::string exclude;
+    {
+        std::error_code ec;
+        auto source = std::filesystem::weakly_canonical(source_dir, ec);
+        auto output = std::filesystem::weakly_canonical(output_path, ec);
+        auto relative = output.lexically_relative(source).generic_string();
+        if (!ec && !relative.empty() && relative.rfind("..", 0) != 0) {
+            exclude = relative;  // Don't pack the package into itself
+        }
+    }
+
+    std::string pack_error;
+    auto pack_into = [&](auto& writer) {
+        package::TarWriter tar([&](const uint8_t* data, size_t size) { return writer.write(data, size); });
+        if (!package::write_tree(tar, source_dir, pack_error, exclude)) {
+            return false;
+        }
+        if (!tar.finish() || !writer.finish()) {
+            pack_error = "cannot write " + output_path;
+            return false;
+        }
+        return true;
+    };
+
+    bool written = false;
+    {
+        std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            pack_error = "cannot write " + output_path;
+        } else if (compression->format == package::CompressionFormat::Zstd) {
+            package::ZstdWriter writer(out, 0, compression->level);
+            written = pack_into(writer);
+        } else {
+            package::BlockGzipWriter writer(out, 0, compression->level);
+            written = pack_into(writer);
+        }
+    }
+    if (!written) {
+        std::error_code ec;
+        std::filesystem::remove(output_path, ec);
+    }
+
+    if (written) {
         if (opts.json) {
             nlohmann::json j;
             j["ok"] = true;
@@ -99,6 +146,7 @@ int cmd_pack(const GlobalOptions& opts, const PackOptions& pack_opts) {
             j["id"] = id;
             j["version"] = version;
             j["package"] = output_path;
+            j["compression"] = compression->format == package::CompressionFormat::Zstd ? "zstd" : "gzip";
             output_json(j);
         } else {
             std::cout << "Created " << manifest_type << " package: " << output_path << std::endl;
@@ -107,7 +155,7 @@ int cmd_pack(const GlobalOptions& opts, const PackOptions& pack_opts) {
         }
         return 0;
     } else {
-        print_error("Failed to create package (tar command failed)", opts.json);
+        print_error("Failed to create package: " + pack_error, opts.json);
         return 1;
     }
 }
@@ -119,6 +167,8 @@ void setup_pack(CLI::App* app, GlobalOptions& opts) {
     
     app->add_option("dir", pack_opts.dir, "Directory to pack")->required();
     app->add_option("-o,--output", pack_opts.output, "Output file path");
+    app->add_option("--compression", pack_opts.compression,
+                    "Package compression: gzip or zstd, optionally with a level (zstd:19)");
     
     app->callback([&opts]() {
         std::exit(cmd_pack(opts, pack_opts));
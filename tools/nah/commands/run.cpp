@@ -22,6 +22,7 @@ struct RunOptions {
     std::string target;
     std::vector<std::string> args;
     std::string loader;  // Runtime loader override
+    bool no_cache = false;
 };
 
 int cmd_run(const GlobalOptions& opts, const RunOptions& run_opts) {
@@ -36,6 +37,7 @@ int cmd_run(const GlobalOptions& opts, const RunOptions& run_opts) {
         print_error("Failed to initialize NAH host", opts.json);
         return 1;
     }
+    host->setContractCacheEnabled(!run_opts.no_cache);
 
     // Parse target (app_id or app_id@version)
     std::string app_id = run_opts.target;
@@ -98,9 +100,12 @@ int cmd_run(const GlobalOptions& opts, const RunOptions& run_opts) {
         }
     }
 
-    // Apply overrides from environment
-    auto host_env = host->getHostEnvironment();
-    nah::overrides::apply_overrides(result, host_env);
+    // Apply overrides from environment (host.json is only needed to check
+    // the override policy, so a cached contract skips it otherwise)
+    if (!safe_getenv("NAH_OVERRIDE_ENVIRONMENT").empty()) {
+        auto host_env = host->getHostEnvironment();
+        nah::overrides::apply_overrides(result, host_env);
+    }
 
     // Add any extra args from command line
     for (const auto& arg : run_opts.args) {
@@ -140,6 +145,7 @@ void setup_run(CLI::App* app, GlobalOptions& opts) {
     app->add_option("target", run_opts.target, "App to run (id or id@version)")->required();
     app->add_option("args", run_opts.args, "Arguments to pass to the app");
     app->add_option("--loader", run_opts.loader, "Loader to use (overrides install record)");
+    app->add_flag("--no-cache", run_opts.no_cache, "Recompose the launch contract instead of using the cache");
 
     // Allow -- to separate nah args from app args
     app->allow_extras();
@@ -27,24 +27,15 @@ namespace nah::cli::commands
                 opts.root.empty() ? std::nullopt : std::make_optional(opts.root));
             auto paths = get_nah_paths(nah_root);
 
+            // Served from registry/index.bin; falls back to reading the records
+            auto index = nah::registry::load_or_scan(nah_root);
+
             // If no target, show overview
             if (show_opts.target.empty())
             {
                 // Overview mode
-                auto app_files = nah::fs::list_directory(paths.registry_apps);
-                auto nak_files = nah::fs::list_directory(paths.registry_naks);
-
-                int app_count = 0, nak_count = 0;
-                for (const auto &f : app_files)
-                {
-                    if (f.size() > 5 && f.substr(f.size() - 5) == ".json")
-                        app_count++;
-                }
-                for (const auto &f : nak_files)
-                {
-                    if (f.size() > 5 && f.substr(f.size() - 5) == ".json")
-                        nak_count++;
-                }
+                size_t app_count = index.apps.size();
+                size_t nak_count = index.naks.size();
 
                 // Check if host.json exists
                 bool has_host_config = nah::fs::exists(paths.host + "/host.json");
@@ -74,31 +65,12 @@ namespace nah::cli::commands
             // Contract mode - show launch contract for an app
             auto parsed = parse_target(show_opts.target);
 
-            // Find the app install record (files named: id@version.json)
+            // Find the app install record (latest version if none given)
             std::string record_path;
-            if (parsed.version)
+            const auto *entry = index.find_app(parsed.id, parsed.version ? *parsed.version : "");
+            if (entry)
             {
-                record_path = paths.registry_apps + "/" + parsed.id + "@" + *parsed.version + ".json";
-            }
-            else
-            {
-                // Find any version
-                auto files = nah::fs::list_directory(paths.registry_apps);
-                for (const auto &filepath : files)
-                {
-                    // Extract filename from full path
-                    std::string f = filepath;
-                    size_t last_slash = filepath.rfind('/');
-                    if (last_slash != std::string::npos)
-                    {
-                        f = filepath.substr(last_slash + 1);
-                    }
-                    if (f.find(parsed.id + "@") == 0 && f.size() > 5 && f.substr(f.size() - 5) == ".json")
-                    {
-                        record_path = filepath;
-                        break;
-                    }
-                }
+                record_path = nah::fs::join_paths(paths.registry_apps, entry->record_file);
             }
 
             if (record_path.empty() || !nah::fs::exists(record_path))
@@ -122,8 +94,15 @@ namespace nah::cli::commands
                 return 1;
             }
 
+            // Records store install_root relative to the NAH root
+            auto &install_root = install_result.value.paths.install_root;
+            if (!install_root.empty() && !nah::fs::is_absolute_path(install_root))
+            {
+                install_root = nah::fs::absolute_path(nah::fs::join_paths(nah_root, install_root));
+            }
+
             // Load app manifest from install directory
-            std::string app_dir = install_result.value.paths.install_root;
+            std::string app_dir = install_root;
             auto manifest_content = nah::fs::read_file(app_dir + "/nap.json");
 
             if (!manifest_content)
@@ -155,9 +134,21 @@ namespace nah::cli::commands
                 inventory,
                 compose_opts);
 
+            const auto &provenance = install_result.value.provenance;
             if (opts.json)
             {
-                std::cout << nah::core::serialize_result(result) << std::endl;
+                // The composition result, plus the install's provenance
+                auto write_provenance = [&](nah::core::json::Writer &w)
+                {
+                    w.key("provenance", 2).raw("{\n");
+                    w.key("package_hash", 4).string(provenance.package_hash).raw(",\n");
+                    w.key("installed_at", 4).string(provenance.installed_at).raw(",\n");
+                    w.key("source", 4).string(provenance.source).raw("\n");
+                    w.raw("  }");
+                };
+                nah::core::json::Writer out(stdout);
+                nah::core::write_result(out, result, write_provenance);
+                out.raw("\n");
             }
             else
             {
@@ -181,6 +172,11 @@ namespace nah::cli::commands
                     std::cout << "NAK: " << contract.nak.id << " v" << contract.nak.version << std::endl;
                 }
 
+                if (!provenance.package_hash.empty())
+                {
+                    std::cout << "Package: " << provenance.package_hash << std::endl;
+                }
+
                 std::cout << "Binary: " << contract.execution.binary << std::endl;
                 std::cout << "CWD: " << contract.execution.cwd << std::endl;
 
@@ -223,7 +219,7 @@ namespace nah::cli::commands
                             std::cout << "\nEnvironment (other):" << std::endl;
                             has_other = true;
                         }
-                        std::string display_value = value.size() > 60 ? value.substr(0, 57) + "..." : value;
+                        std::string display_value = value.size() > 60 ? std::string(value.substr(0, 57)) + "..." : std::string(value);
                         std::cout << "  " << key << "=" << display_value << std::endl;
                     }
                 }
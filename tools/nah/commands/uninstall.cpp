@@ -5,6 +5,7 @@
  */
 
 #include "../common.hpp"
+#include "../digests.hpp"
 #include <CLI/CLI.hpp>
 #include <filesystem>
 
@@ -27,7 +28,20 @@ int cmd_uninstall(const GlobalOptions& opts, const UninstallOptions& uninstall_o
     auto paths = get_nah_paths(nah_root);
     
     auto parsed = parse_target(uninstall_opts.target);
-    
+    std::string version_filter = parsed.version ? *parsed.version : "";
+
+    // Look targets up in the registry index (falls back to a scan when the
+    // persisted index is missing or stale)
+    auto index = nah::registry::load_or_scan(nah_root);
+
+    // Records store install roots relative to the NAH root
+    auto resolve_root = [&](const std::string& dir) {
+        if (dir.empty() || nah::fs::is_absolute_path(dir)) {
+            return dir;
+        }
+        return nah::fs::join_paths(nah_root, dir);
+    };
+
     // Determine type
     bool is_app = false;
     bool is_nak = false;
@@ -38,21 +52,8 @@ int cmd_uninstall(const GlobalOptions& opts, const UninstallOptions& uninstall_o
         is_nak = true;
     } else {
         // Auto-detect
-        auto app_files = nah::fs::list_directory(paths.registry_apps);
-        auto nak_files = nah::fs::list_directory(paths.registry_naks);
-
-        for (const auto& f : app_files) {
-            if (f.find(parsed.id + "@") == 0) {
-                is_app = true;
-                break;
-            }
-        }
-        for (const auto& f : nak_files) {
-            if (f.find(parsed.id + "@") == 0) {
-                is_nak = true;
-                break;
-            }
-        }
+        is_app = index.find_app(parsed.id) != nullptr;
+        is_nak = index.find_nak(parsed.id) != nullptr;
         
         if (is_app && is_nak) {
             print_error("Ambiguous target: " + parsed.id + " exists as both app and NAK. Use --app or --nak.", opts.json);
@@ -66,59 +67,33 @@ int cmd_uninstall(const GlobalOptions& opts, const UninstallOptions& uninstall_o
     }
     
     if (is_app) {
-        // Find the record (files named: id@version.json)
-        std::string record_path;
-        std::string version;
-        
-        if (parsed.version) {
-            record_path = paths.registry_apps + "/" + parsed.id + "@" + *parsed.version + ".json";
-            version = *parsed.version;
-        } else {
-            // Find any version
-            auto files = nah::fs::list_directory(paths.registry_apps);
-            for (const auto& filepath : files) {
-                std::string f = filepath;
-                size_t last_slash = filepath.rfind('/');
-                if (last_slash != std::string::npos) {
-                    f = filepath.substr(last_slash + 1);
-                }
-                if (f.find(parsed.id + "@") == 0 && f.size() > 5 && f.substr(f.size() - 5) == ".json") {
-                    record_path = filepath;
-                    // Extract version from filename: id@version.json
-                    auto at_pos = f.find('@');
-                    version = f.substr(at_pos + 1, f.size() - at_pos - 6);
-                    break;
-                }
-            }
-        }
+        const auto* entry = index.find_app(parsed.id, version_filter);
+        std::string record_path = entry ? nah::fs::join_paths(paths.registry_apps, entry->record_file) : "";
         
         if (record_path.empty() || !nah::fs::exists(record_path)) {
             print_error("App not installed: " + uninstall_opts.target, opts.json);
             return 1;
         }
+        std::string version = entry->version;
         
-        // Read record to get install path
-        auto content = nah::fs::read_file(record_path);
-        if (content) {
-            try {
-                auto record = nlohmann::json::parse(*content);
-                std::string install_dir = record["paths"]["install_root"].get<std::string>();
-                
-                // Remove install directory
-                if (nah::fs::exists(install_dir)) {
-                    std::error_code ec;
-                    std::filesystem::remove_all(install_dir, ec);
-                    if (ec) {
-                        print_warning("Could not fully remove install directory: " + ec.message(), opts.json);
-                    }
-                }
-            } catch (const std::exception& e) {
-                print_warning("Could not parse install record to find install directory: " + std::string(e.what()), opts.json);
+        // Remove install directory
+        std::string install_dir = resolve_root(entry->install_root);
+        if (!install_dir.empty() && nah::fs::exists(install_dir)) {
+            std::error_code ec;
+            std::filesystem::remove_all(install_dir, ec);
+            if (ec) {
+                print_warning("Could not fully remove install directory: " + ec.message(), opts.json);
             }
         }
         
-        // Remove record
+        // Remove record, digest manifest and any cached launch contract
+        nah::registry::IndexLock index_lock(nah_root);
         nah::fs::remove_file(record_path);
+        nah::fs::remove_file(digests::manifest_path(nah_root, nah::registry::EntryKind::App, entry->record_file));
+        nah::registry::update_index(index_lock, [&](nah::registry::RegistryIndex& idx) {
+            idx.remove(nah::registry::EntryKind::App, parsed.id, version);
+        });
+        nah::registry::remove_cached_result(nah_root, parsed.id, version);
         
         if (opts.json) {
             nlohmann::json j;
@@ -130,52 +105,21 @@ int cmd_uninstall(const GlobalOptions& opts, const UninstallOptions& uninstall_o
             std::cout << "Uninstalled " << parsed.id << "@" << version << std::endl;
         }
     } else {
-        // NAK uninstall (files named: id@version.json)
-        std::string record_path;
-        std::string version;
-        
-        if (parsed.version) {
-            record_path = paths.registry_naks + "/" + parsed.id + "@" + *parsed.version + ".json";
-            version = *parsed.version;
-        } else {
-            auto files = nah::fs::list_directory(paths.registry_naks);
-            for (const auto& filepath : files) {
-                std::string f = filepath;
-                size_t last_slash = filepath.rfind('/');
-                if (last_slash != std::string::npos) {
-                    f = filepath.substr(last_slash + 1);
-                }
-                if (f.find(parsed.id + "@") == 0 && f.size() > 5 && f.substr(f.size() - 5) == ".json") {
-                    record_path = filepath;
-                    auto at_pos = f.find('@');
-                    version = f.substr(at_pos + 1, f.size() - at_pos - 6);
-                    break;
-                }
-            }
-        }
+        const auto* entry = index.find_nak(parsed.id, version_filter);
+        std::string record_path = entry ? nah::fs::join_paths(paths.registry_naks, entry->record_file) : "";
         
         if (record_path.empty() || !nah::fs::exists(record_path)) {
             print_error("NAK not installed: " + uninstall_opts.target, opts.json);
             return 1;
         }
+        std::string version = entry->version;
         
         // Check if any apps reference this NAK
         if (!uninstall_opts.force) {
-            auto app_files = nah::fs::list_directory(paths.registry_apps);
             std::vector<std::string> referencing_apps;
-
-            for (const auto& f : app_files) {
-                if (f.substr(f.size() - 5) == ".json") {
-                    auto app_content = nah::fs::read_file(paths.registry_apps + "/" + f);
-                    if (app_content) {
-                        try {
-                            auto app_record = nlohmann::json::parse(*app_content);
-                            if (app_record.contains("nak") &&
-                                app_record["nak"].value("id", "") == parsed.id) {
-                                referencing_apps.push_back(f.substr(0, f.size() - 5));
-                            }
-                        } catch (...) {}
-                    }
+            for (const auto& app : index.apps) {
+                if (app.nak_pin.id == parsed.id) {
+                    referencing_apps.push_back(app.id + "@" + app.version);
                 }
             }
             
@@ -191,27 +135,23 @@ int cmd_uninstall(const GlobalOptions& opts, const UninstallOptions& uninstall_o
             }
         }
         
-        // Read record to get install path
-        auto content = nah::fs::read_file(record_path);
-        if (content) {
-            try {
-                auto record = nlohmann::json::parse(*content);
-                std::string install_dir = record["paths"]["root"].get<std::string>();
-                
-                if (nah::fs::exists(install_dir)) {
-                    std::error_code ec;
-                    std::filesystem::remove_all(install_dir, ec);
-                    if (ec) {
-                        print_warning("Could not fully remove NAK directory: " + ec.message(), opts.json);
-                    }
-                }
-            } catch (const std::exception& e) {
-                print_warning("Could not parse NAK record to find install directory: " + std::string(e.what()), opts.json);
+        // Remove NAK directory
+        std::string install_dir = resolve_root(entry->install_root);
+        if (!install_dir.empty() && nah::fs::exists(install_dir)) {
+            std::error_code ec;
+            std::filesystem::remove_all(install_dir, ec);
+            if (ec) {
+                print_warning("Could not fully remove NAK directory: " + ec.message(), opts.json);
             }
         }
         
-        // Remove record
+        // Remove record and digest manifest
+        nah::registry::IndexLock index_lock(nah_root);
         nah::fs::remove_file(record_path);
+        nah::fs::remove_file(digests::manifest_path(nah_root, nah::registry::EntryKind::Nak, entry->record_file));
+        nah::registry::update_index(index_lock, [&](nah::registry::RegistryIndex& idx) {
+            idx.remove(nah::registry::EntryKind::Nak, parsed.id, version);
+        });
         
         if (opts.json) {
             nlohmann::json j;
@@ -0,0 +1,312 @@
+/**
+ * NAH CLI - verify command
+ *
+ * Check installed apps and NAKs against the digest manifests recorded
+ * when they were installed.
+ */
+
+#include "../common.hpp"
+#include "../digests.hpp"
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+namespace nah::cli::commands {
+
+namespace {
+
+struct VerifyOptions {
+    std::string target;
+    bool all = false;
+    bool as_app = false;
+    bool as_nak = false;
+    size_t jobs = 0;
+};
+
+// One install being verified
+struct Target {
+    const nah::registry::IndexEntry* entry = nullptr;
+    std::string install_dir;
+    std::optional<digests::FileDigests> expected;  // nullopt: no usable digest manifest
+    std::vector<std::string> present;              // Files found in the installed tree
+    std::vector<std::string> modified;
+    std::vector<std::string> missing;
+    std::vector<std::string> added;
+    std::vector<std::string> unreadable;
+
+    bool ok() const {
+        return expected && modified.empty() && missing.empty() && added.empty() && unreadable.empty();
+    }
+};
+
+// A file found in both the manifest and the tree, to be hashed
+struct Job {
+    size_t target;
+    std::string path;
+};
+
+std::string label(const nah::registry::IndexEntry& entry) {
+    return std::string(entry.kind == nah::registry::EntryKind::Nak ? "NAK " : "") + entry.id + "@" + entry.version;
+}
+
+// Stamp verification.last_verified_at into an App Install Record
+bool stamp_record(const std::string& record_path, const std::string& verified_at) {
+    auto content = nah::fs::read_file(record_path);
+    if (!content) {
+        return false;
+    }
+    try {
+        auto record = nlohmann::json::parse(*content);
+        record["verification"]["last_verified_at"] = verified_at;
+        record["verification"]["last_verifier_version"] = NAH_VERSION;
+        return nah::fs::write_file_atomic(record_path, record.dump(2));
+    } catch (...) {
+        return false;
+    }
+}
+
+int cmd_verify(const GlobalOptions& opts, const VerifyOptions& verify_opts) {
+    init_warning_collector(opts.json, opts.quiet);
+
+    if (verify_opts.all == !verify_opts.target.empty()) {
+        print_error("Specify a package to verify or --all", opts.json);
+        return 1;
+    }
+
+    std::string nah_root = resolve_nah_root(
+        opts.root.empty() ? std::nullopt : std::make_optional(opts.root));
+    auto paths = get_nah_paths(nah_root);
+    auto index = nah::registry::load_or_scan(nah_root);
+
+    // Records store install roots relative to the NAH root
+    auto resolve_root = [&](const std::string& dir) {
+        if (dir.empty() || nah::fs::is_absolute_path(dir)) {
+            return dir;
+        }
+        return nah::fs::join_paths(nah_root, dir);
+    };
+
+    // Select installs: every version of the target id unless one is given
+    auto parsed = parse_target(verify_opts.target);
+    auto selected = [&](const nah::registry::IndexEntry& entry) {
+        return verify_opts.all ||
+               (entry.id == parsed.id && (!parsed.version || entry.version == *parsed.version));
+    };
+    bool want_apps = !verify_opts.as_nak;
+    bool want_naks = !verify_opts.as_app;
+
+    std::vector<Target> targets;
+    if (want_apps) {
+        for (const auto& entry : index.apps) {
+            if (selected(entry)) {
+                targets.emplace_back().entry = &entry;
+            }
+        }
+    }
+    if (want_naks) {
+        for (const auto& entry : index.naks) {
+            if (selected(entry)) {
+                targets.emplace_back().entry = &entry;
+            }
+        }
+    }
+
+    if (targets.empty() && !verify_opts.all) {
+        print_error("Package not found: " + verify_opts.target, opts.json);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Load manifests and walk the trees, one install per task
+    nah::core::detail::parallel_for(targets.size(), verify_opts.jobs, [&](size_t i) {
+        auto& target = targets[i];
+        target.install_dir = resolve_root(target.entry->install_root);
+        target.expected = digests::read_manifest(
+            digests::manifest_path(nah_root, target.entry->kind, target.entry->record_file));
+        if (!target.expected) {
+            return;
+        }
+
+        // A missing or unreadable tree leaves `present` empty: every file
+        // is reported missing
+        digests::list_tree(target.install_dir, target.present);
+
+        auto expected_names = [&]() {
+            std::vector<std::string> names;
+            names.reserve(target.expected->size());
+            for (const auto& [file, hex] : *target.expected) {
+                names.push_back(file);
+            }
+            return names;
+        }();
+        std::set_difference(expected_names.begin(), expected_names.end(), target.present.begin(),
+                            target.present.end(), std::back_inserter(target.missing));
+        std::set_difference(target.present.begin(), target.present.end(), expected_names.begin(),
+                            expected_names.end(), std::back_inserter(target.added));
+    });
+
+    // Hash every file that should be there, across all installs at once so
+    // that one large tree does not leave the other workers idle
+    std::vector<Job> jobs;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (!targets[i].expected) {
+            continue;
+        }
+        for (const auto& file : targets[i].present) {
+            if (targets[i].expected->count(file)) {
+                jobs.push_back({i, file});
+            }
+        }
+    }
+
+    std::vector<std::string> job_paths;
+    job_paths.reserve(jobs.size());
+    for (const auto& job : jobs) {
+        job_paths.push_back(nah::fs::join_paths(targets[job.target].install_dir, job.path));
+    }
+    auto hashed = digests::hash_files(job_paths, verify_opts.jobs);
+
+    std::uint64_t bytes = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        auto& target = targets[jobs[i].target];
+        if (!hashed[i].ok) {
+            target.unreadable.push_back(jobs[i].path);
+        } else if (hashed[i].hex != target.expected->at(jobs[i].path)) {
+            target.modified.push_back(jobs[i].path);
+        }
+        bytes += hashed[i].size;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Stamp the records of apps that passed
+    std::string verified_at = get_current_timestamp();
+    std::vector<std::string> passed_records;
+    for (const auto& target : targets) {
+        if (target.ok() && target.entry->kind == nah::registry::EntryKind::App) {
+            passed_records.push_back(nah::fs::join_paths(paths.registry_apps, target.entry->record_file));
+        }
+    }
+    if (!passed_records.empty()) {
+        nah::registry::IndexLock index_lock(nah_root);
+        for (const auto& record_path : passed_records) {
+            if (!stamp_record(record_path, verified_at)) {
+                print_warning("Failed to update install record: " + record_path, opts.json);
+            }
+        }
+
+        // Only the verification sections changed: restamp the index
+        // instead of leaving it stale
+        nah::registry::update_index(index_lock, [](nah::registry::RegistryIndex&) {});
+    }
+
+    // Installs without a manifest cannot be checked, but are not failures:
+    // trees installed before digest manifests existed would otherwise never
+    // pass verify --all
+    size_t failed = 0;
+    size_t no_digests = 0;
+    size_t files = 0;
+    for (const auto& target : targets) {
+        if (!target.expected) {
+            ++no_digests;
+            continue;
+        }
+        if (!target.ok()) {
+            ++failed;
+        }
+        files += target.expected->size();
+    }
+
+    if (opts.json) {
+        nlohmann::json j;
+        j["ok"] = failed == 0;
+        j["verified_at"] = verified_at;
+        j["installs"] = targets.size();
+        j["failed"] = failed;
+        j["no_digests"] = no_digests;
+        j["files"] = files;
+        j["bytes"] = bytes;
+        j["results"] = nlohmann::json::array();
+        for (const auto& target : targets) {
+            nlohmann::json r;
+            r["type"] = target.entry->kind == nah::registry::EntryKind::App ? "app" : "nak";
+            r["id"] = target.entry->id;
+            r["version"] = target.entry->version;
+            if (!target.expected) {
+                r["status"] = "no_digests";
+            } else {
+                r["status"] = target.ok() ? "ok" : "failed";
+                r["files"] = target.expected->size();
+                r["modified"] = target.modified;
+                r["missing"] = target.missing;
+                r["added"] = target.added;
+                r["unreadable"] = target.unreadable;
+            }
+            j["results"].push_back(r);
+        }
+        output_json(j);
+        return failed == 0 ? 0 : 1;
+    }
+
+    if (targets.empty()) {
+        std::cout << "Nothing installed" << std::endl;
+        return 0;
+    }
+
+    for (const auto& target : targets) {
+        if (!target.expected) {
+            std::cout << "NO DIGESTS " << label(*target.entry)
+                      << " (installed without a digest manifest; reinstall to record one)" << std::endl;
+            continue;
+        }
+        std::cout << (target.ok() ? "OK     " : "FAILED ") << label(*target.entry) << " ("
+                  << target.expected->size() << " files)" << std::endl;
+        auto list = [](const char* what, const std::vector<std::string>& names) {
+            for (const auto& name : names) {
+                std::cout << "  " << what << name << std::endl;
+            }
+        };
+        list("modified:   ", target.modified);
+        list("missing:    ", target.missing);
+        list("added:      ", target.added);
+        list("unreadable: ", target.unreadable);
+    }
+
+    if (!opts.quiet) {
+        char rate[64];
+        std::snprintf(rate, sizeof(rate), "%.1f MiB in %.2fs, %.0f MiB/s",
+                      static_cast<double>(bytes) / (1 << 20), seconds,
+                      seconds > 0 ? static_cast<double>(bytes) / (1 << 20) / seconds : 0.0);
+        std::cout << "Verified " << targets.size() << (targets.size() == 1 ? " install, " : " installs, ")
+                  << files << " files (" << rate << ")";
+        if (failed > 0) {
+            std::cout << ": " << failed << " failed";
+        }
+        if (no_digests > 0) {
+            std::cout << (failed > 0 ? ", " : ": ") << no_digests << " without digests";
+        }
+        std::cout << std::endl;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
+
+} // anonymous namespace
+
+void setup_verify(CLI::App* app, GlobalOptions& opts) {
+    static VerifyOptions verify_opts;
+
+    app->add_option("target", verify_opts.target, "Package to verify (id or id@version)");
+    app->add_flag("--all", verify_opts.all, "Verify every installed app and NAK");
+    app->add_flag("--app", verify_opts.as_app, "Only verify apps");
+    app->add_flag("--nak", verify_opts.as_nak, "Only verify NAKs");
+    app->add_option("-j,--jobs", verify_opts.jobs, "Files hashed in parallel (default: hardware threads)");
+
+    app->callback([&opts]() {
+        std::exit(cmd_verify(opts, verify_opts));
+    });
+}
+
+} // namespace nah::cli::commands
@@ -0,0 +1,184 @@
+/**
+ * NAH CLI - Installed tree digests
+ *
+ * Every install gets a digest manifest in the registry,
+ * registry/digests/{apps,naks}/<id>@<version>.json, holding the SHA-256
+ * of each regular file in the installed tree by relative path. nah verify
+ * hashes the tree again and compares. Files are read through
+ * nah::fs::read_file_view (mmap for anything past a few pages) and hashed
+ * one file per task on a thread pool, so a tree of many files keeps every
+ * core busy and enough reads in flight to saturate fast storage.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nah/nah_core.h>
+#include <nah/nah_fs.h>
+#include <nah/nah_registry.h>
+#include <nlohmann/json.hpp>
+
+#include "sha256.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>  // For madvise()
+#endif
+
+namespace nah::cli::digests {
+
+/**
+ * Hex SHA-256 of each file, keyed by path relative to the install root
+ * with '/' separators.
+ */
+using FileDigests = std::map<std::string, std::string>;
+
+/**
+ * Path of the digest manifest for the install whose registry record is
+ * `record_file` ("<id>@<version>.json").
+ */
+inline std::string manifest_path(const std::string& nah_root, nah::registry::EntryKind kind,
+                                 const std::string& record_file) {
+    return nah::fs::join_paths(nah_root, "registry", "digests",
+                               kind == nah::registry::EntryKind::App ? "apps" : "naks", record_file);
+}
+
+/**
+ * List the regular files under `root` (following symlinks), relative and
+ * sorted. Returns false if the tree cannot be walked.
+ */
+inline bool list_tree(const std::string& root, std::vector<std::string>& files) {
+    namespace stdfs = std::filesystem;
+    std::error_code ec;
+    stdfs::recursive_directory_iterator it(root, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            files.push_back(it->path().lexically_relative(root).generic_string());
+        }
+    }
+    if (ec) {
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+/**
+ * Outcome of hashing one file.
+ */
+struct HashedFile {
+    bool ok = false;  // false if the file could not be opened or read
+    std::uint64_t size = 0;
+    std::string hex;
+};
+
+inline HashedFile hash_file(const std::string& path) {
+    HashedFile result;
+    auto view = nah::fs::read_file_view(path);
+    if (!view) {
+        return result;
+    }
+#ifndef _WIN32
+    if (view->mapped()) {
+        // One front-to-back pass: ask for aggressive read-ahead
+        ::madvise(const_cast<char*>(view->data()), view->size(), MADV_SEQUENTIAL);
+    }
+#endif
+    sha256::Sha256 hash;
+    hash.update(view->data(), view->size());
+    result.ok = true;
+    result.size = view->size();
+    result.hex = sha256::to_hex(hash.finish());
+    return result;
+}
+
+/**
+ * Hash `paths` on up to `workers` threads (0 = hardware concurrency).
+ * Results are in the same order as `paths`.
+ */
+inline std::vector<HashedFile> hash_files(const std::vector<std::string>& paths, size_t workers = 0) {
+    std::vector<HashedFile> results(paths.size());
+    nah::core::detail::parallel_for(paths.size(), workers, [&](size_t i) {
+        results[i] = hash_file(paths[i]);
+    });
+    return results;
+}
+
+/**
+ * Hash every regular file under `root`. Returns nullopt if the tree cannot
+ * be walked or a file cannot be read; `error` names the culprit.
+ */
+inline std::optional<FileDigests> hash_tree(const std::string& root, size_t workers = 0,
+                                            std::string* error = nullptr) {
+    std::vector<std::string> files;
+    if (!list_tree(root, files)) {
+        if (error) *error = "Failed to list " + root;
+        return std::nullopt;
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(files.size());
+    for (const auto& file : files) {
+        paths.push_back(nah::fs::join_paths(root, file));
+    }
+    auto hashed = hash_files(paths, workers);
+
+    FileDigests digests;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!hashed[i].ok) {
+            if (error) *error = "Failed to read " + paths[i];
+            return std::nullopt;
+        }
+        digests.emplace_hint(digests.end(), files[i], std::move(hashed[i].hex));
+    }
+    return digests;
+}
+
+/**
+ * Write a digest manifest atomically, creating registry/digests as needed.
+ */
+inline bool write_manifest(const std::string& path, const FileDigests& digests) {
+    nlohmann::json j;
+    j["algorithm"] = "sha256";
+    j["files"] = nlohmann::json::object();
+    for (const auto& [file, hex] : digests) {
+        j["files"][file] = hex;
+    }
+    return nah::fs::create_directories(nah::fs::parent_path(path)) &&
+           nah::fs::write_file_atomic(path, j.dump(2));
+}
+
+/**
+ * Read a digest manifest. Returns nullopt if it is missing, malformed or
+ * uses an algorithm other than sha256.
+ */
+inline std::optional<FileDigests> read_manifest(const std::string& path) {
+    auto content = nah::fs::read_file_view(path);
+    if (!content) {
+        return std::nullopt;
+    }
+    try {
+        auto j = nlohmann::json::parse(content->data(), content->data() + content->size());
+        if (j.value("algorithm", "") != "sha256" || !j.contains("files") || !j["files"].is_object()) {
+            return std::nullopt;
+        }
+        FileDigests digests;
+        for (const auto& [file, hex] : j["files"].items()) {
+            if (!hex.is_string()) {
+                return std::nullopt;
+            }
+            digests.emplace(file, hex.get<std::string>());
+        }
+        return digests;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+} // namespace nah::cli::digests
@@ -17,6 +17,7 @@ namespace nah::cli::commands {
     void setup_show(CLI::App* app, GlobalOptions& opts);
     void setup_which(CLI::App* app, GlobalOptions& opts);
     void setup_pack(CLI::App* app, GlobalOptions& opts);
+    void setup_verify(CLI::App* app, GlobalOptions& opts);
     void register_launch_command(CLI::App& app, GlobalOptions& opts);
     void register_components_command(CLI::App& app, GlobalOptions& opts);
 }
@@ -61,6 +62,9 @@ int main(int argc, char** argv) {
     
     auto* pack_cmd = app.add_subcommand("pack", "Create a .nap or .nak package");
     commands::setup_pack(pack_cmd, opts);
+
+    auto* verify_cmd = app.add_subcommand("verify", "Check installed files against their recorded digests");
+    commands::setup_verify(verify_cmd, opts);
     
     // Component commands
     commands::register_launch_command(app, opts);
@@ -0,0 +1,1344 @@
+/**
+ * NAH CLI - Package streaming
+ *
+ * .nap and .nak packages are gzip- or zstd-compressed tar archives.
+ * Installing one streams it: the file is read in chunks, each chunk is
+ * decompressed, and the output drives an incremental tar extractor that
+ * writes files as their data arrives. Memory use is a few fixed buffers,
+ * whatever the package size. nah pack writes block-gzip by default, which
+ * is still plain gzip but lets both ends work on many blocks at once, or
+ * zstd on request, which decompresses several times faster than inflate.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <nah/nah_core.h>
+
+#include "sha256.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>  // For chmod()
+#endif
+
+namespace nah::cli::package {
+
+/**
+ * Size of the read and inflate buffers used while streaming a package.
+ */
+constexpr size_t STREAM_CHUNK = 256 * 1024;
+
+constexpr size_t TAR_BLOCK = 512;
+
+namespace detail {
+
+// Parse a NUL/space terminated octal tar header field
+inline std::optional<std::uint64_t> parse_octal(const uint8_t* field, size_t size) {
+    size_t i = 0;
+    while (i < size && field[i] == ' ') {
+        ++i;
+    }
+    std::uint64_t value = 0;
+    bool digits = false;
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = (value << 3) | static_cast<std::uint64_t>(field[i] - '0');
+        digits = true;
+    }
+    if (i < size && field[i] != '\0' && field[i] != ' ') {
+        return std::nullopt;
+    }
+    return digits ? std::optional<std::uint64_t>(value) : std::nullopt;
+}
+
+// Whether an entry name stays inside the extraction root: relative, and
+// without ".." components
+inline bool is_safe_entry_path(std::string_view name) {
+    if (name.empty() || name[0] == '/' || name[0] == '\\' ||
+        (name.size() >= 2 && name[1] == ':')) {
+        return false;
+    }
+    size_t start = 0;
+    while (start <= name.size()) {
+        size_t end = name.find_first_of("/\\", start);
+        if (end == std::string_view::npos) {
+            end = name.size();
+        }
+        if (name.substr(start, end - start) == "..") {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+} // namespace detail
+
+// ============================================================================
+// TAR
+// ============================================================================
+//
+// Shared by the extractor and the writer. Entries are ustar; names that do
+// not fit ustar's name/prefix fields, and sizes beyond its 11 octal digits,
+// go in a pax extended header ('x') ahead of the entry. The extractor also
+// understands GNU long names ('L'), as written by GNU tar.
+
+namespace tar {
+
+// Header field offsets and sizes
+constexpr size_t NAME = 0, NAME_LEN = 100;
+constexpr size_t MODE = 100, MODE_LEN = 8;
+constexpr size_t UID = 108, GID = 116, ID_LEN = 8;
+constexpr size_t SIZE = 124, SIZE_LEN = 12;
+constexpr size_t MTIME = 136, MTIME_LEN = 12;
+constexpr size_t CHKSUM = 148, CHKSUM_LEN = 8;
+constexpr size_t TYPEFLAG = 156;
+constexpr size_t MAGIC = 257;  // "ustar\0" then version "00"
+constexpr size_t PREFIX = 345, PREFIX_LEN = 155;
+
+// Largest size that fits the octal size field
+constexpr std::uint64_t MAX_OCTAL_SIZE = 077777777777ull;
+
+// Largest pax or GNU long-name payload the extractor buffers
+constexpr std::uint64_t MAX_META_SIZE = 1 << 20;
+
+} // namespace tar
+
+/**
+ * Incremental tar extractor. Feed it the archive in pieces of any size
+ * with write(), then call finish(). Regular files and directories are
+ * created under the destination directory; other entry types are skipped.
+ * Entries with absolute paths or ".." components are rejected. File modes
+ * come from the headers (0644 if a header has none).
+ */
+class TarExtractor {
+public:
+    explicit TarExtractor(std::string dest_dir) : dest_dir_(std::move(dest_dir)) {
+        std::error_code ec;
+        std::filesystem::create_directories(dest_dir_, ec);
+    }
+
+    TarExtractor(const TarExtractor&) = delete;
+    TarExtractor& operator=(const TarExtractor&) = delete;
+
+    /**
+     * Consume the next `size` bytes of the archive. Returns false once
+     * the archive is found corrupt or a file cannot be written.
+     */
+    bool write(const uint8_t* data, size_t size) {
+        while (size > 0 && ok_) {
+            size_t n = 0;
+            switch (state_) {
+                case State::Header:
+                    n = std::min(size, TAR_BLOCK - header_fill_);
+                    std::memcpy(header_ + header_fill_, data, n);
+                    header_fill_ += n;
+                    if (header_fill_ == TAR_BLOCK) {
+                        header_fill_ = 0;
+                        begin_entry();
+                    }
+                    break;
+
+                case State::Data:
+                    n = static_cast<size_t>(std::min<std::uint64_t>(size, remaining_));
+                    if (meta_type_) {
+                        meta_.append(reinterpret_cast<const char*>(data), n);
+                    } else if (file_.is_open()) {
+                        file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n));
+                        if (!file_) {
+                            fail("Failed to write " + file_path_.string());
+                        }
+                    }
+                    remaining_ -= n;
+                    if (remaining_ == 0) {
+                        end_entry();
+                    }
+                    break;
+
+                case State::Padding:
+                    n = static_cast<size_t>(std::min<std::uint64_t>(size, remaining_));
+                    remaining_ -= n;
+                    if (remaining_ == 0) {
+                        state_ = State::Header;
+                    }
+                    break;
+
+                case State::End:
+                    // Anything after the end-of-archive marker is ignored
+                    return true;
+            }
+            data += n;
+            size -= n;
+        }
+        return ok_;
+    }
+
+    /**
+     * Call once the whole archive has been written. Returns false if it
+     * ended in the middle of an entry.
+     */
+    bool finish() {
+        if (ok_ && (state_ == State::Data || state_ == State::Padding)) {
+            fail("Truncated archive entry: " + file_path_.string());
+        }
+        if (file_.is_open()) {
+            file_.close();
+        }
+        return ok_;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    enum class State { Header, Data, Padding, End };
+
+    void fail(std::string message) {
+        if (ok_) {
+            ok_ = false;
+            error_ = std::move(message);
+        }
+    }
+
+    void begin_entry() {
+        // End of archive: a zero block, or an entry without a name
+        bool all_zero = true;
+        for (size_t i = 0; i < TAR_BLOCK; ++i) {
+            if (header_[i] != 0) {
+                all_zero = false;
+                break;
+            }
+        }
+        if (all_zero || header_[0] == '\0') {
+            state_ = State::End;
+            return;
+        }
+
+        // A long name or pax path from the previous entry wins over the
+        // header's own fields
+        std::string name = std::move(next_path_);
+        next_path_.clear();
+        if (name.empty()) {
+            name = field(tar::NAME, tar::NAME_LEN);
+            if (std::memcmp(header_ + tar::MAGIC, "ustar", 5) == 0 && header_[tar::PREFIX] != '\0') {
+                name = field(tar::PREFIX, tar::PREFIX_LEN) + "/" + name;
+            }
+        }
+
+        auto size = detail::parse_octal(header_ + tar::SIZE, tar::SIZE_LEN);
+        if (next_size_) {
+            size = next_size_;
+            next_size_.reset();
+        }
+        if (!size) {
+            fail("Corrupt tar header: " + name);
+            return;
+        }
+        mode_ = static_cast<unsigned int>(detail::parse_octal(header_ + tar::MODE, tar::MODE_LEN).value_or(0));
+        remaining_ = *size;
+        padding_ = (TAR_BLOCK - *size % TAR_BLOCK) % TAR_BLOCK;
+
+        uint8_t typeflag = header_[tar::TYPEFLAG];
+        meta_type_ = 0;
+        if (typeflag == 'x' || typeflag == 'L') {
+            // Describes the next entry: buffer it
+            if (*size > tar::MAX_META_SIZE) {
+                fail("Oversized tar extended header: " + name);
+                return;
+            }
+            meta_type_ = typeflag;
+            meta_.clear();
+            start_data();
+            return;
+        }
+
+        if (!detail::is_safe_entry_path(name)) {
+            fail("Unsafe path in archive: " + name);
+            return;
+        }
+        file_path_ = std::filesystem::path(dest_dir_) / name;
+        std::error_code ec;
+
+        // Type: '0' or '\0' = regular file, '5' = directory
+        if (typeflag == '5') {
+            std::filesystem::create_directories(file_path_, ec);
+        } else if (typeflag == '0' || typeflag == '\0') {
+            std::filesystem::create_directories(file_path_.parent_path(), ec);
+            file_.open(file_path_, std::ios::binary | std::ios::trunc);
+            if (!file_) {
+                fail("Failed to create " + file_path_.string());
+                return;
+            }
+        }
+
+        start_data();
+    }
+
+    void start_data() {
+        if (remaining_ == 0) {
+            end_entry();
+        } else {
+            state_ = State::Data;
+        }
+    }
+
+    void end_entry() {
+        if (meta_type_) {
+            apply_meta();
+        } else if (file_.is_open()) {
+            file_.close();
+            if (!file_) {
+                fail("Failed to write " + file_path_.string());
+                return;
+            }
+
+            // Apply permissions from tar header
+            if (mode_ == 0) {
+                // If mode is 0, tar header might be corrupted or missing permissions
+                // Default to 0644 for regular files
+                mode_ = 0644;
+            }
+
+            // Use POSIX chmod directly on Unix-like systems for maximum compatibility
+            // Some filesystems (like Docker Desktop Mac's fakeowner) don't properly support
+            // std::filesystem::permissions(), but do support POSIX chmod()
+#ifdef _WIN32
+            std::error_code perm_ec;
+            std::filesystem::permissions(file_path_,
+                static_cast<std::filesystem::perms>(mode_),
+                std::filesystem::perm_options::replace,
+                perm_ec);
+#else
+            chmod(file_path_.string().c_str(), static_cast<mode_t>(mode_ & 07777));
+#endif
+        }
+
+        remaining_ = padding_;
+        state_ = remaining_ > 0 ? State::Padding : State::Header;
+    }
+
+    // Take the path (and size) for the next entry from a GNU long name or
+    // pax records ("<length> <key>=<value>\n"); other pax keys are ignored
+    void apply_meta() {
+        if (meta_type_ == 'L') {
+            next_path_ = meta_.substr(0, meta_.find('\0'));
+        } else {
+            size_t pos = 0;
+            while (pos < meta_.size()) {
+                size_t space = meta_.find(' ', pos);
+                if (space == std::string::npos) {
+                    fail("Corrupt pax header");
+                    return;
+                }
+                auto length = std::strtoull(meta_.c_str() + pos, nullptr, 10);
+                if (length <= space - pos + 1 || pos + length > meta_.size() || meta_[pos + length - 1] != '\n') {
+                    fail("Corrupt pax header");
+                    return;
+                }
+                std::string_view record(meta_.data() + space + 1, pos + length - space - 2);
+                size_t eq = record.find('=');
+                if (eq != std::string_view::npos) {
+                    auto key = record.substr(0, eq);
+                    auto value = record.substr(eq + 1);
+                    if (key == "path") {
+                        next_path_ = std::string(value);
+                    } else if (key == "size") {
+                        next_size_ = std::strtoull(std::string(value).c_str(), nullptr, 10);
+                    }
+                }
+                pos += length;
+            }
+        }
+        meta_type_ = 0;
+        meta_.clear();
+    }
+
+    std::string field(size_t offset, size_t length) const {
+        const char* begin = reinterpret_cast<const char*>(header_ + offset);
+        return std::string(begin, strnlen(begin, length));
+    }
+
+    std::string dest_dir_;
+    State state_ = State::Header;
+    uint8_t header_[TAR_BLOCK] = {};
+    size_t header_fill_ = 0;
+    std::uint64_t remaining_ = 0;
+    std::uint64_t padding_ = 0;
+    unsigned int mode_ = 0;
+    std::filesystem::path file_path_;
+    std::ofstream file_;
+    uint8_t meta_type_ = 0;  // 'x' or 'L' while buffering one
+    std::string meta_;
+    std::string next_path_;
+    std::optional<std::uint64_t> next_size_;
+    bool ok_ = true;
+    std::string error_;
+};
+
+/**
+ * Deterministic tar writer. Headers are ustar with uid/gid 0, empty
+ * owner names and mtime 0, so the archive depends only on the names,
+ * modes and contents given; see SPEC.md "Deterministic Packaging".
+ * Output goes to `sink(data, size)`, which returns false on failure.
+ */
+class TarWriter {
+public:
+    using Sink = std::function<bool(const uint8_t*, size_t)>;
+
+    explicit TarWriter(Sink sink) : sink_(std::move(sink)) {}
+
+    /**
+     * Add a directory entry; `name` is relative, without a trailing slash.
+     */
+    bool add_directory(const std::string& name, unsigned int mode) {
+        return write_header(name + "/", mode, 0, '5');
+    }
+
+    /**
+     * Add a regular file, streaming `size` bytes from `source` in
+     * STREAM_CHUNK pieces. Fails if the file does not have exactly `size`
+     * bytes, e.g. because it changed while being packed.
+     */
+    bool add_file(const std::string& name, unsigned int mode, std::istream& source, std::uint64_t size) {
+        if (!write_header(name, mode, size, '0')) {
+            return false;
+        }
+        buffer_.resize(STREAM_CHUNK);
+        std::uint64_t left = size;
+        while (left > 0) {
+            auto n = static_cast<size_t>(std::min<std::uint64_t>(left, buffer_.size()));
+            source.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(n));
+            if (static_cast<size_t>(source.gcount()) != n || !sink_(buffer_.data(), n)) {
+                return false;
+            }
+            left -= n;
+        }
+        return pad(size);
+    }
+
+    /**
+     * Write the end-of-archive marker (two zero blocks).
+     */
+    bool finish() {
+        static const uint8_t zeros[2 * TAR_BLOCK] = {};
+        return sink_(zeros, sizeof(zeros));
+    }
+
+private:
+    bool write_header(const std::string& name, unsigned int mode, std::uint64_t size, char typeflag) {
+        uint8_t header[TAR_BLOCK] = {};
+
+        // ustar splits long names at a '/' into prefix and name
+        std::string prefix;
+        std::string short_name = name;
+        if (name.size() > tar::NAME_LEN) {
+            // The last '/' that keeps the prefix short enough; if the rest is
+            // still too long, no split works
+            size_t split = name.rfind('/', std::min(name.size() - 2, tar::PREFIX_LEN));
+            if (split != std::string::npos && split > 0 && name.size() - split - 1 <= tar::NAME_LEN) {
+                prefix = name.substr(0, split);
+                short_name = name.substr(split + 1);
+            }
+        }
+
+        std::string pax;
+        if (short_name.size() > tar::NAME_LEN) {
+            pax += pax_record("path", name);
+            short_name = short_name.substr(0, tar::NAME_LEN);
+            prefix.clear();
+        }
+        if (size > tar::MAX_OCTAL_SIZE) {
+            pax += pax_record("size", std::to_string(size));
+        }
+        if (!pax.empty()) {
+            std::string pax_name = "PaxHeaders/" + short_name.substr(0, tar::NAME_LEN - 11);
+            if (!write_header(pax_name, 0644, pax.size(), 'x') ||
+                !sink_(reinterpret_cast<const uint8_t*>(pax.data()), pax.size()) || !pad(pax.size())) {
+                return false;
+            }
+        }
+
+        std::memcpy(header + tar::NAME, short_name.data(), short_name.size());
+        put_octal(header + tar::MODE, tar::MODE_LEN, mode & 07777);
+        put_octal(header + tar::UID, tar::ID_LEN, 0);
+        put_octal(header + tar::GID, tar::ID_LEN, 0);
+        put_octal(header + tar::SIZE, tar::SIZE_LEN, size > tar::MAX_OCTAL_SIZE ? 0 : size);
+        put_octal(header + tar::MTIME, tar::MTIME_LEN, 0);
+        header[tar::TYPEFLAG] = static_cast<uint8_t>(typeflag);
+        std::memcpy(header + tar::MAGIC, "ustar\0" "00", 8);
+        std::memcpy(header + tar::PREFIX, prefix.data(), prefix.size());
+
+        // Checksum: byte sum with the checksum field read as spaces
+        std::memset(header + tar::CHKSUM, ' ', tar::CHKSUM_LEN);
+        unsigned int sum = 0;
+        for (uint8_t byte : header) {
+            sum += byte;
+        }
+        put_octal(header + tar::CHKSUM, 7, sum);
+
+        return sink_(header, TAR_BLOCK);
+    }
+
+    bool pad(std::uint64_t size) {
+        static const uint8_t zeros[TAR_BLOCK] = {};
+        size_t padding = static_cast<size_t>((TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+        return padding == 0 || sink_(zeros, padding);
+    }
+
+    // Zero-padded octal, NUL terminated, filling `length` bytes
+    static void put_octal(uint8_t* field, size_t length, std::uint64_t value) {
+        field[length - 1] = '\0';
+        for (size_t i = length - 1; i-- > 0;) {
+            field[i] = static_cast<uint8_t>('0' + (value & 7));
+            value >>= 3;
+        }
+    }
+
+    // "<length> <key>=<value>\n", where length counts the whole record
+    static std::string pax_record(const std::string& key, const std::string& value) {
+        size_t body = key.size() + value.size() + 3;  // ' ', '=', '\n'
+        size_t length = body + 1;
+        while (std::to_string(length).size() + body != length) {
+            ++length;
+        }
+        return std::to_string(length) + " " + key + "=" + value + "\n";
+    }
+
+    Sink sink_;
+    std::vector<uint8_t> buffer_;
+};
+
+/**
+ * Add everything under `source_dir` to `tar` following SPEC.md's
+ * deterministic packaging rules: entries sorted by full path (so each
+ * directory precedes its contents), directories 0755, files 0755 if any
+ * execute bit is set or they are under bin/ and 0644 otherwise. Symlinks,
+ * hard links and special files make it fail. `exclude`, relative to
+ * `source_dir`, is skipped: the package itself when written inside the
+ * tree. Does not write the end-of-archive marker.
+ */
+inline bool write_tree(TarWriter& tar, const std::string& source_dir, std::string& error,
+                       const std::string& exclude = "") {
+    namespace stdfs = std::filesystem;
+
+    struct Entry {
+        std::string name;  // Relative, '/'-separated
+        bool directory;
+        std::uint64_t size;
+        unsigned int mode;
+    };
+    std::vector<Entry> entries;
+
+    std::error_code ec;
+    stdfs::recursive_directory_iterator it(source_dir, ec), end;
+    if (ec) {
+        error = "Cannot read directory: " + source_dir;
+        return false;
+    }
+    for (; it != end; it.increment(ec)) {
+        if (ec) {
+            error = "Cannot read directory: " + source_dir + ": " + ec.message();
+            return false;
+        }
+        std::string name = it->path().lexically_relative(source_dir).generic_string();
+        if (name == exclude) {
+            continue;
+        }
+
+        auto status = it->symlink_status(ec);
+        if (stdfs::is_symlink(status)) {
+            error = "Symlinks are not allowed in packages: " + name;
+            return false;
+        }
+        if (stdfs::is_directory(status)) {
+            entries.push_back({name, true, 0, 0755});
+        } else if (stdfs::is_regular_file(status)) {
+            if (it->hard_link_count(ec) > 1) {
+                error = "Hard links are not allowed in packages: " + name;
+                return false;
+            }
+            bool executable = (status.permissions() & (stdfs::perms::owner_exec | stdfs::perms::group_exec |
+                                                       stdfs::perms::others_exec)) != stdfs::perms::none ||
+                              name.rfind("bin/", 0) == 0;
+            entries.push_back({name, false, it->file_size(ec), executable ? 0755u : 0644u});
+        } else {
+            error = "Only regular files and directories are allowed in packages: " + name;
+            return false;
+        }
+    }
+
+    // Directories compare as "<name>/", which puts each one right before
+    // its contents
+    auto key = [](const Entry& entry) { return entry.directory ? entry.name + "/" : entry.name; };
+    std::sort(entries.begin(), entries.end(),
+              [&](const Entry& a, const Entry& b) { return key(a) < key(b); });
+
+    for (const auto& entry : entries) {
+        if (entry.directory) {
+            if (!tar.add_directory(entry.name, entry.mode)) {
+                error = "Failed to write " + entry.name;
+                return false;
+            }
+            continue;
+        }
+        std::ifstream file(stdfs::path(source_dir) / entry.name, std::ios::binary);
+        if (!file || !tar.add_file(entry.name, entry.mode, file, entry.size)) {
+            error = "Failed to pack " + entry.name + " (unreadable, or changed while packing)";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Streaming gzip inflater. Compressed input goes in through write() in
+ * pieces of any size; inflated output is handed to `sink(data, size)`
+ * in STREAM_CHUNK pieces as it is produced. Concatenated gzip members
+ * (as in block-gzip packages) are inflated one after another.
+ */
+class GzipInflater {
+public:
+    GzipInflater() : out_(STREAM_CHUNK) {
+        std::memset(&stream_, 0, sizeof(stream_));
+        // 16 + MAX_WBITS tells zlib to handle gzip format
+        ok_ = inflateInit2(&stream_, 16 + MAX_WBITS) == Z_OK;
+        initialized_ = ok_;
+    }
+
+    ~GzipInflater() {
+        if (initialized_) {
+            inflateEnd(&stream_);
+        }
+    }
+
+    GzipInflater(const GzipInflater&) = delete;
+    GzipInflater& operator=(const GzipInflater&) = delete;
+
+    /**
+     * Inflate `size` more compressed bytes. Returns false on corrupt
+     * input, or as soon as the sink returns false.
+     */
+    template <typename Sink>
+    bool write(const uint8_t* data, size_t size, Sink&& sink) {
+        // Callers pass at most STREAM_CHUNK bytes, well inside avail_in
+        stream_.next_in = const_cast<Bytef*>(data);
+        stream_.avail_in = static_cast<uInt>(size);
+
+        while (ok_ && !trailing_ && (stream_.avail_in > 0 || stream_.avail_out == 0)) {
+            if (done_) {
+                // Another member follows, or the rest is trailing garbage,
+                // which gzip readers ignore
+                if (stream_.avail_in == 0) {
+                    break;
+                }
+                if (stream_.next_in[0] != 0x1f) {
+                    trailing_ = true;
+                    break;
+                }
+                inflateReset(&stream_);
+                done_ = false;
+            }
+
+            stream_.next_out = out_.data();
+            stream_.avail_out = static_cast<uInt>(out_.size());
+
+            int ret = inflate(&stream_, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                ok_ = false;
+                break;
+            }
+
+            size_t have = out_.size() - stream_.avail_out;
+            if (have > 0 && !sink(out_.data(), have)) {
+                ok_ = false;
+                break;
+            }
+
+            if (ret == Z_STREAM_END) {
+                done_ = true;
+            } else if (ret == Z_BUF_ERROR) {
+                break;  // Needs more input
+            }
+        }
+        return ok_;
+    }
+
+    /**
+     * Whether the input so far ends cleanly at the end of a gzip member.
+     * Input after the last member that is not another member is ignored.
+     */
+    bool finished() const { return ok_ && done_; }
+
+private:
+    z_stream stream_;
+    std::vector<uint8_t> out_;
+    bool initialized_ = false;
+    bool ok_ = false;
+    bool done_ = false;
+    bool trailing_ = false;
+};
+
+// ============================================================================
+// BLOCK-GZIP PACKAGES
+// ============================================================================
+//
+// A block-gzip package is a sequence of independent gzip members, each
+// holding BLOCK_SIZE bytes of the tar stream (the last one may be shorter),
+// followed by an empty trailer member. It is plain multi-member gzip, so
+// gzip, tar -z and the streaming path above all read it unchanged; nah
+// uses the extra fields to deflate and inflate blocks in parallel.
+//
+// Every gzip header carries FEXTRA (XLEN, then one subfield):
+//   data member:    'N' 'B', LEN=4:  u32 total member size in bytes
+//   trailer member: 'N' 'I', LEN=20: u32 block size, u64 data member count,
+//                                    u64 uncompressed size
+// All integers are little-endian, as elsewhere in gzip. The trailer is the
+// index: it lets the reader check that no block was lost at a member
+// boundary, which plain gzip cannot detect.
+
+/**
+ * Uncompressed bytes per block-gzip member.
+ */
+constexpr size_t BLOCK_SIZE = 512 * 1024;
+
+/**
+ * Size of a data member's gzip header (fixed header, XLEN, NB subfield).
+ */
+constexpr size_t BLOCK_HEADER_SIZE = 20;
+
+/**
+ * Size of the trailer member.
+ */
+constexpr size_t BLOCK_TRAILER_SIZE = 46;
+
+namespace detail {
+
+inline void put_le(std::vector<uint8_t>& out, std::uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+inline std::uint64_t get_le(const uint8_t* in, size_t bytes) {
+    std::uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Gzip header with FEXTRA holding one subfield of `len` bytes, which the
+// caller appends. mtime 0, no file name, OS 255, per SPEC.md.
+inline void put_gzip_header(std::vector<uint8_t>& out, char si1, char si2, uint16_t len) {
+    const uint8_t fixed[10] = {0x1f, 0x8b, 8, 0x04, 0, 0, 0, 0, 0, 255};
+    out.insert(out.end(), fixed, fixed + 10);
+    put_le(out, 4u + len, 2);
+    out.push_back(static_cast<uint8_t>(si1));
+    out.push_back(static_cast<uint8_t>(si2));
+    put_le(out, len, 2);
+}
+
+// One complete data member for `size` bytes of input
+inline bool deflate_block(const uint8_t* data, size_t size, int level, std::vector<uint8_t>& out) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // Raw deflate; the gzip framing is written here so it can carry NB
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    out.clear();
+    put_gzip_header(out, 'N', 'B', 4);
+    put_le(out, 0, 4);  // Member size, patched below
+
+    size_t bound = deflateBound(&stream, static_cast<uLong>(size));
+    out.resize(BLOCK_HEADER_SIZE + bound);
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out.data() + BLOCK_HEADER_SIZE;
+    stream.avail_out = static_cast<uInt>(bound);
+    int ret = deflate(&stream, Z_FINISH);
+    size_t produced = bound - stream.avail_out;
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END) {
+        return false;
+    }
+    out.resize(BLOCK_HEADER_SIZE + produced);
+
+    put_le(out, crc32(crc32(0L, Z_NULL, 0), data, static_cast<uInt>(size)), 4);
+    put_le(out, size, 4);
+
+    std::uint64_t member_size = out.size();
+    for (size_t i = 0; i < 4; ++i) {
+        out[16 + i] = static_cast<uint8_t>(member_size >> (8 * i));
+    }
+    return true;
+}
+
+inline std::vector<uint8_t> block_trailer(size_t block_size, std::uint64_t members, std::uint64_t total) {
+    std::vector<uint8_t> out;
+    put_gzip_header(out, 'N', 'I', 20);
+    put_le(out, block_size, 4);
+    put_le(out, members, 8);
+    put_le(out, total, 8);
+    const uint8_t empty[10] = {0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0};  // Empty deflate, CRC 0, ISIZE 0
+    out.insert(out.end(), empty, empty + 10);
+    return out;
+}
+
+// Inflate one whole data member into `out`, checking its CRC and size
+inline bool inflate_member(const uint8_t* member, size_t size, std::vector<uint8_t>& out) {
+    if (size < BLOCK_HEADER_SIZE + 8) {
+        return false;
+    }
+    std::uint64_t isize = get_le(member + size - 4, 4);
+    if (isize > (64u << 20)) {
+        return false;  // Not a size nah writes; don't allocate for it
+    }
+    out.resize(static_cast<size_t>(isize));
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = const_cast<Bytef*>(member);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    int ret = inflate(&stream, Z_FINISH);
+    bool ok = ret == Z_STREAM_END && stream.avail_in == 0 && stream.total_out == isize;
+    inflateEnd(&stream);
+    return ok;
+}
+
+} // namespace detail
+
+/**
+ * Writes a block-gzip stream to `out`. Input is cut into BLOCK_SIZE blocks
+ * that are deflated on up to `workers` threads (0 = hardware concurrency),
+ * a batch at a time; the next batch is filled while the previous one
+ * compresses. Output is identical for any worker count.
+ */
+class BlockGzipWriter {
+public:
+    explicit BlockGzipWriter(std::ostream& out, size_t workers = 0,
+                             int level = Z_DEFAULT_COMPRESSION, size_t block_size = BLOCK_SIZE)
+        : out_(out), level_(level), block_size_(block_size) {
+        workers_ = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ~BlockGzipWriter() {
+        if (pending_.valid()) {
+            pending_.wait();
+        }
+    }
+
+    BlockGzipWriter(const BlockGzipWriter&) = delete;
+    BlockGzipWriter& operator=(const BlockGzipWriter&) = delete;
+
+    bool write(const uint8_t* data, size_t size) {
+        while (size > 0 && ok_) {
+            if (batch_.empty() || batch_.back().size() == block_size_) {
+                if (batch_.size() == workers_) {
+                    flush_batch();
+                }
+                batch_.emplace_back();
+                batch_.back().reserve(block_size_);
+            }
+            auto& block = batch_.back();
+            size_t n = std::min(size, block_size_ - block.size());
+            block.insert(block.end(), data, data + n);
+            total_ += n;
+            data += n;
+            size -= n;
+        }
+        return ok_;
+    }
+
+    /**
+     * Compress what is left and write the trailer. Returns false if any
+     * block failed to compress or the output failed.
+     */
+    bool finish() {
+        if (!batch_.empty()) {
+            flush_batch();
+        }
+        collect();
+        if (ok_) {
+            auto trailer = detail::block_trailer(block_size_, members_, total_);
+            out_.write(reinterpret_cast<const char*>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+            out_.flush();
+            ok_ = out_.good();
+        }
+        return ok_;
+    }
+
+private:
+    using Batch = std::vector<std::vector<uint8_t>>;
+
+    // Start compressing the filled batch, after writing out the previous one
+    void flush_batch() {
+        collect();
+        pending_ = std::async(std::launch::async, [this, batch = std::move(batch_)]() mutable {
+            std::atomic<bool> ok{true};
+            Batch members(batch.size());
+            nah::core::detail::parallel_for(batch.size(), workers_, [&](size_t i) {
+                if (!detail::deflate_block(batch[i].data(), batch[i].size(), level_, members[i])) {
+                    ok = false;
+                }
+            });
+            return ok ? members : Batch{};
+        });
+        batch_.clear();
+    }
+
+    // Write out the batch being compressed, if any
+    void collect() {
+        if (!pending_.valid()) {
+            return;
+        }
+        Batch members = pending_.get();
+        if (members.empty()) {
+            ok_ = false;
+        }
+        for (const auto& member : members) {
+            out_.write(reinterpret_cast<const char*>(member.data()), static_cast<std::streamsize>(member.size()));
+            ++members_;
+        }
+        if (!out_) {
+            ok_ = false;
+        }
+    }
+
+    std::ostream& out_;
+    int level_;
+    size_t block_size_;
+    size_t workers_;
+    Batch batch_;
+    std::future<Batch> pending_;
+    std::uint64_t members_ = 0;
+    std::uint64_t total_ = 0;
+    bool ok_ = true;
+};
+
+// ============================================================================
+// ZSTD PACKAGES
+// ============================================================================
+//
+// A zstd package is the same tar stream as a zstd frame (or several
+// concatenated frames) carrying a content checksum. zstd spreads
+// compression over its own worker threads; decompression is a single
+// stream, but fast enough that it no longer dominates an install.
+
+/**
+ * Streaming zstd decompressor, used like GzipInflater: compressed input
+ * goes in through write() in pieces of any size, and decompressed output
+ * is handed to `sink(data, size)` in STREAM_CHUNK pieces.
+ */
+class ZstdInflater {
+public:
+    ZstdInflater() : stream_(ZSTD_createDStream()), out_(STREAM_CHUNK) {
+        ok_ = stream_ != nullptr;
+    }
+
+    ~ZstdInflater() { ZSTD_freeDStream(stream_); }
+
+    ZstdInflater(const ZstdInflater&) = delete;
+    ZstdInflater& operator=(const ZstdInflater&) = delete;
+
+    /**
+     * Decompress `size` more bytes. Returns false on corrupt input, or as
+     * soon as the sink returns false.
+     */
+    template <typename Sink>
+    bool write(const uint8_t* data, size_t size, Sink&& sink) {
+        ZSTD_inBuffer in = {data, size, 0};
+        bool full = false;
+        // A full output buffer may leave more output inside the decoder
+        while (ok_ && (in.pos < in.size || full)) {
+            ZSTD_outBuffer out = {out_.data(), out_.size(), 0};
+            size_t ret = ZSTD_decompressStream(stream_, &out, &in);
+            if (ZSTD_isError(ret)) {
+                ok_ = false;
+                break;
+            }
+            if (out.pos > 0 && !sink(out_.data(), out.pos)) {
+                ok_ = false;
+                break;
+            }
+            full = out.pos == out.size;
+            done_ = ret == 0;
+        }
+        return ok_;
+    }
+
+    /**
+     * Whether the input so far ends cleanly at the end of a frame.
+     */
+    bool finished() const { return ok_ && done_; }
+
+private:
+    ZSTD_DStream* stream_;
+    std::vector<uint8_t> out_;
+    bool ok_ = false;
+    bool done_ = false;
+};
+
+/**
+ * Writes a zstd stream to `out`, compressing on up to `workers` zstd
+ * threads (0 = hardware concurrency). zstd's multithreaded output depends
+ * only on the level, not on the worker count, so packing stays
+ * deterministic; a libzstd built without threads compresses on the
+ * calling thread instead.
+ */
+class ZstdWriter {
+public:
+    explicit ZstdWriter(std::ostream& out, size_t workers = 0, int level = ZSTD_CLEVEL_DEFAULT)
+        : out_(out), stream_(ZSTD_createCCtx()), buffer_(ZSTD_CStreamOutSize()) {
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        ok_ = stream_ != nullptr &&
+              !ZSTD_isError(ZSTD_CCtx_setParameter(stream_, ZSTD_c_compressionLevel, level)) &&
+              !ZSTD_isError(ZSTD_CCtx_setParameter(stream_, ZSTD_c_checksumFlag, 1));
+        if (ok_) {
+            // Fails harmlessly when libzstd has no thread support
+            ZSTD_CCtx_setParameter(stream_, ZSTD_c_nbWorkers, static_cast<int>(std::min<size_t>(workers, 200)));
+        }
+    }
+
+    ~ZstdWriter() { ZSTD_freeCCtx(stream_); }
+
+    ZstdWriter(const ZstdWriter&) = delete;
+    ZstdWriter& operator=(const ZstdWriter&) = delete;
+
+    bool write(const uint8_t* data, size_t size) { return compress(data, size, ZSTD_e_continue); }
+
+    /**
+     * Compress what is buffered and end the frame. Returns false if
+     * compression or the output failed.
+     */
+    bool finish() {
+        if (compress(nullptr, 0, ZSTD_e_end)) {
+            out_.flush();
+            ok_ = out_.good();
+        }
+        return ok_;
+    }
+
+private:
+    bool compress(const uint8_t* data, size_t size, ZSTD_EndDirective mode) {
+        ZSTD_inBuffer in = {data, size, 0};
+        while (ok_) {
+            ZSTD_outBuffer out = {buffer_.data(), buffer_.size(), 0};
+            size_t remaining = ZSTD_compressStream2(stream_, &out, &in, mode);
+            if (ZSTD_isError(remaining)) {
+                ok_ = false;
+                break;
+            }
+            out_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(out.pos));
+            if (!out_) {
+                ok_ = false;
+                break;
+            }
+            if (mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size) {
+                break;
+            }
+        }
+        return ok_;
+    }
+
+    std::ostream& out_;
+    ZSTD_CCtx* stream_;
+    std::vector<uint8_t> buffer_;
+    bool ok_ = false;
+};
+
+// ============================================================================
+// COMPRESSION SELECTION
+// ============================================================================
+
+enum class CompressionFormat { Gzip, Zstd };
+
+/**
+ * Compression for nah pack: format and level.
+ */
+struct Compression {
+    CompressionFormat format = CompressionFormat::Gzip;
+    int level = Z_DEFAULT_COMPRESSION;
+};
+
+/**
+ * Parse "gzip", "zstd", "gzip:<1-9>" or "zstd:<1-max>". Without a level
+ * the format's default is used. Returns nullopt for anything else.
+ */
+inline std::optional<Compression> parse_compression(const std::string& spec) {
+    std::string name = spec.substr(0, spec.find(':'));
+    Compression compression;
+    int max_level = 0;
+    if (name == "gzip") {
+        compression = {CompressionFormat::Gzip, Z_DEFAULT_COMPRESSION};
+        max_level = 9;
+    } else if (name == "zstd") {
+        compression = {CompressionFormat::Zstd, ZSTD_CLEVEL_DEFAULT};
+        max_level = ZSTD_maxCLevel();
+    } else {
+        return std::nullopt;
+    }
+
+    if (name.size() < spec.size()) {
+        std::string level = spec.substr(name.size() + 1);
+        if (level.empty() || level.size() > 2 || level.find_first_not_of("0123456789") != std::string::npos) {
+            return std::nullopt;
+        }
+        compression.level = std::stoi(level);
+        if (compression.level < 1 || compression.level > max_level) {
+            return std::nullopt;
+        }
+    }
+    return compression;
+}
+
+/**
+ * Outcome of extract_package().
+ */
+enum class ExtractStatus {
+    Ok,
+    OpenFailed,        // Package file could not be opened or read
+    DecompressFailed,  // Not gzip or zstd, or the stream is corrupt or truncated
+    ExtractFailed      // Corrupt tar data, or a file could not be written
+};
+
+namespace detail {
+
+// Block-gzip path of extract_package(). Members are read (and hashed) a
+// batch at a time and inflated in parallel while the previous batch is
+// written out.
+inline ExtractStatus extract_block_package(std::istream& in, TarExtractor& tar, size_t workers,
+                                           sha256::Sha256& hash, std::string* error) {
+    using Batch = std::vector<std::vector<uint8_t>>;
+
+    std::uint64_t members = 0;
+    std::uint64_t total = 0;
+    bool trailer_seen = false;
+    std::vector<uint8_t> trailer;
+
+    // Read up to `workers` whole data members; stops at the trailer
+    auto read_batch = [&](Batch& batch) {
+        batch.clear();
+        while (batch.size() < workers && !trailer_seen) {
+            uint8_t header[BLOCK_HEADER_SIZE];
+            if (!in.read(reinterpret_cast<char*>(header), 12)) {
+                return in.gcount() == 0 && in.eof();  // Clean EOF (checked against the trailer)
+            }
+            if (header[0] != 0x1f || header[1] != 0x8b || !(header[3] & 0x04)) {
+                return false;
+            }
+            std::uint64_t xlen = get_le(header + 10, 2);
+            if (xlen == 24) {
+                // Trailer member: NI subfield plus the empty deflate stream
+                trailer.assign(header, header + 12);
+                trailer.resize(BLOCK_TRAILER_SIZE);
+                if (!in.read(reinterpret_cast<char*>(trailer.data() + 12), BLOCK_TRAILER_SIZE - 12) ||
+                    trailer[12] != 'N' || trailer[13] != 'I') {
+                    return false;
+                }
+                hash.update(trailer.data(), trailer.size());
+                trailer_seen = true;
+                break;
+            }
+            if (xlen != 8 || !in.read(reinterpret_cast<char*>(header + 12), 8) ||
+                header[12] != 'N' || header[13] != 'B') {
+                return false;
+            }
+            std::uint64_t size = get_le(header + 16, 4);
+            if (size < BLOCK_HEADER_SIZE + 8 || size > (64u << 20)) {
+                return false;
+            }
+            batch.emplace_back(header, header + BLOCK_HEADER_SIZE);
+            batch.back().resize(static_cast<size_t>(size));
+            if (!in.read(reinterpret_cast<char*>(batch.back().data() + BLOCK_HEADER_SIZE),
+                         static_cast<std::streamsize>(size - BLOCK_HEADER_SIZE))) {
+                return false;
+            }
+            hash.update(batch.back().data(), batch.back().size());
+        }
+        return true;
+    };
+
+    auto inflate_batch = [workers](Batch compressed) {
+        Batch blocks(compressed.size());
+        std::atomic<bool> ok{true};
+        nah::core::detail::parallel_for(compressed.size(), workers, [&](size_t i) {
+            if (!inflate_member(compressed[i].data(), compressed[i].size(), blocks[i])) {
+                ok = false;
+            }
+        });
+        return std::make_pair(ok.load(), std::move(blocks));
+    };
+
+    Batch compressed;
+    if (!read_batch(compressed)) {
+        return ExtractStatus::DecompressFailed;
+    }
+    auto current = inflate_batch(std::move(compressed));
+
+    while (true) {
+        if (!current.first) {
+            return ExtractStatus::DecompressFailed;
+        }
+        if (current.second.empty()) {
+            break;
+        }
+
+        // Inflate the next batch while this one is extracted
+        Batch next;
+        if (!read_batch(next)) {
+            return ExtractStatus::DecompressFailed;
+        }
+        auto pending = std::async(std::launch::async, inflate_batch, std::move(next));
+
+        for (const auto& block : current.second) {
+            members += 1;
+            total += block.size();
+            if (!tar.write(block.data(), block.size())) {
+                pending.wait();
+                if (error) *error = tar.error();
+                return ExtractStatus::ExtractFailed;
+            }
+        }
+        current = pending.get();
+    }
+
+    if (!trailer_seen || get_le(trailer.data() + 20, 8) != members || get_le(trailer.data() + 28, 8) != total) {
+        return ExtractStatus::DecompressFailed;  // Members lost or added
+    }
+    return ExtractStatus::Ok;
+}
+
+// Whether the stream starts with a zstd frame
+inline bool is_zstd(const uint8_t* header, size_t size) {
+    return size >= 4 && get_le(header, 4) == ZSTD_MAGICNUMBER;
+}
+
+// Whether the stream starts with a block-gzip data or trailer member
+inline bool is_block_gzip(const uint8_t* header, size_t size) {
+    return size >= 14 && header[0] == 0x1f && header[1] == 0x8b && (header[3] & 0x04) &&
+           header[12] == 'N' && (header[13] == 'B' || header[13] == 'I');
+}
+
+// Streaming path of extract_package(): read and hash, decompress through
+// `inflater` (GzipInflater or ZstdInflater) and extract, a chunk at a time
+template <typename Inflater>
+ExtractStatus extract_stream(std::istream& in, Inflater& inflater, TarExtractor& tar, sha256::Sha256& hash,
+                             std::string* error) {
+    auto to_tar = [&](const uint8_t* data, size_t size) { return tar.write(data, size); };
+
+    std::vector<uint8_t> buffer(STREAM_CHUNK);
+    while (in) {
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        size_t n = static_cast<size_t>(in.gcount());
+        if (n == 0) {
+            break;
+        }
+        hash.update(buffer.data(), n);
+        if (!inflater.write(buffer.data(), n, to_tar)) {
+            if (!tar.error().empty()) {
+                if (error) *error = tar.error();
+                return ExtractStatus::ExtractFailed;
+            }
+            return ExtractStatus::DecompressFailed;
+        }
+    }
+    if (in.bad()) {
+        return ExtractStatus::OpenFailed;
+    }
+    if (!inflater.finished()) {
+        return ExtractStatus::DecompressFailed;
+    }
+    return ExtractStatus::Ok;
+}
+
+} // namespace detail
+
+/**
+ * Extract a package into `dest_dir`, telling gzip from zstd by the magic
+ * bytes. Block-gzip packages are inflated on up to `workers` threads
+ * (0 = hardware concurrency); zstd and any other gzip stream are read,
+ * decompressed and extracted in fixed-size chunks. `package_hash`, if
+ * given, receives the SHA-256 of the package file, computed from the same
+ * reads. On failure `dest_dir` may be partially populated; `error`
+ * receives details where there are any.
+ */
+inline ExtractStatus extract_package(const std::string& package_path, const std::string& dest_dir,
+                                     std::string* error = nullptr, sha256::Digest* package_hash = nullptr,
+                                     size_t workers = 0) {
+    std::ifstream in(package_path, std::ios::binary);
+    if (!in) {
+        return ExtractStatus::OpenFailed;
+    }
+
+    TarExtractor tar(dest_dir);
+    sha256::Sha256 hash;
+
+    uint8_t magic[14] = {};
+    in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    bool block_gzip = detail::is_block_gzip(magic, static_cast<size_t>(in.gcount()));
+    bool zstd = detail::is_zstd(magic, static_cast<size_t>(in.gcount()));
+    in.clear();
+    in.seekg(0);
+
+    if (block_gzip) {
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        auto status = detail::extract_block_package(in, tar, workers, hash, error);
+        if (status != ExtractStatus::Ok) {
+            return in.bad() ? ExtractStatus::OpenFailed : status;
+        }
+
+        // Anything after the trailer still belongs to the package bytes
+        std::vector<uint8_t> rest(STREAM_CHUNK);
+        while (in.read(reinterpret_cast<char*>(rest.data()), static_cast<std::streamsize>(rest.size())) ||
+               in.gcount() > 0) {
+            hash.update(rest.data(), static_cast<size_t>(in.gcount()));
+        }
+    } else if (zstd) {
+        ZstdInflater inflater;
+        auto status = detail::extract_stream(in, inflater, tar, hash, error);
+        if (status != ExtractStatus::Ok) {
+            return status;
+        }
+    } else {
+        GzipInflater inflater;
+        auto status = detail::extract_stream(in, inflater, tar, hash, error);
+        if (status != ExtractStatus::Ok) {
+            return status;
+        }
+    }
+
+    if (!tar.finish()) {
+        if (error) *error = tar.error();
+        return ExtractStatus::ExtractFailed;
+    }
+    if (package_hash) {
+        *package_hash = hash.finish();
+    }
+    return ExtractStatus::Ok;
+}
+
+} // namespace nah::cli::package
@@ -0,0 +1,274 @@
+/**
+ * NAH CLI - SHA-256
+ *
+ * Incremental SHA-256 for hashing packages and installed files as they
+ * stream past. The block function uses the SHA extensions on x86 (checked
+ * at runtime) and the ARMv8 crypto extensions on AArch64 (when the
+ * compiler targets them, as it does by default on Apple silicon), and a
+ * portable implementation everywhere else.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NAH_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define NAH_SHA256_ARM 1
+#include <arm_neon.h>
+#endif
+
+namespace nah::cli::sha256 {
+
+using Digest = std::array<uint8_t, 32>;
+
+namespace detail {
+
+alignas(16) inline constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Process `count` 64-byte blocks
+using BlockFn = void (*)(uint32_t state[8], const uint8_t* data, size_t count);
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline void blocks_portable(uint32_t state[8], const uint8_t* data, size_t count) {
+    for (; count > 0; --count, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<uint32_t>(data[4 * i]) << 24 | static_cast<uint32_t>(data[4 * i + 1]) << 16 |
+                   static_cast<uint32_t>(data[4 * i + 2]) << 8 | static_cast<uint32_t>(data[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if defined(NAH_SHA256_X86)
+
+// SHA-NI: each sha256rnds2 does two rounds on the state held as ABEF/CDGH
+__attribute__((target("sha,sse4.1"))) inline void blocks_x86(uint32_t state[8], const uint8_t* data,
+                                                              size_t count) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+    for (; count > 0; --count, data += 64) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+        __m128i w[4];
+
+        // 16 groups of 4 rounds; the message schedule runs three groups ahead
+        for (int g = 0; g < 16; ++g) {
+            int cur = g % 4;
+            if (g < 4) {
+                w[cur] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), mask);
+            }
+            __m128i msg = _mm_add_epi32(w[cur], _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * g])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g <= 14) {
+                int next = (g + 1) % 4;
+                w[next] = _mm_add_epi32(w[next], _mm_alignr_epi8(w[cur], w[(g + 3) % 4], 4));
+                w[next] = _mm_sha256msg2_epu32(w[next], w[cur]);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            if (g >= 1 && g <= 12) {
+                w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], w[cur]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);      // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);   // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);  // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);   // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+inline bool cpu_has_sha() {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) {
+        return false;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29));
+}
+
+#elif defined(NAH_SHA256_ARM)
+
+inline void blocks_arm(uint32_t state[8], const uint8_t* data, size_t count) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    for (; count > 0; --count, data += 64) {
+        uint32x4_t abcd = state0;
+        uint32x4_t efgh = state1;
+        uint32x4_t w[4];
+        for (int i = 0; i < 4; ++i) {
+            w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+
+        // 16 groups of 4 rounds, extending the schedule in place
+        for (int g = 0; g < 16; ++g) {
+            int cur = g % 4;
+            uint32x4_t msg = vaddq_u32(w[cur], vld1q_u32(&K[4 * g]));
+            if (g < 12) {
+                w[cur] = vsha256su0q_u32(w[cur], w[(g + 1) % 4]);
+            }
+            uint32x4_t saved = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, saved, msg);
+            if (g < 12) {
+                w[cur] = vsha256su1q_u32(w[cur], w[(g + 2) % 4], w[(g + 3) % 4]);
+            }
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+#endif
+
+/**
+ * The fastest block function this CPU supports.
+ */
+inline BlockFn select_blocks() {
+#if defined(NAH_SHA256_X86)
+    static const BlockFn fn = cpu_has_sha() ? blocks_x86 : blocks_portable;
+    return fn;
+#elif defined(NAH_SHA256_ARM)
+    return blocks_arm;
+#else
+    return blocks_portable;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * Incremental SHA-256. update() any number of times, then finish() once.
+ */
+class Sha256 {
+public:
+    explicit Sha256(detail::BlockFn blocks = detail::select_blocks()) : blocks_(blocks) {}
+
+    void update(const void* data, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        length_ += size;
+
+        if (buffer_fill_ > 0) {
+            size_t n = std::min(size, sizeof(buffer_) - buffer_fill_);
+            std::memcpy(buffer_ + buffer_fill_, bytes, n);
+            buffer_fill_ += n;
+            bytes += n;
+            size -= n;
+            if (buffer_fill_ < sizeof(buffer_)) {
+                return;
+            }
+            blocks_(state_, buffer_, 1);
+            buffer_fill_ = 0;
+        }
+
+        if (size >= 64) {
+            blocks_(state_, bytes, size / 64);
+            bytes += size & ~size_t{63};
+            size &= 63;
+        }
+        std::memcpy(buffer_, bytes, size);
+        buffer_fill_ = size;
+    }
+
+    Digest finish() {
+        uint64_t bits = length_ * 8;
+        uint8_t pad[72] = {0x80};
+        size_t pad_size = (buffer_fill_ < 56 ? 56 : 120) - buffer_fill_;
+        for (int i = 0; i < 8; ++i) {
+            pad[pad_size + static_cast<size_t>(i)] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(pad, pad_size + 8);
+
+        Digest digest;
+        for (size_t i = 0; i < 8; ++i) {
+            digest[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+        }
+        return digest;
+    }
+
+private:
+    detail::BlockFn blocks_;
+    uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t buffer_[64] = {};
+    size_t buffer_fill_ = 0;
+    uint64_t length_ = 0;
+};
+
+/**
+ * Lowercase hex, as written after "sha256:" in install records.
+ */
+inline std::string to_hex(const Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(64);
+    for (uint8_t byte : digest) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 15]);
+    }
+    return hex;
+}
+
+} // namespace nah::cli::sha256